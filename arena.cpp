@@ -0,0 +1,201 @@
+#include "arena.h"
+#include "bin.h"
+
+struct PoolBlock {
+  struct PoolBlock *next;
+};
+
+struct PoolNode {
+  struct PoolNode *next;
+};
+
+struct LargeSlots {
+  struct LargeSlots *prev;
+  struct LargeSlots *next;
+};
+
+// Keep nodes pointer aligned after the block and large slot headers.
+#define PoolAlign(size_) (((size_) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+#define PoolBlockNodes(block_) ((char *)(block_) + PoolAlign(sizeof(struct PoolBlock)))
+#define LargeSlotsHeader PoolAlign(sizeof(struct LargeSlots))
+
+void InitPool(struct Pool *pool, struct Arena *arena, size_t nodeSize) {
+  memset(pool, 0, sizeof(*pool));
+  pool->arena = arena;
+  pool->nodeSize = PoolAlign(nodeSize < sizeof(struct PoolNode) ? sizeof(struct PoolNode) : nodeSize);
+  pool->nodesPerBlock = (int)(POOL_BLOCK_BYTES / pool->nodeSize);
+  if (pool->nodesPerBlock < 1)
+    pool->nodesPerBlock = 1;
+}
+
+void ResetPool(struct Pool *pool) {
+  pool->current = pool->blocks;
+  pool->currentUsed = 0;
+  pool->freeList = NULL;
+  pool->liveCount = 0;
+}
+
+void ReleasePool(struct Pool *pool) {
+  struct PoolBlock *block = pool->blocks;
+  while (block != NULL) {
+    struct PoolBlock *next = block->next;
+    FreeBytes(block);
+    block = next;
+  }
+  pool->blocks = NULL;
+  ResetPool(pool);
+}
+
+void *PoolAllocate(struct Pool *pool) {
+  AssertNotNull(pool);
+
+  void *node;
+  if (pool->freeList != NULL) {
+    node = pool->freeList;
+    pool->freeList = pool->freeList->next;
+  } else {
+    if (pool->current == NULL || pool->currentUsed == pool->nodesPerBlock) {
+      if (pool->current != NULL && pool->current->next != NULL) {
+        pool->current = pool->current->next;
+      } else {
+        size_t blockBytes = PoolAlign(sizeof(struct PoolBlock)) + pool->nodeSize * pool->nodesPerBlock;
+        struct PoolBlock *block = (struct PoolBlock *)AllocateBytes(blockBytes, 1, "PoolBlock");
+        if (pool->current != NULL)
+          pool->current->next = block;
+        else
+          pool->blocks = block;
+        pool->current = block;
+      }
+      pool->currentUsed = 0;
+    }
+    node = PoolBlockNodes(pool->current) + pool->nodeSize * pool->currentUsed++;
+  }
+
+  memset(node, 0, pool->nodeSize);
+  pool->liveCount++;
+  allocationStats.poolAllocations++;
+  return node;
+}
+
+void PoolFree(struct Pool *pool, void *node) {
+  AssertNotNull(pool);
+  AssertNotNull(node);
+  AssertGreater(pool->liveCount, 0);
+
+  struct PoolNode *freeNode = (struct PoolNode *)node;
+  freeNode->next = pool->freeList;
+  pool->freeList = freeNode;
+  pool->liveCount--;
+  allocationStats.poolFrees++;
+}
+
+int SlotClass(int count) {
+  int slotClass = 0;
+  while (slotClass < ARENA_SLOT_CLASSES && (ARENA_MIN_SLOTS << slotClass) < count)
+    slotClass++;
+  return slotClass;
+}
+
+int ArenaSlotCapacity(int count) {
+  int slotClass = SlotClass(count);
+  if (slotClass < ARENA_SLOT_CLASSES)
+    return ARENA_MIN_SLOTS << slotClass;
+  return count;
+}
+
+struct Bin **ArenaAllocateSlots(struct Arena *arena, int count) {
+  AssertNotNull(arena);
+
+  int slotClass = SlotClass(count);
+  if (slotClass < ARENA_SLOT_CLASSES)
+    return (struct Bin **)PoolAllocate(&arena->slots[slotClass]);
+
+  struct LargeSlots *large =
+      (struct LargeSlots *)AllocateBytes(LargeSlotsHeader + count * sizeof(struct Bin *), 1, "LargeSlots");
+  large->next = arena->largeSlots;
+  if (arena->largeSlots != NULL)
+    arena->largeSlots->prev = large;
+  arena->largeSlots = large;
+  return (struct Bin **)((char *)large + LargeSlotsHeader);
+}
+
+void ArenaFreeSlots(struct Arena *arena, struct Bin **slots, int count) {
+  AssertNotNull(arena);
+
+  if (slots == NULL)
+    return;
+
+  int slotClass = SlotClass(count);
+  if (slotClass < ARENA_SLOT_CLASSES) {
+    PoolFree(&arena->slots[slotClass], slots);
+    return;
+  }
+
+  struct LargeSlots *large = (struct LargeSlots *)((char *)slots - LargeSlotsHeader);
+  if (large->prev != NULL)
+    large->prev->next = large->next;
+  else
+    arena->largeSlots = large->next;
+  if (large->next != NULL)
+    large->next->prev = large->prev;
+  FreeBytes(large);
+}
+
+int ArenaItemSlots(size_t size, int count) {
+  return (int)((size * count + sizeof(struct Bin *) - 1) / sizeof(struct Bin *));
+}
+
+void *ArenaAllocateItems(struct Arena *arena, size_t size, int count) {
+  return ArenaAllocateSlots(arena, ArenaItemSlots(size, count));
+}
+
+void ArenaFreeItems(struct Arena *arena, void *items, size_t size, int count) {
+  ArenaFreeSlots(arena, (struct Bin **)items, ArenaItemSlots(size, count));
+}
+
+void ReleaseLargeSlots(struct Arena *arena) {
+  struct LargeSlots *large = arena->largeSlots;
+  while (large != NULL) {
+    struct LargeSlots *next = large->next;
+    FreeBytes(large);
+    large = next;
+  }
+  arena->largeSlots = NULL;
+}
+
+void InitArena(struct Arena *arena) {
+  InitPool(&arena->cells, arena, sizeof(struct Cell));
+  InitPool(&arena->shelves, arena, sizeof(struct Shelf));
+  InitPool(&arena->grids, arena, sizeof(struct Grid));
+  InitPool(&arena->swirls, arena, sizeof(struct Swirl));
+  InitPool(&arena->stacks, arena, sizeof(struct Stack));
+  for (int slotClass = 0; slotClass < ARENA_SLOT_CLASSES; slotClass++)
+    InitPool(&arena->slots[slotClass], arena, (ARENA_MIN_SLOTS << slotClass) * sizeof(struct Bin *));
+  arena->largeSlots = NULL;
+}
+
+void ResetArena(struct Arena *arena) {
+  AssertNotNull(arena);
+
+  ResetPool(&arena->cells);
+  ResetPool(&arena->shelves);
+  ResetPool(&arena->grids);
+  ResetPool(&arena->swirls);
+  ResetPool(&arena->stacks);
+  for (int slotClass = 0; slotClass < ARENA_SLOT_CLASSES; slotClass++)
+    ResetPool(&arena->slots[slotClass]);
+  ReleaseLargeSlots(arena);
+}
+
+void ReleaseArena(struct Arena *arena) {
+  AssertNotNull(arena);
+
+  ReleasePool(&arena->cells);
+  ReleasePool(&arena->shelves);
+  ReleasePool(&arena->grids);
+  ReleasePool(&arena->swirls);
+  ReleasePool(&arena->stacks);
+  for (int slotClass = 0; slotClass < ARENA_SLOT_CLASSES; slotClass++)
+    ReleasePool(&arena->slots[slotClass]);
+  ReleaseLargeSlots(arena);
+}
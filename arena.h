@@ -0,0 +1,64 @@
+#pragma once
+
+#include "core.h"
+
+// Bins are allocated from a per-monitor Arena: one fixed-size Pool per node type plus size-classed pools for the
+// Bin * slot arrays of shelves and grids. Pools carve nodes out of large blocks and recycle them through free lists,
+// so editing or rebuilding a tree costs almost no heap traffic. Destroying a whole tree is a ResetArena (keep the
+// blocks for the next build) or a ReleaseArena (return them to the heap), without visiting any nodes.
+
+#define POOL_BLOCK_BYTES (32 * 1024)
+
+// Slot arrays hold ARENA_MIN_SLOTS << class pointers; anything larger goes straight to the heap.
+#define ARENA_MIN_SLOTS 4
+#define ARENA_SLOT_CLASSES 12
+
+struct PoolBlock;
+struct PoolNode;
+struct LargeSlots;
+
+struct Pool {
+  struct Arena *arena;
+
+  size_t nodeSize;
+  int nodesPerBlock;
+
+  // Blocks are kept oldest first; nodes are bumped out of current until it runs out, then recycled via freeList.
+  struct PoolBlock *blocks;
+  struct PoolBlock *current;
+  int currentUsed;
+
+  struct PoolNode *freeList;
+
+  int liveCount;
+};
+
+struct Arena {
+  struct Pool cells;
+  struct Pool shelves;
+  struct Pool grids;
+  struct Pool swirls;
+  struct Pool stacks;
+
+  struct Pool slots[ARENA_SLOT_CLASSES];
+  struct LargeSlots *largeSlots;
+};
+
+void InitArena(struct Arena *arena);
+void ResetArena(struct Arena *arena);
+void ReleaseArena(struct Arena *arena);
+
+void *PoolAllocate(struct Pool *pool);
+void PoolFree(struct Pool *pool, void *node);
+
+// Rounds count up to the number of slots ArenaAllocateSlots really provides, so containers can grow into them.
+int ArenaSlotCapacity(int count);
+
+// Returns a zeroed array of at least count slots. The same count must be passed back when it is freed.
+struct Bin **ArenaAllocateSlots(struct Arena *arena, int count);
+void ArenaFreeSlots(struct Arena *arena, struct Bin **slots, int count);
+
+// As ArenaAllocateSlots, for a zeroed array of count items of size bytes, carved from the same pools. The same size and
+// count must be passed back when it is freed.
+void *ArenaAllocateItems(struct Arena *arena, size_t size, int count);
+void ArenaFreeItems(struct Arena *arena, void *items, size_t size, int count);
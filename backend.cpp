@@ -0,0 +1,86 @@
+#include "backend.h"
+#include "drawlist.h"
+#include "placement.h"
+
+struct Backend *backend;
+
+const struct LineStyleInfo lineStyles[LineStyle_Count] = {
+    {0xff1f1fff, 2.5f, false},
+    {0xff808080, 3.0f, true},
+    {0xfff3a116, 3.5f, true},
+    {0x3c404040, 3.5f, true},
+};
+
+void DrawText(int x, int y, int size, const char *text) {
+  if (drawRecording) {
+    DrawListAdd(drawRecording, DrawCommand_Text, DrawStyle_Text, size, x, y, 0, 0, text);
+    return;
+  }
+
+  AssertNotNull(backend);
+  if (backend->drawTextFn)
+    backend->drawTextFn(x, y, size, text);
+}
+
+void DrawLine(struct Point from, struct Point to, enum LineStyle style) {
+  if (drawRecording) {
+    DrawListAdd(drawRecording, DrawCommand_Line, style, 0, from.x, from.y, to.x, to.y, NULL);
+    return;
+  }
+
+  AssertNotNull(backend);
+  if (backend->drawLineFn)
+    backend->drawLineFn(from, to, style);
+}
+
+void DrawRoundedRectangle(struct Bounds bounds, int diameter, enum LineStyle style) {
+  if (drawRecording) {
+    DrawListAdd(drawRecording, DrawCommand_RoundedRectangle, style, diameter, bounds.x, bounds.y, bounds.width,
+                bounds.height, NULL);
+    return;
+  }
+
+  AssertNotNull(backend);
+  if (backend->drawRoundedRectangleFn)
+    backend->drawRoundedRectangleFn(bounds, diameter, style);
+}
+
+void DrawRectangle(struct Bounds bounds, enum LineStyle style) {
+  if (drawRecording) {
+    DrawListAdd(drawRecording, DrawCommand_Rectangle, style, 0, bounds.x, bounds.y, bounds.width, bounds.height, NULL);
+    return;
+  }
+
+  AssertNotNull(backend);
+  if (backend->drawRectangleFn)
+    backend->drawRectangleFn(bounds, style);
+}
+
+void PlaceWindow(WindowHandle hWnd, struct Bounds bounds) {
+  AssertNotNull(backend);
+  if (backend->placeWindowFn)
+    backend->placeWindowFn(hWnd, bounds);
+}
+
+void PlaceWindows(const struct WindowPlacement *placements, int count) {
+  if (count == 0)
+    return;
+
+  AssertNotNull(backend);
+  if (backend->placeWindowsFn) {
+    backend->placeWindowsFn(placements, count);
+    return;
+  }
+
+  for (int index = 0; index < count; index++)
+    PlaceWindow(placements[index].hWnd, placements[index].bounds);
+}
+
+void StackWindows(const struct WindowStacking *stackings, int count) {
+  if (count == 0)
+    return;
+
+  AssertNotNull(backend);
+  if (backend->stackWindowsFn)
+    backend->stackWindowsFn(stackings, count);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "core.h"
+
+// Opaque handle to a top level window, owned by the backend. On Win32 this is an HWND.
+typedef void *WindowHandle;
+
+struct DrawCommand;
+struct ResourceCache;
+struct WindowPlacement;
+
+enum WindowShow { WindowShow_Keep, WindowShow_Show, WindowShow_Hide };
+
+// Puts a window just below another in the z-order, or above all the others when above is NULL, showing it first if
+// asked to. A window being hidden is left where it is in the z-order, and above is ignored.
+struct WindowStacking {
+  WindowHandle hWnd;
+  WindowHandle above;
+  enum WindowShow show;
+};
+
+// The window system the layout core draws to and moves windows with. Win32 lives in windy.cpp; the headless backend
+// in headless.cpp records the same calls in memory so layout can be driven without a desktop session.
+struct Backend {
+  const char *name;
+
+  void (*drawLineFn)(struct Point from, struct Point to, enum LineStyle style);
+  void (*drawRectangleFn)(struct Bounds bounds, enum LineStyle style);
+  void (*drawRoundedRectangleFn)(struct Bounds bounds, int diameter, enum LineStyle style);
+  void (*drawTextFn)(int x, int y, int size, const char *text);
+
+  // Draws a batch of recorded commands that share one style, resolving text offsets against text. Optional: without
+  // it the commands are replayed through the functions above.
+  void (*drawCommandsFn)(const struct DrawCommand *commands, int count, const char *text);
+
+  void (*placeWindowFn)(WindowHandle hWnd, struct Bounds bounds);
+
+  // Moves several windows at once, so the window system can apply them together. Optional: without it each window is
+  // placed through placeWindowFn.
+  void (*placeWindowsFn)(const struct WindowPlacement *placements, int count);
+
+  // Restacks, shows and hides windows in one batch, applying the stackings in order. Optional: without it windows
+  // stay as they are.
+  void (*stackWindowsFn)(const struct WindowStacking *stackings, int count);
+
+  // The pens, fonts and text the draw functions look up, or NULL for a backend that keeps none.
+  struct ResourceCache *resources;
+};
+
+extern struct Backend *backend;
+
+// How each LineStyle looks, shared by every backend: an ARGB colour, a pen width in pixels and whether the line is
+// dash-dotted. Pens are inset, so outlines stay inside the bounds they are drawn for.
+struct LineStyleInfo {
+  unsigned int color;
+  float width;
+  bool dashed;
+};
+
+extern const struct LineStyleInfo lineStyles[LineStyle_Count];
+
+void DrawText(int x, int y, int size, const char *text);
+void DrawLine(struct Point from, struct Point to, enum LineStyle style);
+void DrawRoundedRectangle(struct Bounds bounds, int diameter, enum LineStyle style);
+void DrawRectangle(struct Bounds bounds, enum LineStyle style);
+
+void PlaceWindow(WindowHandle hWnd, struct Bounds bounds);
+void PlaceWindows(const struct WindowPlacement *placements, int count);
+void StackWindows(const struct WindowStacking *stackings, int count);
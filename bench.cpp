@@ -0,0 +1,3001 @@
+#include <atomic>
+#include <chrono>
+#include <stdarg.h>
+#include <stdio.h>
+#include <thread>
+
+#include "bin.h"
+#include "damage.h"
+#include "headless.h"
+#include "hitindex.h"
+#include "inputqueue.h"
+#include "layout.h"
+#include "movepool.h"
+#include "patch.h"
+#include "placement.h"
+#include "raster.h"
+#include "resources.h"
+#include "rules.h"
+#include "snapshot.h"
+#include "tracker.h"
+#include "void.h"
+#include "watcher.h"
+
+// Runs the layout core against the headless backend and reports throughput. Pass benchmark names on the command line
+// to run a subset.
+
+#define BENCH_WIDTH 3840
+#define BENCH_HEIGHT 2160
+
+double BenchSeconds() {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+unsigned int benchSeed = 1;
+
+int BenchRandom(int limit) {
+  benchSeed = benchSeed * 1664525 + 1013904223;
+  return (int)((benchSeed >> 8) % (unsigned int)limit);
+}
+
+struct Point BenchRandomPoint() { return MakePoint(BenchRandom(BENCH_WIDTH), BenchRandom(BENCH_HEIGHT)); }
+
+struct Bounds BenchScreen() {
+  struct Bounds bounds = {0, 0, BENCH_WIDTH, BENCH_HEIGHT};
+  return bounds;
+}
+
+void BenchReport(const char *name, const char *phase, int count, const char *unit, double seconds) {
+  printf("%-12s %-10s %9d %-8s %10.3f ms %14.0f %s/s\n", name, phase, count, unit, seconds * 1000.0, count / seconds,
+         unit);
+}
+
+// Checks that failed across the whole run. A failed check is reported and counted, and makes main return an error once
+// every selected benchmark has run, so a regression fails the run rather than only changing a printed number.
+int benchFailures;
+
+bool BenchCheck(const char *name, const char *check, bool passed) {
+  if (!passed) {
+    fprintf(stderr, "%-12s %-10s FAILED\n", name, check);
+    benchFailures++;
+  }
+  return passed;
+}
+
+void BenchReportAllocations(const char *name, const char *phase, struct AllocationStats before) {
+  printf("%-12s %-10s %9lld heap allocs %9lld heap frees %9lld pool allocs %9lld pool frees\n", name, phase,
+         allocationStats.heapAllocations - before.heapAllocations, allocationStats.heapFrees - before.heapFrees,
+         allocationStats.poolAllocations - before.poolAllocations, allocationStats.poolFrees - before.poolFrees);
+}
+
+void BenchReportLayout(const char *name, const char *phase, struct LayoutStats before) {
+  long long passes = layoutStats.passes - before.passes;
+  printf("%-12s %-10s %9lld passes %12.1f visited/pass %12.1f skipped/pass\n", name, phase, passes,
+         (double)(layoutStats.visited - before.visited) / passes,
+         (double)(layoutStats.skipped - before.skipped) / passes);
+}
+
+int BenchPrimitives() {
+  return headless.lineCount + headless.rectangleCount + headless.roundedRectangleCount + headless.textCount;
+}
+
+// Synthetic trees alternate horizontal shelves, vertical shelves and grids, splitting every cell at each level.
+
+struct BenchTree {
+  struct Arena *arena;
+  int depth;
+  int fanout;
+  int binCount;
+};
+
+struct Bin *BenchBranch(struct BenchTree *tree, int level);
+
+void BenchSplitCell(struct BenchTree *tree, struct Bin *bin, int level) {
+  tree->binCount++;
+  if (level < tree->depth) {
+    struct Cell *cell = Unwrap(struct Cell, bin, bin);
+    CellSetSubBin(cell, BenchBranch(tree, level));
+  }
+}
+
+struct Bin *BenchBranch(struct BenchTree *tree, int level) {
+  tree->binCount++;
+
+  if (level % 3 == 2) {
+    struct Grid *grid = NewGrid(tree->arena);
+    for (int column = 1; column < (tree->fanout + 1) / 2; column++)
+      GridInsertColumn(grid, column);
+    GridInsertRow(grid, 1);
+
+    for (int index = 0; index < grid->rowCount * grid->columnCount; index++)
+      BenchSplitCell(tree, grid->bins[index], level + 1);
+    return Wrap(grid, bin);
+  }
+
+  enum ShelfDirection direction = level % 3 == 0 ? ShelfDirection_Horizontal : ShelfDirection_Vertical;
+  struct Shelf *shelf = NewShelf(tree->arena, direction, tree->fanout);
+  for (int slot = 0; slot < shelf->slotCount; slot++)
+    BenchSplitCell(tree, shelf->bins[slot], level + 1);
+  return Wrap(shelf, bin);
+}
+
+void BenchTreePhases(int depth, int fanout) {
+  struct Arena arena;
+  InitArena(&arena);
+
+  struct BenchTree tree = {&arena, depth, fanout, 0};
+  char name[32];
+  snprintf(name, sizeof(name), "tree-%dx%d", depth, fanout);
+
+  struct AllocationStats before = allocationStats;
+  double start = BenchSeconds();
+  struct Bin *root = BenchBranch(&tree, 0);
+  BenchReport(name, "build", tree.binCount, "bins", BenchSeconds() - start);
+  BenchReportAllocations(name, "build", before);
+
+  // Nudging the root width every pass forces every bin to be laid out again; an unchanged root skips the tree.
+  const int layoutPasses = 20;
+  struct LayoutStats beforeLayout = layoutStats;
+  start = BenchSeconds();
+  for (int pass = 0; pass < layoutPasses; pass++) {
+    struct Bounds bounds = BenchScreen();
+    bounds.width -= (pass + 1) & 1;
+    LayoutRoot(root, bounds);
+  }
+  BenchReport(name, "layout", tree.binCount * layoutPasses, "bins", BenchSeconds() - start);
+  BenchReportLayout(name, "layout", beforeLayout);
+
+  beforeLayout = layoutStats;
+  start = BenchSeconds();
+  for (int pass = 0; pass < layoutPasses; pass++)
+    LayoutRoot(root, BenchScreen());
+  BenchReport(name, "relayout", layoutPasses, "passes", BenchSeconds() - start);
+  BenchReportLayout(name, "relayout", beforeLayout);
+
+  const int mouseMoves = 100000;
+  beforeLayout = layoutStats;
+  start = BenchSeconds();
+  for (int move = 0; move < mouseMoves; move++)
+    DispatchMouse(root, BenchRandomPoint(), 0);
+  BenchReport(name, "input", mouseMoves, "events", BenchSeconds() - start);
+  BenchReportLayout(name, "input", beforeLayout);
+
+  // Splitting a leaf only lays out the path down to it.
+  const int splits = 1000;
+  beforeLayout = layoutStats;
+  start = BenchSeconds();
+  for (int split = 0; split < splits; split++) {
+    DispatchMouse(root, BenchRandomPoint(), 0);
+    DispatchKey(root, split & 1 ? 'H' : 'V', false);
+  }
+  BenchReport(name, "split", splits, "edits", BenchSeconds() - start);
+  BenchReportLayout(name, "split", beforeLayout);
+
+  const int drawPasses = 20;
+  HeadlessReset();
+  start = BenchSeconds();
+  for (int pass = 0; pass < drawPasses; pass++)
+    DrawRoot(root, BenchScreen());
+  double drawSeconds = BenchSeconds() - start;
+  BenchReport(name, "draw", BenchPrimitives(), "prims", drawSeconds);
+
+  before = allocationStats;
+  start = BenchSeconds();
+  DestroyBin(root);
+  BenchReport(name, "teardown", tree.binCount, "bins", BenchSeconds() - start);
+  BenchReportAllocations(name, "teardown", before);
+
+  // Rebuilding into the same arena after a bulk reset should not touch the heap at all.
+  tree.binCount = 0;
+  before = allocationStats;
+  start = BenchSeconds();
+  ResetArena(&arena);
+  root = BenchBranch(&tree, 0);
+  BenchReport(name, "rebuild", tree.binCount, "bins", BenchSeconds() - start);
+  BenchReportAllocations(name, "rebuild", before);
+
+  before = allocationStats;
+  start = BenchSeconds();
+  ReleaseArena(&arena);
+  BenchReport(name, "release", tree.binCount, "bins", BenchSeconds() - start);
+  BenchReportAllocations(name, "release", before);
+}
+
+void BenchTrees() {
+  BenchTreePhases(5, 4);
+  BenchTreePhases(6, 4);
+  BenchTreePhases(7, 4);
+}
+
+// Structural edits on wide containers: each insert or delete shifts the slots in place and lays the container out once.
+
+void BenchShelfEdits(int slotCount) {
+  struct Arena arena;
+  InitArena(&arena);
+
+  char name[32];
+  snprintf(name, sizeof(name), "shelf-%d", slotCount);
+
+  struct Shelf *shelf = NewShelf(&arena, ShelfDirection_Horizontal, slotCount);
+  LayoutRoot(&shelf->bin, BenchScreen());
+
+  const int edits = 2000;
+  struct AllocationStats before = allocationStats;
+  double start = BenchSeconds();
+  for (int edit = 0; edit < edits; edit++)
+    ShelfInsert(shelf, BenchRandom(shelf->slotCount + 1));
+  BenchReport(name, "insert", edits, "edits", BenchSeconds() - start);
+
+  start = BenchSeconds();
+  for (int edit = 0; edit < edits; edit++)
+    ShelfDelete(shelf, BenchRandom(shelf->slotCount));
+  BenchReport(name, "delete", edits, "edits", BenchSeconds() - start);
+  BenchReportAllocations(name, "edits", before);
+
+  DestroyBin(&shelf->bin);
+  ReleaseArena(&arena);
+}
+
+void BenchGridEdits(int rowCount, int columnCount) {
+  struct Arena arena;
+  InitArena(&arena);
+
+  char name[32];
+  snprintf(name, sizeof(name), "grid-%dx%d", rowCount, columnCount);
+
+  struct Grid *grid = NewGrid(&arena);
+  for (int row = 1; row < rowCount; row++)
+    GridInsertRow(grid, row);
+  for (int column = 1; column < columnCount; column++)
+    GridInsertColumn(grid, column);
+  LayoutRoot(&grid->bin, BenchScreen());
+
+  const int edits = 200;
+  struct AllocationStats before = allocationStats;
+  double start = BenchSeconds();
+  for (int edit = 0; edit < edits; edit++) {
+    GridInsertRow(grid, BenchRandom(grid->rowCount + 1));
+    GridDeleteRow(grid, BenchRandom(grid->rowCount));
+  }
+  BenchReport(name, "rows", edits * 2, "edits", BenchSeconds() - start);
+
+  start = BenchSeconds();
+  for (int edit = 0; edit < edits; edit++) {
+    GridInsertColumn(grid, BenchRandom(grid->columnCount + 1));
+    GridDeleteColumn(grid, BenchRandom(grid->columnCount));
+  }
+  BenchReport(name, "columns", edits * 2, "edits", BenchSeconds() - start);
+  BenchReportAllocations(name, "edits", before);
+
+  DestroyBin(&grid->bin);
+  ReleaseArena(&arena);
+}
+
+void BenchEdits() {
+  BenchShelfEdits(100);
+  BenchShelfEdits(400);
+  BenchShelfEdits(1600);
+  BenchGridEdits(32, 32);
+  BenchGridEdits(128, 128);
+}
+
+// Mouse moves over a large tree, both as random jumps and as a pointer wandering a few pixels at a time, dispatched by
+// walking down the tree and through the leaf index.
+
+struct Point BenchWander(struct Point point) {
+  point.x += BenchRandom(9) - 4;
+  point.y += BenchRandom(9) - 4;
+  point.x = point.x < 0 ? 0 : point.x >= BENCH_WIDTH ? BENCH_WIDTH - 1 : point.x;
+  point.y = point.y < 0 ? 0 : point.y >= BENCH_HEIGHT ? BENCH_HEIGHT - 1 : point.y;
+  return point;
+}
+
+// Dispatches a move through the index and then again down the whole tree from the same hover, and says whether the
+// walk reached the leaf the index found and left the same hover, damage and preview behind.
+bool BenchIndexedMatches(struct HitIndex *index, struct Point point) {
+  struct HoverLeaf hover = drawnHover;
+  ClearDamage();
+  DispatchMouseIndexed(index, point, 0);
+  struct Bin *leaf = HitTestLeaf(index, point);
+  struct HoverLeaf indexedHover = newHover;
+  struct Damage indexedDamage = damage;
+  struct Cell *cell = leaf != NULL ? BinCell(leaf) : NULL;
+  enum CellAction indexedAction = cell != NULL ? cell->previewAction : CellAction_None;
+
+  drawnHover = hover;
+  ClearDamage();
+  DispatchMouse(index->root, point, 0);
+  bool matches = memcmp(&newHover, &indexedHover, sizeof(newHover)) == 0 &&
+                 damage.rectCount == indexedDamage.rectCount &&
+                 memcmp(damage.rects, indexedDamage.rects, damage.rectCount * sizeof(struct Bounds)) == 0;
+  if (cell != NULL)
+    matches &= cell->sequence == newInput.sequence && cell->previewAction == indexedAction;
+  return matches;
+}
+
+// Counts the random and wandering moves whose indexed dispatch differs from a walk down the tree.
+int BenchIndexedMismatches(struct HitIndex *index, int moves) {
+  int mismatches = 0;
+  for (int move = 0; move < moves; move++)
+    mismatches += !BenchIndexedMatches(index, BenchRandomPoint());
+  struct Point point = MakePoint(BENCH_WIDTH / 2, BENCH_HEIGHT / 2);
+  for (int move = 0; move < moves; move++) {
+    point = BenchWander(point);
+    mismatches += !BenchIndexedMatches(index, point);
+  }
+  return mismatches;
+}
+
+void BenchHitPhases(int depth, int fanout) {
+  struct Arena arena;
+  InitArena(&arena);
+
+  struct BenchTree tree = {&arena, depth, fanout, 0};
+  char name[32];
+  snprintf(name, sizeof(name), "hit-%dx%d", depth, fanout);
+
+  struct Bin *root = BenchBranch(&tree, 0);
+  LayoutRoot(root, BenchScreen());
+
+  struct HitIndex index;
+  InitHitIndex(&index, root);
+
+  const int moves = 200000;
+  double start = BenchSeconds();
+  for (int move = 0; move < moves; move++)
+    DispatchMouse(root, BenchRandomPoint(), 0);
+  BenchReport(name, "jump-tree", moves, "events", BenchSeconds() - start);
+
+  start = BenchSeconds();
+  for (int move = 0; move < moves; move++)
+    DispatchMouseIndexed(&index, BenchRandomPoint(), 0);
+  BenchReport(name, "jump-index", moves, "events", BenchSeconds() - start);
+
+  struct Point point = MakePoint(BENCH_WIDTH / 2, BENCH_HEIGHT / 2);
+  start = BenchSeconds();
+  for (int move = 0; move < moves; move++) {
+    point = BenchWander(point);
+    DispatchMouse(root, point, 0);
+  }
+  BenchReport(name, "walk-tree", moves, "events", BenchSeconds() - start);
+
+  long long fastBefore = index.fastDispatches;
+  start = BenchSeconds();
+  for (int move = 0; move < moves; move++) {
+    point = BenchWander(point);
+    DispatchMouseIndexed(&index, point, 0);
+  }
+  BenchReport(name, "walk-index", moves, "events", BenchSeconds() - start);
+  printf("%-12s %-10s %9lld fast %9lld rebuilds %9d leaves\n", name, "walk-index", index.fastDispatches - fastBefore,
+         index.rebuilds, index.leafCount);
+
+  // The fast path only runs the leaf, which is right as long as leaves are disjoint and nest inside their ancestors'
+  // slots. Both dispatches agree before and after splits that make the index rebuild.
+  const int checks = 20000;
+  int mismatches = BenchIndexedMismatches(&index, checks);
+  long long rebuilds = index.rebuilds;
+  for (int split = 0; split < 16; split++) {
+    struct Bin *leaf = HitTestLeaf(&index, BenchRandomPoint());
+    if (leaf != NULL)
+      CellSetSubBin(BinCell(leaf), Wrap(NewShelf(&arena, ShelfDirection_Vertical, 2), bin));
+  }
+  LayoutRoot(root, BenchScreen());
+  mismatches += BenchIndexedMismatches(&index, checks);
+  printf("%-12s %-10s %9d moves %9d mismatched %9lld rebuilds\n", name, "agree", checks * 4, mismatches,
+         index.rebuilds - rebuilds);
+  BenchCheck(name, "agree", mismatches == 0 && index.rebuilds > rebuilds);
+
+  ReleaseHitIndex(&index);
+  DestroyBin(root);
+  ReleaseArena(&arena);
+}
+
+void BenchHits() {
+  BenchHitPhases(5, 4);
+  BenchHitPhases(7, 4);
+  BenchHitPhases(9, 3);
+}
+
+// Paints after every mouse move, either the whole screen or only the damaged rectangles, and reports how many pixels
+// and primitives each approach redraws.
+
+void BenchPaint(struct Bin *root, bool damaged) {
+  double start = BenchSeconds();
+  if (damaged) {
+    for (int rect = 0; rect < damage.rectCount; rect++) {
+      DrawRoot(root, damage.rects[rect]);
+      renderStats.pixelsTouched += (long long)damage.rects[rect].width * damage.rects[rect].height;
+    }
+  } else {
+    DrawRoot(root, BenchScreen());
+    renderStats.pixelsTouched += (long long)BENCH_WIDTH * BENCH_HEIGHT;
+  }
+  ClearDamage();
+
+  renderStats.paints++;
+  renderStats.lastPaintSeconds = BenchSeconds() - start;
+  renderStats.paintSeconds += renderStats.lastPaintSeconds;
+}
+
+void BenchDamagePhases(int depth, int fanout) {
+  struct Arena arena;
+  InitArena(&arena);
+
+  struct BenchTree tree = {&arena, depth, fanout, 0};
+  char name[32];
+  snprintf(name, sizeof(name), "damage-%dx%d", depth, fanout);
+
+  struct Bin *root = BenchBranch(&tree, 0);
+  LayoutRoot(root, BenchScreen());
+
+  struct HitIndex index;
+  InitHitIndex(&index, root);
+
+  const int moves = 20000;
+  const char *phases[] = {"full", "damaged"};
+  for (int phase = 0; phase < 2; phase++) {
+    struct Point point = MakePoint(BENCH_WIDTH / 2, BENCH_HEIGHT / 2);
+    ClearDamage();
+    HeadlessReset();
+    memset(&renderStats, 0, sizeof(renderStats));
+
+    double start = BenchSeconds();
+    for (int move = 0; move < moves; move++) {
+      point = BenchWander(point);
+      DispatchMouseIndexed(&index, point, 0);
+      BenchPaint(root, phase == 1);
+    }
+    BenchReport(name, phases[phase], moves, "frames", BenchSeconds() - start);
+    printf("%-12s %-10s %12.0f pixels/frame %9.1f prims/frame %9.3f ms paint/frame\n", name, phases[phase],
+           (double)renderStats.pixelsTouched / renderStats.paints, (double)BenchPrimitives() / renderStats.paints,
+           renderStats.paintSeconds * 1000 / renderStats.paints);
+  }
+
+  ReleaseHitIndex(&index);
+  DestroyBin(root);
+  ReleaseArena(&arena);
+}
+
+void BenchDamage() {
+  BenchDamagePhases(5, 4);
+  BenchDamagePhases(7, 4);
+}
+
+// Draws full frames with a few text labels, creating drawing objects per primitive and then through the cache, and
+// reports the heap allocations and backend objects each frame costs.
+
+// The uncached baseline: each primitive creates the drawing objects it needs straight from the backend's functions and
+// destroys them again, as the renderer did before it had a resource cache.
+struct ResourceCache *benchUncachedResources;
+long long benchUncachedCreations;
+
+void BenchUncachedPen(enum LineStyle style) {
+  struct ResourceCache *resources = benchUncachedResources;
+  resources->destroyPenFn(resources->createPenFn(style, resources->scale));
+  benchUncachedCreations++;
+}
+
+void BenchUncachedDrawLine(struct Point, struct Point, enum LineStyle style) {
+  BenchUncachedPen(style);
+}
+
+void BenchUncachedDrawRectangle(struct Bounds, enum LineStyle style) {
+  BenchUncachedPen(style);
+}
+
+void BenchUncachedDrawRoundedRectangle(struct Bounds, int, enum LineStyle style) {
+  BenchUncachedPen(style);
+}
+
+void BenchUncachedDrawText(int, int, int size, const char *text) {
+  struct ResourceCache *resources = benchUncachedResources;
+  void *font = resources->createFontFn(size, resources->scale);
+  resources->destroyTextFn(resources->createTextFn(text, size, resources->scale));
+  resources->destroyFontFn(font);
+  benchUncachedCreations += 2;
+}
+
+void BenchResourcePhases(int depth, int fanout) {
+  struct Arena arena;
+  InitArena(&arena);
+
+  struct BenchTree tree = {&arena, depth, fanout, 0};
+  char name[32];
+  snprintf(name, sizeof(name), "resource-%dx%d", depth, fanout);
+
+  struct Bin *root = BenchBranch(&tree, 0);
+  LayoutRoot(root, BenchScreen());
+
+  static const char *labels[] = {"Windy", "Split horizontally", "Split vertically", "Delete", "Grid"};
+  const int labelCount = sizeof(labels) / sizeof(labels[0]);
+
+  // Without drawCommandsFn the recorded frame is replayed one primitive at a time through the uncached functions.
+  struct Backend *cachedBackend = backend;
+  struct Backend uncachedBackend = *backend;
+  uncachedBackend.drawLineFn = BenchUncachedDrawLine;
+  uncachedBackend.drawRectangleFn = BenchUncachedDrawRectangle;
+  uncachedBackend.drawRoundedRectangleFn = BenchUncachedDrawRoundedRectangle;
+  uncachedBackend.drawTextFn = BenchUncachedDrawText;
+  uncachedBackend.drawCommandsFn = NULL;
+
+  struct ResourceCache *resources = backend->resources;
+  benchUncachedResources = resources;
+  const int frames = 200;
+  const char *phases[] = {"uncached", "cached"};
+  for (int phase = 0; phase < 2; phase++) {
+    FlushResources(resources);
+    backend = phase == 0 ? &uncachedBackend : cachedBackend;
+    long long creationsBefore = resources->creations + benchUncachedCreations;
+    struct AllocationStats before = allocationStats;
+
+    double start = BenchSeconds();
+    for (int frame = 0; frame < frames; frame++) {
+      DrawRoot(root, BenchScreen());
+      for (int label = 0; label < labelCount; label++)
+        DrawText(10, 10 + label * 20, 16 + label % 2 * 4, labels[label]);
+    }
+    BenchReport(name, phases[phase], frames, "frames", BenchSeconds() - start);
+    printf("%-12s %-10s %12.1f heap allocs/frame %9.1f objects/frame\n", name, phases[phase],
+           (double)(allocationStats.heapAllocations - before.heapAllocations) / frames,
+           (double)(resources->creations + benchUncachedCreations - creationsBefore) / frames);
+  }
+  backend = cachedBackend;
+  FlushResources(resources);
+
+  DestroyBin(root);
+  ReleaseArena(&arena);
+}
+
+void BenchResources() {
+  BenchResourcePhases(5, 4);
+  BenchResourcePhases(6, 4);
+}
+
+// Splits a frame into recording the draw list, hashing it and submitting it in batches, and checks that the hash
+// only changes when the picture does.
+
+void BenchCommandPhases(int depth, int fanout) {
+  struct Arena arena;
+  InitArena(&arena);
+
+  struct BenchTree tree = {&arena, depth, fanout, 0};
+  char name[32];
+  snprintf(name, sizeof(name), "commands-%dx%d", depth, fanout);
+
+  struct Bin *root = BenchBranch(&tree, 0);
+  LayoutRoot(root, BenchScreen());
+  DispatchMouse(root, MakePoint(BENCH_WIDTH / 3, BENCH_HEIGHT / 3), 0);
+
+  struct DrawList list = {};
+  const int frames = 100;
+  double start = BenchSeconds();
+  for (int frame = 0; frame < frames; frame++)
+    RecordRoot(root, BenchScreen(), &list);
+  BenchReport(name, "record", frames * list.commandCount, "commands", BenchSeconds() - start);
+
+  unsigned long long hash = 0;
+  start = BenchSeconds();
+  for (int frame = 0; frame < frames; frame++)
+    hash = DrawListHash(&list);
+  BenchReport(name, "hash", frames * list.commandCount, "commands", BenchSeconds() - start);
+
+  HeadlessReset();
+  start = BenchSeconds();
+  for (int frame = 0; frame < frames; frame++)
+    SubmitDrawList(&list);
+  BenchReport(name, "submit", frames * list.commandCount, "commands", BenchSeconds() - start);
+  printf("%-12s %-10s %9d commands/frame %9d bytes/frame %9d batches/frame\n", name, "frame", list.commandCount,
+         (int)(list.commandCount * sizeof(struct DrawCommand)) + list.textBytes, headless.batchCount / frames);
+
+  // Drawing the same tree again gives the same hash; moving the hover to another leaf changes it.
+  RecordRoot(root, BenchScreen(), &list);
+  bool stable = DrawListHash(&list) == hash;
+  DispatchMouse(root, MakePoint(BENCH_WIDTH * 2 / 3, BENCH_HEIGHT * 2 / 3), 0);
+  RecordRoot(root, BenchScreen(), &list);
+  bool changed = DrawListHash(&list) != hash;
+  printf("%-12s %-10s %016llx %s %s\n", name, "hash", hash, stable ? "stable" : "UNSTABLE",
+         changed ? "changes" : "DOES NOT CHANGE");
+  BenchCheck(name, "hash", stable && changed);
+
+  ReleaseDrawList(&list);
+  DestroyBin(root);
+  ReleaseArena(&arena);
+}
+
+void BenchCommands() {
+  BenchCommandPhases(5, 4);
+  BenchCommandPhases(7, 4);
+}
+
+// Renders whole 4K overlay frames with the software rasterizer, once per span function the processor supports. The
+// frame hashes must agree, since every span function produces the same pixels.
+
+void BenchRasterPhases(int depth, int fanout) {
+  struct Arena arena;
+  InitArena(&arena);
+
+  struct BenchTree tree = {&arena, depth, fanout, 0};
+  char name[32];
+  snprintf(name, sizeof(name), "raster-%dx%d", depth, fanout);
+
+  struct Bin *root = BenchBranch(&tree, 0);
+  LayoutRoot(root, BenchScreen());
+  DispatchMouse(root, MakePoint(BENCH_WIDTH / 3, BENCH_HEIGHT / 3), 0);
+
+  struct DrawList list = {};
+  RecordRoot(root, BenchScreen(), &list);
+
+  struct Backend *oldBackend = backend;
+  backend = &rasterBackend;
+  RasterAllocate(BENCH_WIDTH, BENCH_HEIGHT, MakePoint(0, 0));
+
+  const int frames = 10;
+  unsigned long long frameHash = 0;
+  unsigned long long washHash = 0;
+  for (int spans = 0; spans < RasterSpans_Count; spans++) {
+    if (!RasterSpansSupported((enum RasterSpans)spans))
+      continue;
+    raster.spans = (enum RasterSpans)spans;
+    raster.pixelCount = 0;
+
+    double start = BenchSeconds();
+    for (int frame = 0; frame < frames; frame++) {
+      RasterClear(0xfff0f0f0);
+      SubmitDrawList(&list);
+    }
+    double seconds = BenchSeconds() - start;
+    BenchReport(name, RasterSpansName(raster.spans), frames, "frames", seconds);
+    printf("%-12s %-10s %9d commands %12.1f Mpixels/s %9.3f ms/frame %016llx\n", name, RasterSpansName(raster.spans),
+           list.commandCount, raster.pixelCount / seconds / 1e6, seconds * 1000 / frames, RasterHash());
+    if (frameHash == 0)
+      frameHash = RasterHash();
+    BenchCheck(name, RasterSpansName(raster.spans), RasterHash() == frameHash);
+  }
+
+  // A translucent wash over the whole screen is all wide spans, so it shows the span functions' own throughput.
+  for (int spans = 0; spans < RasterSpans_Count; spans++) {
+    if (!RasterSpansSupported((enum RasterSpans)spans))
+      continue;
+    raster.spans = (enum RasterSpans)spans;
+    RasterClear(0xfff0f0f0);
+    raster.pixelCount = 0;
+
+    double start = BenchSeconds();
+    for (int frame = 0; frame < frames; frame++)
+      RasterFillBounds(BenchScreen(), 0x40204080);
+    double seconds = BenchSeconds() - start;
+    printf("%-12s %-10s %9s %12.1f Mpixels/s %9.3f ms/frame %016llx\n", name, RasterSpansName(raster.spans), "wash",
+           raster.pixelCount / seconds / 1e6, seconds * 1000 / frames, RasterHash());
+    if (washHash == 0)
+      washHash = RasterHash();
+    BenchCheck(name, "wash", RasterHash() == washHash);
+  }
+
+  ReleaseRaster();
+  backend = oldBackend;
+
+  ReleaseDrawList(&list);
+  DestroyBin(root);
+  ReleaseArena(&arena);
+}
+
+void BenchRaster() {
+  BenchRasterPhases(3, 4);
+  BenchRasterPhases(5, 4);
+  BenchRasterPhases(7, 4);
+}
+
+// A 1000 Hz mouse wandering over a large tree with the odd key press, either dispatched and painted per event or queued
+// and processed once per 60 Hz frame.
+
+void BenchInputPhases(int depth, int fanout) {
+  struct Arena arena;
+  InitArena(&arena);
+
+  struct BenchTree tree = {&arena, depth, fanout, 0};
+  char name[32];
+  snprintf(name, sizeof(name), "input-%dx%d", depth, fanout);
+
+  struct Bin *root = BenchBranch(&tree, 0);
+  LayoutRoot(root, BenchScreen());
+
+  struct HitIndex index;
+  InitHitIndex(&index, root);
+
+  const int events = 20000;
+  const int eventsPerFrame = 1000 / 60;
+  const char *phases[] = {"direct", "queued"};
+  for (int phase = 0; phase < 2; phase++) {
+    struct Point point = MakePoint(BENCH_WIDTH / 2, BENCH_HEIGHT / 2);
+    ClearDamage();
+    memset(&renderStats, 0, sizeof(renderStats));
+    memset(&inputStats, 0, sizeof(inputStats));
+    long long dispatched = 0;
+
+    double start = BenchSeconds();
+    for (int event = 0; event < events; event++) {
+      point = BenchWander(point);
+      bool key = event % 100 == 99;
+      if (phase == 0) {
+        if (key)
+          DispatchKey(root, 'Q', false);
+        else
+          DispatchMouseIndexed(&index, point, 0);
+        BenchPaint(root, true);
+        dispatched++;
+        continue;
+      }
+
+      bool full = key ? QueueKey('Q', false) : QueueMouse(point, 0);
+      if (full || event % eventsPerFrame == eventsPerFrame - 1) {
+        dispatched += ProcessInput(&index);
+        BenchPaint(root, true);
+      }
+    }
+    dispatched += ProcessInput(&index);
+    BenchReport(name, phases[phase], events, "events", BenchSeconds() - start);
+    printf("%-12s %-10s %9lld dispatched %9lld paints %9lld coalesced\n", name, phases[phase], dispatched,
+           renderStats.paints, inputStats.coalescedEvents);
+  }
+
+  ReleaseHitIndex(&index);
+  DestroyBin(root);
+  ReleaseArena(&arena);
+}
+
+// Two trees went through the same edits when they have the same bins with the same bounds.
+bool BenchSameShape(struct Bin *a, struct Bin *b) {
+  if (a == NULL || b == NULL)
+    return a == b;
+  int childCount = BinChildCount(a);
+  if (a->onLayoutFn != b->onLayoutFn || memcmp(&a->bounds, &b->bounds, sizeof(a->bounds)) != 0 ||
+      childCount != BinChildCount(b))
+    return false;
+  for (int child = 0; child < childCount; child++)
+    if (!BenchSameShape(BinChild(a, child), BinChild(b, child)))
+      return false;
+  return true;
+}
+
+// Feeds a frame's events to one tree as they arrive, and queues them for the other and processes the queue.
+void BenchInputFrame(struct HitIndex *direct, struct HitIndex *queued, const struct QueuedInput *events, int count) {
+  for (int event = 0; event < count; event++) {
+    if (events[event].kind == QueuedInput_Key) {
+      DispatchKey(direct->root, events[event].key, events[event].shift);
+      QueueKey(events[event].key, events[event].shift);
+    } else {
+      DispatchMouseIndexed(direct, events[event].position, events[event].buttons);
+      QueueMouse(events[event].position, events[event].buttons);
+    }
+  }
+  ProcessInput(queued);
+}
+
+int BenchAddInput(struct QueuedInput *events, int count, enum QueuedInputKind kind, struct Point position,
+                  int buttons) {
+  struct QueuedInput event = {};
+  event.kind = kind;
+  event.position = position;
+  event.buttons = buttons;
+  event.key = kind == QueuedInput_Key ? 'V' : 0;
+  events[count] = event;
+  return count + 1;
+}
+
+// Clicks on the split hint of random cells, dragging away before the release, with a key after more moves in the next
+// frame, both dispatched as they arrive and through the queue. The queue folds the moves but keeps the press, release
+// and key where they were, so each click splits the cell it was pressed in and both trees end up the same.
+void BenchInputClicks(int depth, int fanout) {
+  struct Arena directArena, queuedArena;
+  InitArena(&directArena);
+  InitArena(&queuedArena);
+
+  struct BenchTree directTree = {&directArena, depth, fanout, 0};
+  struct BenchTree queuedTree = {&queuedArena, depth, fanout, 0};
+  char name[32];
+  snprintf(name, sizeof(name), "input-%dx%d", depth, fanout);
+
+  struct Bin *directRoot = BenchBranch(&directTree, 0);
+  struct Bin *queuedRoot = BenchBranch(&queuedTree, 0);
+  LayoutRoot(directRoot, BenchScreen());
+  LayoutRoot(queuedRoot, BenchScreen());
+
+  struct HitIndex direct, queued;
+  InitHitIndex(&direct, directRoot);
+  InitHitIndex(&queued, queuedRoot);
+  memset(&inputStats, 0, sizeof(inputStats));
+
+  const int clicks = 200;
+  int splits = 0;
+  int strays = 0;
+  for (int click = 0; click < clicks; click++) {
+    // The split hint is on the line through the cell's midpoint; the press is made on it, below the midpoint.
+    struct Bin *leaf = HitTestLeaf(&queued, BenchRandomPoint());
+    struct Point press = leaf != NULL ? BoundsMidpoint(leaf->bounds) : MakePoint(0, 0);
+    press.y += 15;
+    if (leaf == NULL || HitTestLeaf(&queued, press) != leaf) {
+      click--;
+      continue;
+    }
+
+    struct QueuedInput events[16];
+    int count = 0;
+    struct Point point = BenchRandomPoint();
+    for (int move = 0; move < 4; move++)
+      count = BenchAddInput(events, count, QueuedInput_Move, point = BenchWander(point), 0);
+    count = BenchAddInput(events, count, QueuedInput_Move, press, 0);
+    count = BenchAddInput(events, count, QueuedInput_Button, press, InputButton_Left);
+    point = BenchRandomPoint();
+    for (int move = 0; move < 4; move++)
+      count = BenchAddInput(events, count, QueuedInput_Move, point = BenchWander(point), InputButton_Left);
+    count = BenchAddInput(events, count, QueuedInput_Button, point, 0);
+    struct Bin *released = HitTestLeaf(&queued, point);
+    BenchInputFrame(&direct, &queued, events, count);
+
+    struct Bin *split = BinCell(leaf)->subBin;
+    if (split != NULL && split->onLayoutFn == ShelfLayout) {
+      struct Shelf *shelf = Unwrap(struct Shelf, bin, split);
+      splits += shelf->direction == ShelfDirection_Horizontal;
+    }
+    strays += released != NULL && released != leaf && BinCell(released)->subBin != NULL;
+
+    count = 0;
+    point = BenchRandomPoint();
+    for (int move = 0; move < 4; move++)
+      count = BenchAddInput(events, count, QueuedInput_Move, point = BenchWander(point), 0);
+    count = BenchAddInput(events, count, QueuedInput_Key, point, 0);
+    BenchInputFrame(&direct, &queued, events, count);
+  }
+
+  bool same = BenchSameShape(directRoot, queuedRoot);
+  printf("%-12s %-10s %9d clicks %9d splits %9d strays %9lld coalesced %9s\n", name, "clicks", clicks, splits, strays,
+         inputStats.coalescedEvents, same ? "same" : "DIFFERENT");
+  BenchCheck(name, "clicks", splits == clicks && strays == 0 && inputStats.coalescedEvents > 0 && same);
+
+  ReleaseHitIndex(&direct);
+  ReleaseHitIndex(&queued);
+  DestroyBin(directRoot);
+  DestroyBin(queuedRoot);
+  ReleaseArena(&directArena);
+  ReleaseArena(&queuedArena);
+}
+
+void BenchInput() {
+  BenchInputPhases(5, 4);
+  BenchInputPhases(7, 4);
+  BenchInputClicks(5, 4);
+  BenchInputClicks(7, 4);
+}
+
+// Gives every leaf cell of a large tree a window, then reflows the tree by laying it out again unchanged, resizing the
+// screen and splitting cells, and reports how many windows each pass places and in how many backend calls.
+
+int BenchAssignWindows(struct Bin *bin, int count) {
+  struct Cell *cell = BinCell(bin);
+  if (cell != NULL && cell->subBin == NULL) {
+    cell->hWnd = (WindowHandle)(size_t)(count + 1);
+    return count + 1;
+  }
+
+  for (int child = 0; child < BinChildCount(bin); child++)
+    if (BinChild(bin, child) != NULL)
+      count = BenchAssignWindows(BinChild(bin, child), count);
+  return count;
+}
+
+void BenchReportPlacements(const char *name, const char *phase, int passes, double seconds,
+                           struct Placements *placements, struct Placements before) {
+  BenchReport(name, phase, passes, "passes", seconds);
+  printf("%-12s %-10s %9lld collected %9lld placed %9d calls\n", name, phase,
+         placements->windowsCollected - before.windowsCollected, placements->windowsPlaced - before.windowsPlaced,
+         headless.placementBatchCount);
+}
+
+// Splits the leaf under a random point into two cells and moves its window, if it has one, into the first of them, as
+// dropping a new window onto it would. Returns how many windows that leaves to place.
+int BenchSplitWindow(struct Arena *arena, struct HitIndex *index) {
+  struct Bin *leaf = HitTestLeaf(index, BenchRandomPoint());
+  if (leaf == NULL)
+    return 0;
+
+  struct Cell *cell = BinCell(leaf);
+  struct Bin *subBin = Wrap(NewShelf(arena, ShelfDirection_Vertical, 2), bin);
+  CellSetSubBin(cell, subBin);
+  if (cell->hWnd == NULL)
+    return 0;
+
+  BinCell(BinChild(subBin, 0))->hWnd = cell->hWnd;
+  cell->hWnd = NULL;
+  return 1;
+}
+
+void BenchPlacementPhases(int depth, int fanout) {
+  struct Arena arena;
+  InitArena(&arena);
+
+  struct BenchTree tree = {&arena, depth, fanout, 0};
+  char name[32];
+  snprintf(name, sizeof(name), "place-%dx%d", depth, fanout);
+
+  struct Bin *root = BenchBranch(&tree, 0);
+  int windows = BenchAssignWindows(root, 0);
+  LayoutRoot(root, BenchScreen());
+
+  struct Placements placements;
+  InitPlacements(&placements);
+
+  HeadlessReset();
+  struct Placements before = placements;
+  double start = BenchSeconds();
+  ApplyPlacements(&placements, root);
+  BenchReportPlacements(name, "initial", 1, BenchSeconds() - start, &placements, before);
+  BenchCheck(name, "initial",
+             headless.placementBatchCount == 1 && headless.placementCount == windows &&
+                 placements.windowsPlaced - before.windowsPlaced == windows);
+
+  const int passes = 100;
+  HeadlessReset();
+  before = placements;
+  start = BenchSeconds();
+  for (int pass = 0; pass < passes; pass++) {
+    LayoutRoot(root, BenchScreen());
+    ApplyPlacements(&placements, root);
+  }
+  BenchReportPlacements(name, "relayout", passes, BenchSeconds() - start, &placements, before);
+  BenchCheck(name, "relayout", headless.placementBatchCount == 0 && placements.windowsPlaced == before.windowsPlaced);
+
+  HeadlessReset();
+  before = placements;
+  start = BenchSeconds();
+  for (int pass = 0; pass < passes; pass++) {
+    struct Bounds screen = BenchScreen();
+    screen.width -= pass % 2 * 100;
+    LayoutRoot(root, screen);
+    ApplyPlacements(&placements, root);
+  }
+  BenchReportPlacements(name, "resize", passes, BenchSeconds() - start, &placements, before);
+
+  // Back to the full screen before splitting, so that each split pass places only what the split moved.
+  LayoutRoot(root, BenchScreen());
+  ApplyPlacements(&placements, root);
+
+  struct HitIndex index;
+  InitHitIndex(&index, root);
+  HeadlessReset();
+  before = placements;
+  int moved = 0;
+  int strays = 0;
+  start = BenchSeconds();
+  for (int pass = 0; pass < passes; pass++) {
+    long long placed = placements.windowsPlaced;
+    int split = BenchSplitWindow(&arena, &index);
+    LayoutRoot(root, BenchScreen());
+    ApplyPlacements(&placements, root);
+    moved += split;
+    strays += placements.windowsPlaced - placed != split;
+  }
+  BenchReportPlacements(name, "split", passes, BenchSeconds() - start, &placements, before);
+  BenchCheck(name, "split", strays == 0 && moved > 0 && headless.placementBatchCount == moved);
+
+  ReleaseHitIndex(&index);
+  ReleasePlacements(&placements);
+  DestroyBin(root);
+  ReleaseArena(&arena);
+}
+
+void BenchPlacements() {
+  BenchPlacementPhases(5, 4);
+  BenchPlacementPhases(7, 4);
+}
+
+// Reflows windows through a simulated slow window system in which every call takes a millisecond, however many windows
+// it moves, and a few windows hang for much longer: first one window at a time on the calling thread, then in batches
+// through the move workers, with a restack of every window queued behind the moves. The calling thread stands in for
+// the overlay: what matters is how long it is blocked, how soon the responsive windows are in place, and that every
+// window ends up where the last reflow put it.
+
+#define BENCH_MOVE_WINDOWS 100
+#define BENCH_MOVE_HANG_EVERY 40
+#define BENCH_MOVE_HANG_MS 300
+
+std::atomic<int> benchMovesDone;
+std::atomic<int> benchStackingsDone;
+std::atomic<int> benchMovedTo[BENCH_MOVE_WINDOWS + 1];
+
+bool BenchMoveHangs(WindowHandle hWnd) {
+  return (size_t)hWnd % BENCH_MOVE_HANG_EVERY == 0;
+}
+
+void BenchSlowMove(WindowHandle hWnd, struct Bounds bounds) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(BenchMoveHangs(hWnd) ? BENCH_MOVE_HANG_MS : 1));
+  benchMovedTo[(size_t)hWnd] = bounds.x;
+  benchMovesDone++;
+}
+
+// A batch is held up by any window in it that hangs.
+void BenchSlowMoves(const struct WindowPlacement *placements, int count) {
+  bool hangs = false;
+  for (int index = 0; index < count; index++)
+    hangs |= BenchMoveHangs(placements[index].hWnd);
+  std::this_thread::sleep_for(std::chrono::milliseconds(hangs ? BENCH_MOVE_HANG_MS : 1));
+  for (int index = 0; index < count; index++)
+    benchMovedTo[(size_t)placements[index].hWnd] = placements[index].bounds.x;
+  benchMovesDone += count;
+}
+
+void BenchSlowStack(const struct WindowStacking *stackings, int count) {
+  bool hangs = false;
+  for (int index = 0; index < count; index++)
+    hangs |= BenchMoveHangs(stackings[index].hWnd);
+  std::this_thread::sleep_for(std::chrono::milliseconds(hangs ? BENCH_MOVE_HANG_MS : 1));
+  benchStackingsDone++;
+}
+
+// Windows not yet where the last reflow put them, leaving out the ones that hang if asked to.
+int BenchMisplacedWindows(int x, bool hung) {
+  int misplaced = 0;
+  for (int window = 1; window <= BENCH_MOVE_WINDOWS; window++)
+    if (hung || !BenchMoveHangs((WindowHandle)(size_t)window))
+      misplaced += benchMovedTo[window] != x;
+  return misplaced;
+}
+
+void BenchMoves() {
+  const char *name = "moves";
+
+  struct WindowPlacement placements[BENCH_MOVE_WINDOWS];
+  struct WindowStacking stackings[BENCH_MOVE_WINDOWS];
+  for (int window = 0; window < BENCH_MOVE_WINDOWS; window++) {
+    placements[window].hWnd = (WindowHandle)(size_t)(window + 1);
+    placements[window].bounds = BenchScreen();
+    stackings[window].hWnd = placements[window].hWnd;
+    stackings[window].above = window > 0 ? placements[window - 1].hWnd : NULL;
+    stackings[window].show = WindowShow_Keep;
+  }
+
+  double start = BenchSeconds();
+  for (int window = 0; window < BENCH_MOVE_WINDOWS; window++)
+    BenchSlowMove(placements[window].hWnd, placements[window].bounds);
+  BenchReport(name, "blocked", BENCH_MOVE_WINDOWS, "moves", BenchSeconds() - start);
+
+  // Three reflows in quick succession, of which only the last needs to reach each window.
+  struct Backend slowWindows = {};
+  slowWindows.name = "slow";
+  slowWindows.placeWindowFn = BenchSlowMove;
+  slowWindows.placeWindowsFn = BenchSlowMoves;
+  slowWindows.stackWindowsFn = BenchSlowStack;
+  benchMovesDone = 0;
+  benchStackingsDone = 0;
+  StartMoveWorkers(4, 0.1, &slowWindows, NULL);
+  start = BenchSeconds();
+  const int reflows = 3;
+  for (int reflow = 0; reflow < reflows; reflow++) {
+    for (int window = 0; window < BENCH_MOVE_WINDOWS; window++)
+      placements[window].bounds.x = reflow;
+    QueueWindowMoves(placements, BENCH_MOVE_WINDOWS);
+  }
+  QueueWindowStackings(stackings, BENCH_MOVE_WINDOWS);
+  BenchReport(name, "queue", BENCH_MOVE_WINDOWS * reflows, "moves", BenchSeconds() - start);
+
+  struct MoveCompletion completions[64];
+  double responsiveSeconds = 0;
+  while (PendingMoves() > 0) {
+    CheckMoveTimeouts();
+    while (TakeMoveCompletions(completions, 64) > 0)
+      continue;
+    if (responsiveSeconds == 0 && BenchMisplacedWindows(reflows - 1, false) == 0)
+      responsiveSeconds = BenchSeconds() - start;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  double allSeconds = BenchSeconds() - start;
+  // Nothing is kept for windows whose moves are all done, including the ones that hung.
+  struct MoveStats stats = GetMoveStats();
+  bool unresponsive = false;
+  for (int window = 0; window < BENCH_MOVE_WINDOWS; window++)
+    unresponsive |= WindowUnresponsive(placements[window].hWnd);
+  StopMoveWorkers();
+
+  int misplaced = BenchMisplacedWindows(reflows - 1, true);
+  printf("%-12s %-10s %9.1f ms responsive %9.1f ms all %9d moved %9d misplaced\n", name, "workers",
+         responsiveSeconds * 1000, allSeconds * 1000, benchMovesDone.load(), misplaced);
+  printf("%-12s %-10s %9lld batches %9lld split %9lld singles %9lld stackings %9d stacked\n", name, "workers",
+         stats.batches, stats.splitBatches, stats.singles, stats.stackings, benchStackingsDone.load());
+  printf("%-12s %-10s %9lld coalesced %9lld timed out %9lld recovered %9d workers %9d slots left\n", name,
+         "workers", stats.coalesced, stats.timedOut, stats.recovered, stats.workersStarted, stats.slots);
+  BenchCheck(name, "workers", misplaced == 0 && benchStackingsDone.load() == 1);
+  BenchCheck(name, "slots", stats.slots == 0 && !unresponsive);
+}
+
+// Feeds the window tracker a stream of events like a busy desktop's, mostly moves, half of them for windows it does not
+// track, with windows coming and going. Then puts windows in every leaf cell of a tree, destroys half of them, and
+// checks the cells were emptied.
+
+int BenchLinkWindows(struct Bin *bin, int count) {
+  struct Cell *cell = BinCell(bin);
+  if (cell != NULL && cell->subBin == NULL) {
+    CellSetWindow(cell, (WindowHandle)(size_t)(count + 1));
+    return count + 1;
+  }
+
+  for (int child = 0; child < BinChildCount(bin); child++)
+    if (BinChild(bin, child) != NULL)
+      count = BenchLinkWindows(BinChild(bin, child), count);
+  return count;
+}
+
+int BenchCountWindowCells(struct Bin *bin) {
+  struct Cell *cell = BinCell(bin);
+  int count = cell != NULL && cell->hWnd != NULL ? 1 : 0;
+  for (int child = 0; child < BinChildCount(bin); child++)
+    if (BinChild(bin, child) != NULL)
+      count += BenchCountWindowCells(BinChild(bin, child));
+  return count;
+}
+
+void BenchTracker() {
+  const char *name = "tracker";
+  const int windows = 4096;
+  const int events = 2000000;
+
+  for (int window = 1; window <= windows; window++)
+    TrackWindow((WindowHandle)(size_t)window, BenchScreen(), TrackedWindow_Visible);
+
+  double start = BenchSeconds();
+  for (int event = 0; event < events; event++) {
+    WindowHandle hWnd = (WindowHandle)(size_t)(BenchRandom(windows * 2) + 1);
+    int kind = BenchRandom(100);
+    if (kind < 90) {
+      struct Bounds bounds = {BenchRandom(BENCH_WIDTH), BenchRandom(BENCH_HEIGHT), 800, 600};
+      TrackWindowMoved(hWnd, bounds);
+    } else if (kind < 95) {
+      TrackWindowFlags(hWnd, kind & 1 ? TrackedWindow_Minimized : 0, kind & 1 ? 0 : TrackedWindow_Minimized);
+    } else if (kind < 97) {
+      TrackForeground(hWnd);
+    } else if (kind < 99) {
+      TrackWindowDestroyed(hWnd);
+    } else {
+      TrackWindow(hWnd, BenchScreen(), TrackedWindow_Visible);
+    }
+  }
+  BenchReport(name, "events", events, "events", BenchSeconds() - start);
+  printf("%-12s %-10s %9d tracked %9lld ignored %9lld created %9lld destroyed\n", name, "events",
+         windowTracker.windows.count, windowTracker.stats.ignored, windowTracker.stats.created,
+         windowTracker.stats.destroyed);
+  ReleaseWindowTracker();
+
+  struct Arena arena;
+  InitArena(&arena);
+  struct BenchTree tree = {&arena, 5, 4, 0};
+  struct Bin *root = BenchBranch(&tree, 0);
+  int linked = BenchLinkWindows(root, 0);
+
+  start = BenchSeconds();
+  for (int window = 1; window <= linked; window += 2)
+    TrackWindowDestroyed((WindowHandle)(size_t)window);
+  BenchReport(name, "destroy", (linked + 1) / 2, "windows", BenchSeconds() - start);
+  printf("%-12s %-10s %9d linked %9d cells left %9d tracked\n", name, "destroy", linked, BenchCountWindowCells(root),
+         windowTracker.windows.count);
+  BenchCheck(name, "destroy", BenchCountWindowCells(root) == linked / 2 && windowTracker.windows.count == linked / 2);
+
+  DestroyBin(root);
+  ReleaseArena(&arena);
+  ReleaseWindowTracker();
+}
+
+// Windows of a few hundred made up applications, each with rules on some of its class, title and process name.
+void BenchRulePatterns(int rule, char patterns[RuleField_Count][64]) {
+  int app = rule / 2;
+  snprintf(patterns[RuleField_Class], 64, rule % 3 == 0 ? "^App%dFrame$" : "", app);
+  if (rule % 2 == 0)
+    snprintf(patterns[RuleField_Title], 64, "(?i)report-%d[0-9]*\\.(txt|md)", app);
+  else
+    snprintf(patterns[RuleField_Title], 64, "Project %d - .*(Debug|Release)", app);
+  snprintf(patterns[RuleField_Process], 64, rule % 4 == 1 ? "" : "^app%d\\.exe$", app);
+}
+
+void BenchRuleTexts(int window, int version, char texts[RuleField_Count][128]) {
+  int app = window % 160;
+  snprintf(texts[RuleField_Class], 128, "App%dFrame", app);
+  if (window % 2 == 0)
+    snprintf(texts[RuleField_Title], 128, "REPORT-%d%d.txt - edited %d times", app, window % 10, version);
+  else
+    snprintf(texts[RuleField_Title], 128, "Project %d - build %d %s", app, version, version % 2 ? "Debug" : "Test");
+  snprintf(texts[RuleField_Process], 128, "app%d.exe", app);
+}
+
+void BenchRules() {
+  const char *name = "rules";
+  const int ruleCount = 300;
+  const int windows = 4096;
+  char error[256];
+
+  // One set per pattern, matched rule by rule, against all of them compiled together.
+  struct PatternSet *separate = AllocateArray(struct PatternSet, ruleCount * RuleField_Count);
+  struct RuleSet rules;
+  InitRuleSet(&rules);
+  for (int rule = 0; rule < ruleCount; rule++) {
+    char patterns[RuleField_Count][64];
+    BenchRulePatterns(rule, patterns);
+    for (int field = 0; field < RuleField_Count; field++) {
+      InitPatternSet(&separate[rule * RuleField_Count + field]);
+      if (patterns[field][0] && AddPattern(&separate[rule * RuleField_Count + field], patterns[field], error, 256) < 0)
+        FatalError("%s", error);
+    }
+    if (!AddRule(&rules, "cell", patterns[0][0] ? patterns[0] : NULL, patterns[1][0] ? patterns[1] : NULL,
+                 patterns[2][0] ? patterns[2] : NULL, error, sizeof(error)))
+      FatalError("%s", error);
+  }
+
+  int *decisions = AllocateArray(int, windows);
+  double start = BenchSeconds();
+  for (int window = 0; window < windows; window++) {
+    char texts[RuleField_Count][128];
+    BenchRuleTexts(window, 0, texts);
+    decisions[window] = -1;
+    for (int rule = 0; rule < ruleCount && decisions[window] < 0; rule++) {
+      bool matched = true;
+      for (int field = 0; field < RuleField_Count && matched; field++) {
+        struct PatternSet *set = &separate[rule * RuleField_Count + field];
+        unsigned long long bits = 0;
+        if (set->patternCount > 0)
+          MatchPatterns(set, texts[field], &bits);
+        matched = set->patternCount == 0 || bits != 0;
+      }
+      if (matched)
+        decisions[window] = rule;
+    }
+  }
+  BenchReport(name, "separate", windows, "windows", BenchSeconds() - start);
+
+  int mismatches = 0;
+  int placed = 0;
+  start = BenchSeconds();
+  for (int window = 0; window < windows; window++) {
+    char texts[RuleField_Count][128];
+    BenchRuleTexts(window, 0, texts);
+    const char *fields[RuleField_Count] = {
+        texts[RuleField_Class],
+        texts[RuleField_Title],
+        texts[RuleField_Process],
+    };
+    int rule = MatchWindowRules(&rules, (WindowHandle)(size_t)(window + 1), fields);
+    mismatches += rule != decisions[window];
+    placed += rule >= 0;
+  }
+  BenchReport(name, "combined", windows, "windows", BenchSeconds() - start);
+  printf("%-12s %-10s %9d rules %9d placed %9d mismatched %9lld states\n", name, "combined", ruleCount, placed,
+         mismatches, rules.fields[RuleField_Title].stats.dfaStates);
+  BenchCheck(name, "combined", mismatches == 0);
+
+  // Nothing changed, so every lookup is answered from the cache.
+  const char *unchanged[RuleField_Count] = {};
+  start = BenchSeconds();
+  for (int window = 0; window < windows; window++)
+    MatchWindowRules(&rules, (WindowHandle)(size_t)(window + 1), unchanged);
+  BenchReport(name, "cached", windows, "windows", BenchSeconds() - start);
+
+  // Titles change, as they do with every edit or tab switch; only the title patterns run again.
+  const int versions = 16;
+  long long fieldsBefore = rules.stats.fieldsMatched;
+  start = BenchSeconds();
+  for (int version = 1; version <= versions; version++)
+    for (int window = 0; window < windows; window++) {
+      char texts[RuleField_Count][128];
+      BenchRuleTexts(window, version, texts);
+      const char *fields[RuleField_Count] = {
+          NULL,
+          texts[RuleField_Title],
+          NULL,
+      };
+      MatchWindowRules(&rules, (WindowHandle)(size_t)(window + 1), fields);
+    }
+  BenchReport(name, "title", windows * versions, "changes", BenchSeconds() - start);
+  printf("%-12s %-10s %9lld fields matched %9lld cached\n", name, "title", rules.stats.fieldsMatched - fieldsBefore,
+         rules.stats.cached);
+
+  for (int set = 0; set < ruleCount * RuleField_Count; set++)
+    ReleasePatternSet(&separate[set]);
+  FreeBytes(separate);
+  FreeBytes(decisions);
+  ReleaseRuleSet(&rules);
+}
+
+int BenchNameCells(struct Bin *bin, char (*names)[16], int count) {
+  struct Cell *cell = BinCell(bin);
+  if (cell != NULL) {
+    snprintf(names[count], 16, "cell-%d", count);
+    CellSetName(cell, names[count]);
+    count++;
+  }
+  for (int child = 0; child < BinChildCount(bin); child++)
+    if (BinChild(bin, child) != NULL)
+      count = BenchNameCells(BinChild(bin, child), names, count);
+  return count;
+}
+
+// A grid with a named tree in three of its four slots, so the snapshot holds every kind of node.
+struct Bin *BenchSnapshotTree(struct BenchTree *tree) {
+  struct Grid *grid = NewEmptyGrid(tree->arena, 2, 2);
+  for (int slot = 0; slot < 3; slot++)
+    GridPut(grid, slot / 2, slot % 2, BenchBranch(tree, 0));
+  tree->binCount++;
+  return Wrap(grid, bin);
+}
+
+void BenchSnapshotPhases(int depth, int fanout) {
+  struct Arena arena;
+  InitArena(&arena);
+
+  struct BenchTree tree = {&arena, depth, fanout, 0};
+  char name[32];
+  snprintf(name, sizeof(name), "snap-%dx%d", depth, fanout);
+
+  double start = BenchSeconds();
+  struct Bin *root = BenchSnapshotTree(&tree);
+  BenchReport(name, "build", tree.binCount, "bins", BenchSeconds() - start);
+
+  char(*names)[16] = (char(*)[16])AllocateBytes(16, tree.binCount, "name");
+  int named = BenchNameCells(root, names, 0);
+
+  const int passes = 10;
+  struct SnapshotBuffer buffer = {};
+  start = BenchSeconds();
+  const unsigned long long layoutHash = 0x5eed5eed5eed5eedull;
+  for (int pass = 0; pass < passes; pass++)
+    WriteSnapshot(root, layoutHash, &buffer);
+  BenchReport(name, "write", tree.binCount * passes, "bins", BenchSeconds() - start);
+
+  const char *path = "windy_bench.snapshot";
+  start = BenchSeconds();
+  bool saved = SaveSnapshot(&buffer, path);
+  BenchReport(name, "save", (int)(buffer.size / 1024), "KiB", BenchSeconds() - start);
+
+  struct Snapshot snapshot;
+  start = BenchSeconds();
+  bool opened = saved && OpenSnapshot(&snapshot, path);
+  BenchReport(name, "open", 1, "files", BenchSeconds() - start);
+  if (!opened)
+    FatalError("Could not map %s", path);
+
+  struct Arena loadArena;
+  InitArena(&loadArena);
+  struct Bin *loaded = NULL;
+  struct AllocationStats before = allocationStats;
+  start = BenchSeconds();
+  for (int pass = 0; pass < passes; pass++) {
+    ResetArena(&loadArena);
+    loaded = LoadSnapshot(&loadArena, &snapshot);
+  }
+  BenchReport(name, "load", tree.binCount * passes, "bins", BenchSeconds() - start);
+  BenchReportAllocations(name, "load", before);
+
+  // Writing the loaded tree again must give back the same bytes, layout hash included.
+  struct SnapshotBuffer again = {};
+  WriteSnapshot(loaded, SnapshotLayoutHash(&snapshot), &again);
+  bool identical = again.size == buffer.size && memcmp(again.bytes, buffer.bytes, buffer.size) == 0;
+  LayoutRoot(loaded, BenchScreen());
+  printf("%-12s %-10s %9d bins %9d named %9zu bytes %9s\n", name, "roundtrip", tree.binCount, named, buffer.size,
+         identical ? "identical" : "DIFFERENT");
+  BenchCheck(name, "roundtrip", identical);
+
+  CloseSnapshot(&snapshot);
+  remove(path);
+  ReleaseSnapshotBuffer(&again);
+  ReleaseSnapshotBuffer(&buffer);
+  ReleaseArena(&loadArena);
+  DestroyBin(root);
+  ReleaseArena(&arena);
+  FreeBytes(names);
+}
+
+void BenchSnapshots() {
+  BenchSnapshotPhases(5, 4);
+  BenchSnapshotPhases(7, 4);
+}
+
+struct BenchText {
+  size_t size;
+  size_t capacity;
+  char *text;
+};
+
+void BenchAppend(struct BenchText *text, const char *format, ...) {
+  for (;;) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text->text + text->size, text->capacity - text->size, format, args);
+    va_end(args);
+    if (text->size + length < text->capacity) {
+      text->size += length;
+      return;
+    }
+
+    size_t newCapacity = text->capacity ? text->capacity * 2 : 4096;
+    char *newText = AllocateArray(char, newCapacity);
+    if (text->text != NULL)
+      memcpy(newText, text->text, text->size + 1);
+    FreeBytes(text->text);
+    text->text = newText;
+    text->capacity = newCapacity;
+  }
+}
+
+void BenchWriteSizes(struct BenchText *text, const char *key, const struct Track *track, int count) {
+  if (TrackIsUniform(track, count))
+    return;
+
+  BenchAppend(text, ", \"%s\": [", key);
+  for (int slot = 0; slot < count; slot++) {
+    const struct SlotSize *size = &track->sizes[slot];
+    if (slot > 0)
+      BenchAppend(text, ", ");
+    if (size->min == 0 && size->max == 0)
+      BenchAppend(text, "%d", size->weight);
+    else
+      BenchAppend(text, "{\"weight\": %d, \"min\": %d, \"max\": %d}", size->weight, size->min, size->max);
+  }
+  BenchAppend(text, "]");
+}
+
+void BenchWriteSpans(struct BenchText *text, struct Grid *grid) {
+  bool first = true;
+  for (int row = 0; row < grid->rowCount; row++) {
+    for (int column = 0; column < grid->columnCount; column++) {
+      int rowSpan, columnSpan;
+      GridGetSpan(grid, row, column, &rowSpan, &columnSpan);
+      if (rowSpan == 1 && columnSpan == 1)
+        continue;
+      BenchAppend(text, first ? ", \"spans\": [" : ", ");
+      BenchAppend(text, "[%d, %d, %d, %d]", row, column, rowSpan, columnSpan);
+      first = false;
+    }
+  }
+  if (!first)
+    BenchAppend(text, "]");
+}
+
+// Writes bin in the layout file's syntax, one object per line so a mistake in it is easy to find.
+void BenchWriteLayoutBin(struct BenchText *text, struct Bin *bin) {
+  if (bin == NULL) {
+    BenchAppend(text, "null");
+    return;
+  }
+
+  struct Cell *cell = BinCell(bin);
+  if (cell != NULL) {
+    if (cell->subBin == NULL) {
+      BenchAppend(text, "\"%s\"", cell->name);
+      return;
+    }
+    BenchAppend(text, "{\"cell\": \"%s\", \"bin\": ", cell->name);
+    BenchWriteLayoutBin(text, cell->subBin);
+    BenchAppend(text, "}");
+    return;
+  }
+
+  if (bin->onLayoutFn == ShelfLayout) {
+    struct Shelf *shelf = Unwrap(struct Shelf, bin, bin);
+    BenchAppend(text, "\n{\"shelf\": \"%s\", \"slots\": [",
+                shelf->direction == ShelfDirection_Horizontal ? "horizontal" : "vertical");
+  } else if (bin->onLayoutFn == SwirlLayout) {
+    struct Swirl *swirl = Unwrap(struct Swirl, bin, bin);
+    BenchAppend(text, "\n{\"swirl\": %d, \"slots\": [", swirl->tightness);
+  } else if (bin->onLayoutFn == StackLayout) {
+    struct Stack *stack = Unwrap(struct Stack, bin, bin);
+    BenchAppend(text, "\n{\"stack\": \"%s\", \"slots\": [", stack->style == StackStyle_Tabs ? "tabs" : "depth");
+  } else {
+    struct Grid *grid = Unwrap(struct Grid, bin, bin);
+    BenchAppend(text, "\n{\"grid\": [%d, %d], \"slots\": [", grid->rowCount, grid->columnCount);
+  }
+  // Cells taken in by spans have no slot.
+  bool first = true;
+  for (int child = 0; child < BinChildCount(bin); child++) {
+    if (bin->onLayoutFn == GridLayout) {
+      struct Grid *grid = Unwrap(struct Grid, bin, bin);
+      int row = child / grid->columnCount;
+      int column = child % grid->columnCount;
+      if (GridFindSpan(grid, &row, &column))
+        continue;
+    }
+    if (!first)
+      BenchAppend(text, ", ");
+    first = false;
+    BenchWriteLayoutBin(text, BinChild(bin, child));
+  }
+  BenchAppend(text, "]");
+
+  if (bin->onLayoutFn == ShelfLayout) {
+    struct Shelf *shelf = Unwrap(struct Shelf, bin, bin);
+    BenchWriteSizes(text, "sizes", &shelf->track, shelf->slotCount);
+  } else if (bin->onLayoutFn == GridLayout) {
+    struct Grid *grid = Unwrap(struct Grid, bin, bin);
+    BenchWriteSizes(text, "rows", &grid->rows, grid->rowCount);
+    BenchWriteSizes(text, "columns", &grid->columns, grid->columnCount);
+    BenchWriteSpans(text, grid);
+  } else if (bin->onLayoutFn == StackLayout) {
+    struct Stack *stack = Unwrap(struct Stack, bin, bin);
+    if (stack->active != 0)
+      BenchAppend(text, ", \"active\": %d", stack->active);
+  }
+  BenchAppend(text, "}");
+}
+
+void BenchWriteLayout(struct BenchText *text, struct Bin *root, const char *errorAt) {
+  text->size = 0;
+  BenchAppend(text, "# Written by the layout benchmark.\n{\n\"monitors\": [\n{\"monitor\": \"*\", \"layout\": ");
+  BenchWriteLayoutBin(text, root);
+  BenchAppend(text, "},\n{\"monitor\": \"BENCH2\", \"layout\": ");
+  BenchAppend(text, "{\"shelf\": \"vertical\", \"slots\": [\"top\", %s]}}\n],\n", errorAt);
+  BenchAppend(text, "\"rules\": [\n");
+  BenchAppend(text, "{\"cell\": \"cell-1\", \"class\": \"^Bench[0-9]+$\", \"title\": \"(?i)report\"}\n]\n}\n");
+}
+
+void BenchLayoutPhases(int depth, int fanout) {
+  struct Arena arena;
+  InitArena(&arena);
+
+  struct BenchTree tree = {&arena, depth, fanout, 0};
+  char name[32];
+  snprintf(name, sizeof(name), "file-%dx%d", depth, fanout);
+
+  struct Bin *root = BenchSnapshotTree(&tree);
+  char(*names)[16] = (char(*)[16])AllocateBytes(16, tree.binCount, "name");
+  BenchNameCells(root, names, 0);
+
+  struct BenchText text = {};
+  BenchWriteLayout(&text, root, "\"bottom\"");
+
+  struct Layout layout;
+  InitLayout(&layout);
+  struct LayoutError error;
+  const int passes = 10;
+  double start = BenchSeconds();
+  for (int pass = 0; pass < passes; pass++)
+    if (!ParseLayout(&layout, text.text, text.size, &error))
+      FatalError("The benchmark layout is not valid: %d:%d %s", error.line, error.column, error.message);
+  double seconds = BenchSeconds() - start;
+  BenchReport(name, "parse", (int)(text.size * passes / 1024), "KiB", seconds);
+  BenchReport(name, "parse", tree.binCount * passes, "bins", seconds);
+
+  struct LayoutMonitor *monitor = FindLayoutMonitor(&layout, "DISPLAY1");
+  struct Arena buildArena;
+  InitArena(&buildArena);
+  struct Bin *built = NULL;
+  char *builtNames = NULL;
+  struct AllocationStats before = allocationStats;
+  start = BenchSeconds();
+  for (int pass = 0; pass < passes; pass++) {
+    if (built != NULL) {
+      DestroyBin(built);
+      FreeBytes(builtNames);
+    }
+    ResetArena(&buildArena);
+    built = BuildLayoutTree(monitor, &buildArena, &builtNames);
+  }
+  BenchReport(name, "build", tree.binCount * passes, "bins", BenchSeconds() - start);
+  BenchReportAllocations(name, "build", before);
+
+  // The built tree must write back to the same text.
+  struct BenchText again = {};
+  BenchWriteLayout(&again, built, "\"bottom\"");
+  bool identical = again.size == text.size && memcmp(again.text, text.text, text.size) == 0;
+  printf("%-12s %-10s %9d bins %9zu bytes %9s\n", name, "roundtrip", tree.binCount, text.size,
+         identical ? "identical" : "DIFFERENT");
+  BenchCheck(name, "roundtrip", identical);
+
+  // Parsing the same text again leaves every monitor's hash alone, so a reload would rebuild nothing.
+  unsigned long long hash = monitor->hash;
+  ParseLayout(&layout, text.text, text.size, &error);
+  bool unchanged = FindLayoutMonitor(&layout, "DISPLAY1")->hash == hash;
+  printf("%-12s %-10s %9s\n", name, "reparse", unchanged ? "unchanged" : "CHANGED");
+  BenchCheck(name, "reparse", unchanged);
+
+  // A mistake on the last lines is found after the whole tree is read, and the layout already parsed survives it.
+  BenchWriteLayout(&again, built, "{\"shelf\": \"diagonal\", \"slots\": [\"x\"]}");
+  start = BenchSeconds();
+  bool parsed = ParseLayout(&layout, again.text, again.size, &error);
+  BenchReport(name, "reject", 1, "files", BenchSeconds() - start);
+  printf("%-12s %-10s %9s at %d:%d %s; %d monitors kept\n", name, "error", parsed ? "ACCEPTED" : "rejected",
+         error.line, error.column, error.message, layout.monitorCount);
+  BenchCheck(name, "error", !parsed && layout.monitorCount > 0);
+
+  DestroyBin(built);
+  FreeBytes(builtNames);
+  ReleaseArena(&buildArena);
+  ReleaseLayout(&layout);
+  FreeBytes(again.text);
+  FreeBytes(text.text);
+  DestroyBin(root);
+  ReleaseArena(&arena);
+  FreeBytes(names);
+}
+
+void BenchLayouts() {
+  BenchLayoutPhases(5, 4);
+  BenchLayoutPhases(7, 4);
+}
+
+// Edits a layout file the way a person would, splitting a few cells deep in the tree and renaming one, then patches
+// the live tree built from the old file to match the new one. Then saves a file in a burst of writes and times how
+// long the watcher takes to load it.
+
+struct Cell *BenchFindLeaf(struct Bin *bin, int *skip) {
+  struct Cell *cell = BinCell(bin);
+  if (cell != NULL && cell->subBin == NULL && (*skip)-- == 0)
+    return cell;
+
+  for (int child = 0; child < BinChildCount(bin); child++) {
+    struct Cell *leaf = BinChild(bin, child) != NULL ? BenchFindLeaf(BinChild(bin, child), skip) : NULL;
+    if (leaf != NULL)
+      return leaf;
+  }
+  return NULL;
+}
+
+void BenchEditLayout(struct Bin *root, int leafCount, char (*newNames)[16]) {
+  for (int edit = 0; edit < 3; edit++) {
+    int skip = leafCount * (edit + 1) / 4;
+    struct Cell *leaf = BenchFindLeaf(root, &skip);
+    struct Shelf *shelf = NewShelf(BinArena(root), ShelfDirection_Vertical, 2);
+    for (int slot = 0; slot < 2; slot++) {
+      snprintf(newNames[edit * 2 + slot], 16, "new-%d", edit * 2 + slot);
+      CellSetName(BinCell(ShelfGet(shelf, slot)), newNames[edit * 2 + slot]);
+    }
+    CellSetSubBin(leaf, Wrap(shelf, bin));
+  }
+
+  int skip = leafCount / 8;
+  CellSetName(BenchFindLeaf(root, &skip), "renamed");
+}
+
+void BenchReloadPhases(int depth, int fanout) {
+  struct Arena arena;
+  InitArena(&arena);
+
+  struct BenchTree tree = {&arena, depth, fanout, 0};
+  char name[32];
+  snprintf(name, sizeof(name), "reload-%dx%d", depth, fanout);
+
+  struct Bin *source = BenchSnapshotTree(&tree);
+  char(*names)[16] = (char(*)[16])AllocateBytes(16, tree.binCount, "name");
+  BenchNameCells(source, names, 0);
+  struct BenchText before = {};
+  BenchWriteLayout(&before, source, "\"bottom\"");
+
+  struct Layout layout;
+  InitLayout(&layout);
+  struct LayoutError error;
+  if (!ParseLayout(&layout, before.text, before.size, &error))
+    FatalError("The benchmark layout is not valid: %d:%d %s", error.line, error.column, error.message);
+
+  struct Arena liveArena;
+  InitArena(&liveArena);
+  char *liveNames;
+  struct Bin *live = BuildLayoutTree(FindLayoutMonitor(&layout, "DISPLAY1"), &liveArena, &liveNames);
+  int windows = BenchLinkWindows(live, 0);
+  LayoutRoot(live, BenchScreen());
+  struct Placements placements;
+  InitPlacements(&placements);
+  ApplyPlacements(&placements, live);
+
+  char newNames[6][16];
+  BenchEditLayout(source, windows, newNames);
+  struct BenchText after = {};
+  BenchWriteLayout(&after, source, "\"bottom\"");
+
+  double start = BenchSeconds();
+  if (!ParseLayout(&layout, after.text, after.size, &error))
+    FatalError("The edited benchmark layout is not valid: %d:%d %s", error.line, error.column, error.message);
+  BenchReport(name, "parse", (int)(after.size / 1024), "KiB", BenchSeconds() - start);
+
+  char *nextNames;
+  start = BenchSeconds();
+  struct Bin *next = BuildLayoutTree(FindLayoutMonitor(&layout, "DISPLAY1"), &liveArena, &nextNames);
+  BenchReport(name, "build", tree.binCount, "bins", BenchSeconds() - start);
+
+  struct PatchStats stats;
+  start = BenchSeconds();
+  live = PatchTree(live, next, &stats);
+  FreeBytes(liveNames);
+  liveNames = nextNames;
+  BenchReport(name, "patch", tree.binCount, "bins", BenchSeconds() - start);
+  printf("%-12s %-10s %9d kept %9d added %9d removed %9d renamed %9d moved\n", name, "patch", stats.kept,
+         stats.added, stats.removed, stats.renamed, stats.windowsMoved);
+
+  // Only the changed subtrees are laid out again, and only the windows in them placed, in one batch.
+  struct LayoutStats beforeLayout = layoutStats;
+  struct Placements beforePlacements = placements;
+  HeadlessReset();
+  start = BenchSeconds();
+  LayoutRoot(live, BenchScreen());
+  ApplyPlacements(&placements, live);
+  BenchReportPlacements(name, "apply", 1, BenchSeconds() - start, &placements, beforePlacements);
+  BenchReportLayout(name, "apply", beforeLayout);
+
+  struct BenchText again = {};
+  BenchWriteLayout(&again, live, "\"bottom\"");
+  bool identical = again.size == after.size && memcmp(again.text, after.text, after.size) == 0;
+  printf("%-12s %-10s %9d bins %9d windows %9d held %9s\n", name, "result", tree.binCount, windows,
+         BenchCountWindowCells(live), identical ? "identical" : "DIFFERENT");
+  BenchCheck(name, "result", identical);
+
+  ReleasePlacements(&placements);
+  DestroyBin(live);
+  FreeBytes(liveNames);
+  ReleaseArena(&liveArena);
+  ReleaseLayout(&layout);
+  FreeBytes(again.text);
+  FreeBytes(after.text);
+  FreeBytes(before.text);
+  DestroyBin(source);
+  ReleaseArena(&arena);
+  FreeBytes(names);
+  ReleaseWindowTracker();
+}
+
+struct BenchWatch {
+  struct Layout layout;
+  std::atomic<int> loads;
+  std::atomic<int> failures;
+  double loadedAt;
+};
+
+// Runs on the watcher thread.
+void BenchWatchLoad(void *context, const char *path, double) {
+  struct BenchWatch *watch = (struct BenchWatch *)context;
+  struct LayoutError error;
+  if (!ReadLayoutFile(&watch->layout, path, &error))
+    watch->failures++;
+  watch->loadedAt = FileWatchClock();
+  watch->loads++;
+}
+
+bool BenchWaitForLoads(struct BenchWatch *watch, int loads) {
+  for (int wait = 0; wait < 2000 && watch->loads.load() < loads; wait++)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  return watch->loads.load() >= loads;
+}
+
+void BenchWatcher() {
+  const char *name = "watch";
+  const char *path = "windy_bench_layout.json";
+  const double debounce = 0.05;
+
+  struct Arena arena;
+  InitArena(&arena);
+  struct BenchTree tree = {&arena, 5, 4, 0};
+  struct Bin *root = BenchSnapshotTree(&tree);
+  char(*names)[16] = (char(*)[16])AllocateBytes(16, tree.binCount, "name");
+  BenchNameCells(root, names, 0);
+  struct BenchText text = {};
+  BenchWriteLayout(&text, root, "\"bottom\"");
+
+  remove(path);
+  struct BenchWatch watch;
+  InitLayout(&watch.layout);
+  watch.loads = 0;
+  watch.failures = 0;
+  struct FileWatcher *watcher = StartFileWatcher(path, debounce, BenchWatchLoad, &watch);
+  if (watcher == NULL)
+    FatalError("Could not watch %s", path);
+
+  // A save that truncates, writes in pieces and closes, as editors do; only the finished file should be loaded.
+  const int pieces = 8;
+  double start = FileWatchClock();
+  FILE *file = fopen(path, "wb");
+  for (int piece = 0; piece < pieces; piece++) {
+    size_t from = text.size * piece / pieces;
+    fwrite(text.text + from, 1, text.size * (piece + 1) / pieces - from, file);
+    fflush(file);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  fclose(file);
+  double written = FileWatchClock();
+  bool loaded = BenchWaitForLoads(&watch, 1);
+
+  struct FileWatchStats stats = GetFileWatchStats(watcher);
+  printf("%-12s %-10s %9lld events %9lld loads %9d failed %9d monitors\n", name, "burst", stats.events, stats.loads,
+         watch.failures.load(), loaded ? watch.layout.monitorCount : 0);
+  BenchCheck(name, "burst", loaded && watch.failures.load() == 0);
+  printf("%-12s %-10s %9.1f ms writing %9.1f ms to load %9.1f ms debounce\n", name, "burst",
+         (written - start) * 1000, (watch.loadedAt - written) * 1000, debounce * 1000);
+
+  // One more save, timed from the write to the parsed layout.
+  start = FileWatchClock();
+  file = fopen(path, "wb");
+  fwrite(text.text, 1, text.size, file);
+  fclose(file);
+  loaded = BenchWaitForLoads(&watch, 2);
+  stats = GetFileWatchStats(watcher);
+  printf("%-12s %-10s %9.1f ms to load %9.1f ms latency %9zu bytes %9s\n", name, "save",
+         (watch.loadedAt - start) * 1000, stats.lastLatency * 1000, text.size, loaded ? "loaded" : "MISSED");
+  BenchCheck(name, "save", loaded && watch.failures.load() == 0);
+
+  StopFileWatcher(watcher);
+  remove(path);
+  ReleaseLayout(&watch.layout);
+  FreeBytes(text.text);
+  DestroyBin(root);
+  ReleaseArena(&arena);
+  FreeBytes(names);
+}
+
+void BenchReloads() {
+  BenchReloadPhases(5, 4);
+  BenchReloadPhases(7, 4);
+  BenchWatcher();
+}
+
+// Four monitors at different scales, each with a tree full of windows, as the monitor manager in windy.cpp keeps them.
+// Laying out one monitor after another must not lay either out again in full just because the dimensions were
+// switched, and a display change that touches several monitors must move their windows in one batch.
+
+#define BENCH_MONITORS 4
+
+struct BenchMonitor {
+  struct Arena arena;
+  struct Bin *root;
+  struct Placements placements;
+  struct Bounds bounds;
+  float scale;
+  float layoutScale;
+  bool changed;
+};
+
+void BenchLayoutMonitor(struct BenchMonitor *monitor) {
+  LayoutRootAtScale(monitor->root, monitor->bounds, monitor->scale, &monitor->layoutScale);
+}
+
+void BenchReflowMonitors(const char *name, const char *phase, struct BenchMonitor *monitors,
+                         struct PlacementList *batch) {
+  struct LayoutStats before = layoutStats;
+  HeadlessReset();
+  double start = BenchSeconds();
+  batch->count = 0;
+  int reflowed = 0;
+  for (int index = 0; index < BENCH_MONITORS; index++) {
+    struct BenchMonitor *monitor = &monitors[index];
+    if (!monitor->changed)
+      continue;
+    monitor->changed = false;
+    BenchLayoutMonitor(monitor);
+    CollectPlacements(&monitor->placements, monitor->root, batch);
+    reflowed++;
+  }
+  if (batch->count > 0)
+    PlaceWindows(batch->placements, batch->count);
+  BenchReport(name, phase, reflowed, "monitors", BenchSeconds() - start);
+  printf("%-12s %-10s %9lld visited %9d placed %9d calls\n", name, phase, layoutStats.visited - before.visited,
+         headless.placementCount, headless.placementBatchCount);
+}
+
+void BenchMonitors() {
+  const char *name = "monitors";
+  const float scales[BENCH_MONITORS] = {
+      1.0f,
+      1.5f,
+      1.25f,
+      2.0f,
+  };
+
+  struct BenchMonitor monitors[BENCH_MONITORS];
+  int windows = 0;
+  for (int index = 0; index < BENCH_MONITORS; index++) {
+    struct BenchMonitor *monitor = &monitors[index];
+    InitArena(&monitor->arena);
+    struct BenchTree tree = {&monitor->arena, 5, 4, 0};
+    monitor->root = BenchBranch(&tree, 0);
+    windows = BenchLinkWindows(monitor->root, windows);
+    InitPlacements(&monitor->placements);
+    monitor->bounds = BenchScreen();
+    monitor->bounds.x = index * BENCH_WIDTH;
+    monitor->scale = scales[index];
+    monitor->layoutScale = 0;
+    monitor->changed = true;
+  }
+
+  struct PlacementList batch = {};
+  BenchReflowMonitors(name, "startup", monitors, &batch);
+
+  // The overlay moving between monitors, each laid out at its own scale with nothing changed.
+  const int switches = 1000;
+  struct LayoutStats before = layoutStats;
+  double start = BenchSeconds();
+  for (int pass = 0; pass < switches; pass++)
+    BenchLayoutMonitor(&monitors[pass % BENCH_MONITORS]);
+  BenchReport(name, "switch", switches, "layouts", BenchSeconds() - start);
+  BenchReportLayout(name, "switch", before);
+  BenchCheck(name, "switch", layoutStats.visited == before.visited);
+
+  // The second monitor's DPI changes, then the task bar grows on the last two.
+  monitors[1].scale = 1.75f;
+  monitors[1].changed = true;
+  BenchReflowMonitors(name, "dpi", monitors, &batch);
+
+  for (int index = 2; index < BENCH_MONITORS; index++) {
+    monitors[index].bounds.height -= 40;
+    monitors[index].changed = true;
+  }
+  BenchReflowMonitors(name, "workarea", monitors, &batch);
+
+  SetDimensionScale(1);
+  ReleasePlacementList(&batch);
+  for (int index = 0; index < BENCH_MONITORS; index++) {
+    ReleasePlacements(&monitors[index].placements);
+    DestroyBin(monitors[index].root);
+    ReleaseArena(&monitors[index].arena);
+  }
+  ReleaseWindowTracker();
+}
+
+struct Benchmark {
+  const char *name;
+  void (*runFn)();
+};
+
+// Shares a shelf and a grid out by random weights, some slots with limits, and checks that every pixel is handed out,
+// that the limits hold and that hit testing the cached offsets finds the same slot as testing every slot's bounds.
+
+struct SlotSize BenchSlotSize(int slot) {
+  struct SlotSize size = uniformSlotSize;
+  size.weight = 1 + BenchRandom(4);
+  if (slot % 7 == 3)
+    size.min = 40;
+  else if (slot % 11 == 5)
+    size.max = 12;
+  return size;
+}
+
+// Returns how many of the slots break their limits. length is the container's, and space what the slots share.
+int BenchCheckTrack(struct Track *track, int count, int length, int *space) {
+  const int *offsets = TrackOffsets(track, count, length, track->inset);
+  int broken = 0;
+  *space = 0;
+  for (int slot = 0; slot < count; slot++) {
+    int size = offsets[slot + 1] - offsets[slot] - track->inset;
+    const struct SlotSize *limits = &track->sizes[slot];
+    if (size < limits->min || (limits->max > 0 && size > limits->max))
+      broken++;
+    *space += size;
+  }
+  return broken;
+}
+
+void BenchSizePhases(int slotCount) {
+  struct Arena arena;
+  InitArena(&arena);
+
+  char name[32];
+  snprintf(name, sizeof(name), "sizes-%d", slotCount);
+
+  int inset = dimensions[Dimension_BorderInset];
+  dimensions[Dimension_BorderInset] = 2;
+
+  struct Shelf *shelf = NewShelf(&arena, ShelfDirection_Horizontal, slotCount);
+  struct Grid *grid = NewEmptyGrid(&arena, slotCount / 8, slotCount / 8);
+  for (int slot = 0; slot < slotCount; slot++)
+    ShelfSetSize(shelf, slot, BenchSlotSize(slot));
+  for (int row = 0; row < grid->rowCount; row++) {
+    GridSetRowSize(grid, row, BenchSlotSize(row));
+    for (int column = 0; column < grid->columnCount; column++)
+      GridPut(grid, row, column, Wrap(NewCell(&arena), bin));
+  }
+  for (int column = 0; column < grid->columnCount; column++)
+    GridSetColumnSize(grid, column, BenchSlotSize(column));
+
+  // Resizing by a pixel at a time makes every pass share the space out again.
+  const int passes = 1000;
+  struct Bounds screen = BenchScreen();
+  double start = BenchSeconds();
+  for (int pass = 0; pass < passes; pass++) {
+    screen.width = BENCH_WIDTH - pass % 2;
+    LayoutRoot(&shelf->bin, screen);
+  }
+  BenchReport(name, "shelf", slotCount * passes, "slots", BenchSeconds() - start);
+
+  start = BenchSeconds();
+  for (int pass = 0; pass < passes; pass++) {
+    screen.height = BENCH_HEIGHT - pass % 2;
+    LayoutRoot(&grid->bin, screen);
+  }
+  BenchReport(name, "grid", grid->rowCount * grid->columnCount * passes, "cells", BenchSeconds() - start);
+
+  // Every pixel the insets leave goes to a slot unless the limits keep it back, where dividing evenly drops the
+  // remainder of every division.
+  int lengths[3] = {
+      shelf->bin.bounds.width,
+      grid->bin.bounds.height,
+      grid->bin.bounds.width,
+  };
+  struct Track *tracks[3] = {
+      &shelf->track,
+      &grid->rows,
+      &grid->columns,
+  };
+  int counts[3] = {
+      shelf->slotCount,
+      grid->rowCount,
+      grid->columnCount,
+  };
+  const char *phases[3] = {
+      "shelf",
+      "rows",
+      "columns",
+  };
+  for (int track = 0; track < 3; track++) {
+    int space;
+    int broken = BenchCheckTrack(tracks[track], counts[track], lengths[track], &space);
+    int available = lengths[track] - (counts[track] + 1) * dimensions[Dimension_BorderInset];
+    printf("%-12s %-10s %9d pixels %9d shared %9d broken limits %9d lost evenly\n", name, phases[track], available,
+           space, broken, available % counts[track]);
+    BenchCheck(name, phases[track], broken == 0);
+  }
+
+  // The slot found from the offsets must be the one whose bounds hold the point.
+  const int hits = 200000;
+  struct Point *points = AllocateArray(struct Point, hits);
+  for (int hit = 0; hit < hits; hit++)
+    points[hit] = BenchRandomPoint();
+  int found = 0;
+  start = BenchSeconds();
+  for (int hit = 0; hit < hits; hit++)
+    found += ShelfSlotAtPoint(shelf, points[hit]) >= 0;
+  BenchReport(name, "hit-shelf", hits, "points", BenchSeconds() - start);
+  start = BenchSeconds();
+  for (int hit = 0; hit < hits; hit++) {
+    int row, column;
+    GridCellAtPoint(grid, points[hit], &row, &column);
+    found += row >= 0;
+  }
+  BenchReport(name, "hit-grid", hits, "points", BenchSeconds() - start);
+
+  int wrong = 0;
+  for (int hit = 0; hit < hits; hit += 97) {
+    int expected = -1;
+    for (int slot = 0; slot < shelf->slotCount; slot++)
+      if (PointInBounds(points[hit], ShelfMakeCellBounds(shelf, slot)))
+        expected = slot;
+    wrong += ShelfSlotAtPoint(shelf, points[hit]) != expected;
+  }
+  printf("%-12s %-10s %9d found %9d wrong\n", name, "hits", found, wrong);
+  BenchCheck(name, "hits", wrong == 0);
+
+  // Sizes survive a snapshot, and a layout file, written and read back.
+  struct SnapshotBuffer buffer = {};
+  struct SnapshotBuffer again = {};
+  WriteSnapshot(&grid->bin, 0, &buffer);
+  struct Arena loadArena;
+  InitArena(&loadArena);
+  struct Bin *loaded = ReadSnapshot(&loadArena, buffer.bytes, buffer.size);
+  WriteSnapshot(loaded, 0, &again);
+  bool identical = again.size == buffer.size && memcmp(again.bytes, buffer.bytes, buffer.size) == 0;
+
+  char(*names)[16] = (char(*)[16])AllocateBytes(16, slotCount, "name");
+  BenchNameCells(&shelf->bin, names, 0);
+  struct BenchText text = {};
+  BenchWriteLayout(&text, &shelf->bin, "\"bottom\"");
+  struct Layout layout;
+  InitLayout(&layout);
+  struct LayoutError error;
+  if (!ParseLayout(&layout, text.text, text.size, &error))
+    FatalError("The benchmark layout is not valid: %d:%d %s", error.line, error.column, error.message);
+  char *builtNames = NULL;
+  struct Bin *built = BuildLayoutTree(FindLayoutMonitor(&layout, "DISPLAY1"), &loadArena, &builtNames);
+  struct BenchText textAgain = {};
+  BenchWriteLayout(&textAgain, built, "\"bottom\"");
+  bool written = textAgain.size == text.size && memcmp(textAgain.text, text.text, text.size) == 0;
+  printf("%-12s %-10s %9zu bytes %9s\n", name, "snapshot", buffer.size, identical ? "identical" : "DIFFERENT");
+  printf("%-12s %-10s %9zu bytes %9s\n", name, "file", text.size, written ? "identical" : "DIFFERENT");
+  BenchCheck(name, "snapshot", identical);
+  BenchCheck(name, "file", written);
+
+  DestroyBin(built);
+  FreeBytes(builtNames);
+  DestroyBin(loaded);
+  ReleaseLayout(&layout);
+  FreeBytes(names);
+  FreeBytes(text.text);
+  FreeBytes(textAgain.text);
+  ReleaseSnapshotBuffer(&again);
+  ReleaseSnapshotBuffer(&buffer);
+  ReleaseArena(&loadArena);
+  FreeBytes(points);
+  DestroyBin(&grid->bin);
+  DestroyBin(&shelf->bin);
+  ReleaseArena(&arena);
+  dimensions[Dimension_BorderInset] = inset;
+}
+
+void BenchSizes() {
+  BenchSizePhases(64);
+  BenchSizePhases(512);
+}
+
+// The spans the grid should have, kept the obvious way to check the bitmaps against.
+struct BenchSpans {
+  int count;
+  struct SnapshotSpan *spans;
+  // The index of the span over each cell, or -1.
+  int *owners;
+};
+
+bool BenchSpanMeets(const struct SnapshotSpan *span, int row, int column, int rowSpan, int columnSpan) {
+  return span->row < row + rowSpan && row < span->row + span->rowCount && span->column < column + columnSpan &&
+         column < span->column + span->columnCount;
+}
+
+// Does what GridSetSpan should, returning whether it should succeed.
+bool BenchModelSetSpan(struct BenchSpans *model, struct Grid *grid, int row, int column, int rowSpan, int columnSpan) {
+  if (row + rowSpan > grid->rowCount || column + columnSpan > grid->columnCount)
+    return false;
+  int own = -1;
+  for (int index = 0; index < model->count; index++) {
+    struct SnapshotSpan *span = &model->spans[index];
+    if (span->row == row && span->column == column)
+      own = index;
+    else if (BenchSpanMeets(span, row, column, rowSpan, columnSpan))
+      return false;
+  }
+
+  if (own < 0) {
+    own = model->count++;
+    model->spans[own].row = row;
+    model->spans[own].column = column;
+  }
+  model->spans[own].rowCount = rowSpan;
+  model->spans[own].columnCount = columnSpan;
+  if (rowSpan == 1 && columnSpan == 1)
+    model->spans[own] = model->spans[--model->count];
+  return true;
+}
+
+// Moves the spans for a row or column inserted before at, or deleted at, along one axis.
+void BenchModelShift(struct BenchSpans *model, bool rows, int at, bool inserted) {
+  for (int index = 0; index < model->count; index++) {
+    struct SnapshotSpan *span = &model->spans[index];
+    int *start = rows ? &span->row : &span->column;
+    int *length = rows ? &span->rowCount : &span->columnCount;
+    if (inserted && *start >= at)
+      (*start)++;
+    else if (inserted && at < *start + *length)
+      (*length)++;
+    else if (!inserted && *start > at)
+      (*start)--;
+    else if (!inserted && at < *start + *length)
+      (*length)--;
+
+    if ((span->rowCount == 1 && span->columnCount == 1) || *length == 0)
+      model->spans[index--] = model->spans[--model->count];
+  }
+}
+
+// Returns how many cells of the grid disagree with the model about what covers them and whether they hold a bin.
+int BenchCheckSpans(struct BenchSpans *model, struct Grid *grid) {
+  int cellCount = grid->rowCount * grid->columnCount;
+  for (int cell = 0; cell < cellCount; cell++)
+    model->owners[cell] = -1;
+  for (int index = 0; index < model->count; index++) {
+    struct SnapshotSpan *span = &model->spans[index];
+    for (int row = span->row; row < span->row + span->rowCount; row++)
+      for (int column = span->column; column < span->column + span->columnCount; column++)
+        model->owners[row * grid->columnCount + column] = index;
+  }
+
+  int wrong = 0;
+  for (int row = 0; row < grid->rowCount; row++) {
+    for (int column = 0; column < grid->columnCount; column++) {
+      int owner = model->owners[row * grid->columnCount + column];
+      struct SnapshotSpan *span = owner >= 0 ? &model->spans[owner] : NULL;
+      bool anchor = span == NULL || (span->row == row && span->column == column);
+      int spanRow = row;
+      int spanColumn = column;
+      bool covered = GridFindSpan(grid, &spanRow, &spanColumn);
+      int rowSpan, columnSpan;
+      GridGetSpan(grid, row, column, &rowSpan, &columnSpan);
+      if (covered == anchor || (covered && (spanRow != span->row || spanColumn != span->column)) ||
+          (grid->bins[row * grid->columnCount + column] == NULL) == anchor)
+        wrong++;
+      else if (anchor && (rowSpan != (span ? span->rowCount : 1) || columnSpan != (span ? span->columnCount : 1)))
+        wrong++;
+    }
+  }
+  return wrong;
+}
+
+void BenchSpanPhases(int size) {
+  struct Arena arena;
+  InitArena(&arena);
+
+  char name[32];
+  snprintf(name, sizeof(name), "spans-%d", size);
+
+  struct Grid *grid = NewEmptyGrid(&arena, size, size);
+  for (int row = 0; row < size; row++)
+    for (int column = 0; column < size; column++)
+      GridPut(grid, row, column, Wrap(NewCell(&arena), bin));
+
+  // The grid stays between half and twice its size, so the model never holds more spans than that has cells.
+  struct BenchSpans model = {};
+  int capacity = 4 * size * size;
+  model.spans = AllocateArray(struct SnapshotSpan, capacity);
+  model.owners = AllocateArray(int, capacity);
+
+  const int edits = 20000;
+  int refused = 0;
+  int wrong = 0;
+  double spanSeconds = 0;
+  double shiftSeconds = 0;
+  int spanEdits = 0;
+  for (int edit = 0; edit < edits; edit++) {
+    int choice = BenchRandom(10);
+    bool rows = choice % 2 == 0;
+    int count = rows ? grid->rowCount : grid->columnCount;
+    double start = BenchSeconds();
+    if (choice < 8) {
+      int row = BenchRandom(grid->rowCount);
+      int column = BenchRandom(grid->columnCount);
+      int rowSpan = 1 + BenchRandom(4);
+      int columnSpan = 1 + BenchRandom(4);
+      bool set = GridSetSpan(grid, row, column, rowSpan, columnSpan);
+      spanSeconds += BenchSeconds() - start;
+      spanEdits++;
+      refused += !set;
+      wrong += set != BenchModelSetSpan(&model, grid, row, column, rowSpan, columnSpan);
+    } else if (count < 2 * size && (count <= size / 2 || BenchRandom(2) == 0)) {
+      int at = BenchRandom(count + 1);
+      if (rows)
+        GridInsertRow(grid, at);
+      else
+        GridInsertColumn(grid, at);
+      shiftSeconds += BenchSeconds() - start;
+      BenchModelShift(&model, rows, at, true);
+    } else {
+      int at = BenchRandom(count);
+      if (rows)
+        GridDeleteRow(grid, at);
+      else
+        GridDeleteColumn(grid, at);
+      shiftSeconds += BenchSeconds() - start;
+      BenchModelShift(&model, rows, at, false);
+    }
+
+    if (edit % 1000 == 999)
+      wrong += BenchCheckSpans(&model, grid);
+  }
+  BenchReport(name, "set", spanEdits, "spans", spanSeconds);
+  BenchReport(name, "shift", edits - spanEdits, "lines", shiftSeconds);
+  printf("%-12s %-10s %9d spans %9d refused %9d wrong\n", name, "edits", model.count, refused, wrong);
+  BenchCheck(name, "edits", wrong == 0);
+
+  // A point belongs to the one cell whose bounds, which take in its span, hold it.
+  LayoutRoot(&grid->bin, BenchScreen());
+  const int hits = 200000;
+  struct Point *points = AllocateArray(struct Point, hits);
+  for (int hit = 0; hit < hits; hit++)
+    points[hit] = BenchRandomPoint();
+  int found = 0;
+  double start = BenchSeconds();
+  for (int hit = 0; hit < hits; hit++) {
+    int row, column;
+    GridCellAtPoint(grid, points[hit], &row, &column);
+    found += row >= 0;
+  }
+  BenchReport(name, "hit", hits, "points", BenchSeconds() - start);
+
+  int wrongHits = 0;
+  for (int hit = 0; hit < hits; hit += 997) {
+    int expected = -1;
+    for (int row = 0; row < grid->rowCount; row++) {
+      for (int column = 0; column < grid->columnCount; column++) {
+        int spanRow = row;
+        int spanColumn = column;
+        if (!GridFindSpan(grid, &spanRow, &spanColumn) &&
+            PointInBounds(points[hit], GridMakeCellBounds(grid, row, column)))
+          expected = row * grid->columnCount + column;
+      }
+    }
+    int row, column;
+    GridCellAtPoint(grid, points[hit], &row, &column);
+    wrongHits += (row < 0 ? -1 : row * grid->columnCount + column) != expected;
+  }
+  printf("%-12s %-10s %9d found %9d wrong\n", name, "hits", found, wrongHits);
+  BenchCheck(name, "hits", wrongHits == 0);
+
+  // Spans survive a snapshot, and a layout file, written and read back.
+  struct SnapshotBuffer buffer = {};
+  struct SnapshotBuffer again = {};
+  WriteSnapshot(&grid->bin, 0, &buffer);
+  struct Arena loadArena;
+  InitArena(&loadArena);
+  struct Bin *loaded = ReadSnapshot(&loadArena, buffer.bytes, buffer.size);
+  WriteSnapshot(loaded, 0, &again);
+  bool identical = again.size == buffer.size && memcmp(again.bytes, buffer.bytes, buffer.size) == 0;
+
+  char(*names)[16] = (char(*)[16])AllocateBytes(16, grid->rowCount * grid->columnCount, "name");
+  BenchNameCells(&grid->bin, names, 0);
+  struct BenchText text = {};
+  BenchWriteLayout(&text, &grid->bin, "\"bottom\"");
+  struct Layout layout;
+  InitLayout(&layout);
+  struct LayoutError error;
+  if (!ParseLayout(&layout, text.text, text.size, &error))
+    FatalError("The benchmark layout is not valid: %d:%d %s", error.line, error.column, error.message);
+  char *builtNames = NULL;
+  struct Bin *built = BuildLayoutTree(FindLayoutMonitor(&layout, "DISPLAY1"), &loadArena, &builtNames);
+  struct BenchText textAgain = {};
+  BenchWriteLayout(&textAgain, built, "\"bottom\"");
+  bool written = textAgain.size == text.size && memcmp(textAgain.text, text.text, text.size) == 0;
+  printf("%-12s %-10s %9zu bytes %9s\n", name, "snapshot", buffer.size, identical ? "identical" : "DIFFERENT");
+  printf("%-12s %-10s %9zu bytes %9s\n", name, "file", text.size, written ? "identical" : "DIFFERENT");
+  BenchCheck(name, "snapshot", identical);
+  BenchCheck(name, "file", written);
+
+  DestroyBin(built);
+  FreeBytes(builtNames);
+  DestroyBin(loaded);
+  ReleaseLayout(&layout);
+  FreeBytes(names);
+  FreeBytes(text.text);
+  FreeBytes(textAgain.text);
+  ReleaseSnapshotBuffer(&again);
+  ReleaseSnapshotBuffer(&buffer);
+  ReleaseArena(&loadArena);
+  FreeBytes(points);
+  FreeBytes(model.owners);
+  FreeBytes(model.spans);
+  DestroyBin(&grid->bin);
+  ReleaseArena(&arena);
+}
+
+void BenchSpans() {
+  BenchSpanPhases(64);
+  BenchSpanPhases(256);
+}
+
+// The slot whose window shows at point, found by testing every frame from the top down, or -1.
+int BenchTopFrame(struct Swirl *swirl, struct Point point) {
+  for (int slot = 0; slot < swirl->slotCount; slot++)
+    if (PointInBounds(point, SwirlMakeCellBounds(swirl, slot)))
+      return slot;
+  return -1;
+}
+
+// Returns whether the windows are stacked, top first, in the order of the slots holding them.
+bool BenchStackedInOrder(struct Swirl *swirl) {
+  int at = 0;
+  for (int slot = 0; slot < swirl->slotCount; slot++) {
+    struct Cell *cell = BinCell(SwirlGet(swirl, slot));
+    while (at < headless.zCount && headless.zOrder[at] != cell->hWnd)
+      at++;
+    if (at == headless.zCount)
+      return false;
+  }
+  return true;
+}
+
+void BenchSwirlPhases(int slotCount) {
+  struct Arena arena;
+  InitArena(&arena);
+
+  char name[32];
+  snprintf(name, sizeof(name), "swirl-%d", slotCount);
+
+  struct Swirl *swirl = NewSwirl(&arena, slotCount, SWIRL_TIGHTNESS);
+  BenchAssignWindows(&swirl->bin, 0);
+  LayoutRoot(&swirl->bin, BenchScreen());
+
+  // Resizing makes the frames again on every pass; a dirty swirl at the same size reuses them.
+  const int passes = 1000;
+  struct Bounds screen = BenchScreen();
+  double start = BenchSeconds();
+  for (int pass = 0; pass < passes; pass++) {
+    screen.width = BENCH_WIDTH - pass % 2;
+    LayoutRoot(&swirl->bin, screen);
+  }
+  BenchReport(name, "resize", slotCount * passes, "slots", BenchSeconds() - start);
+
+  start = BenchSeconds();
+  for (int pass = 0; pass < passes; pass++) {
+    MarkLayoutDirty(&swirl->bin);
+    LayoutRoot(&swirl->bin, screen);
+  }
+  BenchReport(name, "cached", slotCount * passes, "slots", BenchSeconds() - start);
+
+  // A corner found must be the window that shows there, and where a corner shows it must be found.
+  const int hits = 200000;
+  struct Point *points = AllocateArray(struct Point, hits);
+  for (int hit = 0; hit < hits; hit++)
+    points[hit] = BenchRandomPoint();
+  int found = 0;
+  start = BenchSeconds();
+  for (int hit = 0; hit < hits; hit++)
+    found += SwirlSlotAtPoint(swirl, points[hit]) > 0;
+  BenchReport(name, "hit", hits, "points", BenchSeconds() - start);
+
+  int wrong = 0;
+  for (int hit = 0; hit < hits; hit += 7) {
+    int slot = SwirlSlotAtPoint(swirl, points[hit]);
+    int top = BenchTopFrame(swirl, points[hit]);
+    if (slot >= 0) {
+      wrong += slot != top;
+      continue;
+    }
+    if (top <= 0)
+      continue;
+    struct Bounds frame = SwirlMakeCellBounds(swirl, top);
+    int corner = (top - 1) % 4;
+    struct Bounds square = {
+        corner == 1 || corner == 2 ? frame.x + frame.width - swirl->step : frame.x,
+        corner >= 2 ? frame.y + frame.height - swirl->step : frame.y,
+        swirl->step,
+        swirl->step,
+    };
+    wrong += PointInBounds(points[hit], square);
+  }
+  printf("%-12s %-10s %9d corners %9d wrong %9d step\n", name, "hits", found, wrong, swirl->step);
+  BenchCheck(name, "hits", wrong == 0);
+
+  // Raising a slot swaps it with the top one, so two windows move and at most two are restacked.
+  struct Placements placements;
+  InitPlacements(&placements);
+  HeadlessReset();
+  SwirlRestack(swirl);
+  ApplyPlacements(&placements, &swirl->bin);
+  int stacked = headless.stackingCount;
+  int placed = headless.placementCount;
+  // The raise itself, restack included, allocates nothing.
+  const int raises = 2000;
+  long long allocations = 0;
+  start = BenchSeconds();
+  for (int raise = 0; raise < raises; raise++) {
+    long long heapAllocations = allocationStats.heapAllocations;
+    SwirlRaise(swirl, BenchRandom(slotCount));
+    allocations += allocationStats.heapAllocations - heapAllocations;
+    LayoutRoot(&swirl->bin, screen);
+    ApplyPlacements(&placements, &swirl->bin);
+  }
+  BenchReport(name, "raise", raises, "raises", BenchSeconds() - start);
+  bool ordered = BenchStackedInOrder(swirl);
+  printf("%-12s %-10s %9d restacked %9d moved %9lld allocs %9s\n", name, "raise", headless.stackingCount - stacked,
+         headless.placementCount - placed, allocations, ordered ? "ordered" : "DISORDERED");
+  BenchCheck(name, "raise", ordered && allocations == 0);
+
+  // The swirl survives a snapshot, and a layout file, written and read back.
+  struct SnapshotBuffer buffer = {};
+  struct SnapshotBuffer again = {};
+  WriteSnapshot(&swirl->bin, 0, &buffer);
+  struct Arena loadArena;
+  InitArena(&loadArena);
+  struct Bin *loaded = ReadSnapshot(&loadArena, buffer.bytes, buffer.size);
+  WriteSnapshot(loaded, 0, &again);
+  bool identical = again.size == buffer.size && memcmp(again.bytes, buffer.bytes, buffer.size) == 0;
+
+  char(*names)[16] = (char(*)[16])AllocateBytes(16, slotCount, "name");
+  BenchNameCells(&swirl->bin, names, 0);
+  struct BenchText text = {};
+  BenchWriteLayout(&text, &swirl->bin, "\"bottom\"");
+  struct Layout layout;
+  InitLayout(&layout);
+  struct LayoutError error;
+  if (!ParseLayout(&layout, text.text, text.size, &error))
+    FatalError("The benchmark layout is not valid: %d:%d %s", error.line, error.column, error.message);
+  char *builtNames = NULL;
+  struct Bin *built = BuildLayoutTree(FindLayoutMonitor(&layout, "DISPLAY1"), &loadArena, &builtNames);
+  struct BenchText textAgain = {};
+  BenchWriteLayout(&textAgain, built, "\"bottom\"");
+  bool written = textAgain.size == text.size && memcmp(textAgain.text, text.text, text.size) == 0;
+  printf("%-12s %-10s %9zu bytes %9s\n", name, "snapshot", buffer.size, identical ? "identical" : "DIFFERENT");
+  printf("%-12s %-10s %9zu bytes %9s\n", name, "file", text.size, written ? "identical" : "DIFFERENT");
+  BenchCheck(name, "snapshot", identical);
+  BenchCheck(name, "file", written);
+
+  DestroyBin(built);
+  FreeBytes(builtNames);
+  DestroyBin(loaded);
+  ReleaseLayout(&layout);
+  FreeBytes(names);
+  FreeBytes(text.text);
+  FreeBytes(textAgain.text);
+  ReleaseSnapshotBuffer(&again);
+  ReleaseSnapshotBuffer(&buffer);
+  ReleaseArena(&loadArena);
+  ReleasePlacements(&placements);
+  FreeBytes(points);
+  for (int slot = 0; slot < swirl->slotCount; slot++)
+    BinCell(SwirlGet(swirl, slot))->hWnd = NULL;
+  DestroyBin(&swirl->bin);
+  ReleaseArena(&arena);
+}
+
+void BenchSwirls() {
+  BenchSwirlPhases(16);
+  BenchSwirlPhases(256);
+}
+
+// Returns whether exactly the windows below bin are stacked, top first, in the order of their cells.
+bool BenchShownInOrder(struct Bin *bin) {
+  WindowHandle *windows = AllocateArray(WindowHandle, headless.zCount + 1);
+  memcpy(windows, headless.zOrder, headless.zCount * sizeof(WindowHandle));
+  int count = 0;
+  bool ordered = true;
+  for (int child = 0; child < BinChildCount(bin); child++) {
+    struct Cell *cell = BinCell(BinChild(bin, child));
+    if (cell->hWnd != NULL)
+      ordered &= count < headless.zCount && windows[count++] == cell->hWnd;
+  }
+  FreeBytes(windows);
+  return ordered && count == headless.zCount;
+}
+
+// Tells the tracker where the windows placed since the first placement went, as the window system would.
+void BenchTrackPlacements(int first) {
+  for (int index = first; index < headless.placementCount; index++)
+    TrackWindowMoved(headless.placements[index].hWnd, headless.placements[index].bounds);
+}
+
+void BenchStackPhases(int slotCount) {
+  struct Arena arena;
+  InitArena(&arena);
+
+  char name[32];
+  snprintf(name, sizeof(name), "stack-%d", slotCount);
+
+  // Every slot holds a shelf of windows, so a pass over all of them would cost slotCount times one over the active one.
+  const int windowsPerSlot = 16;
+  struct Stack *stack = NewEmptyStack(&arena, StackStyle_Tabs, slotCount);
+  for (int slot = 0; slot < slotCount; slot++)
+    StackPut(stack, slot, Wrap(NewShelf(&arena, ShelfDirection_Horizontal, windowsPerSlot), bin));
+  int windowCount = BenchAssignWindows(&stack->bin, 0);
+  struct Bounds unplaced = {};
+  for (int window = 1; window <= windowCount; window++)
+    TrackWindow((WindowHandle)(size_t)window, unplaced, TrackedWindow_Visible);
+
+  struct Placements placements;
+  InitPlacements(&placements);
+  HeadlessReset();
+  struct LayoutStats before = layoutStats;
+  LayoutRoot(&stack->bin, BenchScreen());
+  ApplyPlacements(&placements, &stack->bin);
+  BenchTrackPlacements(0);
+  printf("%-12s %-10s %9lld visited %9d placed %9d windows\n", name, "first", layoutStats.visited - before.visited,
+         headless.placementCount, slotCount * windowsPerSlot);
+
+  // Each switch hides one slot's windows and shows the other's in one batch, and lays out only the slot switched to.
+  // Its windows are placed only if the stack was resized since it last showed, which the placements alone tell: the
+  // tracker is not told where they went.
+  const int switches = 2000;
+  struct Bounds screen = BenchScreen();
+  before = layoutStats;
+  HeadlessReset();
+  int shown = 0;
+  double start = BenchSeconds();
+  for (int change = 0; change < switches; change++) {
+    // Now and then the stack is resized, which the hidden slots only catch up with when they next show.
+    if (change % 500 == 250) {
+      screen.width = screen.width == BENCH_WIDTH ? BENCH_WIDTH - 1 : BENCH_WIDTH;
+      LayoutRoot(&stack->bin, screen);
+      ApplyPlacements(&placements, &stack->bin);
+    }
+    shown += StackActivate(stack, BenchRandom(slotCount)) > 0;
+    LayoutRoot(&stack->bin, screen);
+    ApplyPlacements(&placements, &stack->bin);
+  }
+  BenchReport(name, "switch", switches, "switches", BenchSeconds() - start);
+
+  // Once every slot has shown since the last resize, switching between them places nothing.
+  for (int slot = 0; slot < slotCount; slot++) {
+    StackActivate(stack, slot);
+    LayoutRoot(&stack->bin, screen);
+    ApplyPlacements(&placements, &stack->bin);
+  }
+  int placedBefore = headless.placementCount;
+  for (int change = 0; change < 100; change++) {
+    StackActivate(stack, BenchRandom(slotCount));
+    LayoutRoot(&stack->bin, screen);
+    ApplyPlacements(&placements, &stack->bin);
+  }
+  int replaced = headless.placementCount - placedBefore;
+  printf("%-12s %-10s %9d placed again\n", name, "return", replaced);
+  BenchCheck(name, "return", replaced == 0);
+  bool ordered = BenchShownInOrder(StackGet(stack, stack->active));
+  printf("%-12s %-10s %9d switched %9d batches %9d shown %9d hidden %9d placed\n", name, "switch", shown,
+         headless.stackingBatchCount, headless.showCount, headless.hideCount, headless.placementCount);
+  printf("%-12s %-10s %12.1f visited/switch %9s\n", name, "switch",
+         (double)(layoutStats.visited - before.visited) / switches, ordered ? "ordered" : "DISORDERED");
+  BenchCheck(name, "switch", ordered);
+
+  // Hit testing finds only the active slot, whatever the hidden slots were last laid out over.
+  struct HitIndex index;
+  InitHitIndex(&index, &stack->bin);
+  struct Bin *active = StackGet(stack, stack->active);
+  int wrong = 0;
+  for (int hit = 0; hit < 20000; hit++) {
+    struct Bin *leaf = HitTestLeaf(&index, BenchRandomPoint());
+    if (leaf != NULL)
+      wrong += leaf->parent != active;
+  }
+  printf("%-12s %-10s %9d leaves %9d wrong\n", name, "hits", index.leafCount, wrong);
+  BenchCheck(name, "hits", wrong == 0);
+  ReleaseHitIndex(&index);
+
+  // The stack and its active slot survive a snapshot, and a layout file, written and read back.
+  StackActivate(stack, slotCount / 2);
+  struct SnapshotBuffer buffer = {};
+  struct SnapshotBuffer again = {};
+  WriteSnapshot(&stack->bin, 0, &buffer);
+  struct Arena loadArena;
+  InitArena(&loadArena);
+  struct Bin *loaded = ReadSnapshot(&loadArena, buffer.bytes, buffer.size);
+  WriteSnapshot(loaded, 0, &again);
+  bool identical = again.size == buffer.size && memcmp(again.bytes, buffer.bytes, buffer.size) == 0;
+
+  int cellCount = slotCount * (windowsPerSlot + 1);
+  char(*names)[16] = (char(*)[16])AllocateBytes(16, cellCount, "name");
+  BenchNameCells(&stack->bin, names, 0);
+  struct BenchText text = {};
+  BenchWriteLayout(&text, &stack->bin, "\"bottom\"");
+  struct Layout layout;
+  InitLayout(&layout);
+  struct LayoutError error;
+  if (!ParseLayout(&layout, text.text, text.size, &error))
+    FatalError("The benchmark layout is not valid: %d:%d %s", error.line, error.column, error.message);
+  char *builtNames = NULL;
+  struct Bin *built = BuildLayoutTree(FindLayoutMonitor(&layout, "DISPLAY1"), &loadArena, &builtNames);
+  struct BenchText textAgain = {};
+  BenchWriteLayout(&textAgain, built, "\"bottom\"");
+  bool written = textAgain.size == text.size && memcmp(textAgain.text, text.text, text.size) == 0;
+  printf("%-12s %-10s %9zu bytes %9s\n", name, "snapshot", buffer.size, identical ? "identical" : "DIFFERENT");
+  printf("%-12s %-10s %9zu bytes %9s\n", name, "file", text.size, written ? "identical" : "DIFFERENT");
+  BenchCheck(name, "snapshot", identical);
+  BenchCheck(name, "file", written);
+
+  DestroyBin(built);
+  FreeBytes(builtNames);
+  DestroyBin(loaded);
+  ReleaseLayout(&layout);
+  FreeBytes(names);
+  FreeBytes(text.text);
+  FreeBytes(textAgain.text);
+  ReleaseSnapshotBuffer(&again);
+  ReleaseSnapshotBuffer(&buffer);
+  ReleaseArena(&loadArena);
+  ReleasePlacements(&placements);
+  DestroyBin(&stack->bin);
+  ReleaseArena(&arena);
+  ReleaseWindowTracker();
+}
+
+void BenchStacks() {
+  BenchStackPhases(16);
+  BenchStackPhases(256);
+}
+
+int BenchListCells(struct Bin *bin, struct Cell **cells, int count) {
+  struct Cell *cell = BinCell(bin);
+  if (cell != NULL && cell->subBin == NULL) {
+    cells[count] = cell;
+    return count + 1;
+  }
+
+  for (int child = 0; child < BinChildCount(bin); child++)
+    if (BinChild(bin, child) != NULL)
+      count = BenchListCells(BinChild(bin, child), cells, count);
+  return count;
+}
+
+// Moves a window to the top of a model of the void's recency order, newest last, or adds it there.
+void BenchModelPark(WindowHandle *model, int *count, WindowHandle hWnd) {
+  int at = 0;
+  while (at < *count && model[at] != hWnd)
+    at++;
+  if (at < *count)
+    memmove(&model[at], &model[at + 1], (*count - at - 1) * sizeof(WindowHandle));
+  else
+    (*count)++;
+  model[*count - 1] = hWnd;
+}
+
+void BenchModelTake(WindowHandle *model, int *count, WindowHandle hWnd) {
+  int at = 0;
+  while (model[at] != hWnd)
+    at++;
+  memmove(&model[at], &model[at + 1], (*count - at - 1) * sizeof(WindowHandle));
+  (*count)--;
+}
+
+bool BenchVoidMatches(struct Void *parking, WindowHandle *model, int count) {
+  int index = count;
+  for (WindowHandle hWnd = NewestParkedWindow(parking); hWnd != NULL; hWnd = OlderParkedWindow(parking, hWnd))
+    if (--index < 0 || model[index] != hWnd)
+      return false;
+  return index == 0 && parking->windows.count == count && (count == 0 || parking->oldest == model[0]);
+}
+
+void BenchVoidPhases(int depth, int fanout) {
+  struct Arena arena;
+  InitArena(&arena);
+
+  struct BenchTree tree = {&arena, depth, fanout, 0};
+  char name[32];
+  snprintf(name, sizeof(name), "void-%dx%d", depth, fanout);
+
+  struct Bin *root = BenchBranch(&tree, 0);
+  int linked = BenchLinkWindows(root, 0);
+  struct Cell **cells = AllocateArray(struct Cell *, linked);
+  BenchListCells(root, cells, 0);
+
+  struct Placements placements;
+  InitPlacements(&placements);
+  HeadlessReset();
+  LayoutRoot(root, BenchScreen());
+  ApplyPlacements(&placements, root);
+  BenchTrackPlacements(0);
+
+  // Half as many windows again as there are cells are parked, each from where it last was on screen.
+  const int parkedCount = linked / 2;
+  const int windowCount = linked + parkedCount;
+  struct Void parking;
+  InitVoid(&parking, MakePoint(-32000, -32000));
+  HeadlessReset();
+  double start = BenchSeconds();
+  for (int window = linked + 1; window <= windowCount; window++) {
+    struct Bounds bounds = {BenchRandom(BENCH_WIDTH), BenchRandom(BENCH_HEIGHT), 800, 600};
+    TrackWindow((WindowHandle)(size_t)window, bounds, TrackedWindow_Visible);
+    ParkWindow(&parking, (WindowHandle)(size_t)window, bounds);
+  }
+  BenchReport(name, "park", parkedCount, "windows", BenchSeconds() - start);
+  BenchTrackPlacements(0);
+
+  // Each swap moves the parked window into a cell and the cell's window out in one batch. The cell keeps its bounds,
+  // so the layout pass after it visits nothing and places nothing. Every fourth swap asks for any window by handle,
+  // which is refused when that window is in a cell.
+  const int swaps = 100000;
+  struct LayoutStats before = layoutStats;
+  struct Placements placedBefore = placements;
+  HeadlessReset();
+  int swapped = 0;
+  start = BenchSeconds();
+  for (int swap = 0; swap < swaps; swap++) {
+    struct Cell *cell = cells[BenchRandom(linked)];
+    WindowHandle hWnd = swap % 4 == 0 ? (WindowHandle)(size_t)(BenchRandom(windowCount) + 1) : NULL;
+    int placed = headless.placementCount;
+    if (!SwapParkedWindow(&parking, cell, hWnd))
+      continue;
+    swapped++;
+    BenchTrackPlacements(placed);
+    LayoutRoot(root, BenchScreen());
+    ApplyPlacements(&placements, root);
+  }
+  BenchReport(name, "swap", swaps, "swaps", BenchSeconds() - start);
+  printf("%-12s %-10s %9d swapped %9d batches %9d moved %9lld visited %9lld placed\n", name, "swap", swapped,
+         headless.placementBatchCount, headless.placementCount, layoutStats.visited - before.visited,
+         placements.windowsPlaced - placedBefore.windowsPlaced);
+  BenchCheck(name, "swap",
+             layoutStats.visited == before.visited && placements.windowsPlaced == placedBefore.windowsPlaced);
+
+  // The recency order matches a model of it through parks, swaps and swaps by handle.
+  WindowHandle *model = AllocateArray(WindowHandle, windowCount);
+  int modelCount = 0;
+  for (WindowHandle hWnd = parking.oldest; hWnd != NULL; hWnd = FindParkedWindow(&parking, hWnd)->newer)
+    model[modelCount++] = hWnd;
+  bool ordered = modelCount == parking.windows.count;
+  for (int change = 0; change < 2000; change++) {
+    struct Cell *cell = cells[BenchRandom(linked)];
+    if (change % 5 == 0) {
+      // Parked and then swapped back into the cell it left empty, this or another window takes one move.
+      BenchModelPark(model, &modelCount, cell->hWnd);
+      ParkCellWindow(&parking, cell);
+      WindowHandle hWnd = model[BenchRandom(modelCount)];
+      BenchModelTake(model, &modelCount, hWnd);
+      SwapParkedWindow(&parking, cell, hWnd);
+    } else {
+      WindowHandle hWnd = change % 3 == 0 ? model[BenchRandom(modelCount)] : NULL;
+      WindowHandle old = cell->hWnd;
+      BenchModelTake(model, &modelCount, hWnd != NULL ? hWnd : model[modelCount - 1]);
+      BenchModelPark(model, &modelCount, old);
+      SwapParkedWindow(&parking, cell, hWnd);
+    }
+    ordered &= BenchVoidMatches(&parking, model, modelCount);
+  }
+  printf("%-12s %-10s %9d parked %9s\n", name, "order", parking.windows.count, ordered ? "ordered" : "DISORDERED");
+  BenchCheck(name, "order", ordered);
+
+  // A resize afterwards places the swapped in windows with the rest, and leaves the parked ones where they are.
+  bool inCells = true;
+  for (int cell = 0; cell < linked; cell++)
+    inCells &= cells[cell]->hWnd != NULL && FindParkedWindow(&parking, cells[cell]->hWnd) == NULL &&
+               WindowCell(cells[cell]->hWnd) == cells[cell];
+  struct Bounds screen = BenchScreen();
+  screen.width -= 100;
+  HeadlessReset();
+  LayoutRoot(root, screen);
+  ApplyPlacements(&placements, root);
+  int offscreen = 0;
+  for (int index = 0; index < headless.placementCount; index++)
+    offscreen += FindParkedWindow(&parking, headless.placements[index].hWnd) != NULL;
+  printf("%-12s %-10s %9d placed %9d parked moved %9s\n", name, "resize", headless.placementCount, offscreen,
+         inCells ? "linked" : "UNLINKED");
+  BenchCheck(name, "resize", inCells && offscreen == 0);
+
+  // Destroyed windows leave the void, and the rest go back where they were parked from.
+  for (int window = 0; window < modelCount; window += 3)
+    ForgetParkedWindow(&parking, model[window]);
+  int left = parking.windows.count;
+  HeadlessReset();
+  start = BenchSeconds();
+  while (NewestParkedWindow(&parking) != NULL)
+    RestoreParkedWindow(&parking, NewestParkedWindow(&parking));
+  BenchReport(name, "restore", left, "windows", BenchSeconds() - start);
+  printf("%-12s %-10s %9d restored %9d parked %9lld swaps\n", name, "restore", headless.placementCount,
+         parking.windows.count, parking.stats.swapped);
+  BenchCheck(name, "restore", headless.placementCount == left && parking.windows.count == 0);
+
+  ReleaseVoid(&parking);
+  FreeBytes(model);
+  FreeBytes(cells);
+  ReleasePlacements(&placements);
+  DestroyBin(root);
+  ReleaseArena(&arena);
+  ReleaseWindowTracker();
+}
+
+void BenchVoids() {
+  BenchVoidPhases(5, 4);
+  BenchVoidPhases(7, 4);
+}
+
+void BenchZoom(struct Bin *container, int slot) {
+  if (container->onLayoutFn == GridLayout) {
+    struct Grid *grid = Unwrap(struct Grid, bin, container);
+    GridZoom(grid, slot < 0 ? -1 : slot / grid->columnCount, slot < 0 ? -1 : slot % grid->columnCount);
+  } else {
+    ShelfZoom(Unwrap(struct Shelf, bin, container), slot);
+  }
+}
+
+// Lays out and places the container, and counts the windows placed that are not in the slot.
+int BenchZoomPass(struct Bin *container, struct Placements *placements, struct Bin *slot) {
+  int placed = headless.placementCount;
+  LayoutRoot(container, BenchScreen());
+  ApplyPlacements(placements, container);
+
+  int strays = 0;
+  for (int index = placed; index < headless.placementCount; index++)
+    strays += WindowCell(headless.placements[index].hWnd)->bin.parent != slot;
+  return strays;
+}
+
+void BenchZoomPhases(int rowCount, int columnCount) {
+  struct Arena arena;
+  InitArena(&arena);
+
+  char name[32];
+  snprintf(name, sizeof(name), rowCount > 1 ? "zoom-%dx%d" : "zoom-%d", rowCount > 1 ? rowCount : columnCount,
+           columnCount);
+
+  // A shelf, or a grid, of shelves of windows, so a pass over all of them would cost every slot's windows.
+  const int windowsPerSlot = 16;
+  int slotCount = rowCount * columnCount;
+  struct Bin *container;
+  if (rowCount > 1) {
+    struct Grid *grid = NewEmptyGrid(&arena, rowCount, columnCount);
+    for (int slot = 0; slot < slotCount; slot++)
+      GridPut(grid, slot / columnCount, slot % columnCount,
+              Wrap(NewShelf(&arena, ShelfDirection_Vertical, windowsPerSlot), bin));
+    container = &grid->bin;
+  } else {
+    struct Shelf *shelf = NewEmptyShelf(&arena, ShelfDirection_Horizontal, slotCount);
+    for (int slot = 0; slot < slotCount; slot++)
+      ShelfPut(shelf, slot, Wrap(NewShelf(&arena, ShelfDirection_Vertical, windowsPerSlot), bin));
+    container = &shelf->bin;
+  }
+  int windowCount = BenchLinkWindows(container, 0);
+  struct Cell **cells = AllocateArray(struct Cell *, windowCount);
+  struct Bounds *unzoomed = AllocateArray(struct Bounds, windowCount);
+  BenchListCells(container, cells, 0);
+
+  struct Placements placements;
+  InitPlacements(&placements);
+  HeadlessReset();
+  BenchZoomPass(container, &placements, NULL);
+  for (int cell = 0; cell < windowCount; cell++)
+    unzoomed[cell] = cells[cell]->bin.bounds;
+
+  // Each zoom and unzoom lays out and places the one slot whose bounds change, and the others stay where they were. The
+  // tracker is not told where windows went, so the placements alone keep the others from being placed on unzoom.
+  const int toggles = 2000;
+  struct LayoutStats before = layoutStats;
+  HeadlessReset();
+  int strays = 0;
+  double start = BenchSeconds();
+  for (int toggle = 0; toggle < toggles; toggle++) {
+    int slot = BenchRandom(slotCount);
+    BenchZoom(container, slot);
+    strays += BenchZoomPass(container, &placements, BinChild(container, slot));
+    BenchZoom(container, -1);
+    strays += BenchZoomPass(container, &placements, BinChild(container, slot));
+  }
+  BenchReport(name, "toggle", toggles, "toggles", BenchSeconds() - start);
+  int moved = 0;
+  for (int cell = 0; cell < windowCount; cell++)
+    moved += memcmp(&cells[cell]->bin.bounds, &unzoomed[cell], sizeof(struct Bounds)) != 0;
+  printf("%-12s %-10s %12.1f visited/toggle %9.1f placed/toggle %9d batches\n", name, "toggle",
+         (double)(layoutStats.visited - before.visited) / toggles, (double)headless.placementCount / toggles,
+         headless.stackingBatchCount);
+  printf("%-12s %-10s %9d strays %9d cells moved %9d windows\n", name, "toggle", strays, moved, windowCount);
+  BenchCheck(name, "toggle",
+             strays == 0 && moved == 0 && headless.placementCount == toggles * 2 * windowsPerSlot);
+
+  // While a slot is zoomed only it is hit, wherever the others lie under it.
+  int zoomed = slotCount / 2;
+  BenchZoom(container, zoomed);
+  BenchZoomPass(container, &placements, BinChild(container, zoomed));
+  struct HitIndex index;
+  InitHitIndex(&index, container);
+  int wrong = 0;
+  for (int hit = 0; hit < 20000; hit++) {
+    struct Bin *leaf = HitTestLeaf(&index, BenchRandomPoint());
+    if (leaf != NULL)
+      wrong += leaf->parent != BinChild(container, zoomed);
+  }
+  printf("%-12s %-10s %9d leaves %9d wrong\n", name, "hits", index.leafCount, wrong);
+  BenchCheck(name, "hits", wrong == 0);
+  ReleaseHitIndex(&index);
+
+  FreeBytes(unzoomed);
+  FreeBytes(cells);
+  ReleasePlacements(&placements);
+  DestroyBin(container);
+  ReleaseArena(&arena);
+  ReleaseWindowTracker();
+}
+
+void BenchZooms() {
+  BenchZoomPhases(1, 16);
+  BenchZoomPhases(1, 256);
+  BenchZoomPhases(16, 16);
+}
+
+struct Benchmark benchmarks[] = {
+    {"trees", BenchTrees},
+    {"edits", BenchEdits},
+    {"hits", BenchHits},
+    {"damage", BenchDamage},
+    {"resources", BenchResources},
+    {"commands", BenchCommands},
+    {"raster", BenchRaster},
+    {"input", BenchInput},
+    {"placements", BenchPlacements},
+    {"moves", BenchMoves},
+    {"tracker", BenchTracker},
+    {"rules", BenchRules},
+    {"snapshot", BenchSnapshots},
+    {"layout", BenchLayouts},
+    {"reload", BenchReloads},
+    {"monitors", BenchMonitors},
+    {"sizes", BenchSizes},
+    {"spans", BenchSpans},
+    {"swirl", BenchSwirls},
+    {"stack", BenchStacks},
+    {"void", BenchVoids},
+    {"zoom", BenchZooms},
+};
+
+int main(int argc, char **argv) {
+  backend = &headlessBackend;
+
+  for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+    bool selected = argc < 2;
+    for (int arg = 1; arg < argc; arg++)
+      if (strcmp(argv[arg], benchmarks[i].name) == 0)
+        selected = true;
+    if (selected)
+      benchmarks[i].runFn();
+  }
+
+  if (benchFailures > 0) {
+    fprintf(stderr, "%d checks failed\n", benchFailures);
+    return 1;
+  }
+  return 0;
+}
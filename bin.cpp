@@ -0,0 +1,2520 @@
+#include <stdio.h>
+
+#include "bin.h"
+#include "damage.h"
+#include "tracker.h"
+
+struct Input oldInput;
+struct Input newInput;
+
+struct OnDeck onDeck;
+
+struct LayoutStats layoutStats;
+
+struct HoverLeaf drawnHover;
+struct HoverLeaf newHover;
+
+// Bins entirely outside this are not drawn.
+struct Bounds drawClip;
+
+// The list DrawRoot records into, kept between frames so recording does not allocate.
+struct DrawList rootDrawList;
+
+void MarkLayoutDirty(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  bin->layoutDirty = true;
+  for (struct Bin *parent = bin->parent; parent != NULL; parent = parent->parent)
+    parent->childLayoutDirty = true;
+}
+
+void MarkBelowDirty(struct Bin *bin) {
+  for (int child = 0; child < BinChildCount(bin); child++) {
+    struct Bin *childBin = BinChild(bin, child);
+    if (childBin != NULL) {
+      childBin->layoutDirty = true;
+      childBin->childLayoutDirty = true;
+      MarkBelowDirty(childBin);
+    }
+  }
+}
+
+void MarkTreeDirty(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  MarkLayoutDirty(bin);
+  bin->childLayoutDirty = true;
+  MarkBelowDirty(bin);
+}
+
+void LayoutBin(struct Bin *bin, struct Bounds bounds) {
+  AssertNotNull(bin);
+
+  if (memcmp(&bin->bounds, &bounds, sizeof(bounds)) != 0) {
+    DamageBounds(bin->bounds);
+    bin->bounds = bounds;
+    bin->layoutDirty = true;
+  }
+
+  if (!bin->layoutDirty && !bin->childLayoutDirty) {
+    layoutStats.skipped++;
+    return;
+  }
+
+  layoutStats.visited++;
+  if (bin->layoutDirty)
+    DamageBounds(bin->bounds);
+  bin->layoutDirty = false;
+  bin->childLayoutDirty = false;
+  bin->placementDirty = true;
+  if (bin->onLayoutFn)
+    bin->onLayoutFn(bin);
+}
+
+void CellSetSubBin(struct Cell *cell, struct Bin *subBin) {
+  AssertNotNull(cell);
+  AssertNull(cell->subBin);
+
+  cell->subBin = subBin;
+  if (subBin != NULL) {
+    subBin->parent = &cell->bin;
+    MarkLayoutDirty(&cell->bin);
+  }
+}
+
+void CellSetName(struct Cell *cell, const char *name) {
+  AssertNotNull(cell);
+
+  cell->name = name;
+}
+
+void CellInput(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct Cell *cell = Unwrap(struct Cell, bin, bin);
+
+  cell->sequence = newInput.sequence;
+
+  if (cell->subBin != NULL) {
+    if (cell->subBin->onInputFn)
+      cell->subBin->onInputFn(cell->subBin);
+  } else {
+    struct Point midPoint = BoundsMidpoint(cell->bin.bounds);
+    int xDelta = abs(newInput.position.x - midPoint.x);
+    int yDelta = abs(newInput.position.y - midPoint.y);
+
+    cell->previewAction = CellAction_None;
+    if (xDelta < yDelta) {
+      if (xDelta < 10)
+        cell->previewAction = CellAction_SplitHorizontal;
+    } else {
+      if (yDelta < 10)
+        cell->previewAction = CellAction_SplitVertical;
+    }
+
+    if (cell->previewAction == CellAction_SplitHorizontal) {
+      if ((newInput.buttons & InputButton_Left) && !(oldInput.buttons & InputButton_Left)) {
+        struct Shelf *newShelf = NewShelf(BinArena(bin), ShelfDirection_Horizontal, 2);
+        CellSetSubBin(cell, Wrap(newShelf, bin));
+        cell->previewAction = CellAction_None;
+      }
+    } else if (cell->previewAction == CellAction_SplitVertical) {
+      if ((newInput.buttons & InputButton_Left) && !(oldInput.buttons & InputButton_Left)) {
+        struct Shelf *newShelf = NewShelf(BinArena(bin), ShelfDirection_Vertical, 2);
+        CellSetSubBin(cell, Wrap(newShelf, bin));
+        cell->previewAction = CellAction_None;
+      }
+      // cell->hWnd = onDeck.hWnd;
+      // onDeck.placement = cell->bin.bounds;
+      // PlaceOnDeckWindow();
+    }
+
+    if (cell->subBin == NULL) {
+      newHover.valid = true;
+      newHover.bounds = cell->bin.bounds;
+      newHover.previewAction = cell->previewAction;
+    }
+  }
+}
+
+void DrawBin(struct Bin *bin) {
+  if (bin->onDrawFn && BoundsIntersect(bin->bounds, drawClip))
+    bin->onDrawFn(bin);
+}
+
+void CellDraw(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct Cell *cell = Unwrap(struct Cell, bin, bin);
+
+  DrawRoundedRectangle(cell->bin.bounds, 5, LineStyle_Border);
+
+  if (cell->subBin != NULL) {
+    DrawBin(cell->subBin);
+  } else {
+    if (cell->sequence == newInput.sequence) {
+      struct Point midPoint = BoundsMidpoint(cell->bin.bounds);
+
+      struct Point from, to;
+      from = MakePoint(cell->bin.bounds.x, midPoint.y);
+      to = MakePoint(cell->bin.bounds.x + cell->bin.bounds.width, midPoint.y);
+      DrawLine(from, to, cell->previewAction == CellAction_SplitVertical ? LineStyle_Action : LineStyle_ActionHint);
+
+      from = MakePoint(midPoint.x, cell->bin.bounds.y);
+      to = MakePoint(midPoint.x, cell->bin.bounds.y + cell->bin.bounds.height);
+      DrawLine(from, to, cell->previewAction == CellAction_SplitHorizontal ? LineStyle_Action : LineStyle_ActionHint);
+    }
+  }
+}
+
+void CellLayout(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct Cell *cell = Unwrap(struct Cell, bin, bin);
+
+  if (cell->subBin != NULL)
+    LayoutBin(cell->subBin, cell->bin.bounds);
+}
+
+void CellDestroy(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct Cell *cell = Unwrap(struct Cell, bin, bin);
+
+  if (cell->subBin != NULL) {
+    DestroyBin(cell->subBin);
+    cell->subBin = NULL;
+  }
+
+  struct TrackedWindow *window = FindTrackedWindow(cell->hWnd);
+  if (window != NULL && window->cell == cell)
+    window->cell = NULL;
+  cell->hWnd = NULL;
+}
+
+int CellChildCount(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct Cell *cell = Unwrap(struct Cell, bin, bin);
+  return cell->subBin != NULL ? 1 : 0;
+}
+
+struct Bin *CellChild(struct Bin *bin, int index) {
+  AssertNotNull(bin);
+
+  struct Cell *cell = Unwrap(struct Cell, bin, bin);
+  AssertIndex(index, CellChildCount(bin));
+  return cell->subBin;
+}
+
+struct Cell *NewCell(struct Arena *arena) {
+  struct Cell *cell = (struct Cell *)PoolAllocate(&arena->cells);
+  cell->bin.pool = &arena->cells;
+  cell->bin.onInputFn = CellInput;
+  cell->bin.onDrawFn = CellDraw;
+  cell->bin.onLayoutFn = CellLayout;
+  cell->bin.onDestroyFn = CellDestroy;
+  cell->bin.onChildCountFn = CellChildCount;
+  cell->bin.onChildFn = CellChild;
+  cell->bin.layoutDirty = true;
+  return cell;
+}
+
+const struct SlotSize uniformSlotSize = {
+    1,
+    0,
+    0,
+};
+
+void InitTrack(struct Track *track, struct Arena *arena, int count) {
+  track->capacity = count;
+  track->sizes = (struct SlotSize *)ArenaAllocateItems(arena, sizeof(struct SlotSize), track->capacity);
+  track->offsets = (int *)ArenaAllocateItems(arena, sizeof(int), track->capacity + 1);
+  for (int slot = 0; slot < count; slot++)
+    track->sizes[slot] = uniformSlotSize;
+  track->stale = true;
+}
+
+void ReleaseTrack(struct Track *track, struct Arena *arena) {
+  ArenaFreeItems(arena, track->sizes, sizeof(struct SlotSize), track->capacity);
+  ArenaFreeItems(arena, track->offsets, sizeof(int), track->capacity + 1);
+}
+
+// Makes room for a slot to be inserted into count, at least doubling the capacity.
+void TrackReserve(struct Track *track, struct Arena *arena, int count) {
+  if (count < track->capacity)
+    return;
+
+  struct Track newTrack = {};
+  InitTrack(&newTrack, arena, track->capacity * 2 > count ? track->capacity * 2 : count + 1);
+  memcpy(newTrack.sizes, track->sizes, count * sizeof(struct SlotSize));
+  ReleaseTrack(track, arena);
+  *track = newTrack;
+}
+
+void TrackInsert(struct Track *track, struct Arena *arena, int count, int newSlot) {
+  TrackReserve(track, arena, count);
+  memmove(&track->sizes[newSlot + 1], &track->sizes[newSlot], (count - newSlot) * sizeof(struct SlotSize));
+  track->sizes[newSlot] = uniformSlotSize;
+  track->stale = true;
+}
+
+void TrackDelete(struct Track *track, int count, int oldSlot) {
+  memmove(&track->sizes[oldSlot], &track->sizes[oldSlot + 1], (count - oldSlot - 1) * sizeof(struct SlotSize));
+  track->stale = true;
+}
+
+// Returns whether the size changed.
+bool TrackSetSize(struct Track *track, int slot, struct SlotSize size) {
+  AssertMessage(size.weight >= 0 && size.min >= 0 && (size.max == 0 || size.max >= size.min),
+                ("A slot size of weight %d, min %d and max %d makes no sense", size.weight, size.min, size.max));
+
+  struct SlotSize *old = &track->sizes[slot];
+  if (old->weight == size.weight && old->min == size.min && old->max == size.max)
+    return false;
+  *old = size;
+  track->stale = true;
+  return true;
+}
+
+bool TrackIsUniform(const struct Track *track, int count) {
+  AssertNotNull(track);
+
+  for (int slot = 0; slot < count; slot++) {
+    const struct SlotSize *size = &track->sizes[slot];
+    if (size->weight != uniformSlotSize.weight || size->min != 0 || size->max != 0)
+      return false;
+  }
+  return true;
+}
+
+const int *TrackOffsets(struct Track *track, int count, int length, int inset) {
+  AssertNotNull(track);
+  AssertGreater(count, 0);
+
+  if (!track->stale && track->length == length && track->inset == inset)
+    return track->offsets;
+
+  // Slots whose share would break their limits are held at the limit, and the rest share what is left. Holding one
+  // slot changes the others' shares, so this repeats until none break, which it only does when limits are set. While
+  // it runs, offsets holds the size of each held slot, or -1.
+  int space = length - (count + 1) * inset;
+  if (space < 0)
+    space = 0;
+  int *offsets = track->offsets;
+  for (int slot = 0; slot < count; slot++)
+    offsets[slot] = -1;
+
+  long long left, weights;
+  for (;;) {
+    left = space;
+    weights = 0;
+    for (int slot = 0; slot < count; slot++) {
+      if (offsets[slot] < 0)
+        weights += track->sizes[slot].weight;
+      else
+        left -= offsets[slot];
+    }
+    if (left < 0)
+      left = 0;
+
+    // A share comes out as its quotient or one more, so mins are checked against the quotient, and maxes against one
+    // more whenever there is a remainder. Slots under their min are held first, since holding them only shrinks the
+    // other shares.
+    bool held = false;
+    for (int slot = 0; slot < count; slot++) {
+      const struct SlotSize *size = &track->sizes[slot];
+      if (offsets[slot] < 0 && size->min > 0 && (weights > 0 ? left * size->weight / weights : 0) < size->min) {
+        offsets[slot] = size->min;
+        held = true;
+      }
+    }
+    if (held)
+      continue;
+    for (int slot = 0; slot < count; slot++) {
+      const struct SlotSize *size = &track->sizes[slot];
+      if (offsets[slot] < 0 && size->max > 0 && weights > 0 &&
+          (left * size->weight + weights - 1) / weights > size->max) {
+        offsets[slot] = size->max;
+        held = true;
+      }
+    }
+    if (!held)
+      break;
+  }
+
+  // Each free slot ends where its running total of weight divides the space, so the remainders add up to whole pixels
+  // along the way and the last slot ends exactly at the end of the space.
+  long long prefix = 0;
+  int start = inset;
+  for (int slot = 0; slot < count; slot++) {
+    int size = offsets[slot];
+    if (size < 0) {
+      long long before = weights > 0 ? left * prefix / weights : 0;
+      prefix += track->sizes[slot].weight;
+      long long after = weights > 0 ? left * prefix / weights : 0;
+      size = (int)(after - before);
+    }
+    offsets[slot] = start;
+    start += size + inset;
+  }
+  offsets[count] = start;
+
+  track->length = length;
+  track->inset = inset;
+  track->stale = false;
+  return offsets;
+}
+
+int TrackSlotFrom(const struct Track *track, int count, int position) {
+  AssertNotNull(track);
+  AssertMessage(!track->stale, ("A track must be laid out before it is hit tested"));
+
+  if (count <= 0 || position < track->offsets[0])
+    return -1;
+
+  // Slots squeezed to nothing share their start with the next one, which is the one found.
+  int low = 0;
+  int high = count;
+  while (high - low > 1) {
+    int middle = (low + high) / 2;
+    if (track->offsets[middle] <= position)
+      low = middle;
+    else
+      high = middle;
+  }
+  return low;
+}
+
+int TrackSlotAt(const struct Track *track, int count, int position) {
+  int slot = TrackSlotFrom(track, count, position);
+  if (slot < 0 || position >= track->offsets[slot + 1] - track->inset)
+    return -1;
+  return slot;
+}
+
+struct Bin *ShelfGet(struct Shelf *shelf, int slot) {
+  AssertNotNull(shelf);
+  AssertNotNull(shelf->bins);
+  AssertIndex(slot, shelf->slotCount);
+
+  return shelf->bins[slot];
+}
+
+void ShelfPut(struct Shelf *shelf, int slot, struct Bin *bin) {
+  AssertNotNull(shelf);
+  AssertNotNull(shelf->bins);
+  AssertIndex(slot, shelf->slotCount);
+
+  AssertNull(shelf->bins[slot]);
+
+  shelf->bins[slot] = bin;
+
+  if (bin != NULL) {
+    bin->parent = &shelf->bin;
+    MarkLayoutDirty(&shelf->bin);
+  }
+}
+
+void ShelfClear(struct Shelf *shelf, int slot) {
+  AssertNotNull(shelf);
+  AssertNotNull(shelf->bins);
+  AssertIndex(slot, shelf->slotCount);
+
+  struct Bin *bin = shelf->bins[slot];
+  if (bin != NULL) {
+    DestroyBin(bin);
+    shelf->bins[slot] = NULL;
+  }
+}
+
+// Grows the slot array to hold at least count slots. Capacity at least doubles so that repeated inserts are amortized.
+void ShelfReserve(struct Shelf *shelf, int count) {
+  AssertNotNull(shelf);
+
+  if (count <= shelf->slotCapacity)
+    return;
+
+  int newCapacity = shelf->slotCapacity * 2;
+  if (newCapacity < count)
+    newCapacity = count;
+  newCapacity = ArenaSlotCapacity(newCapacity);
+
+  struct Arena *arena = BinArena(&shelf->bin);
+  struct Bin **newBins = ArenaAllocateSlots(arena, newCapacity);
+  memcpy(newBins, shelf->bins, shelf->slotCount * sizeof(struct Bin *));
+  ArenaFreeSlots(arena, shelf->bins, shelf->slotCapacity);
+
+  shelf->bins = newBins;
+  shelf->slotCapacity = newCapacity;
+}
+
+void ShelfInsert(struct Shelf *shelf, int newSlot) {
+  AssertNotNull(shelf);
+  AssertNotNull(shelf->bins);
+  AssertIndex(newSlot, shelf->slotCount + 1);
+
+  ShelfReserve(shelf, shelf->slotCount + 1);
+  TrackInsert(&shelf->track, BinArena(&shelf->bin), shelf->slotCount, newSlot);
+
+  memmove(&shelf->bins[newSlot + 1], &shelf->bins[newSlot], (shelf->slotCount - newSlot) * sizeof(struct Bin *));
+  shelf->slotCount += 1;
+  shelf->zoomSlot = -1;
+
+  struct Cell *newCell = NewCell(BinArena(&shelf->bin));
+  shelf->bins[newSlot] = Wrap(newCell, bin);
+  newCell->bin.parent = &shelf->bin;
+
+  // Every slot moves when the count changes; they are all laid out once when the layout is next flushed.
+  MarkLayoutDirty(&shelf->bin);
+}
+
+void ShelfDelete(struct Shelf *shelf, int oldSlot) {
+  AssertNotNull(shelf);
+  AssertNotNull(shelf->bins);
+  AssertIndex(oldSlot, shelf->slotCount);
+
+  ShelfClear(shelf, oldSlot);
+  TrackDelete(&shelf->track, shelf->slotCount, oldSlot);
+
+  memmove(&shelf->bins[oldSlot], &shelf->bins[oldSlot + 1], (shelf->slotCount - oldSlot - 1) * sizeof(struct Bin *));
+  shelf->slotCount -= 1;
+  shelf->bins[shelf->slotCount] = NULL;
+  shelf->zoomSlot = -1;
+
+  MarkLayoutDirty(&shelf->bin);
+}
+
+void ShelfSetSize(struct Shelf *shelf, int slot, struct SlotSize size) {
+  AssertNotNull(shelf);
+  AssertIndex(slot, shelf->slotCount);
+
+  if (TrackSetSize(&shelf->track, slot, size))
+    MarkLayoutDirty(&shelf->bin);
+}
+
+// The bounds a zoomed slot or cell fills: all of its container but the border inset.
+struct Bounds ZoomBounds(struct Bin *bin) {
+  int inset = dimensions[Dimension_BorderInset];
+  struct Bounds bounds = {bin->bounds.x + inset, bin->bounds.y + inset, bin->bounds.width - 2 * inset,
+                          bin->bounds.height - 2 * inset};
+  return bounds;
+}
+
+// Whether a container above bin has a slot zoomed, which bin must then be in.
+bool ZoomedAbove(struct Bin *bin) {
+  for (struct Bin *parent = bin->parent; parent != NULL; parent = parent->parent) {
+    if (parent->onLayoutFn == ShelfLayout) {
+      struct Shelf *shelf = Unwrap(struct Shelf, bin, parent);
+      if (shelf->zoomSlot >= 0)
+        return true;
+    }
+    if (parent->onLayoutFn == GridLayout) {
+      struct Grid *grid = Unwrap(struct Grid, bin, parent);
+      if (grid->zoomRow >= 0)
+        return true;
+    }
+  }
+  return false;
+}
+
+// The slots left unzoomed keep their bounds, so the pass lays out only the slot whose bounds change, and the placements
+// that follow move only its windows.
+void ShelfZoom(struct Shelf *shelf, int slot) {
+  AssertNotNull(shelf);
+  if (slot >= 0)
+    AssertIndex(slot, shelf->slotCount);
+
+  if (shelf->zoomSlot == slot)
+    return;
+
+  shelf->zoomSlot = slot;
+  MarkLayoutDirty(&shelf->bin);
+  if (slot >= 0 && shelf->bins[slot] != NULL)
+    RaiseBinWindows(shelf->bins[slot]);
+}
+
+struct Bounds ShelfMakeCellBounds(struct Shelf *shelf, int slot) {
+  AssertNotNull(shelf);
+  AssertIndex(slot, shelf->slotCount);
+
+  AssertGreater(shelf->slotCount, 0);
+
+  if (slot == shelf->zoomSlot)
+    return ZoomBounds(&shelf->bin);
+
+  struct Bounds bounds;
+  int inset = dimensions[Dimension_BorderInset];
+
+  if (shelf->direction == ShelfDirection_Vertical) {
+    const int *offsets = TrackOffsets(&shelf->track, shelf->slotCount, shelf->bin.bounds.height, inset);
+    bounds.width = shelf->bin.bounds.width - 2 * inset;
+    bounds.height = offsets[slot + 1] - offsets[slot] - inset;
+    bounds.x = shelf->bin.bounds.x + inset;
+    bounds.y = shelf->bin.bounds.y + offsets[slot];
+  } else {
+    const int *offsets = TrackOffsets(&shelf->track, shelf->slotCount, shelf->bin.bounds.width, inset);
+    bounds.width = offsets[slot + 1] - offsets[slot] - inset;
+    bounds.height = shelf->bin.bounds.height - 2 * inset;
+    bounds.x = shelf->bin.bounds.x + offsets[slot];
+    bounds.y = shelf->bin.bounds.y + inset;
+  }
+
+  return bounds;
+}
+
+// The slot under a point is found by binary search of the cached offsets; only that candidate is tested.
+int ShelfSlotAtPoint(struct Shelf *shelf, struct Point point) {
+  AssertNotNull(shelf);
+
+  if (shelf->slotCount <= 0)
+    return -1;
+  if (shelf->zoomSlot >= 0)
+    return PointInBounds(point, ShelfMakeCellBounds(shelf, shelf->zoomSlot)) ? shelf->zoomSlot : -1;
+
+  int inset = dimensions[Dimension_BorderInset];
+  int slot;
+  if (shelf->direction == ShelfDirection_Vertical) {
+    TrackOffsets(&shelf->track, shelf->slotCount, shelf->bin.bounds.height, inset);
+    slot = TrackSlotAt(&shelf->track, shelf->slotCount, point.y - shelf->bin.bounds.y);
+  } else {
+    TrackOffsets(&shelf->track, shelf->slotCount, shelf->bin.bounds.width, inset);
+    slot = TrackSlotAt(&shelf->track, shelf->slotCount, point.x - shelf->bin.bounds.x);
+  }
+
+  if (slot < 0 || !PointInBounds(point, ShelfMakeCellBounds(shelf, slot)))
+    return -1;
+  return slot;
+}
+
+void ShelfDraw(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct Shelf *shelf = Unwrap(struct Shelf, bin, bin);
+
+  if (shelf->zoomSlot >= 0) {
+    DrawBin(ShelfGet(shelf, shelf->zoomSlot));
+    return;
+  }
+
+  for (int slot = 0; slot < shelf->slotCount; slot++) {
+    DrawBin(ShelfGet(shelf, slot));
+  }
+}
+
+void ShelfInput(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct Shelf *shelf = Unwrap(struct Shelf, bin, bin);
+
+  shelf->hoverSlot = ShelfSlotAtPoint(shelf, newInput.position);
+
+  if (shelf->hoverSlot != -1) {
+    struct Bin *hoverBin = ShelfGet(shelf, shelf->hoverSlot);
+    if (hoverBin != NULL) {
+      if (hoverBin->onInputFn)
+        hoverBin->onInputFn(hoverBin);
+    }
+
+    if (!newInput.used) {
+      if (newInput.key == 'X') {
+        if (shelf->slotCount > 1) {
+          ShelfDelete(shelf, shelf->hoverSlot);
+          newInput.used = true;
+        }
+        // Pass other cases up to the parent to deal with.
+      }
+
+      if (newInput.key == 'H') {
+        if (shelf->direction == ShelfDirection_Horizontal) {
+          ShelfInsert(shelf, shelf->hoverSlot);
+          newInput.used = true;
+        } else {
+          ShelfClear(shelf, shelf->hoverSlot);
+          struct Shelf *newShelf = NewShelf(BinArena(bin), ShelfDirection_Horizontal, 2);
+          struct Bin *newBin = Wrap(newShelf, bin);
+          ShelfPut(shelf, shelf->hoverSlot, newBin);
+          newInput.used = true;
+        }
+      }
+
+      if (newInput.key == 'V') {
+        if (shelf->direction == ShelfDirection_Vertical) {
+          ShelfInsert(shelf, shelf->hoverSlot);
+          newInput.used = true;
+        } else {
+          ShelfClear(shelf, shelf->hoverSlot);
+          struct Shelf *newShelf = NewShelf(BinArena(bin), ShelfDirection_Vertical, 2);
+          struct Bin *newBin = Wrap(newShelf, bin);
+          ShelfPut(shelf, shelf->hoverSlot, newBin);
+          newInput.used = true;
+        }
+      }
+
+      if (newInput.key == 'W') {
+        ShelfClear(shelf, shelf->hoverSlot);
+        struct Swirl *newSwirl = NewSwirl(BinArena(bin), 4, SWIRL_TIGHTNESS);
+        ShelfPut(shelf, shelf->hoverSlot, Wrap(newSwirl, bin));
+        newInput.used = true;
+      }
+
+      // K turns the hovered slot into tabs, and shift K into a depth stack.
+      if (newInput.key == 'K') {
+        ShelfClear(shelf, shelf->hoverSlot);
+        struct Stack *newStack = NewStack(BinArena(bin), newInput.shift ? StackStyle_Depth : StackStyle_Tabs, 2);
+        ShelfPut(shelf, shelf->hoverSlot, Wrap(newStack, bin));
+        newInput.used = true;
+      }
+
+      // Z zooms the hovered slot and unzooms it again. Within a zoomed slot it is left to the container that zoomed.
+      if (newInput.key == 'Z' && !ZoomedAbove(bin)) {
+        ShelfZoom(shelf, shelf->zoomSlot < 0 ? shelf->hoverSlot : -1);
+        newInput.used = true;
+      }
+    }
+  }
+}
+
+void ShelfLayout(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct Shelf *shelf = Unwrap(struct Shelf, bin, bin);
+
+  for (int slot = 0; slot < shelf->slotCount; slot++) {
+    struct Bin *bin = ShelfGet(shelf, slot);
+    if (bin != NULL)
+      LayoutBin(bin, ShelfMakeCellBounds(shelf, slot));
+  }
+}
+
+void ShelfDestroy(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct Shelf *shelf = Unwrap(struct Shelf, bin, bin);
+
+  for (int slot = 0; slot < shelf->slotCount; slot++)
+    ShelfClear(shelf, slot);
+
+  ArenaFreeSlots(BinArena(&shelf->bin), shelf->bins, shelf->slotCapacity);
+  ReleaseTrack(&shelf->track, BinArena(&shelf->bin));
+}
+
+int ShelfChildCount(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct Shelf *shelf = Unwrap(struct Shelf, bin, bin);
+  return shelf->slotCount;
+}
+
+struct Bin *ShelfChild(struct Bin *bin, int index) {
+  AssertNotNull(bin);
+
+  struct Shelf *shelf = Unwrap(struct Shelf, bin, bin);
+  return ShelfGet(shelf, index);
+}
+
+struct Shelf *NewEmptyShelf(struct Arena *arena, enum ShelfDirection direction, int count) {
+  struct Shelf *shelf = (struct Shelf *)PoolAllocate(&arena->shelves);
+  shelf->bin.pool = &arena->shelves;
+  shelf->bin.onDrawFn = ShelfDraw;
+  shelf->bin.onInputFn = ShelfInput;
+  shelf->bin.onLayoutFn = ShelfLayout;
+  shelf->bin.onDestroyFn = ShelfDestroy;
+  shelf->bin.onChildCountFn = ShelfChildCount;
+  shelf->bin.onChildFn = ShelfChild;
+  shelf->bin.layoutDirty = true;
+
+  shelf->direction = direction;
+  shelf->zoomSlot = -1;
+
+  shelf->slotCount = count;
+  shelf->slotCapacity = ArenaSlotCapacity(count);
+  shelf->bins = ArenaAllocateSlots(arena, shelf->slotCapacity);
+  InitTrack(&shelf->track, arena, count);
+
+  return shelf;
+}
+
+struct Shelf *NewShelf(struct Arena *arena, enum ShelfDirection direction, int count) {
+  struct Shelf *shelf = NewEmptyShelf(arena, direction, count);
+
+  for (int slot = 0; slot < shelf->slotCount; slot++) {
+    struct Cell *newCell = NewCell(arena);
+    struct Bin *newBin = Wrap(newCell, bin);
+    ShelfPut(shelf, slot, newBin);
+  }
+
+  return shelf;
+}
+
+struct Bin *Grid(struct Grid *grid, int row, int column) {
+  AssertNotNull(grid);
+  AssertNotNull(grid->bins);
+  AssertIndex(row, grid->rowCount);
+  AssertIndex(column, grid->columnCount);
+
+  int index = grid->columnCount * row + column;
+
+  return grid->bins[index];
+}
+
+bool SpanBit(const unsigned long long *words, int column) { return (words[column / 64] >> (column % 64)) & 1; }
+
+void SpanSetBit(unsigned long long *words, int column, bool value) {
+  unsigned long long bit = 1ULL << (column % 64);
+  if (value)
+    words[column / 64] |= bit;
+  else
+    words[column / 64] &= ~bit;
+}
+
+// The bits of the word holding column first to last - 1, where they are both in the word with index word.
+unsigned long long SpanMask(int word, int first, int last) {
+  int low = first > word * 64 ? first - word * 64 : 0;
+  int high = last < (word + 1) * 64 ? last - word * 64 : 64;
+  unsigned long long below = high == 64 ? ~0ULL : (1ULL << high) - 1;
+  return below & ~((1ULL << low) - 1);
+}
+
+void SpanSetRange(unsigned long long *words, int first, int last, bool value) {
+  for (int word = first / 64; word * 64 < last; word++) {
+    if (value)
+      words[word] |= SpanMask(word, first, last);
+    else
+      words[word] &= ~SpanMask(word, first, last);
+  }
+}
+
+bool SpanAnyInRange(const unsigned long long *words, int first, int last) {
+  for (int word = first / 64; word * 64 < last; word++)
+    if (words[word] & SpanMask(word, first, last))
+      return true;
+  return false;
+}
+
+// Inserts a clear bit at column, moving the bits from there on up by one. The top bit of the row falls off.
+void SpanInsertBit(unsigned long long *words, int wordCount, int column) {
+  int first = column / 64;
+  for (int word = wordCount - 1; word > first; word--)
+    words[word] = (words[word] << 1) | (words[word - 1] >> 63);
+  unsigned long long low = (1ULL << (column % 64)) - 1;
+  words[first] = (words[first] & low) | ((words[first] & ~low) << 1);
+}
+
+// Removes the bit at column, moving the bits after it down by one.
+void SpanDeleteBit(unsigned long long *words, int wordCount, int column) {
+  int first = column / 64;
+  unsigned long long low = (1ULL << (column % 64)) - 1;
+  words[first] = (words[first] & low) | ((words[first] >> 1) & ~low);
+  for (int word = first; word < wordCount - 1; word++) {
+    words[word] |= words[word + 1] << 63;
+    words[word + 1] >>= 1;
+  }
+}
+
+unsigned long long *GridSpanLeft(struct Grid *grid, int row) { return &grid->spanLeft[row * grid->spanStride]; }
+unsigned long long *GridSpanUp(struct Grid *grid, int row) { return &grid->spanUp[row * grid->spanStride]; }
+
+// Whether the cell is part of a span held by another cell.
+bool GridCovered(struct Grid *grid, int row, int column) {
+  if (grid->spanLeft == NULL)
+    return false;
+  return SpanBit(GridSpanLeft(grid, row), column) || SpanBit(GridSpanUp(grid, row), column);
+}
+
+void ReleaseGridSpans(struct Grid *grid) {
+  if (grid->spanLeft == NULL)
+    return;
+
+  struct Arena *arena = BinArena(&grid->bin);
+  int wordCount = grid->spanRowCapacity * grid->spanStride;
+  ArenaFreeItems(arena, grid->spanLeft, sizeof(unsigned long long), wordCount);
+  ArenaFreeItems(arena, grid->spanUp, sizeof(unsigned long long), wordCount);
+  grid->spanLeft = NULL;
+  grid->spanUp = NULL;
+}
+
+// Makes the span bitmaps, if there are none yet, big enough for rowCount rows of columnCount columns, at least doubling
+// whichever runs out.
+void GridReserveSpans(struct Grid *grid, int rowCount, int columnCount) {
+  int stride = (columnCount + 63) / 64;
+  if (grid->spanLeft != NULL && rowCount <= grid->spanRowCapacity && stride <= grid->spanStride)
+    return;
+
+  int newRowCapacity = grid->spanRowCapacity;
+  if (grid->spanLeft == NULL || rowCount > newRowCapacity)
+    newRowCapacity = newRowCapacity * 2 > rowCount ? newRowCapacity * 2 : rowCount;
+  int newStride = grid->spanStride;
+  if (grid->spanLeft == NULL || stride > newStride)
+    newStride = newStride * 2 > stride ? newStride * 2 : stride;
+
+  struct Arena *arena = BinArena(&grid->bin);
+  int wordCount = newRowCapacity * newStride;
+  unsigned long long *newLeft =
+      (unsigned long long *)ArenaAllocateItems(arena, sizeof(unsigned long long), wordCount);
+  unsigned long long *newUp = (unsigned long long *)ArenaAllocateItems(arena, sizeof(unsigned long long), wordCount);
+  if (grid->spanLeft != NULL) {
+    for (int row = 0; row < grid->rowCount; row++) {
+      memcpy(&newLeft[row * newStride], GridSpanLeft(grid, row), grid->spanStride * sizeof(unsigned long long));
+      memcpy(&newUp[row * newStride], GridSpanUp(grid, row), grid->spanStride * sizeof(unsigned long long));
+    }
+    ReleaseGridSpans(grid);
+  }
+
+  grid->spanLeft = newLeft;
+  grid->spanUp = newUp;
+  grid->spanRowCapacity = newRowCapacity;
+  grid->spanStride = newStride;
+}
+
+void GridMarkSpan(struct Grid *grid, int row, int column, int rowSpan, int columnSpan, bool value) {
+  for (int spanRow = row; spanRow < row + rowSpan; spanRow++) {
+    SpanSetRange(GridSpanLeft(grid, spanRow), column + 1, column + columnSpan, value);
+    if (spanRow > row)
+      SpanSetRange(GridSpanUp(grid, spanRow), column, column + columnSpan, value);
+  }
+}
+
+// Whether the cells of a span would all be free of other spans, neither covered by one nor holding one that reaches
+// outside it. Only the span's rows, and the column to its right and row below it, are looked at.
+bool GridSpanFree(struct Grid *grid, int row, int column, int rowSpan, int columnSpan) {
+  for (int spanRow = row; spanRow < row + rowSpan; spanRow++) {
+    if (SpanAnyInRange(GridSpanLeft(grid, spanRow), column, column + columnSpan) ||
+        SpanAnyInRange(GridSpanUp(grid, spanRow), column, column + columnSpan))
+      return false;
+    if (column + columnSpan < grid->columnCount && SpanBit(GridSpanLeft(grid, spanRow), column + columnSpan))
+      return false;
+  }
+  if (row + rowSpan < grid->rowCount && SpanAnyInRange(GridSpanUp(grid, row + rowSpan), column, column + columnSpan))
+    return false;
+  return true;
+}
+
+void GridGetSpan(struct Grid *grid, int row, int column, int *rowSpan, int *columnSpan) {
+  AssertNotNull(grid);
+  AssertIndex(row, grid->rowCount);
+  AssertIndex(column, grid->columnCount);
+
+  *rowSpan = 1;
+  *columnSpan = 1;
+  if (GridCovered(grid, row, column))
+    return;
+  if (grid->spanLeft == NULL)
+    return;
+
+  unsigned long long *left = GridSpanLeft(grid, row);
+  while (column + *columnSpan < grid->columnCount && SpanBit(left, column + *columnSpan))
+    (*columnSpan)++;
+  while (row + *rowSpan < grid->rowCount && SpanBit(GridSpanUp(grid, row + *rowSpan), column))
+    (*rowSpan)++;
+}
+
+bool GridFindSpan(struct Grid *grid, int *row, int *column) {
+  AssertNotNull(grid);
+  AssertIndex(*row, grid->rowCount);
+  AssertIndex(*column, grid->columnCount);
+
+  if (grid->spanLeft == NULL)
+    return false;
+
+  bool covered = false;
+  unsigned long long *left = GridSpanLeft(grid, *row);
+  while (SpanBit(left, *column)) {
+    (*column)--;
+    covered = true;
+  }
+  while (SpanBit(GridSpanUp(grid, *row), *column)) {
+    (*row)--;
+    covered = true;
+  }
+  return covered;
+}
+
+bool GridSetSpan(struct Grid *grid, int row, int column, int rowSpan, int columnSpan) {
+  AssertNotNull(grid);
+  AssertNotNull(grid->bins);
+  AssertIndex(row, grid->rowCount);
+  AssertIndex(column, grid->columnCount);
+  AssertGreater(rowSpan, 0);
+  AssertGreater(columnSpan, 0);
+
+  if (row + rowSpan > grid->rowCount || column + columnSpan > grid->columnCount || GridCovered(grid, row, column))
+    return false;
+  if (grid->spanLeft == NULL && rowSpan == 1 && columnSpan == 1)
+    return true;
+
+  GridReserveSpans(grid, grid->rowCount, grid->columnCount);
+  int oldRowSpan, oldColumnSpan;
+  GridGetSpan(grid, row, column, &oldRowSpan, &oldColumnSpan);
+  GridMarkSpan(grid, row, column, oldRowSpan, oldColumnSpan, false);
+  if (!GridSpanFree(grid, row, column, rowSpan, columnSpan)) {
+    GridMarkSpan(grid, row, column, oldRowSpan, oldColumnSpan, true);
+    return false;
+  }
+
+  for (int spanRow = row; spanRow < row + rowSpan; spanRow++)
+    for (int spanColumn = column; spanColumn < column + columnSpan; spanColumn++)
+      if (spanRow != row || spanColumn != column)
+        GridClear(grid, spanRow, spanColumn);
+  GridMarkSpan(grid, row, column, rowSpan, columnSpan, true);
+
+  // Cells a shrinking span lets go of are given empty cells, as inserted rows and columns are.
+  for (int spanRow = row; spanRow < row + oldRowSpan; spanRow++) {
+    for (int spanColumn = column; spanColumn < column + oldColumnSpan; spanColumn++) {
+      if (spanRow < row + rowSpan && spanColumn < column + columnSpan)
+        continue;
+      struct Cell *newCell = NewCell(BinArena(&grid->bin));
+      grid->bins[grid->columnCount * spanRow + spanColumn] = Wrap(newCell, bin);
+      newCell->bin.parent = &grid->bin;
+    }
+  }
+
+  grid->zoomRow = -1;
+  grid->zoomColumn = -1;
+  MarkLayoutDirty(&grid->bin);
+  return true;
+}
+
+bool GridSameSpans(struct Grid *grid, struct Grid *other) {
+  AssertNotNull(grid);
+  AssertNotNull(other);
+
+  if (grid->rowCount != other->rowCount || grid->columnCount != other->columnCount)
+    return false;
+  if (grid->spanLeft == NULL && other->spanLeft == NULL)
+    return true;
+
+  for (int row = 0; row < grid->rowCount; row++) {
+    for (int word = 0; word * 64 < grid->columnCount; word++) {
+      unsigned long long left = grid->spanLeft != NULL ? GridSpanLeft(grid, row)[word] : 0;
+      unsigned long long up = grid->spanLeft != NULL ? GridSpanUp(grid, row)[word] : 0;
+      unsigned long long otherLeft = other->spanLeft != NULL ? GridSpanLeft(other, row)[word] : 0;
+      unsigned long long otherUp = other->spanLeft != NULL ? GridSpanUp(other, row)[word] : 0;
+      if (left != otherLeft || up != otherUp)
+        return false;
+    }
+  }
+  return true;
+}
+
+void GridPut(struct Grid *grid, int row, int column, struct Bin *bin) {
+  AssertNotNull(grid);
+  AssertNotNull(grid->bins);
+  AssertIndex(row, grid->rowCount);
+  AssertIndex(column, grid->columnCount);
+
+  int index = grid->columnCount * row + column;
+  AssertNull(grid->bins[index]);
+  AssertMessage(!GridCovered(grid, row, column), ("A cell covered by a span cannot hold a bin"));
+
+  grid->bins[index] = bin;
+
+  if (bin != NULL) {
+    bin->parent = &grid->bin;
+    MarkLayoutDirty(&grid->bin);
+  }
+}
+
+void GridClear(struct Grid *grid, int row, int column) {
+  AssertNotNull(grid);
+  AssertNotNull(grid->bins);
+  AssertIndex(row, grid->rowCount);
+  AssertIndex(column, grid->columnCount);
+
+  int index = grid->columnCount * row + column;
+
+  struct Bin *bin = grid->bins[index];
+  if (bin != NULL) {
+    DestroyBin(bin);
+    grid->bins[index] = NULL;
+  }
+}
+
+// Grows the slot array to hold at least count cells, at least doubling its capacity.
+void GridReserve(struct Grid *grid, int count) {
+  AssertNotNull(grid);
+
+  if (count <= grid->slotCapacity)
+    return;
+
+  int newCapacity = grid->slotCapacity * 2;
+  if (newCapacity < count)
+    newCapacity = count;
+  newCapacity = ArenaSlotCapacity(newCapacity);
+
+  struct Arena *arena = BinArena(&grid->bin);
+  struct Bin **newBins = ArenaAllocateSlots(arena, newCapacity);
+  memcpy(newBins, grid->bins, grid->rowCount * grid->columnCount * sizeof(struct Bin *));
+  ArenaFreeSlots(arena, grid->bins, grid->slotCapacity);
+
+  grid->bins = newBins;
+  grid->slotCapacity = newCapacity;
+}
+
+void GridInsertRow(struct Grid *grid, int newRow) {
+  AssertNotNull(grid);
+  AssertNotNull(grid->bins);
+  AssertIndex(newRow, grid->rowCount + 1);
+
+  GridReserve(grid, (grid->rowCount + 1) * grid->columnCount);
+  TrackInsert(&grid->rows, BinArena(&grid->bin), grid->rowCount, newRow);
+
+  // Rows are contiguous, so the rows below the new one shift down in a single move.
+  struct Bin **rowBins = &grid->bins[grid->columnCount * newRow];
+  memmove(rowBins + grid->columnCount, rowBins, (grid->rowCount - newRow) * grid->columnCount * sizeof(struct Bin *));
+
+  // The new row is part of every span that reaches across it, which is every span the row it pushes down continues.
+  if (grid->spanLeft != NULL) {
+    GridReserveSpans(grid, grid->rowCount + 1, grid->columnCount);
+    int stride = grid->spanStride;
+    size_t bytes = (grid->rowCount - newRow) * stride * sizeof(unsigned long long);
+    memmove(GridSpanLeft(grid, newRow) + stride, GridSpanLeft(grid, newRow), bytes);
+    memmove(GridSpanUp(grid, newRow) + stride, GridSpanUp(grid, newRow), bytes);
+    unsigned long long *left = GridSpanLeft(grid, newRow);
+    unsigned long long *up = GridSpanUp(grid, newRow);
+    for (int word = 0; word < stride; word++) {
+      bool below = newRow < grid->rowCount;
+      up[word] = below ? up[word + stride] : 0;
+      left[word] = below ? left[word + stride] & up[word + stride] : 0;
+    }
+  }
+  grid->rowCount += 1;
+
+  struct Arena *arena = BinArena(&grid->bin);
+  for (int column = 0; column < grid->columnCount; column++) {
+    if (GridCovered(grid, newRow, column)) {
+      rowBins[column] = NULL;
+      continue;
+    }
+    struct Cell *newCell = NewCell(arena);
+    rowBins[column] = Wrap(newCell, bin);
+    newCell->bin.parent = &grid->bin;
+  }
+
+  grid->zoomRow = -1;
+  grid->zoomColumn = -1;
+  MarkLayoutDirty(&grid->bin);
+}
+
+void GridDeleteRow(struct Grid *grid, int oldRow) {
+  AssertNotNull(grid);
+  AssertNotNull(grid->bins);
+  AssertIndex(oldRow, grid->rowCount);
+
+  // Spans that start on the row and reach below it start on the next row instead, and their bins move there.
+  if (grid->spanLeft != NULL && oldRow + 1 < grid->rowCount) {
+    unsigned long long *left = GridSpanLeft(grid, oldRow);
+    unsigned long long *up = GridSpanUp(grid, oldRow);
+    unsigned long long *belowUp = GridSpanUp(grid, oldRow + 1);
+    for (int column = 0; column < grid->columnCount; column++) {
+      if (!SpanBit(belowUp, column) || SpanBit(up, column))
+        continue;
+      SpanSetBit(belowUp, column, false);
+      if (!SpanBit(left, column)) {
+        struct Bin **oldSlot = &grid->bins[grid->columnCount * oldRow + column];
+        grid->bins[grid->columnCount * (oldRow + 1) + column] = *oldSlot;
+        *oldSlot = NULL;
+      }
+    }
+  }
+
+  for (int column = 0; column < grid->columnCount; column++)
+    GridClear(grid, oldRow, column);
+  TrackDelete(&grid->rows, grid->rowCount, oldRow);
+
+  struct Bin **rowBins = &grid->bins[grid->columnCount * oldRow];
+  memmove(rowBins, rowBins + grid->columnCount,
+          (grid->rowCount - oldRow - 1) * grid->columnCount * sizeof(struct Bin *));
+  grid->rowCount -= 1;
+  memset(&grid->bins[grid->columnCount * grid->rowCount], 0, grid->columnCount * sizeof(struct Bin *));
+
+  if (grid->spanLeft != NULL) {
+    int stride = grid->spanStride;
+    size_t bytes = (grid->rowCount - oldRow) * stride * sizeof(unsigned long long);
+    memmove(GridSpanLeft(grid, oldRow), GridSpanLeft(grid, oldRow) + stride, bytes);
+    memmove(GridSpanUp(grid, oldRow), GridSpanUp(grid, oldRow) + stride, bytes);
+    memset(GridSpanLeft(grid, grid->rowCount), 0, stride * sizeof(unsigned long long));
+    memset(GridSpanUp(grid, grid->rowCount), 0, stride * sizeof(unsigned long long));
+  }
+
+  grid->zoomRow = -1;
+  grid->zoomColumn = -1;
+  MarkLayoutDirty(&grid->bin);
+}
+
+void GridInsertColumn(struct Grid *grid, int newColumn) {
+  AssertNotNull(grid);
+  AssertNotNull(grid->bins);
+  AssertIndex(newColumn, grid->columnCount + 1);
+
+  int oldColumnCount = grid->columnCount;
+  int newColumnCount = oldColumnCount + 1;
+
+  GridReserve(grid, grid->rowCount * newColumnCount);
+  TrackInsert(&grid->columns, BinArena(&grid->bin), oldColumnCount, newColumn);
+
+  // As GridInsertRow: the new column is part of every span the column it pushes right continues.
+  if (grid->spanLeft != NULL) {
+    GridReserveSpans(grid, grid->rowCount, newColumnCount);
+    for (int row = 0; row < grid->rowCount; row++) {
+      unsigned long long *left = GridSpanLeft(grid, row);
+      unsigned long long *up = GridSpanUp(grid, row);
+      bool right = newColumn < oldColumnCount && SpanBit(left, newColumn);
+      bool rightUp = right && SpanBit(up, newColumn);
+      SpanInsertBit(left, grid->spanStride, newColumn);
+      SpanInsertBit(up, grid->spanStride, newColumn);
+      SpanSetBit(left, newColumn, right);
+      SpanSetBit(up, newColumn, rightUp);
+    }
+  }
+
+  // Each row moves to a wider stride in place. Working from the last row back, and moving the part of each row
+  // after the new column before the part ahead of it, never overwrites a slot that has yet to move.
+  struct Arena *arena = BinArena(&grid->bin);
+  for (int row = grid->rowCount - 1; row >= 0; row--) {
+    struct Bin **oldRowBins = &grid->bins[oldColumnCount * row];
+    struct Bin **newRowBins = &grid->bins[newColumnCount * row];
+    memmove(newRowBins + newColumn + 1, oldRowBins + newColumn, (oldColumnCount - newColumn) * sizeof(struct Bin *));
+    memmove(newRowBins, oldRowBins, newColumn * sizeof(struct Bin *));
+
+    if (GridCovered(grid, row, newColumn)) {
+      newRowBins[newColumn] = NULL;
+      continue;
+    }
+    struct Cell *newCell = NewCell(arena);
+    newRowBins[newColumn] = Wrap(newCell, bin);
+    newCell->bin.parent = &grid->bin;
+  }
+  grid->columnCount = newColumnCount;
+
+  grid->zoomRow = -1;
+  grid->zoomColumn = -1;
+  MarkLayoutDirty(&grid->bin);
+}
+
+void GridDeleteColumn(struct Grid *grid, int oldColumn) {
+  AssertNotNull(grid);
+  AssertNotNull(grid->bins);
+  AssertIndex(oldColumn, grid->columnCount);
+
+  // As GridDeleteRow: spans that start on the column and reach right of it start on the next column instead.
+  if (grid->spanLeft != NULL && oldColumn + 1 < grid->columnCount) {
+    for (int row = 0; row < grid->rowCount; row++) {
+      unsigned long long *left = GridSpanLeft(grid, row);
+      if (!SpanBit(left, oldColumn + 1) || SpanBit(left, oldColumn))
+        continue;
+      SpanSetBit(left, oldColumn + 1, false);
+      if (!SpanBit(GridSpanUp(grid, row), oldColumn)) {
+        struct Bin **oldSlot = &grid->bins[grid->columnCount * row + oldColumn];
+        oldSlot[1] = *oldSlot;
+        *oldSlot = NULL;
+      }
+    }
+  }
+
+  for (int row = 0; row < grid->rowCount; row++)
+    GridClear(grid, row, oldColumn);
+  TrackDelete(&grid->columns, grid->columnCount, oldColumn);
+
+  int oldColumnCount = grid->columnCount;
+  int newColumnCount = oldColumnCount - 1;
+
+  // The reverse of GridInsertColumn: rows move to a narrower stride, first row first.
+  for (int row = 0; row < grid->rowCount; row++) {
+    struct Bin **oldRowBins = &grid->bins[oldColumnCount * row];
+    struct Bin **newRowBins = &grid->bins[newColumnCount * row];
+    memmove(newRowBins, oldRowBins, oldColumn * sizeof(struct Bin *));
+    memmove(newRowBins + oldColumn, oldRowBins + oldColumn + 1, (newColumnCount - oldColumn) * sizeof(struct Bin *));
+  }
+  grid->columnCount = newColumnCount;
+  memset(&grid->bins[newColumnCount * grid->rowCount], 0, grid->rowCount * sizeof(struct Bin *));
+
+  if (grid->spanLeft != NULL) {
+    for (int row = 0; row < grid->rowCount; row++) {
+      SpanDeleteBit(GridSpanLeft(grid, row), grid->spanStride, oldColumn);
+      SpanDeleteBit(GridSpanUp(grid, row), grid->spanStride, oldColumn);
+    }
+  }
+
+  grid->zoomRow = -1;
+  grid->zoomColumn = -1;
+  MarkLayoutDirty(&grid->bin);
+}
+
+void GridSetRowSize(struct Grid *grid, int row, struct SlotSize size) {
+  AssertNotNull(grid);
+  AssertIndex(row, grid->rowCount);
+
+  if (TrackSetSize(&grid->rows, row, size))
+    MarkLayoutDirty(&grid->bin);
+}
+
+void GridSetColumnSize(struct Grid *grid, int column, struct SlotSize size) {
+  AssertNotNull(grid);
+  AssertIndex(column, grid->columnCount);
+
+  if (TrackSetSize(&grid->columns, column, size))
+    MarkLayoutDirty(&grid->bin);
+}
+
+void GridZoom(struct Grid *grid, int row, int column) {
+  AssertNotNull(grid);
+
+  if (row >= 0 || column >= 0) {
+    AssertIndex(row, grid->rowCount);
+    AssertIndex(column, grid->columnCount);
+    GridFindSpan(grid, &row, &column);
+  } else {
+    row = column = -1;
+  }
+
+  if (grid->zoomRow == row && grid->zoomColumn == column)
+    return;
+
+  grid->zoomRow = row;
+  grid->zoomColumn = column;
+  MarkLayoutDirty(&grid->bin);
+  if (row >= 0 && Grid(grid, row, column) != NULL)
+    RaiseBinWindows(Grid(grid, row, column));
+}
+
+struct Bounds GridMakeCellBounds(struct Grid *grid, int row, int column) {
+  AssertNotNull(grid);
+  AssertIndex(row, grid->rowCount);
+  AssertIndex(column, grid->columnCount);
+
+  AssertGreater(grid->columnCount, 0);
+  AssertGreater(grid->rowCount, 0);
+
+  if (row == grid->zoomRow && column == grid->zoomColumn)
+    return ZoomBounds(&grid->bin);
+
+  int rowSpan, columnSpan;
+  GridGetSpan(grid, row, column, &rowSpan, &columnSpan);
+
+  struct Bounds bounds;
+  int inset = dimensions[Dimension_BorderInset];
+  const int *columnOffsets = TrackOffsets(&grid->columns, grid->columnCount, grid->bin.bounds.width, inset);
+  const int *rowOffsets = TrackOffsets(&grid->rows, grid->rowCount, grid->bin.bounds.height, inset);
+  bounds.width = columnOffsets[column + columnSpan] - columnOffsets[column] - inset;
+  bounds.height = rowOffsets[row + rowSpan] - rowOffsets[row] - inset;
+  bounds.x = grid->bin.bounds.x + columnOffsets[column];
+  bounds.y = grid->bin.bounds.y + rowOffsets[row];
+  return bounds;
+}
+
+// As ShelfSlotAtPoint, per axis. Sets row and column to -1 when the point is not over a cell.
+void GridCellAtPoint(struct Grid *grid, struct Point point, int *row, int *column) {
+  AssertNotNull(grid);
+
+  *row = -1;
+  *column = -1;
+
+  if (grid->zoomRow >= 0) {
+    if (PointInBounds(point, GridMakeCellBounds(grid, grid->zoomRow, grid->zoomColumn))) {
+      *row = grid->zoomRow;
+      *column = grid->zoomColumn;
+    }
+    return;
+  }
+
+  int inset = dimensions[Dimension_BorderInset];
+  TrackOffsets(&grid->columns, grid->columnCount, grid->bin.bounds.width, inset);
+  TrackOffsets(&grid->rows, grid->rowCount, grid->bin.bounds.height, inset);
+  // The insets between the cells of a span are part of it, so the cell the point is in or after is taken, and the
+  // bounds of the span it belongs to decide.
+  int hitRow = TrackSlotFrom(&grid->rows, grid->rowCount, point.y - grid->bin.bounds.y);
+  int hitColumn = TrackSlotFrom(&grid->columns, grid->columnCount, point.x - grid->bin.bounds.x);
+  if (hitRow < 0 || hitColumn < 0)
+    return;
+  GridFindSpan(grid, &hitRow, &hitColumn);
+  if (!PointInBounds(point, GridMakeCellBounds(grid, hitRow, hitColumn)))
+    return;
+
+  *row = hitRow;
+  *column = hitColumn;
+}
+
+void GridDraw(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct Grid *grid = Unwrap(struct Grid, bin, bin);
+
+  if (grid->zoomRow >= 0) {
+    DrawBin(Grid(grid, grid->zoomRow, grid->zoomColumn));
+    return;
+  }
+
+  for (int row = 0; row < grid->rowCount; row++) {
+    for (int column = 0; column < grid->columnCount; column++)
+      DrawBin(Grid(grid, row, column));
+  }
+}
+
+void GridInput(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct Grid *grid = Unwrap(struct Grid, bin, bin);
+
+  GridCellAtPoint(grid, newInput.position, &grid->hoverRow, &grid->hoverColumn);
+
+  if (grid->hoverRow != -1 && grid->hoverColumn != -1) {
+    struct Bin *hoverBin = Grid(grid, grid->hoverRow, grid->hoverColumn);
+    if (hoverBin != NULL) {
+      if (hoverBin->onInputFn)
+        hoverBin->onInputFn(hoverBin);
+    }
+
+    if (!newInput.used) {
+      if (newInput.key == 'X') {
+        if (grid->rowCount > 1 && grid->columnCount == 1) {
+          GridDeleteRow(grid, grid->hoverRow);
+          newInput.used = true;
+        } else if (grid->rowCount == 1 && grid->columnCount > 1) {
+          GridDeleteColumn(grid, grid->hoverColumn);
+          newInput.used = true;
+        }
+        // Pass other cases up to the parent to deal with.
+      }
+
+      if (newInput.key == 'H') {
+        GridClear(grid, grid->hoverRow, grid->hoverColumn);
+        struct Grid *newGrid = NewGrid(BinArena(bin));
+        struct Bin *newBin = Wrap(newGrid, bin);
+        GridPut(grid, grid->hoverRow, grid->hoverColumn, newBin);
+        newInput.used = true;
+      }
+
+      if (newInput.key == 'C' && !newInput.shift) {
+        GridInsertColumn(grid, grid->hoverColumn);
+        newInput.used = true;
+      }
+      if (newInput.key == 'C' && newInput.shift) {
+        if (grid->columnCount > 1)
+          GridDeleteColumn(grid, grid->hoverColumn);
+        newInput.used = true;
+      }
+
+      if (newInput.key == 'R' && !newInput.shift) {
+        GridInsertRow(grid, grid->hoverRow);
+        newInput.used = true;
+      }
+
+      if (newInput.key == 'R' && newInput.shift) {
+        if (grid->rowCount > 1)
+          GridDeleteRow(grid, grid->hoverRow);
+        newInput.used = true;
+      }
+
+      // S spans the hovered cell over the next column, or with shift the next row, if nothing is in the way.
+      if (newInput.key == 'S') {
+        int rowSpan, columnSpan;
+        GridGetSpan(grid, grid->hoverRow, grid->hoverColumn, &rowSpan, &columnSpan);
+        if (newInput.shift)
+          rowSpan++;
+        else
+          columnSpan++;
+        GridSetSpan(grid, grid->hoverRow, grid->hoverColumn, rowSpan, columnSpan);
+        newInput.used = true;
+      }
+
+      if (newInput.key == 'Z' && !ZoomedAbove(bin)) {
+        if (grid->zoomRow < 0)
+          GridZoom(grid, grid->hoverRow, grid->hoverColumn);
+        else
+          GridZoom(grid, -1, -1);
+        newInput.used = true;
+      }
+    }
+  }
+}
+
+void GridLayout(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct Grid *grid = Unwrap(struct Grid, bin, bin);
+
+  for (int row = 0; row < grid->rowCount; row++) {
+    for (int column = 0; column < grid->columnCount; column++) {
+      struct Bin *bin = Grid(grid, row, column);
+      if (bin != NULL)
+        LayoutBin(bin, GridMakeCellBounds(grid, row, column));
+    }
+  }
+}
+
+void GridDestroy(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct Grid *grid = Unwrap(struct Grid, bin, bin);
+
+  for (int row = 0; row < grid->rowCount; row++)
+    for (int column = 0; column < grid->columnCount; column++)
+      GridClear(grid, row, column);
+
+  ArenaFreeSlots(BinArena(&grid->bin), grid->bins, grid->slotCapacity);
+  ReleaseTrack(&grid->rows, BinArena(&grid->bin));
+  ReleaseTrack(&grid->columns, BinArena(&grid->bin));
+  ReleaseGridSpans(grid);
+}
+
+int GridChildCount(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct Grid *grid = Unwrap(struct Grid, bin, bin);
+  return grid->rowCount * grid->columnCount;
+}
+
+struct Bin *GridChild(struct Bin *bin, int index) {
+  AssertNotNull(bin);
+
+  struct Grid *grid = Unwrap(struct Grid, bin, bin);
+  AssertIndex(index, grid->rowCount * grid->columnCount);
+  return grid->bins[index];
+}
+
+struct Grid *NewEmptyGrid(struct Arena *arena, int rowCount, int columnCount) {
+  struct Grid *grid = (struct Grid *)PoolAllocate(&arena->grids);
+  grid->bin.pool = &arena->grids;
+  grid->bin.onDrawFn = GridDraw;
+  grid->bin.onInputFn = GridInput;
+  grid->bin.onLayoutFn = GridLayout;
+  grid->bin.onDestroyFn = GridDestroy;
+  grid->bin.onChildCountFn = GridChildCount;
+  grid->bin.onChildFn = GridChild;
+  grid->bin.layoutDirty = true;
+
+  grid->rowCount = rowCount;
+  grid->columnCount = columnCount;
+  grid->zoomRow = -1;
+  grid->zoomColumn = -1;
+  grid->slotCapacity = ArenaSlotCapacity(rowCount * columnCount);
+  grid->bins = ArenaAllocateSlots(arena, grid->slotCapacity);
+  InitTrack(&grid->rows, arena, rowCount);
+  InitTrack(&grid->columns, arena, columnCount);
+
+  return grid;
+}
+
+struct Grid *NewGrid(struct Arena *arena) {
+  struct Grid *grid = NewEmptyGrid(arena, 1, 1);
+
+  struct Cell *newCell = NewCell(arena);
+  struct Bin *newBin = Wrap(newCell, bin);
+  GridPut(grid, 0, 0, newBin);
+
+  return grid;
+}
+
+struct Bin *SwirlGet(struct Swirl *swirl, int slot) {
+  AssertNotNull(swirl);
+  AssertNotNull(swirl->bins);
+  AssertIndex(slot, swirl->slotCount);
+
+  return swirl->bins[slot];
+}
+
+void SwirlPut(struct Swirl *swirl, int slot, struct Bin *bin) {
+  AssertNotNull(swirl);
+  AssertNotNull(swirl->bins);
+  AssertIndex(slot, swirl->slotCount);
+
+  AssertNull(swirl->bins[slot]);
+
+  swirl->bins[slot] = bin;
+
+  if (bin != NULL) {
+    bin->parent = &swirl->bin;
+    MarkLayoutDirty(&swirl->bin);
+  }
+}
+
+void SwirlClear(struct Swirl *swirl, int slot) {
+  AssertNotNull(swirl);
+  AssertNotNull(swirl->bins);
+  AssertIndex(slot, swirl->slotCount);
+
+  struct Bin *bin = swirl->bins[slot];
+  if (bin != NULL) {
+    DestroyBin(bin);
+    swirl->bins[slot] = NULL;
+  }
+}
+
+// Makes, or frees, the restack scratch for a swirl of this slot capacity.
+void SwirlAllocateScratch(struct Swirl *swirl, int capacity) {
+  struct Arena *arena = BinArena(&swirl->bin);
+  swirl->restackWindows = (WindowHandle *)ArenaAllocateItems(arena, sizeof(WindowHandle), capacity);
+  swirl->restackSorted = (struct SwirlStacked *)ArenaAllocateItems(arena, sizeof(struct SwirlStacked), capacity);
+  swirl->restackRuns = (int *)ArenaAllocateItems(arena, sizeof(int), 3 * capacity);
+  swirl->restackKept = (bool *)ArenaAllocateItems(arena, sizeof(bool), capacity);
+  swirl->restackStackings =
+      (struct WindowStacking *)ArenaAllocateItems(arena, sizeof(struct WindowStacking), capacity);
+}
+
+void SwirlFreeScratch(struct Swirl *swirl, int capacity) {
+  struct Arena *arena = BinArena(&swirl->bin);
+  ArenaFreeItems(arena, swirl->restackWindows, sizeof(WindowHandle), capacity);
+  ArenaFreeItems(arena, swirl->restackSorted, sizeof(struct SwirlStacked), capacity);
+  ArenaFreeItems(arena, swirl->restackRuns, sizeof(int), 3 * capacity);
+  ArenaFreeItems(arena, swirl->restackKept, sizeof(bool), capacity);
+  ArenaFreeItems(arena, swirl->restackStackings, sizeof(struct WindowStacking), capacity);
+}
+
+// Grows the slots, and the frames, stacked windows and restack scratch that go with them, to hold at least count, at
+// least doubling.
+void SwirlReserve(struct Swirl *swirl, int count) {
+  if (count <= swirl->slotCapacity)
+    return;
+
+  int newCapacity = swirl->slotCapacity * 2;
+  if (newCapacity < count)
+    newCapacity = count;
+  newCapacity = ArenaSlotCapacity(newCapacity);
+
+  struct Arena *arena = BinArena(&swirl->bin);
+  struct Bin **newBins = ArenaAllocateSlots(arena, newCapacity);
+  memcpy(newBins, swirl->bins, swirl->slotCount * sizeof(struct Bin *));
+  ArenaFreeSlots(arena, swirl->bins, swirl->slotCapacity);
+  swirl->bins = newBins;
+
+  WindowHandle *newStacked = (WindowHandle *)ArenaAllocateItems(arena, sizeof(WindowHandle), newCapacity);
+  memcpy(newStacked, swirl->stacked, swirl->stackedCount * sizeof(WindowHandle));
+  ArenaFreeItems(arena, swirl->stacked, sizeof(WindowHandle), swirl->slotCapacity);
+  swirl->stacked = newStacked;
+
+  // The frames are made again for the new count anyway.
+  ArenaFreeItems(arena, swirl->frames, sizeof(struct Bounds), swirl->slotCapacity);
+  swirl->frames = (struct Bounds *)ArenaAllocateItems(arena, sizeof(struct Bounds), newCapacity);
+  swirl->frameCount = -1;
+
+  SwirlFreeScratch(swirl, swirl->slotCapacity);
+  SwirlAllocateScratch(swirl, newCapacity);
+
+  swirl->slotCapacity = newCapacity;
+}
+
+void SwirlInsert(struct Swirl *swirl, int newSlot) {
+  AssertNotNull(swirl);
+  AssertNotNull(swirl->bins);
+  AssertIndex(newSlot, swirl->slotCount + 1);
+
+  SwirlReserve(swirl, swirl->slotCount + 1);
+
+  memmove(&swirl->bins[newSlot + 1], &swirl->bins[newSlot], (swirl->slotCount - newSlot) * sizeof(struct Bin *));
+  swirl->slotCount += 1;
+
+  struct Cell *newCell = NewCell(BinArena(&swirl->bin));
+  swirl->bins[newSlot] = Wrap(newCell, bin);
+  newCell->bin.parent = &swirl->bin;
+
+  MarkLayoutDirty(&swirl->bin);
+}
+
+void SwirlDelete(struct Swirl *swirl, int oldSlot) {
+  AssertNotNull(swirl);
+  AssertNotNull(swirl->bins);
+  AssertIndex(oldSlot, swirl->slotCount);
+
+  SwirlClear(swirl, oldSlot);
+
+  memmove(&swirl->bins[oldSlot], &swirl->bins[oldSlot + 1], (swirl->slotCount - oldSlot - 1) * sizeof(struct Bin *));
+  swirl->slotCount -= 1;
+  swirl->bins[swirl->slotCount] = NULL;
+
+  MarkLayoutDirty(&swirl->bin);
+}
+
+void SwirlSetTightness(struct Swirl *swirl, int tightness) {
+  AssertNotNull(swirl);
+  AssertGreater(tightness, 0);
+
+  if (swirl->tightness != tightness) {
+    swirl->tightness = tightness;
+    MarkLayoutDirty(&swirl->bin);
+  }
+}
+
+// Makes the frames again if the count, tightness, bounds or inset changed since they were last made. Slot 0 is
+// centred, pulled in from every side by a step per ring, and each slot after it is the same size, moved out a ring at a
+// time towards the top left, top right, bottom right and bottom left corners in turn. A slot ring r out shows the step
+// by step square of its corner that rings r - 1 leave uncovered, and nothing on the other sides can reach it.
+const struct Bounds *SwirlFrames(struct Swirl *swirl) {
+  int inset = dimensions[Dimension_BorderInset];
+  struct Bounds bounds = swirl->bin.bounds;
+  if (swirl->frameCount == swirl->slotCount && swirl->frameTightness == swirl->tightness &&
+      swirl->frameInset == inset && memcmp(&swirl->frameBounds, &bounds, sizeof(bounds)) == 0)
+    return swirl->frames;
+
+  int width = bounds.width - 2 * inset;
+  int height = bounds.height - 2 * inset;
+  int rings = (swirl->slotCount + 2) / 4;
+
+  // The top slot keeps at least half of the smaller side.
+  int step = 0;
+  if (rings > 0) {
+    step = (width < height ? width : height) / (4 * rings);
+    if (step > swirl->tightness)
+      step = swirl->tightness;
+    if (step < 0)
+      step = 0;
+  }
+
+  struct Bounds top;
+  top.x = bounds.x + inset + rings * step;
+  top.y = bounds.y + inset + rings * step;
+  top.width = width - 2 * rings * step;
+  top.height = height - 2 * rings * step;
+  for (int slot = 0; slot < swirl->slotCount; slot++) {
+    struct Bounds frame = top;
+    if (slot > 0) {
+      int ring = (slot - 1) / 4 + 1;
+      int corner = (slot - 1) % 4;
+      frame.x += (corner == 1 || corner == 2 ? ring : -ring) * step;
+      frame.y += (corner >= 2 ? ring : -ring) * step;
+    }
+    swirl->frames[slot] = frame;
+  }
+
+  swirl->step = step;
+  swirl->frameCount = swirl->slotCount;
+  swirl->frameTightness = swirl->tightness;
+  swirl->frameInset = inset;
+  swirl->frameBounds = bounds;
+  return swirl->frames;
+}
+
+struct Bounds SwirlMakeCellBounds(struct Swirl *swirl, int slot) {
+  AssertNotNull(swirl);
+  AssertIndex(slot, swirl->slotCount);
+
+  return SwirlFrames(swirl)[slot];
+}
+
+// The square of a slot below the top one that shows.
+struct Bounds SwirlCornerBounds(struct Swirl *swirl, int slot) {
+  struct Bounds corner = SwirlFrames(swirl)[slot];
+  int step = swirl->step;
+  if ((slot - 1) % 4 == 1 || (slot - 1) % 4 == 2)
+    corner.x += corner.width - step;
+  if ((slot - 1) % 4 >= 2)
+    corner.y += corner.height - step;
+  corner.width = step;
+  corner.height = step;
+  return corner;
+}
+
+int SwirlSlotAtPoint(struct Swirl *swirl, struct Point point) {
+  AssertNotNull(swirl);
+
+  if (swirl->slotCount <= 0)
+    return -1;
+
+  struct Bounds top = SwirlFrames(swirl)[0];
+  if (PointInBounds(point, top))
+    return 0;
+  if (swirl->step <= 0)
+    return -1;
+
+  // Only corners show, so the point must be past the top slot on both axes. How far past, in steps, is the ring.
+  bool left = point.x < top.x;
+  bool above = point.y < top.y;
+  int xPast = left ? top.x - point.x : point.x - (top.x + top.width - 1);
+  int yPast = above ? top.y - point.y : point.y - (top.y + top.height - 1);
+  if (xPast <= 0 || yPast <= 0)
+    return -1;
+
+  int ring = ((xPast > yPast ? xPast : yPast) - 1) / swirl->step + 1;
+  int corner = above ? (left ? 0 : 1) : (left ? 3 : 2);
+  int slot = (ring - 1) * 4 + corner + 1;
+  return slot < swirl->slotCount ? slot : -1;
+}
+
+int CompareSwirlStacked(const void *a, const void *b) {
+  WindowHandle left = ((const struct SwirlStacked *)a)->hWnd;
+  WindowHandle right = ((const struct SwirlStacked *)b)->hWnd;
+  return left < right ? -1 : left > right ? 1 : 0;
+}
+
+int SwirlRestack(struct Swirl *swirl) {
+  AssertNotNull(swirl);
+
+  int count = 0;
+  WindowHandle *windows = swirl->restackWindows;
+  for (int slot = 0; slot < swirl->slotCount; slot++) {
+    struct Cell *cell = swirl->bins[slot] != NULL ? BinCell(swirl->bins[slot]) : NULL;
+    if (cell != NULL && cell->hWnd != NULL)
+      windows[count++] = cell->hWnd;
+  }
+
+  // Where each window was in the last stacking, found by searching a sorted copy of it, or -1 if it was not there.
+  int *previous = swirl->restackRuns;
+  int *tails = previous + count;
+  int *links = tails + count;
+  struct SwirlStacked *sorted = swirl->restackSorted;
+  for (int old = 0; old < swirl->stackedCount; old++) {
+    sorted[old].hWnd = swirl->stacked[old];
+    sorted[old].index = old;
+  }
+  qsort(sorted, swirl->stackedCount, sizeof(struct SwirlStacked), CompareSwirlStacked);
+  for (int index = 0; index < count; index++) {
+    struct SwirlStacked key = {};
+    key.hWnd = windows[index];
+    struct SwirlStacked *found = (struct SwirlStacked *)bsearch(&key, sorted, swirl->stackedCount,
+                                                                sizeof(struct SwirlStacked), CompareSwirlStacked);
+    previous[index] = found != NULL ? found->index : -1;
+  }
+
+  // The longest run of windows still in their old order stays put; every other window is restacked below the one
+  // now above it, top down, which leaves them all in order.
+  int length = 0;
+  for (int index = 0; index < count; index++) {
+    if (previous[index] < 0)
+      continue;
+    int low = 0;
+    int high = length;
+    while (low < high) {
+      int middle = (low + high) / 2;
+      if (previous[tails[middle]] < previous[index])
+        low = middle + 1;
+      else
+        high = middle;
+    }
+    links[index] = low > 0 ? tails[low - 1] : -1;
+    tails[low] = index;
+    if (low == length)
+      length++;
+  }
+
+  bool *kept = swirl->restackKept;
+  memset(kept, 0, count * sizeof(bool));
+  for (int index = length > 0 ? tails[length - 1] : -1; index >= 0; index = links[index])
+    kept[index] = true;
+
+  struct WindowStacking *stackings = swirl->restackStackings;
+  int stackingCount = 0;
+  for (int index = 0; index < count; index++) {
+    if (kept[index])
+      continue;
+    stackings[stackingCount].hWnd = windows[index];
+    stackings[stackingCount].above = index > 0 ? windows[index - 1] : NULL;
+    stackings[stackingCount].show = WindowShow_Keep;
+    stackingCount++;
+  }
+  StackWindows(stackings, stackingCount);
+
+  memcpy(swirl->stacked, windows, count * sizeof(WindowHandle));
+  swirl->stackedCount = count;
+  return stackingCount;
+}
+
+void SwirlRaise(struct Swirl *swirl, int slot) {
+  AssertNotNull(swirl);
+  AssertIndex(slot, swirl->slotCount);
+
+  if (slot == 0)
+    return;
+
+  struct Bin *top = swirl->bins[0];
+  swirl->bins[0] = swirl->bins[slot];
+  swirl->bins[slot] = top;
+
+  // Only the two slots that swapped are given new bounds; the rest are skipped by the layout pass.
+  MarkLayoutDirty(&swirl->bin);
+  SwirlRestack(swirl);
+}
+
+void SwirlDraw(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct Swirl *swirl = Unwrap(struct Swirl, bin, bin);
+
+  if (swirl->step > 0) {
+    for (int slot = swirl->slotCount - 1; slot > 0; slot--) {
+      if (swirl->bins[slot] == NULL)
+        continue;
+      bool hover = swirl->sequence == newInput.sequence && swirl->hoverSlot == slot;
+      DrawRectangle(SwirlCornerBounds(swirl, slot), hover ? LineStyle_Action : LineStyle_ActionHint);
+    }
+  }
+  if (swirl->slotCount > 0 && swirl->bins[0] != NULL)
+    DrawBin(swirl->bins[0]);
+}
+
+void SwirlInput(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct Swirl *swirl = Unwrap(struct Swirl, bin, bin);
+
+  swirl->sequence = newInput.sequence;
+  swirl->hoverSlot = SwirlSlotAtPoint(swirl, newInput.position);
+  if (swirl->hoverSlot == -1)
+    return;
+
+  // Only the top slot takes input; a click on a corner brings its slot to the top instead.
+  if (swirl->hoverSlot == 0) {
+    struct Bin *hoverBin = SwirlGet(swirl, 0);
+    if (hoverBin != NULL && hoverBin->onInputFn)
+      hoverBin->onInputFn(hoverBin);
+  } else {
+    newHover.valid = true;
+    newHover.bounds = SwirlCornerBounds(swirl, swirl->hoverSlot);
+    newHover.previewAction = CellAction_None;
+    if ((newInput.buttons & InputButton_Left) && !(oldInput.buttons & InputButton_Left)) {
+      SwirlRaise(swirl, swirl->hoverSlot);
+      swirl->hoverSlot = 0;
+      newInput.used = true;
+    }
+  }
+
+  if (!newInput.used) {
+    if (newInput.key == 'A') {
+      SwirlInsert(swirl, swirl->slotCount);
+      newInput.used = true;
+    }
+
+    if (newInput.key == 'X' && swirl->slotCount > 1) {
+      SwirlDelete(swirl, swirl->hoverSlot);
+      swirl->hoverSlot = -1;
+      newInput.used = true;
+    }
+
+    // T halves the corners that show, and shift T doubles them.
+    if (newInput.key == 'T') {
+      int tightness = newInput.shift ? swirl->tightness * 2 : swirl->tightness / 2;
+      if (tightness >= 4 && tightness <= 512)
+        SwirlSetTightness(swirl, tightness);
+      newInput.used = true;
+    }
+  }
+}
+
+void SwirlLayout(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct Swirl *swirl = Unwrap(struct Swirl, bin, bin);
+
+  const struct Bounds *frames = SwirlFrames(swirl);
+  for (int slot = 0; slot < swirl->slotCount; slot++) {
+    struct Bin *bin = SwirlGet(swirl, slot);
+    if (bin != NULL)
+      LayoutBin(bin, frames[slot]);
+  }
+}
+
+void SwirlDestroy(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct Swirl *swirl = Unwrap(struct Swirl, bin, bin);
+
+  for (int slot = 0; slot < swirl->slotCount; slot++)
+    SwirlClear(swirl, slot);
+
+  struct Arena *arena = BinArena(&swirl->bin);
+  ArenaFreeSlots(arena, swirl->bins, swirl->slotCapacity);
+  ArenaFreeItems(arena, swirl->frames, sizeof(struct Bounds), swirl->slotCapacity);
+  ArenaFreeItems(arena, swirl->stacked, sizeof(WindowHandle), swirl->slotCapacity);
+  SwirlFreeScratch(swirl, swirl->slotCapacity);
+}
+
+int SwirlChildCount(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct Swirl *swirl = Unwrap(struct Swirl, bin, bin);
+  return swirl->slotCount;
+}
+
+struct Bin *SwirlChild(struct Bin *bin, int index) {
+  AssertNotNull(bin);
+
+  struct Swirl *swirl = Unwrap(struct Swirl, bin, bin);
+  return SwirlGet(swirl, index);
+}
+
+struct Swirl *NewEmptySwirl(struct Arena *arena, int count, int tightness) {
+  AssertGreater(tightness, 0);
+
+  struct Swirl *swirl = (struct Swirl *)PoolAllocate(&arena->swirls);
+  swirl->bin.pool = &arena->swirls;
+  swirl->bin.onDrawFn = SwirlDraw;
+  swirl->bin.onInputFn = SwirlInput;
+  swirl->bin.onLayoutFn = SwirlLayout;
+  swirl->bin.onDestroyFn = SwirlDestroy;
+  swirl->bin.onChildCountFn = SwirlChildCount;
+  swirl->bin.onChildFn = SwirlChild;
+  swirl->bin.layoutDirty = true;
+
+  swirl->tightness = tightness;
+  swirl->hoverSlot = -1;
+
+  swirl->slotCount = count;
+  swirl->slotCapacity = ArenaSlotCapacity(count);
+  swirl->bins = ArenaAllocateSlots(arena, swirl->slotCapacity);
+  swirl->frames = (struct Bounds *)ArenaAllocateItems(arena, sizeof(struct Bounds), swirl->slotCapacity);
+  swirl->frameCount = -1;
+  swirl->stacked = (WindowHandle *)ArenaAllocateItems(arena, sizeof(WindowHandle), swirl->slotCapacity);
+  SwirlAllocateScratch(swirl, swirl->slotCapacity);
+
+  return swirl;
+}
+
+struct Swirl *NewSwirl(struct Arena *arena, int count, int tightness) {
+  struct Swirl *swirl = NewEmptySwirl(arena, count, tightness);
+
+  for (int slot = 0; slot < swirl->slotCount; slot++) {
+    struct Cell *newCell = NewCell(arena);
+    struct Bin *newBin = Wrap(newCell, bin);
+    SwirlPut(swirl, slot, newBin);
+  }
+
+  return swirl;
+}
+
+struct Bin *StackGet(struct Stack *stack, int slot) {
+  AssertNotNull(stack);
+  AssertNotNull(stack->bins);
+  AssertIndex(slot, stack->slotCount);
+
+  return stack->bins[slot];
+}
+
+void StackPut(struct Stack *stack, int slot, struct Bin *bin) {
+  AssertNotNull(stack);
+  AssertNotNull(stack->bins);
+  AssertIndex(slot, stack->slotCount);
+
+  AssertNull(stack->bins[slot]);
+
+  stack->bins[slot] = bin;
+
+  if (bin != NULL) {
+    bin->parent = &stack->bin;
+    MarkLayoutDirty(&stack->bin);
+  }
+}
+
+void StackClear(struct Stack *stack, int slot) {
+  AssertNotNull(stack);
+  AssertNotNull(stack->bins);
+  AssertIndex(slot, stack->slotCount);
+
+  struct Bin *bin = stack->bins[slot];
+  if (bin != NULL) {
+    DestroyBin(bin);
+    stack->bins[slot] = NULL;
+  }
+}
+
+// Grows the slot array to hold at least count slots, at least doubling.
+void StackReserve(struct Stack *stack, int count) {
+  if (count <= stack->slotCapacity)
+    return;
+
+  int newCapacity = stack->slotCapacity * 2;
+  if (newCapacity < count)
+    newCapacity = count;
+  newCapacity = ArenaSlotCapacity(newCapacity);
+
+  struct Arena *arena = BinArena(&stack->bin);
+  struct Bin **newBins = ArenaAllocateSlots(arena, newCapacity);
+  memcpy(newBins, stack->bins, stack->slotCount * sizeof(struct Bin *));
+  ArenaFreeSlots(arena, stack->bins, stack->slotCapacity);
+
+  stack->bins = newBins;
+  stack->slotCapacity = newCapacity;
+}
+
+// The windows a switch shows or hides, in the order they are to be stacked.
+struct StackBatch {
+  int count;
+  int capacity;
+  struct WindowStacking *stackings;
+};
+
+void StackBatchAdd(struct StackBatch *batch, WindowHandle hWnd, enum WindowShow show) {
+  if (batch->count == batch->capacity) {
+    int newCapacity = batch->capacity ? batch->capacity * 2 : 64;
+    struct WindowStacking *newStackings = AllocateArray(struct WindowStacking, newCapacity);
+    if (batch->stackings != NULL)
+      memcpy(newStackings, batch->stackings, batch->count * sizeof(struct WindowStacking));
+    FreeBytes(batch->stackings);
+    batch->stackings = newStackings;
+    batch->capacity = newCapacity;
+  }
+
+  struct WindowStacking *stacking = &batch->stackings[batch->count++];
+  stacking->hWnd = hWnd;
+  stacking->above = NULL;
+  stacking->show = show;
+}
+
+// Adds the windows below bin that are on screen, or would be if bin were, in the order they are drawn from the top.
+void StackCollectShown(struct StackBatch *batch, struct Bin *bin, enum WindowShow show) {
+  struct Cell *cell = BinCell(bin);
+  if (cell != NULL && cell->hWnd != NULL)
+    StackBatchAdd(batch, cell->hWnd, show);
+
+  int childCount = BinChildCount(bin);
+  for (int child = 0; child < childCount; child++) {
+    struct Bin *childBin = BinChild(bin, child);
+    if (childBin != NULL && BinChildShown(bin, child))
+      StackCollectShown(batch, childBin, show);
+  }
+}
+
+// Shows and raises the windows of the active slot, keeping their order among themselves, and hides those below hidden
+// unless it is NULL, all in one batch.
+int StackShow(struct Stack *stack, struct Bin *hidden) {
+  struct StackBatch batch = {};
+  if (stack->slotCount > 0 && stack->bins[stack->active] != NULL)
+    StackCollectShown(&batch, stack->bins[stack->active], WindowShow_Show);
+  for (int index = 1; index < batch.count; index++)
+    batch.stackings[index].above = batch.stackings[index - 1].hWnd;
+  if (hidden != NULL)
+    StackCollectShown(&batch, hidden, WindowShow_Hide);
+
+  StackWindows(batch.stackings, batch.count);
+  FreeBytes(batch.stackings);
+  return batch.count;
+}
+
+int RaiseBinWindows(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct StackBatch batch = {};
+  StackCollectShown(&batch, bin, WindowShow_Keep);
+  for (int index = 1; index < batch.count; index++)
+    batch.stackings[index].above = batch.stackings[index - 1].hWnd;
+
+  StackWindows(batch.stackings, batch.count);
+  FreeBytes(batch.stackings);
+  return batch.count;
+}
+
+void StackInsert(struct Stack *stack, int newSlot) {
+  AssertNotNull(stack);
+  AssertNotNull(stack->bins);
+  AssertIndex(newSlot, stack->slotCount + 1);
+
+  StackReserve(stack, stack->slotCount + 1);
+
+  memmove(&stack->bins[newSlot + 1], &stack->bins[newSlot], (stack->slotCount - newSlot) * sizeof(struct Bin *));
+  stack->slotCount += 1;
+  if (stack->slotCount > 1 && newSlot <= stack->active)
+    stack->active++;
+
+  struct Cell *newCell = NewCell(BinArena(&stack->bin));
+  stack->bins[newSlot] = Wrap(newCell, bin);
+  newCell->bin.parent = &stack->bin;
+
+  // The new slot is not laid out until it is switched to, but the tabs change.
+  MarkLayoutDirty(&stack->bin);
+}
+
+void StackDelete(struct Stack *stack, int oldSlot) {
+  AssertNotNull(stack);
+  AssertNotNull(stack->bins);
+  AssertIndex(oldSlot, stack->slotCount);
+
+  StackClear(stack, oldSlot);
+
+  memmove(&stack->bins[oldSlot], &stack->bins[oldSlot + 1], (stack->slotCount - oldSlot - 1) * sizeof(struct Bin *));
+  stack->slotCount -= 1;
+  stack->bins[stack->slotCount] = NULL;
+
+  if (oldSlot < stack->active) {
+    stack->active--;
+  } else if (oldSlot == stack->active) {
+    // The windows of the deleted slot were let go with it, so there is nothing to hide.
+    if (stack->active == stack->slotCount && stack->active > 0)
+      stack->active--;
+    StackShow(stack, NULL);
+  }
+
+  MarkLayoutDirty(&stack->bin);
+}
+
+struct Bounds StackTabStrip(struct Stack *stack) {
+  int inset = dimensions[Dimension_BorderInset];
+  struct Bounds strip = stack->bin.bounds;
+  strip.x += inset;
+  strip.y += inset;
+  strip.width -= 2 * inset;
+  strip.height = dimensions[Dimension_TabHeight];
+  return strip;
+}
+
+struct Bounds StackMakeCellBounds(struct Stack *stack) {
+  AssertNotNull(stack);
+
+  int inset = dimensions[Dimension_BorderInset];
+  struct Bounds frame = stack->bin.bounds;
+  frame.x += inset;
+  frame.y += inset;
+  frame.width -= 2 * inset;
+  frame.height -= 2 * inset;
+  if (stack->style == StackStyle_Tabs) {
+    frame.y += dimensions[Dimension_TabHeight] + inset;
+    frame.height -= dimensions[Dimension_TabHeight] + inset;
+    if (frame.height < 0)
+      frame.height = 0;
+  }
+  return frame;
+}
+
+// Where tab slot starts along the strip, which the tabs share evenly.
+int StackTabStart(struct Stack *stack, int width, int slot) {
+  return (int)((long long)width * slot / stack->slotCount);
+}
+
+struct Bounds StackTabBounds(struct Stack *stack, int slot) {
+  AssertNotNull(stack);
+  AssertIndex(slot, stack->slotCount);
+
+  struct Bounds tab = StackTabStrip(stack);
+  int start = StackTabStart(stack, tab.width, slot);
+  tab.x += start;
+  tab.width = StackTabStart(stack, tab.width, slot + 1) - start;
+  return tab;
+}
+
+int StackTabAtPoint(struct Stack *stack, struct Point point) {
+  AssertNotNull(stack);
+
+  struct Bounds strip = StackTabStrip(stack);
+  if (stack->style != StackStyle_Tabs || stack->slotCount <= 0 || !PointInBounds(point, strip))
+    return -1;
+
+  // Dividing the other way lands on the tab or next to it, since the starts are rounded down.
+  int offset = point.x - strip.x;
+  int slot = (int)((long long)offset * stack->slotCount / strip.width);
+  while (slot + 1 < stack->slotCount && StackTabStart(stack, strip.width, slot + 1) <= offset)
+    slot++;
+  while (slot > 0 && StackTabStart(stack, strip.width, slot) > offset)
+    slot--;
+  return slot;
+}
+
+int StackActivate(struct Stack *stack, int slot) {
+  AssertNotNull(stack);
+  AssertIndex(slot, stack->slotCount);
+
+  if (slot == stack->active)
+    return 0;
+
+  struct Bin *hidden = stack->bins[stack->active];
+  stack->active = slot;
+
+  // The new slot is laid out on the next pass, which skips it if its bounds have not changed since it last showed.
+  MarkLayoutDirty(&stack->bin);
+  return StackShow(stack, hidden);
+}
+
+void StackDraw(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct Stack *stack = Unwrap(struct Stack, bin, bin);
+
+  if (stack->style == StackStyle_Tabs) {
+    int textSize = dimensions[Dimension_TabHeight] * 2 / 3;
+    for (int slot = 0; slot < stack->slotCount; slot++) {
+      struct Bounds tab = StackTabBounds(stack, slot);
+      bool hover = stack->sequence == newInput.sequence && stack->hoverTab == slot;
+      DrawRectangle(tab, slot == stack->active ? LineStyle_Focus : hover ? LineStyle_Action : LineStyle_Border);
+
+      char label[16];
+      struct Cell *cell = stack->bins[slot] != NULL ? BinCell(stack->bins[slot]) : NULL;
+      const char *name = cell != NULL ? cell->name : NULL;
+      if (name == NULL) {
+        snprintf(label, sizeof(label), "%d", slot + 1);
+        name = label;
+      }
+      DrawText(tab.x + textSize / 4, tab.y + (tab.height - textSize) / 2, textSize, name);
+    }
+  }
+  if (stack->slotCount > 0 && stack->bins[stack->active] != NULL)
+    DrawBin(stack->bins[stack->active]);
+}
+
+void StackInput(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct Stack *stack = Unwrap(struct Stack, bin, bin);
+
+  stack->sequence = newInput.sequence;
+  stack->hoverTab = StackTabAtPoint(stack, newInput.position);
+
+  if (stack->hoverTab != -1) {
+    newHover.valid = true;
+    newHover.bounds = StackTabBounds(stack, stack->hoverTab);
+    newHover.previewAction = CellAction_None;
+    if ((newInput.buttons & InputButton_Left) && !(oldInput.buttons & InputButton_Left)) {
+      StackActivate(stack, stack->hoverTab);
+      newInput.used = true;
+    }
+  } else if (stack->slotCount > 0 && PointInBounds(newInput.position, StackMakeCellBounds(stack))) {
+    struct Bin *activeBin = StackGet(stack, stack->active);
+    if (activeBin != NULL && activeBin->onInputFn)
+      activeBin->onInputFn(activeBin);
+  }
+
+  if (!newInput.used) {
+    if (newInput.key == 'A') {
+      StackInsert(stack, stack->active + (stack->slotCount > 0 ? 1 : 0));
+      StackActivate(stack, stack->slotCount > 1 ? stack->active + 1 : 0);
+      newInput.used = true;
+    }
+
+    if (newInput.key == 'X' && stack->slotCount > 1) {
+      StackDelete(stack, stack->active);
+      newInput.used = true;
+    }
+
+    // N switches to the next slot, and shift N to the one before, wrapping around.
+    if (newInput.key == 'N' && stack->slotCount > 1) {
+      int step = newInput.shift ? stack->slotCount - 1 : 1;
+      StackActivate(stack, (stack->active + step) % stack->slotCount);
+      newInput.used = true;
+    }
+  }
+}
+
+void StackLayout(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct Stack *stack = Unwrap(struct Stack, bin, bin);
+
+  if (stack->slotCount > 0 && stack->bins[stack->active] != NULL)
+    LayoutBin(stack->bins[stack->active], StackMakeCellBounds(stack));
+}
+
+void StackDestroy(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct Stack *stack = Unwrap(struct Stack, bin, bin);
+
+  for (int slot = 0; slot < stack->slotCount; slot++)
+    StackClear(stack, slot);
+
+  ArenaFreeSlots(BinArena(&stack->bin), stack->bins, stack->slotCapacity);
+}
+
+int StackChildCount(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  struct Stack *stack = Unwrap(struct Stack, bin, bin);
+  return stack->slotCount;
+}
+
+struct Bin *StackChild(struct Bin *bin, int index) {
+  AssertNotNull(bin);
+
+  struct Stack *stack = Unwrap(struct Stack, bin, bin);
+  return StackGet(stack, index);
+}
+
+struct Stack *NewEmptyStack(struct Arena *arena, enum StackStyle style, int count) {
+  struct Stack *stack = (struct Stack *)PoolAllocate(&arena->stacks);
+  stack->bin.pool = &arena->stacks;
+  stack->bin.onDrawFn = StackDraw;
+  stack->bin.onInputFn = StackInput;
+  stack->bin.onLayoutFn = StackLayout;
+  stack->bin.onDestroyFn = StackDestroy;
+  stack->bin.onChildCountFn = StackChildCount;
+  stack->bin.onChildFn = StackChild;
+  stack->bin.layoutDirty = true;
+
+  stack->style = style;
+  stack->hoverTab = -1;
+
+  stack->slotCount = count;
+  stack->slotCapacity = ArenaSlotCapacity(count);
+  stack->bins = ArenaAllocateSlots(arena, stack->slotCapacity);
+
+  return stack;
+}
+
+struct Stack *NewStack(struct Arena *arena, enum StackStyle style, int count) {
+  struct Stack *stack = NewEmptyStack(arena, style, count);
+
+  for (int slot = 0; slot < stack->slotCount; slot++) {
+    struct Cell *newCell = NewCell(arena);
+    struct Bin *newBin = Wrap(newCell, bin);
+    StackPut(stack, slot, newBin);
+  }
+
+  return stack;
+}
+
+int BinChildCount(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  return bin->onChildCountFn ? bin->onChildCountFn(bin) : 0;
+}
+
+struct Bin *BinChild(struct Bin *bin, int index) {
+  AssertNotNull(bin);
+  AssertNotNull(bin->onChildFn);
+
+  return bin->onChildFn(bin, index);
+}
+
+bool BinChildShown(struct Bin *bin, int index) {
+  AssertNotNull(bin);
+
+  if (bin->onLayoutFn == StackLayout) {
+    struct Stack *stack = Unwrap(struct Stack, bin, bin);
+    return index == stack->active;
+  }
+  if (bin->onLayoutFn == ShelfLayout) {
+    struct Shelf *shelf = Unwrap(struct Shelf, bin, bin);
+    return shelf->zoomSlot < 0 || index == shelf->zoomSlot;
+  }
+  if (bin->onLayoutFn == GridLayout) {
+    struct Grid *grid = Unwrap(struct Grid, bin, bin);
+    return grid->zoomRow < 0 || index == grid->columnCount * grid->zoomRow + grid->zoomColumn;
+  }
+  return true;
+}
+
+struct Cell *BinCell(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  return bin->onDrawFn == CellDraw ? Unwrap(struct Cell, bin, bin) : NULL;
+}
+
+struct Cell *FindNamedCell(struct Bin *root, const char *name) {
+  AssertNotNull(root);
+  AssertNotNull(name);
+
+  struct Cell *cell = BinCell(root);
+  if (cell != NULL && cell->name != NULL && strcmp(cell->name, name) == 0)
+    return cell;
+
+  int childCount = BinChildCount(root);
+  for (int child = 0; child < childCount; child++) {
+    struct Bin *childBin = BinChild(root, child);
+    struct Cell *found = childBin != NULL ? FindNamedCell(childBin, name) : NULL;
+    if (found != NULL)
+      return found;
+  }
+  return NULL;
+}
+
+struct Arena *BinArena(struct Bin *bin) {
+  AssertNotNull(bin);
+  AssertNotNull(bin->pool);
+
+  return bin->pool->arena;
+}
+
+void DestroyBin(struct Bin *bin) {
+  AssertNotNull(bin);
+
+  if (bin->onDestroyFn != NULL)
+    bin->onDestroyFn(bin);
+
+  PoolFree(bin->pool, bin);
+}
+
+void LayoutRoot(struct Bin *root, struct Bounds bounds) {
+  AssertNotNull(root);
+
+  layoutStats.passes++;
+  LayoutBin(root, bounds);
+}
+
+void SelectRootScale(struct Bin *root, float scale, float *layoutScale) {
+  AssertNotNull(root);
+  AssertNotNull(layoutScale);
+
+  SetDimensionScale(scale);
+  if (*layoutScale != scale) {
+    MarkTreeDirty(root);
+    *layoutScale = scale;
+  }
+}
+
+void LayoutRootAtScale(struct Bin *root, struct Bounds bounds, float scale, float *layoutScale) {
+  SelectRootScale(root, scale, layoutScale);
+  LayoutRoot(root, bounds);
+}
+
+void RecordRoot(struct Bin *root, struct Bounds clip, struct DrawList *list) {
+  AssertNotNull(root);
+  AssertNotNull(list);
+
+  ResetDrawList(list);
+  drawRecording = list;
+  drawClip = clip;
+  DrawBin(root);
+  drawRecording = NULL;
+}
+
+void DrawRoot(struct Bin *root, struct Bounds clip) {
+  RecordRoot(root, clip, &rootDrawList);
+  SubmitDrawList(&rootDrawList);
+}
+
+void BeginMouseInput(struct Point position, int buttons) {
+  oldInput = newInput;
+  newInput.used = false;
+  newInput.sequence++;
+  newInput.position = position;
+  newInput.buttons = buttons;
+  newInput.key = 0;
+
+  newHover.valid = false;
+}
+
+void FinishInput(struct Bin *root) {
+  AssertNotNull(root);
+
+  LayoutRoot(root, root->bounds);
+
+  if (memcmp(&newHover, &drawnHover, sizeof(newHover)) != 0) {
+    if (drawnHover.valid)
+      DamageBounds(drawnHover.bounds);
+    if (newHover.valid)
+      DamageBounds(newHover.bounds);
+    drawnHover = newHover;
+  }
+}
+
+void DispatchMouse(struct Bin *root, struct Point position, int buttons) {
+  AssertNotNull(root);
+
+  BeginMouseInput(position, buttons);
+
+  if (root->onInputFn)
+    root->onInputFn(root);
+
+  FinishInput(root);
+}
+
+void DispatchKey(struct Bin *root, int key, bool shift) {
+  AssertNotNull(root);
+
+  oldInput = newInput;
+  newInput.used = false;
+  newInput.key = key;
+  newInput.shift = shift;
+
+  newHover.valid = false;
+
+  if (root->onInputFn)
+    root->onInputFn(root);
+
+  FinishInput(root);
+}
+
+void ClearOnDeckWindow() { onDeck.hWnd = NULL; }
+
+void PlaceOnDeckWindow() {
+  if (!onDeck.hWnd) {
+    ReportError("Tried to place the on deck window when none was active");
+    return;
+  }
+
+  PlaceWindow(onDeck.hWnd, onDeck.placement);
+}
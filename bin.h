@@ -0,0 +1,391 @@
+#pragma once
+
+#include "arena.h"
+#include "backend.h"
+#include "drawlist.h"
+
+// Mouse button flags carried in Input::buttons. These match the Win32 MK_ values so wParam can be passed through.
+enum InputButton {
+  InputButton_Left = 0x0001,
+};
+
+struct Input {
+  bool used;
+  unsigned int sequence;
+  struct Point position;
+  int buttons;
+  int key;
+  bool shift;
+};
+
+extern struct Input oldInput;
+extern struct Input newInput;
+
+struct Bin {
+  void (*onDrawFn)(struct Bin *bin);
+  void (*onInputFn)(struct Bin *bin);
+  void (*onLayoutFn)(struct Bin *bin);
+  void (*onDestroyFn)(struct Bin *bin);
+
+  // Enumerates the bins directly below this one, which may include NULL for empty slots.
+  int (*onChildCountFn)(struct Bin *bin);
+  struct Bin *(*onChildFn)(struct Bin *bin, int index);
+
+  // The arena pool this bin was allocated from, and returns to when destroyed.
+  struct Pool *pool;
+
+  struct Bin *parent;
+
+  struct Bounds bounds;
+
+  // Layout is incremental: a bin lays out its children again only when its bounds change or it is marked dirty by a
+  // structural edit, and its ancestors are flagged so the next pass can find it.
+  bool layoutDirty;
+  bool childLayoutDirty;
+  // Set when a layout pass visits the bin and cleared when placement collects it, so placement walks only the bins laid
+  // out since.
+  bool placementDirty;
+};
+
+// Counts bins whose onLayoutFn ran, or that were skipped because nothing about them changed.
+struct LayoutStats {
+  long long passes;
+  long long visited;
+  long long skipped;
+};
+
+extern struct LayoutStats layoutStats;
+
+void MarkLayoutDirty(struct Bin *bin);
+
+// Marks every bin below this one dirty, for when something all of them depend on changes, such as the dimensions.
+void MarkTreeDirty(struct Bin *bin);
+
+// Gives a bin its bounds, laying out its children only if they changed or something below is dirty.
+void LayoutBin(struct Bin *bin, struct Bounds bounds);
+
+// How a shelf slot, or a grid row or column, shares out the length of its container: in proportion to its weight, but
+// never less than min pixels, nor more than max unless max is 0. Mins win when there is not room for them all, and the
+// slots then run past the end of the container.
+struct SlotSize {
+  int weight;
+  int min;
+  int max;
+};
+
+// A weight of 1 with no limits, which every slot starts with.
+extern const struct SlotSize uniformSlotSize;
+
+// The sizes of the slots along one axis of a container, and where they were last put. The offsets come from a single
+// prefix sum pass over the weights, which hands out the pixels an even division leaves over one slot at a time instead
+// of dropping them at the end. They are kept until the length, the inset or a size changes, so laying out and hit
+// testing every slot reuses them rather than dividing again.
+struct Track {
+  int capacity;
+  struct SlotSize *sizes;
+
+  // Slot i starts offsets[i] pixels along the container and ends inset pixels before offsets[i + 1].
+  int *offsets;
+  int length;
+  int inset;
+  bool stale;
+};
+
+// Returns the offsets of count slots sharing length, recomputing them only if something changed since the last call.
+const int *TrackOffsets(struct Track *track, int count, int length, int inset);
+// Returns the slot covering position, measured along the container, or -1 if it falls in an inset. The offsets must be
+// up to date.
+int TrackSlotAt(const struct Track *track, int count, int position);
+// Returns the last slot starting at or before position, or -1 if it is before the first.
+int TrackSlotFrom(const struct Track *track, int count, int position);
+// Returns whether every one of the count slots has the uniform size.
+bool TrackIsUniform(const struct Track *track, int count);
+
+enum ShelfDirection { ShelfDirection_Horizontal, ShelfDirection_Vertical };
+
+struct Shelf {
+  struct Bin bin;
+
+  enum ShelfDirection direction;
+
+  int slotCount;
+  int slotCapacity;
+  struct Track track;
+
+  int hoverSlot;
+
+  // The slot zoomed to fill the whole shelf, or -1. The others keep their bounds and the cached offsets under it, and
+  // are not drawn, hit tested or placed until it is unzoomed.
+  int zoomSlot;
+
+  struct Bin **bins;
+};
+
+struct Shelf *NewShelf(struct Arena *arena, enum ShelfDirection direction, int count);
+// Like NewShelf, but the slots start empty for the caller to fill in.
+struct Shelf *NewEmptyShelf(struct Arena *arena, enum ShelfDirection direction, int count);
+struct Bin *ShelfGet(struct Shelf *shelf, int slot);
+void ShelfPut(struct Shelf *shelf, int slot, struct Bin *bin);
+void ShelfClear(struct Shelf *shelf, int slot);
+void ShelfInsert(struct Shelf *shelf, int newSlot);
+void ShelfDelete(struct Shelf *shelf, int oldSlot);
+void ShelfSetSize(struct Shelf *shelf, int slot, struct SlotSize size);
+// Zooms a slot to fill the shelf, raising its windows above the others', or unzooms the shelf with -1. Only the slot
+// zoomed or unzoomed is laid out and placed again. Inserting or deleting a slot unzooms.
+void ShelfZoom(struct Shelf *shelf, int slot);
+struct Bounds ShelfMakeCellBounds(struct Shelf *shelf, int slot);
+int ShelfSlotAtPoint(struct Shelf *shelf, struct Point point);
+void ShelfLayout(struct Bin *bin);
+
+enum CellAction { CellAction_None, CellAction_SplitHorizontal, CellAction_SplitVertical };
+
+struct Cell {
+  struct Bin bin;
+
+  unsigned int sequence;
+  enum CellAction previewAction;
+  struct Bin *subBin;
+  WindowHandle hWnd;
+
+  // Where the window was last put, so placement only moves it again once the cell's bounds change, even if the cell was
+  // hidden meanwhile. Cleared whenever the cell's window changes.
+  WindowHandle placedWindow;
+  struct Bounds placedBounds;
+
+  // The name rules and layouts refer to the cell by, or NULL. The string is not copied and must outlive the cell.
+  const char *name;
+};
+
+struct Cell *NewCell(struct Arena *arena);
+void CellSetSubBin(struct Cell *cell, struct Bin *subBin);
+void CellSetName(struct Cell *cell, const char *name);
+
+struct Grid {
+  struct Bin bin;
+
+  int rowCount;
+  int columnCount;
+  struct Track rows;
+  struct Track columns;
+
+  int hoverRow;
+  int hoverColumn;
+
+  // The cell zoomed to fill the whole grid, as for a shelf, or -1 and -1.
+  int zoomRow;
+  int zoomColumn;
+
+  // Row-major, with room for slotCapacity cells so rows and columns can be inserted in place.
+  int slotCapacity;
+  struct Bin **bins;
+
+  // Spans merge a rectangle of cells into one, whose bin is held by its top left cell, leaving the others' slots NULL.
+  // They are kept as two bitmaps of spanStride words per row, telling for each cell whether the cell to its left, or
+  // the one above, is in the same span. A span's extent and the span a cell is covered by are then found by walking
+  // one row and one column, and inserting or deleting a row or column shifts bits rather than visiting spans. Both
+  // bitmaps are NULL until the first span is made.
+  int spanStride;
+  int spanRowCapacity;
+  unsigned long long *spanLeft;
+  unsigned long long *spanUp;
+};
+
+struct Grid *NewGrid(struct Arena *arena);
+struct Grid *NewEmptyGrid(struct Arena *arena, int rowCount, int columnCount);
+struct Bin *Grid(struct Grid *grid, int row, int column);
+void GridPut(struct Grid *grid, int row, int column, struct Bin *bin);
+void GridClear(struct Grid *grid, int row, int column);
+void GridInsertRow(struct Grid *grid, int newRow);
+void GridDeleteRow(struct Grid *grid, int oldRow);
+void GridInsertColumn(struct Grid *grid, int newColumn);
+void GridDeleteColumn(struct Grid *grid, int oldColumn);
+// Makes the cell at row and column hold the rowSpan by columnSpan cells from there, destroying the bins of the cells it
+// takes in and giving those a shrinking span lets go of new empty cells. Returns false, changing nothing, if the cell
+// is covered by another span, or the span would run off the grid or cut into another span.
+bool GridSetSpan(struct Grid *grid, int row, int column, int rowSpan, int columnSpan);
+// Gets the extent of the span held by the cell at row and column, which is 1 by 1 for a cell that holds none.
+void GridGetSpan(struct Grid *grid, int row, int column, int *rowSpan, int *columnSpan);
+// Returns whether the cell is covered by a span held by another cell, and if so moves row and column to that cell.
+bool GridFindSpan(struct Grid *grid, int *row, int *column);
+// Returns whether the two grids have as many rows and columns, with the same spans.
+bool GridSameSpans(struct Grid *grid, struct Grid *other);
+void GridSetRowSize(struct Grid *grid, int row, struct SlotSize size);
+void GridSetColumnSize(struct Grid *grid, int column, struct SlotSize size);
+// As ShelfZoom, for the cell at row and column, or the span covering it. Inserting or deleting a row or column, or
+// changing a span, unzooms.
+void GridZoom(struct Grid *grid, int row, int column);
+// The bounds of the cell, or of the whole span if the cell holds one, or of the whole grid if it is zoomed.
+struct Bounds GridMakeCellBounds(struct Grid *grid, int row, int column);
+void GridCellAtPoint(struct Grid *grid, struct Point point, int *row, int *column);
+void GridLayout(struct Bin *bin);
+
+// Pixels of each window's corner a new swirl leaves showing.
+#define SWIRL_TIGHTNESS 32
+
+// A spiral of overlapping slots, one on top and the rest stepping out from under it a corner at a time, clockwise from
+// the top left, so a tightness by tightness corner of each shows. Slot 0 is on top and each slot lies below the one
+// before it. The slots' frames depend only on their count, the tightness and the bounds, and are kept until one of
+// those changes. The corner under a point follows from how far out from the top slot it is and on which side, so hit
+// testing never looks at the slots that overlap there.
+// A window of a swirl's last stacking and where it was in it.
+struct SwirlStacked {
+  WindowHandle hWnd;
+  int index;
+};
+
+struct Swirl {
+  struct Bin bin;
+
+  int tightness;
+
+  int slotCount;
+  int slotCapacity;
+  struct Bin **bins;
+
+  unsigned int sequence;
+  int hoverSlot;
+
+  // The frame of each slot, for the count, tightness, bounds and inset they were made for, and the step each ring of
+  // the spiral moves out by, which is the tightness unless the bounds are too small for it.
+  struct Bounds *frames;
+  int frameCount;
+  int frameTightness;
+  int frameInset;
+  struct Bounds frameBounds;
+  int step;
+
+  // The windows of the slots, top first, as they were last stacked, so a reorder restacks only what it changes.
+  int stackedCount;
+  WindowHandle *stacked;
+
+  // Room for a restack to work in, as many of each as there are slots, so that reordering allocates nothing: the
+  // windows in slot order, a sorted copy of the last stacking, three ints per window for finding the longest run still
+  // in order, which windows that run keeps, and the stackings for the rest.
+  WindowHandle *restackWindows;
+  struct SwirlStacked *restackSorted;
+  int *restackRuns;
+  bool *restackKept;
+  struct WindowStacking *restackStackings;
+};
+
+struct Swirl *NewSwirl(struct Arena *arena, int count, int tightness);
+// Like NewSwirl, but the slots start empty for the caller to fill in.
+struct Swirl *NewEmptySwirl(struct Arena *arena, int count, int tightness);
+struct Bin *SwirlGet(struct Swirl *swirl, int slot);
+void SwirlPut(struct Swirl *swirl, int slot, struct Bin *bin);
+void SwirlClear(struct Swirl *swirl, int slot);
+void SwirlInsert(struct Swirl *swirl, int newSlot);
+void SwirlDelete(struct Swirl *swirl, int oldSlot);
+void SwirlSetTightness(struct Swirl *swirl, int tightness);
+struct Bounds SwirlMakeCellBounds(struct Swirl *swirl, int slot);
+// Returns the top slot if it holds the point, or else the slot whose showing corner does, or -1.
+int SwirlSlotAtPoint(struct Swirl *swirl, struct Point point);
+// Swaps the slot with the top one, so only those two change places in the spiral, and restacks their windows.
+void SwirlRaise(struct Swirl *swirl, int slot);
+// Stacks the windows of the slots' cells in slot order, restacking only those that are out of order relative to the
+// others since they were last stacked. Returns how many were restacked.
+int SwirlRestack(struct Swirl *swirl);
+void SwirlLayout(struct Bin *bin);
+
+enum StackStyle { StackStyle_Depth, StackStyle_Tabs };
+
+// Slots piled on one another, of which only the active one is on screen: a depth stack shows nothing else, and a tab
+// stack a strip above it with a tab per slot. Only the active slot is laid out, drawn, hit tested and has its windows
+// placed. The others keep the bounds they were last given and are left alone until switched to, so a pile of slots
+// costs a layout pass no more than the one showing.
+struct Stack {
+  struct Bin bin;
+
+  enum StackStyle style;
+
+  int slotCount;
+  int slotCapacity;
+  struct Bin **bins;
+
+  int active;
+
+  unsigned int sequence;
+  int hoverTab;
+};
+
+struct Stack *NewStack(struct Arena *arena, enum StackStyle style, int count);
+// Like NewStack, but the slots start empty for the caller to fill in.
+struct Stack *NewEmptyStack(struct Arena *arena, enum StackStyle style, int count);
+struct Bin *StackGet(struct Stack *stack, int slot);
+void StackPut(struct Stack *stack, int slot, struct Bin *bin);
+void StackClear(struct Stack *stack, int slot);
+// Inserts an empty cell, which stays hidden until switched to.
+void StackInsert(struct Stack *stack, int newSlot);
+// Deletes a slot. If it was the active one, the slot that takes its place is shown.
+void StackDelete(struct Stack *stack, int oldSlot);
+// The bounds every slot is given, below the tabs if there are any.
+struct Bounds StackMakeCellBounds(struct Stack *stack);
+struct Bounds StackTabBounds(struct Stack *stack, int slot);
+// Returns the slot whose tab holds the point, or -1.
+int StackTabAtPoint(struct Stack *stack, struct Point point);
+// Makes slot the active one, to be laid out on the next pass if it needs to be, and in one batch hides the windows the
+// old slot showed and shows and raises those of the new one. Returns how many windows the batch held.
+int StackActivate(struct Stack *stack, int slot);
+void StackLayout(struct Bin *bin);
+
+int BinChildCount(struct Bin *bin);
+struct Bin *BinChild(struct Bin *bin, int index);
+// Returns whether a child is on screen, which every child is but the inactive slots of a stack and the slots under a
+// zoomed one.
+bool BinChildShown(struct Bin *bin, int index);
+// Raises the windows shown below bin above all others, keeping their order among themselves, in one batch. Returns
+// how many there were.
+int RaiseBinWindows(struct Bin *bin);
+
+// Returns the cell a bin is, or NULL if it is a container.
+struct Cell *BinCell(struct Bin *bin);
+
+// Returns the first cell below root, root included, with this name, or NULL if there is none.
+struct Cell *FindNamedCell(struct Bin *root, const char *name);
+
+struct Arena *BinArena(struct Bin *bin);
+
+// Destroys a bin along with everything below it, returning them to their arena. To drop a whole monitor tree at
+// once, reset or release its arena instead.
+void DestroyBin(struct Bin *bin);
+
+// Entry points for the window system: position the root and flush any pending layout, draw the bins that overlap
+// clip, or feed the tree one input event (which flushes the layout once afterwards). Layout and input record what
+// they changed on screen in damage, for the backend to repaint. DrawRoot records into a draw list and submits it;
+// RecordRoot only records, so the caller can compare or keep the list before submitting it.
+void LayoutRoot(struct Bin *root, struct Bounds bounds);
+
+// Trees of monitors at different scales share the dimensions, so whatever lays out, records or hit tests a tree sets
+// them to its scale first with SelectRootScale. A tree last laid out at another scale, kept in layoutScale, is marked
+// dirty in full. LayoutRootAtScale selects the tree's scale and lays it out.
+void SelectRootScale(struct Bin *root, float scale, float *layoutScale);
+void LayoutRootAtScale(struct Bin *root, struct Bounds bounds, float scale, float *layoutScale);
+void DrawRoot(struct Bin *root, struct Bounds clip);
+void RecordRoot(struct Bin *root, struct Bounds clip, struct DrawList *list);
+void DispatchMouse(struct Bin *root, struct Point position, int buttons);
+void DispatchKey(struct Bin *root, int key, bool shift);
+
+// The halves of DispatchMouse, for dispatchers that deliver the event to part of the tree themselves.
+void BeginMouseInput(struct Point position, int buttons);
+void FinishInput(struct Bin *root);
+
+// The leaf drawn with hover hints, and the one the current event is hovering. Only these two cells change appearance
+// when the pointer moves, so a move damages just them rather than the whole overlay.
+struct HoverLeaf {
+  bool valid;
+  struct Bounds bounds;
+  enum CellAction previewAction;
+};
+
+extern struct HoverLeaf drawnHover;
+extern struct HoverLeaf newHover;
+
+struct OnDeck {
+  WindowHandle hWnd;
+  struct Bounds placement;
+};
+
+extern struct OnDeck onDeck;
+
+void ClearOnDeckWindow();
+void PlaceOnDeckWindow();
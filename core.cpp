@@ -0,0 +1,113 @@
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "core.h"
+
+// Under the debugger errors break immediately; elsewhere (the headless build) they are printed so that a benchmark
+// run still explains what went wrong.
+#if defined(_MSC_VER)
+#define BreakOnError() __debugbreak()
+#else
+#define BreakOnError()                                                                                                 \
+  do {                                                                                                                 \
+    va_list args;                                                                                                      \
+    va_start(args, format);                                                                                            \
+    vfprintf(stderr, format, args);                                                                                    \
+    va_end(args);                                                                                                      \
+    fputc('\n', stderr);                                                                                               \
+  } while (0)
+#endif
+
+void ReportError(const char *format, ...) { BreakOnError(); }
+
+void FatalError(const char *format, ...) {
+  BreakOnError();
+  abort();
+}
+
+thread_local struct AllocationStats allocationStats;
+
+void *AllocateBytes(size_t size, size_t count, const char *name) {
+  void *mem = calloc(count, size);
+  if (mem == NULL)
+    FatalError("Allocation of %d %s%s failed", (int)count, name, count > 1 ? "s" : "");
+  allocationStats.heapAllocations++;
+  return mem;
+}
+
+void FreeBytes(void *mem) {
+  if (mem == NULL)
+    return;
+  free(mem);
+  allocationStats.heapFrees++;
+}
+
+// The dimensions at a scale of 1.
+const int baseDimensions[Dimension_Count] = {
+    0,
+    24,
+};
+
+int dimensions[Dimension_Count] = {
+    0,
+    24,
+};
+
+bool SetDimensionScale(float scale) {
+  bool changed = false;
+  for (int dimension = 0; dimension < Dimension_Count; dimension++) {
+    int size = (int)(baseDimensions[dimension] * scale + 0.5f);
+    changed |= size != dimensions[dimension];
+    dimensions[dimension] = size;
+  }
+  return changed;
+}
+
+struct Point MakePoint(int x, int y) {
+  struct Point point;
+  point.x = x;
+  point.y = y;
+  return point;
+}
+
+bool PointInBounds(struct Point point, struct Bounds bounds) {
+  if (point.x < bounds.x)
+    return false;
+  if (point.x >= bounds.x + bounds.width)
+    return false;
+  if (point.y < bounds.y)
+    return false;
+  if (point.y >= bounds.y + bounds.height)
+    return false;
+  return true;
+}
+
+struct Point BoundsMidpoint(struct Bounds bounds) {
+  struct Point midPoint;
+  midPoint.x = bounds.x + bounds.width / 2;
+  midPoint.y = bounds.y + bounds.height / 2;
+  return midPoint;
+}
+
+bool BoundsIntersect(struct Bounds a, struct Bounds b) {
+  if (a.x >= b.x + b.width || b.x >= a.x + a.width)
+    return false;
+  if (a.y >= b.y + b.height || b.y >= a.y + a.height)
+    return false;
+  return true;
+}
+
+bool BoundsContain(struct Bounds outer, struct Bounds inner) {
+  return inner.x >= outer.x && inner.y >= outer.y && inner.x + inner.width <= outer.x + outer.width &&
+         inner.y + inner.height <= outer.y + outer.height;
+}
+
+struct Bounds BoundsUnion(struct Bounds a, struct Bounds b) {
+  int left = a.x < b.x ? a.x : b.x;
+  int top = a.y < b.y ? a.y : b.y;
+  int right = a.x + a.width > b.x + b.width ? a.x + a.width : b.x + b.width;
+  int bottom = a.y + a.height > b.y + b.height ? a.y + a.height : b.y + b.height;
+
+  struct Bounds bounds = {left, top, right - left, bottom - top};
+  return bounds;
+}
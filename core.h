@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+void ReportError(const char *format, ...);
+
+void FatalError(const char *format, ...);
+
+// Running allocator totals for the calling thread, read by the benchmarks. They are per thread so that the layout file
+// can be parsed off the overlay thread without a lock around them.
+struct AllocationStats {
+  long long heapAllocations;
+  long long heapFrees;
+  long long poolAllocations;
+  long long poolFrees;
+};
+
+extern thread_local struct AllocationStats allocationStats;
+
+void *AllocateBytes(size_t size, size_t count, const char *name);
+void FreeBytes(void *mem);
+
+#define Allocate(type_) (type_ *)AllocateBytes(sizeof(type_), 1, #type_)
+#define AllocateArray(type_, count_) (type_ *)AllocateBytes(sizeof(type_), count_, #type_)
+
+#define OffsetOf(type_, member_)                                                                                       \
+  (size_t)((ptrdiff_t) & reinterpret_cast<const volatile char &>((((type_ *)0)->member_)))
+#define Unwrap(type_, member_, ptr_) (type_ *)((char *)ptr_ - OffsetOf(type_, member_))
+#define Wrap(ptr_, member_) (&((ptr_)->member_))
+
+#define AssertMessage(condition_, message_)                                                                            \
+  do {                                                                                                                 \
+    if (!(condition_))                                                                                                 \
+      FatalError message_;                                                                                             \
+  } while (0)
+#define AssertNull(pointer_) AssertMessage((pointer_) == NULL, ("%s is not NULL", #pointer_))
+#define AssertNotNull(pointer_) AssertMessage((pointer_) != NULL, ("%s is NULL", #pointer_))
+#define AssertGreater(a_, b_) AssertMessage((a_) > (b_), ("%s (%d) is not greater than %s (%d)", #a_, (a_), #b_, (b_)))
+#define AssertIndex(index_, count_)                                                                                    \
+  AssertMessage((index_) >= 0 && (index_) < (count_),                                                                  \
+                ("%s (%d) does not index %s (%d)", #index_, (index_), #count_, (count_)))
+
+struct Point {
+  int x;
+  int y;
+};
+
+struct Bounds {
+  int x;
+  int y;
+  int width;
+  int height;
+};
+
+struct Point MakePoint(int x, int y);
+
+bool PointInBounds(struct Point point, struct Bounds bounds);
+
+struct Point BoundsMidpoint(struct Bounds bounds);
+
+bool BoundsIntersect(struct Bounds a, struct Bounds b);
+bool BoundsContain(struct Bounds outer, struct Bounds inner);
+struct Bounds BoundsUnion(struct Bounds a, struct Bounds b);
+
+enum Dimension {
+  Dimension_BorderInset,
+  // The strip of tabs along the top of a tab stack.
+  Dimension_TabHeight,
+  Dimension_Count,
+};
+
+// Each dimension in pixels at the scale last given to SetDimensionScale, which starts at 1. Layout and hit testing read
+// them, so a tree must be hit tested at the scale it was laid out at.
+extern int dimensions[Dimension_Count];
+
+// Scales the dimensions for a monitor, 1 being 96 DPI. Returns whether any of them changed.
+bool SetDimensionScale(float scale);
+
+enum LineStyle {
+  LineStyle_Border,
+  LineStyle_Focus,
+  LineStyle_Action,
+  LineStyle_ActionHint,
+  LineStyle_Count,
+};
@@ -0,0 +1,51 @@
+#include "damage.h"
+
+struct Damage damage;
+struct RenderStats renderStats;
+
+long long BoundsArea(struct Bounds bounds) { return (long long)bounds.width * bounds.height; }
+
+void DamageBounds(struct Bounds bounds) {
+  if (bounds.width <= 0 || bounds.height <= 0)
+    return;
+
+  for (int rect = 0; rect < damage.rectCount; rect++)
+    if (BoundsContain(damage.rects[rect], bounds))
+      return;
+
+  // Drop anything the new rectangle covers.
+  int kept = 0;
+  for (int rect = 0; rect < damage.rectCount; rect++)
+    if (!BoundsContain(bounds, damage.rects[rect]))
+      damage.rects[kept++] = damage.rects[rect];
+  damage.rectCount = kept;
+
+  if (damage.rectCount < DAMAGE_RECT_LIMIT) {
+    damage.rects[damage.rectCount++] = bounds;
+    return;
+  }
+
+  // Full: fold the new rectangle into whichever existing one grows the least.
+  int best = 0;
+  long long bestGrowth = -1;
+  for (int rect = 0; rect < damage.rectCount; rect++) {
+    struct Bounds merged = BoundsUnion(damage.rects[rect], bounds);
+    long long growth = BoundsArea(merged) - BoundsArea(damage.rects[rect]);
+    if (bestGrowth < 0 || growth < bestGrowth) {
+      best = rect;
+      bestGrowth = growth;
+    }
+  }
+  struct Bounds merged = BoundsUnion(damage.rects[best], bounds);
+  damage.rects[best] = damage.rects[--damage.rectCount];
+  DamageBounds(merged);
+}
+
+void ClearDamage() { damage.rectCount = 0; }
+
+long long DamageArea() {
+  long long area = 0;
+  for (int rect = 0; rect < damage.rectCount; rect++)
+    area += BoundsArea(damage.rects[rect]);
+  return area;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "core.h"
+
+// Screen areas that need repainting, accumulated while input and layout run and drained by the backend after each
+// event. A handful of rectangles is enough: a hover change damages two cells and a layout pass damages the bins it
+// visited, most of which nest inside one another. When the list is full the closest pair is merged.
+
+#define DAMAGE_RECT_LIMIT 16
+
+// Lines are drawn with anti-aliasing, so repaint a little beyond the damaged bounds.
+#define DAMAGE_MARGIN 2
+
+struct Damage {
+  int rectCount;
+  struct Bounds rects[DAMAGE_RECT_LIMIT];
+};
+
+extern struct Damage damage;
+
+void DamageBounds(struct Bounds bounds);
+void ClearDamage();
+long long DamageArea();
+
+// Filled in by whichever backend paints the overlay.
+struct RenderStats {
+  long long paints;
+  // Paints whose draw list matched the previous one, so the back buffer was copied without drawing.
+  long long skippedPaints;
+  long long pixelsTouched;
+  double paintSeconds;
+  double lastPaintSeconds;
+};
+
+extern struct RenderStats renderStats;
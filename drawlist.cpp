@@ -0,0 +1,142 @@
+#include "drawlist.h"
+
+struct DrawList *drawRecording;
+
+static_assert(sizeof(struct DrawCommand) % sizeof(unsigned long long) == 0, "DrawCommand is hashed a word at a time");
+
+void ResetDrawList(struct DrawList *list) {
+  AssertNotNull(list);
+
+  list->commandCount = 0;
+  list->textBytes = 0;
+}
+
+void ReleaseDrawList(struct DrawList *list) {
+  AssertNotNull(list);
+
+  FreeBytes(list->commands);
+  FreeBytes(list->text);
+  FreeBytes(list->sorted);
+  memset(list, 0, sizeof(*list));
+}
+
+void DrawListAdd(struct DrawList *list, enum DrawCommandKind kind, int style, int size, int x0, int y0, int x1, int y1,
+                 const char *text) {
+  AssertNotNull(list);
+
+  if (list->commandCount == list->commandCapacity) {
+    int newCapacity = list->commandCapacity ? list->commandCapacity * 2 : 1024;
+    struct DrawCommand *newCommands = AllocateArray(struct DrawCommand, newCapacity);
+    if (list->commands != NULL)
+      memcpy(newCommands, list->commands, list->commandCount * sizeof(struct DrawCommand));
+    FreeBytes(list->commands);
+    list->commands = newCommands;
+    list->commandCapacity = newCapacity;
+  }
+
+  struct DrawCommand *command = &list->commands[list->commandCount++];
+  command->kind = (unsigned char)kind;
+  command->style = (unsigned char)style;
+  command->size = (unsigned short)size;
+  command->x0 = x0;
+  command->y0 = y0;
+  command->x1 = x1;
+  command->y1 = y1;
+  command->text = 0;
+
+  if (text != NULL) {
+    int length = (int)strlen(text) + 1;
+    if (list->textBytes + length > list->textCapacity) {
+      int newCapacity = list->textCapacity ? list->textCapacity * 2 : 1024;
+      while (newCapacity < list->textBytes + length)
+        newCapacity *= 2;
+      char *newText = AllocateArray(char, newCapacity);
+      if (list->text != NULL)
+        memcpy(newText, list->text, list->textBytes);
+      FreeBytes(list->text);
+      list->text = newText;
+      list->textCapacity = newCapacity;
+    }
+    command->text = list->textBytes;
+    memcpy(list->text + list->textBytes, text, length);
+    list->textBytes += length;
+  }
+}
+
+// FNV-1a style, over the commands eight bytes at a time in recorded order and then the text byte by byte. Commands
+// have no padding, so their bytes are exactly their fields.
+unsigned long long DrawListHash(struct DrawList *list) {
+  AssertNotNull(list);
+
+  unsigned long long hash = 14695981039346656037ull;
+  const char *bytes = (const char *)list->commands;
+  size_t wordCount = list->commandCount * sizeof(struct DrawCommand) / sizeof(unsigned long long);
+  for (size_t word = 0; word < wordCount; word++) {
+    unsigned long long value;
+    memcpy(&value, bytes + word * sizeof(value), sizeof(value));
+    hash = (hash ^ value) * 1099511628211ull;
+    hash ^= hash >> 29;
+  }
+  for (int byte = 0; byte < list->textBytes; byte++)
+    hash = (hash ^ (unsigned char)list->text[byte]) * 1099511628211ull;
+  return hash;
+}
+
+void DrawCommandImmediate(struct DrawCommand *command, const char *text) {
+  enum LineStyle style = (enum LineStyle)command->style;
+  struct Bounds bounds = {command->x0, command->y0, command->x1, command->y1};
+  switch (command->kind) {
+  case DrawCommand_Line:
+    if (backend->drawLineFn)
+      backend->drawLineFn(MakePoint(command->x0, command->y0), MakePoint(command->x1, command->y1), style);
+    break;
+  case DrawCommand_Rectangle:
+    if (backend->drawRectangleFn)
+      backend->drawRectangleFn(bounds, style);
+    break;
+  case DrawCommand_RoundedRectangle:
+    if (backend->drawRoundedRectangleFn)
+      backend->drawRoundedRectangleFn(bounds, command->size, style);
+    break;
+  case DrawCommand_Text:
+    if (backend->drawTextFn)
+      backend->drawTextFn(command->x0, command->y0, command->size, text + command->text);
+    break;
+  }
+}
+
+void SubmitDrawList(struct DrawList *list) {
+  AssertNotNull(list);
+  AssertNotNull(backend);
+
+  if (list->commandCount > list->sortedCapacity) {
+    FreeBytes(list->sorted);
+    list->sortedCapacity = list->commandCapacity;
+    list->sorted = AllocateArray(struct DrawCommand, list->sortedCapacity);
+  }
+
+  // A counting sort by style is stable and linear, and there are only a few styles.
+  int styleStart[DrawStyle_Text + 2] = {};
+  for (int command = 0; command < list->commandCount; command++)
+    styleStart[list->commands[command].style + 1]++;
+  for (int style = 0; style <= DrawStyle_Text; style++)
+    styleStart[style + 1] += styleStart[style];
+  int styleEnd[DrawStyle_Text + 1];
+  memcpy(styleEnd, styleStart, sizeof(styleEnd));
+  for (int command = 0; command < list->commandCount; command++)
+    list->sorted[styleEnd[list->commands[command].style]++] = list->commands[command];
+
+  for (int style = 0; style <= DrawStyle_Text; style++) {
+    int count = styleStart[style + 1] - styleStart[style];
+    if (count == 0)
+      continue;
+
+    struct DrawCommand *batch = &list->sorted[styleStart[style]];
+    if (backend->drawCommandsFn) {
+      backend->drawCommandsFn(batch, count, list->text);
+      continue;
+    }
+    for (int command = 0; command < count; command++)
+      DrawCommandImmediate(&batch[command], list->text);
+  }
+}
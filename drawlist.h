@@ -0,0 +1,58 @@
+#pragma once
+
+#include "backend.h"
+
+// The draw pass records primitives into a flat DrawList instead of drawing as it walks the tree. Submitting the list
+// groups the commands by LineStyle, so a backend can set up each pen once and draw its primitives as a batch, and the
+// hash of a list identifies a frame: equal hashes mean equal pixels, which lets a paint be skipped and gives golden
+// checks something stable to compare.
+
+enum DrawCommandKind {
+  DrawCommand_Line,
+  DrawCommand_Rectangle,
+  DrawCommand_RoundedRectangle,
+  DrawCommand_Text,
+};
+
+// Text has no line style; it is grouped after every style so that it draws on top.
+#define DrawStyle_Text LineStyle_Count
+
+// Packed to 24 bytes, a whole number of words, so lists hash a word at a time.
+struct DrawCommand {
+  unsigned char kind;
+  unsigned char style;
+  // The corner diameter of a rounded rectangle, or the size of text.
+  unsigned short size;
+  // A line runs from x0, y0 to x1, y1; anything else fills the bounds x0, y0, x1 (width), y1 (height).
+  int x0, y0, x1, y1;
+  // Offset of the text in the list's text buffer.
+  int text;
+};
+
+struct DrawList {
+  int commandCount;
+  int commandCapacity;
+  struct DrawCommand *commands;
+
+  int textBytes;
+  int textCapacity;
+  char *text;
+
+  // Scratch for SubmitDrawList, kept with the list so submitting does not allocate.
+  struct DrawCommand *sorted;
+  int sortedCapacity;
+};
+
+// While set, the Draw functions in backend.h append to this list rather than calling the backend.
+extern struct DrawList *drawRecording;
+
+void ResetDrawList(struct DrawList *list);
+void ReleaseDrawList(struct DrawList *list);
+
+void DrawListAdd(struct DrawList *list, enum DrawCommandKind kind, int style, int size, int x0, int y0, int x1, int y1,
+                 const char *text);
+unsigned long long DrawListHash(struct DrawList *list);
+
+// Draws the list through the active backend, one batch per style. Within a style the recorded order is kept; later
+// styles draw over earlier ones.
+void SubmitDrawList(struct DrawList *list);
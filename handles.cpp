@@ -0,0 +1,106 @@
+#include "handles.h"
+
+void InitHandleTable(struct HandleTable *table, size_t entrySize, int firstCapacity) {
+  AssertNotNull(table);
+  AssertMessage(entrySize >= sizeof(WindowHandle), ("An entry starts with its handle"));
+  AssertMessage(firstCapacity > 0 && (firstCapacity & (firstCapacity - 1)) == 0,
+                ("The first capacity must be a power of two"));
+
+  memset(table, 0, sizeof(*table));
+  table->entrySize = entrySize;
+  table->firstCapacity = firstCapacity;
+}
+
+void ReleaseHandleTable(struct HandleTable *table) {
+  AssertNotNull(table);
+
+  FreeBytes(table->entries);
+  InitHandleTable(table, table->entrySize, table->firstCapacity);
+}
+
+int HandleHash(WindowHandle hWnd, int capacity) {
+  size_t hash = (size_t)hWnd;
+  hash ^= hash >> 17;
+  hash *= 0x9e3779b1u;
+  hash ^= hash >> 15;
+  return (int)(hash & (size_t)(capacity - 1));
+}
+
+WindowHandle HandleAt(const struct HandleTable *table, int index) {
+  return *HandleEntry(WindowHandle, table, index);
+}
+
+int FindHandleIndex(const struct HandleTable *table, WindowHandle hWnd) {
+  AssertNotNull(table);
+
+  if (table->capacity == 0 || hWnd == NULL)
+    return -1;
+
+  int index = HandleHash(hWnd, table->capacity);
+  while (HandleAt(table, index) != NULL) {
+    if (HandleAt(table, index) == hWnd)
+      return index;
+    index = (index + 1) & (table->capacity - 1);
+  }
+  return -1;
+}
+
+void *FindHandleEntry(const struct HandleTable *table, WindowHandle hWnd) {
+  int index = FindHandleIndex(table, hWnd);
+  return index >= 0 ? HandleEntry(void, table, index) : NULL;
+}
+
+// Puts an entry in the first free place of its probe run, which the caller has made sure there is.
+void *HandleTableInsert(struct HandleTable *table, WindowHandle hWnd) {
+  int index = HandleHash(hWnd, table->capacity);
+  while (HandleAt(table, index) != NULL)
+    index = (index + 1) & (table->capacity - 1);
+  return HandleEntry(void, table, index);
+}
+
+void GrowHandleTable(struct HandleTable *table) {
+  struct HandleTable grown = *table;
+  grown.capacity = table->capacity ? table->capacity * 2 : table->firstCapacity;
+  grown.entries = (char *)AllocateBytes(table->entrySize, grown.capacity, "HandleTable");
+  for (int index = 0; index < table->capacity; index++) {
+    WindowHandle hWnd = HandleAt(table, index);
+    if (hWnd != NULL)
+      memcpy(HandleTableInsert(&grown, hWnd), HandleEntry(void, table, index), table->entrySize);
+  }
+
+  FreeBytes(table->entries);
+  *table = grown;
+}
+
+void *AddHandleEntry(struct HandleTable *table, WindowHandle hWnd) {
+  AssertNotNull(table);
+  AssertNotNull(hWnd);
+  AssertMessage(FindHandleIndex(table, hWnd) < 0, ("The handle is in the table already"));
+
+  if ((table->count + 1) * 2 > table->capacity)
+    GrowHandleTable(table);
+
+  WindowHandle *entry = (WindowHandle *)HandleTableInsert(table, hWnd);
+  *entry = hWnd;
+  table->count++;
+  return entry;
+}
+
+void RemoveHandleIndex(struct HandleTable *table, int index) {
+  AssertNotNull(table);
+  AssertIndex(index, table->capacity);
+
+  int mask = table->capacity - 1;
+  int hole = index;
+  for (int next = (index + 1) & mask; HandleAt(table, next) != NULL; next = (next + 1) & mask) {
+    int home = HandleHash(HandleAt(table, next), table->capacity);
+    // The entry can fill the hole only if its home is not in the cyclic range (hole, next].
+    bool between = hole <= next ? (home > hole && home <= next) : (home > hole || home <= next);
+    if (!between) {
+      memcpy(HandleEntry(void, table, hole), HandleEntry(void, table, next), table->entrySize);
+      hole = next;
+    }
+  }
+  memset(HandleEntry(void, table, hole), 0, table->entrySize);
+  table->count--;
+}
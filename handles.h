@@ -0,0 +1,38 @@
+#pragma once
+
+#include "backend.h"
+
+// Open addressed hash tables of entries keyed by window handle, for everything that keeps something per window: the
+// tracker, the rule cache, the void and the move pool. Each entry is a struct whose first member is its WindowHandle,
+// and an entry whose handle is NULL is empty. Tables probe linearly and are kept at most half full. Removing an entry
+// shifts later entries of its probe run back rather than leaving a tombstone, so lookups never stop short.
+//
+// Adding and removing entries moves others, so keep handles rather than entry pointers across either.
+
+struct HandleTable {
+  int count;
+  int capacity;
+  // The capacity the table starts at once something is added, a power of two.
+  int firstCapacity;
+  size_t entrySize;
+  char *entries;
+};
+
+void InitHandleTable(struct HandleTable *table, size_t entrySize, int firstCapacity);
+// Frees the entries and leaves the table empty.
+void ReleaseHandleTable(struct HandleTable *table);
+
+// Hashes a handle into a table of a power of two capacity.
+int HandleHash(WindowHandle hWnd, int capacity);
+
+// The entry at index, empty or not, for walking the whole table.
+#define HandleEntry(type_, table_, index_) ((type_ *)((table_)->entries + (size_t)(index_) * (table_)->entrySize))
+
+// Return the entry for hWnd, or -1 and NULL if there is none.
+int FindHandleIndex(const struct HandleTable *table, WindowHandle hWnd);
+void *FindHandleEntry(const struct HandleTable *table, WindowHandle hWnd);
+
+// Adds a zeroed entry for hWnd, which must not be in the table, growing the table first if it would be more than half
+// full.
+void *AddHandleEntry(struct HandleTable *table, WindowHandle hWnd);
+void RemoveHandleIndex(struct HandleTable *table, int index);
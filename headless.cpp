@@ -0,0 +1,188 @@
+#include "headless.h"
+#include "placement.h"
+
+struct Headless headless;
+
+// Stand-ins for real drawing objects, so the resource cache does the same allocation work headless as on a desktop.
+struct HeadlessPen {
+  enum LineStyle style;
+  float width;
+};
+
+struct HeadlessFont {
+  int size;
+};
+
+void *HeadlessCreatePen(enum LineStyle style, float scale) {
+  struct HeadlessPen *pen = Allocate(struct HeadlessPen);
+  pen->style = style;
+  pen->width = lineStyles[style].width * scale;
+  return pen;
+}
+
+void *HeadlessCreateFont(int size, float scale) {
+  struct HeadlessFont *font = Allocate(struct HeadlessFont);
+  font->size = (int)(size * scale);
+  return font;
+}
+
+void *HeadlessCreateText(const char *text, int size, float) {
+  ResourceFont(&headlessResources, size);
+  char *layout = AllocateArray(char, strlen(text) + 1);
+  strcpy(layout, text);
+  return layout;
+}
+
+struct ResourceCache headlessResources = {
+    HeadlessCreatePen,
+    HeadlessCreateFont,
+    HeadlessCreateText,
+    FreeBytes,
+    FreeBytes,
+    FreeBytes,
+    1.0f,
+    // The pens, fonts and texts start out empty, to be made as they are first used.
+    {},
+    0,
+    0,
+    {},
+    {},
+    0,
+    0,
+};
+
+void HeadlessDrawLine(struct Point, struct Point, enum LineStyle style) {
+  ResourcePen(&headlessResources, style);
+  headless.lineCount++;
+}
+
+void HeadlessDrawRectangle(struct Bounds, enum LineStyle style) {
+  ResourcePen(&headlessResources, style);
+  headless.rectangleCount++;
+}
+
+void HeadlessDrawRoundedRectangle(struct Bounds, int, enum LineStyle style) {
+  ResourcePen(&headlessResources, style);
+  headless.roundedRectangleCount++;
+}
+
+void HeadlessDrawText(int, int, int size, const char *text) {
+  if (ResourceText(&headlessResources, text, size) == NULL)
+    ResourceFont(&headlessResources, size);
+  headless.textCount++;
+}
+
+// A batch shares one style, so its pen is looked up once; its primitives are counted as if drawn one by one.
+void HeadlessDrawCommands(const struct DrawCommand *commands, int count, const char *text) {
+  headless.batchCount++;
+  if (commands[0].style != DrawStyle_Text)
+    ResourcePen(&headlessResources, (enum LineStyle)commands[0].style);
+
+  for (int index = 0; index < count; index++) {
+    const struct DrawCommand *command = &commands[index];
+    switch (command->kind) {
+    case DrawCommand_Line:
+      headless.lineCount++;
+      break;
+    case DrawCommand_Rectangle:
+      headless.rectangleCount++;
+      break;
+    case DrawCommand_RoundedRectangle:
+      headless.roundedRectangleCount++;
+      break;
+    case DrawCommand_Text:
+      HeadlessDrawText(command->x0, command->y0, command->size, text + command->text);
+      break;
+    }
+  }
+}
+
+void HeadlessPlaceWindow(WindowHandle hWnd, struct Bounds bounds) {
+  if (headless.placementCount == headless.placementCapacity) {
+    int newCapacity = headless.placementCapacity ? headless.placementCapacity * 2 : 64;
+    struct HeadlessPlacement *newPlacements = AllocateArray(struct HeadlessPlacement, newCapacity);
+    if (headless.placements != NULL)
+      memcpy(newPlacements, headless.placements, headless.placementCount * sizeof(struct HeadlessPlacement));
+    FreeBytes(headless.placements);
+    headless.placements = newPlacements;
+    headless.placementCapacity = newCapacity;
+  }
+
+  struct HeadlessPlacement *placement = &headless.placements[headless.placementCount++];
+  placement->hWnd = hWnd;
+  placement->bounds = bounds;
+}
+
+void HeadlessPlaceWindows(const struct WindowPlacement *placements, int count) {
+  headless.placementBatchCount++;
+  for (int index = 0; index < count; index++)
+    HeadlessPlaceWindow(placements[index].hWnd, placements[index].bounds);
+}
+
+void HeadlessStackWindows(const struct WindowStacking *stackings, int count) {
+  headless.stackingBatchCount++;
+  for (int index = 0; index < count; index++) {
+    const struct WindowStacking *stacking = &stackings[index];
+    headless.stackingCount++;
+
+    int at = 0;
+    while (at < headless.zCount && headless.zOrder[at] != stacking->hWnd)
+      at++;
+    if (at < headless.zCount) {
+      memmove(&headless.zOrder[at], &headless.zOrder[at + 1], (headless.zCount - at - 1) * sizeof(WindowHandle));
+      headless.zCount--;
+    }
+    if (stacking->show == WindowShow_Hide) {
+      headless.hideCount++;
+      continue;
+    }
+    if (stacking->show == WindowShow_Show)
+      headless.showCount++;
+    if (headless.zCount == headless.zCapacity) {
+      int newCapacity = headless.zCapacity ? headless.zCapacity * 2 : 64;
+      WindowHandle *newOrder = AllocateArray(WindowHandle, newCapacity);
+      if (headless.zOrder != NULL)
+        memcpy(newOrder, headless.zOrder, headless.zCount * sizeof(WindowHandle));
+      FreeBytes(headless.zOrder);
+      headless.zOrder = newOrder;
+      headless.zCapacity = newCapacity;
+    }
+
+    // A window stacked below one never stacked goes on top, which is where a new window would be.
+    int below = 0;
+    while (stacking->above != NULL && below < headless.zCount && headless.zOrder[below] != stacking->above)
+      below++;
+    below = stacking->above != NULL && below < headless.zCount ? below + 1 : 0;
+    memmove(&headless.zOrder[below + 1], &headless.zOrder[below], (headless.zCount - below) * sizeof(WindowHandle));
+    headless.zOrder[below] = stacking->hWnd;
+    headless.zCount++;
+  }
+}
+
+struct Backend headlessBackend = {
+    "headless",
+    HeadlessDrawLine,
+    HeadlessDrawRectangle,
+    HeadlessDrawRoundedRectangle,
+    HeadlessDrawText,
+    HeadlessDrawCommands,
+    HeadlessPlaceWindow,
+    HeadlessPlaceWindows,
+    HeadlessStackWindows,
+    &headlessResources,
+};
+
+void HeadlessReset() {
+  headless.lineCount = 0;
+  headless.rectangleCount = 0;
+  headless.roundedRectangleCount = 0;
+  headless.textCount = 0;
+  headless.batchCount = 0;
+  headless.placementCount = 0;
+  headless.placementBatchCount = 0;
+  headless.stackingCount = 0;
+  headless.stackingBatchCount = 0;
+  headless.showCount = 0;
+  headless.hideCount = 0;
+  headless.zCount = 0;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "backend.h"
+#include "drawlist.h"
+#include "resources.h"
+
+// A window placement recorded by the headless backend in place of SetWindowPos.
+struct HeadlessPlacement {
+  WindowHandle hWnd;
+  struct Bounds bounds;
+};
+
+struct Headless {
+  int lineCount;
+  int rectangleCount;
+  int roundedRectangleCount;
+  int textCount;
+  int batchCount;
+
+  int placementCount;
+  int placementBatchCount;
+  int placementCapacity;
+  struct HeadlessPlacement *placements;
+
+  // Stackings, and the z-order they built up, top first, of the windows that have been stacked and not hidden since.
+  int stackingCount;
+  int stackingBatchCount;
+  int showCount;
+  int hideCount;
+  int zCount;
+  int zCapacity;
+  WindowHandle *zOrder;
+};
+
+extern struct Headless headless;
+extern struct ResourceCache headlessResources;
+extern struct Backend headlessBackend;
+
+// Forgets the recorded calls and the z-order, keeping their storage for reuse.
+void HeadlessReset();
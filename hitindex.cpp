@@ -0,0 +1,176 @@
+#include "hitindex.h"
+
+void InitHitIndex(struct HitIndex *index, struct Bin *root) {
+  AssertNotNull(index);
+
+  memset(index, 0, sizeof(*index));
+  index->root = root;
+}
+
+void ReleaseHitIndex(struct HitIndex *index) {
+  AssertNotNull(index);
+
+  FreeBytes(index->leaves);
+  FreeBytes(index->bucketStart);
+  FreeBytes(index->bucketLeaves);
+  InitHitIndex(index, NULL);
+}
+
+void HitIndexAddLeaf(struct HitIndex *index, struct Bin *bin) {
+  if (index->leafCount == index->leafCapacity) {
+    int newCapacity = index->leafCapacity ? index->leafCapacity * 2 : 256;
+    struct HitLeaf *newLeaves = AllocateArray(struct HitLeaf, newCapacity);
+    if (index->leaves != NULL)
+      memcpy(newLeaves, index->leaves, index->leafCount * sizeof(struct HitLeaf));
+    FreeBytes(index->leaves);
+    index->leaves = newLeaves;
+    index->leafCapacity = newCapacity;
+  }
+
+  struct HitLeaf *leaf = &index->leaves[index->leafCount++];
+  leaf->bounds = bin->bounds;
+  leaf->bin = bin;
+}
+
+void HitIndexCollect(struct HitIndex *index, struct Bin *bin) {
+  int childCount = BinChildCount(bin);
+  if (childCount == 0) {
+    if (bin->bounds.width > 0 && bin->bounds.height > 0)
+      HitIndexAddLeaf(index, bin);
+    return;
+  }
+
+  // The slots of a swirl overlap, and only its top slot takes input, so the others are left to a full dispatch.
+  if (bin->onLayoutFn == SwirlLayout && childCount > 1)
+    childCount = 1;
+
+  for (int child = 0; child < childCount; child++) {
+    struct Bin *childBin = BinChild(bin, child);
+    if (childBin != NULL && BinChildShown(bin, child))
+      HitIndexCollect(index, childBin);
+  }
+}
+
+// Maps a coordinate to its bucket along one axis, clamped to the index.
+int HitIndexBucket(struct HitIndex *index, int offset, int size) {
+  if (size <= 0 || offset < 0)
+    return 0;
+  int bucket = (int)((long long)offset * index->buckets / size);
+  return bucket < index->buckets ? bucket : index->buckets - 1;
+}
+
+void HitIndexBucketRange(struct HitIndex *index, struct Bounds bounds, int *x0, int *y0, int *x1, int *y1) {
+  *x0 = HitIndexBucket(index, bounds.x - index->bounds.x, index->bounds.width);
+  *y0 = HitIndexBucket(index, bounds.y - index->bounds.y, index->bounds.height);
+  *x1 = HitIndexBucket(index, bounds.x + bounds.width - 1 - index->bounds.x, index->bounds.width);
+  *y1 = HitIndexBucket(index, bounds.y + bounds.height - 1 - index->bounds.y, index->bounds.height);
+}
+
+void RebuildHitIndex(struct HitIndex *index) {
+  AssertNotNull(index->root);
+
+  index->leafCount = 0;
+  index->bounds = index->root->bounds;
+  HitIndexCollect(index, index->root);
+
+  index->buckets = HIT_INDEX_MIN_BUCKETS;
+  while (index->buckets < HIT_INDEX_MAX_BUCKETS && index->buckets * index->buckets < index->leafCount)
+    index->buckets *= 2;
+
+  int bucketCount = index->buckets * index->buckets;
+  if (bucketCount + 1 > index->bucketStartCapacity) {
+    FreeBytes(index->bucketStart);
+    index->bucketStartCapacity = bucketCount + 1;
+    index->bucketStart = AllocateArray(int, index->bucketStartCapacity);
+  }
+
+  // Count the leaves in each bucket, prefix sum the counts into starts, then scatter the leaves into place.
+  int *bucketStart = index->bucketStart;
+  memset(bucketStart, 0, (bucketCount + 1) * sizeof(int));
+  for (int leaf = 0; leaf < index->leafCount; leaf++) {
+    int x0, y0, x1, y1;
+    HitIndexBucketRange(index, index->leaves[leaf].bounds, &x0, &y0, &x1, &y1);
+    for (int y = y0; y <= y1; y++)
+      for (int x = x0; x <= x1; x++)
+        bucketStart[y * index->buckets + x + 1]++;
+  }
+  for (int bucket = 0; bucket < bucketCount; bucket++)
+    bucketStart[bucket + 1] += bucketStart[bucket];
+
+  index->bucketLeafCount = bucketStart[bucketCount];
+  if (index->bucketLeafCount > index->bucketLeafCapacity) {
+    FreeBytes(index->bucketLeaves);
+    index->bucketLeafCapacity = index->bucketLeafCount * 2;
+    index->bucketLeaves = AllocateArray(int, index->bucketLeafCapacity);
+  }
+
+  for (int leaf = 0; leaf < index->leafCount; leaf++) {
+    int x0, y0, x1, y1;
+    HitIndexBucketRange(index, index->leaves[leaf].bounds, &x0, &y0, &x1, &y1);
+    for (int y = y0; y <= y1; y++)
+      for (int x = x0; x <= x1; x++)
+        index->bucketLeaves[bucketStart[y * index->buckets + x]++] = leaf;
+  }
+  // The scatter advanced every start to the next bucket's start; shift them back.
+  for (int bucket = bucketCount; bucket > 0; bucket--)
+    bucketStart[bucket] = bucketStart[bucket - 1];
+  bucketStart[0] = 0;
+
+  index->layoutVisited = layoutStats.visited;
+  index->built = true;
+  index->hoverLeaf = NULL;
+  index->rebuilds++;
+}
+
+bool HitIndexIsCurrent(struct HitIndex *index) {
+  struct Bin *root = index->root;
+  if (!index->built || root->layoutDirty || root->childLayoutDirty)
+    return false;
+  return index->layoutVisited == layoutStats.visited;
+}
+
+struct Bin *HitTestLeaf(struct HitIndex *index, struct Point point) {
+  AssertNotNull(index);
+  AssertNotNull(index->root);
+
+  if (!HitIndexIsCurrent(index))
+    RebuildHitIndex(index);
+
+  if (!PointInBounds(point, index->bounds))
+    return NULL;
+
+  int x = HitIndexBucket(index, point.x - index->bounds.x, index->bounds.width);
+  int y = HitIndexBucket(index, point.y - index->bounds.y, index->bounds.height);
+  int bucket = y * index->buckets + x;
+  for (int entry = index->bucketStart[bucket]; entry < index->bucketStart[bucket + 1]; entry++) {
+    struct HitLeaf *leaf = &index->leaves[index->bucketLeaves[entry]];
+    if (PointInBounds(point, leaf->bounds))
+      return leaf->bin;
+  }
+  return NULL;
+}
+
+void DispatchMouseIndexed(struct HitIndex *index, struct Point position, int buttons) {
+  AssertNotNull(index);
+  AssertNotNull(index->root);
+
+  // Leaves are disjoint and nested inside every ancestor's slot, so staying on one leaf means every container on the
+  // path would pick the same slot again. Only the leaf itself needs to see the new position.
+  struct Bin *leaf = HitTestLeaf(index, position);
+  if (leaf != NULL && leaf == index->hoverLeaf && buttons == newInput.buttons) {
+    BeginMouseInput(position, buttons);
+
+    if (leaf->onInputFn)
+      leaf->onInputFn(leaf);
+
+    FinishInput(index->root);
+    index->fastDispatches++;
+    return;
+  }
+
+  DispatchMouse(index->root, position, buttons);
+  index->fullDispatches++;
+
+  // A full dispatch may have edited the tree, in which case the leaf is looked up again after the next rebuild.
+  index->hoverLeaf = HitIndexIsCurrent(index) ? leaf : NULL;
+}
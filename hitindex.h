@@ -0,0 +1,51 @@
+#pragma once
+
+#include "bin.h"
+
+// A flattened index of the leaf rectangles of one root, bucketed on a uniform grid over the root bounds. The index is
+// rebuilt lazily whenever a layout pass has run since it was built, and lets plain mouse moves that stay over the same
+// leaf skip the walk down the tree.
+
+// Buckets per axis grow with the square root of the leaf count, aiming for a couple of leaves per bucket.
+#define HIT_INDEX_MIN_BUCKETS 16
+#define HIT_INDEX_MAX_BUCKETS 512
+
+struct HitLeaf {
+  struct Bounds bounds;
+  struct Bin *bin;
+};
+
+struct HitIndex {
+  struct Bin *root;
+  struct Bounds bounds;
+  long long layoutVisited;
+  bool built;
+
+  int leafCount;
+  int leafCapacity;
+  struct HitLeaf *leaves;
+
+  // Leaves overlapping bucket i are bucketLeaves[bucketStart[i]] up to bucketLeaves[bucketStart[i + 1]].
+  int buckets;
+  int bucketStartCapacity;
+  int *bucketStart;
+  int bucketLeafCount;
+  int bucketLeafCapacity;
+  int *bucketLeaves;
+
+  // The leaf the last event dispatched through the index landed on.
+  struct Bin *hoverLeaf;
+
+  long long rebuilds;
+  long long fastDispatches;
+  long long fullDispatches;
+};
+
+void InitHitIndex(struct HitIndex *index, struct Bin *root);
+void ReleaseHitIndex(struct HitIndex *index);
+
+// Returns the leaf bin under point, or NULL if the point falls between leaves.
+struct Bin *HitTestLeaf(struct HitIndex *index, struct Point point);
+
+// As DispatchMouse, but a move with no button change that stays over the previous leaf only runs that leaf's input.
+void DispatchMouseIndexed(struct HitIndex *index, struct Point position, int buttons);
@@ -0,0 +1,65 @@
+#include "inputqueue.h"
+
+struct InputQueue inputQueue;
+struct InputStats inputStats;
+
+bool QueueInput(struct QueuedInput event) {
+  AssertMessage(inputQueue.count < INPUT_QUEUE_LIMIT, ("The input queue overflowed"));
+
+  inputQueue.events[inputQueue.count++] = event;
+  return inputQueue.count == INPUT_QUEUE_LIMIT;
+}
+
+bool QueueMouse(struct Point position, int buttons) {
+  inputStats.rawEvents++;
+
+  // A move straight after another move replaces it. Moves after a button change are not folded into it, so a click
+  // still lands where it was made.
+  if (buttons == inputQueue.buttons && inputQueue.count > 0) {
+    struct QueuedInput *last = &inputQueue.events[inputQueue.count - 1];
+    if (last->kind == QueuedInput_Move) {
+      last->position = position;
+      inputStats.coalescedEvents++;
+      return false;
+    }
+  }
+
+  struct QueuedInput event = {};
+  event.kind = buttons == inputQueue.buttons ? QueuedInput_Move : QueuedInput_Button;
+  event.position = position;
+  event.buttons = buttons;
+  inputQueue.buttons = buttons;
+  return QueueInput(event);
+}
+
+bool QueueKey(int key, bool shift) {
+  inputStats.rawEvents++;
+
+  struct QueuedInput event = {};
+  event.kind = QueuedInput_Key;
+  event.key = key;
+  event.shift = shift;
+  return QueueInput(event);
+}
+
+int ProcessInput(struct HitIndex *index) {
+  int count = inputQueue.count;
+  if (count == 0)
+    return 0;
+
+  AssertNotNull(index);
+  AssertNotNull(index->root);
+
+  for (int event = 0; event < count; event++) {
+    struct QueuedInput *input = &inputQueue.events[event];
+    if (input->kind == QueuedInput_Key)
+      DispatchKey(index->root, input->key, input->shift);
+    else
+      DispatchMouseIndexed(index, input->position, input->buttons);
+  }
+
+  inputQueue.count = 0;
+  inputStats.processedEvents += count;
+  inputStats.frames++;
+  return count;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "hitindex.h"
+
+// Input events queued as they arrive and dispatched together once per frame. A mouse can report moves several times
+// faster than the display refreshes, and only the last position before a frame can ever be seen, so consecutive moves
+// are folded into one. Button changes and keys are kept exactly, in order, with the position each arrived at.
+
+#define INPUT_QUEUE_LIMIT 64
+
+enum QueuedInputKind {
+  QueuedInput_Move,
+  QueuedInput_Button,
+  QueuedInput_Key,
+};
+
+struct QueuedInput {
+  enum QueuedInputKind kind;
+  struct Point position;
+  int buttons;
+  int key;
+  bool shift;
+};
+
+struct InputQueue {
+  int count;
+  struct QueuedInput events[INPUT_QUEUE_LIMIT];
+
+  // The buttons as of the last queued mouse event, which tell a move from a button change.
+  int buttons;
+};
+
+// Raw events as they arrived, how many of them were folded into an earlier move, how many were dispatched, and the
+// frames they were dispatched in.
+struct InputStats {
+  long long rawEvents;
+  long long coalescedEvents;
+  long long processedEvents;
+  long long frames;
+};
+
+extern struct InputQueue inputQueue;
+extern struct InputStats inputStats;
+
+// Both return true once the queue is full, when it should be processed without waiting for the next frame.
+bool QueueMouse(struct Point position, int buttons);
+bool QueueKey(int key, bool shift);
+
+// Dispatches everything queued, in order, through the index and its root. Returns the number of events dispatched.
+int ProcessInput(struct HitIndex *index);
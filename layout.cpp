@@ -0,0 +1,1039 @@
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "layout.h"
+
+struct LayoutParser {
+  const char *at;
+  const char *end;
+  int line;
+  const char *lineStart;
+
+  struct LayoutError *error;
+  bool failed;
+
+  // Decoded strings are appended here; there is room for them all, since no string decodes to more than its source.
+  char *strings;
+  int stringCount;
+
+  // The arena to build bins in, or NULL when only checking the text. Bins parsed for a container wait on the pending
+  // stack until its slots are all known.
+  struct Arena *arena;
+  int pendingCount;
+  int pendingCapacity;
+  struct Bin **pending;
+
+  // An open addressed set of the cell names of the monitor being checked, to catch one used twice.
+  int nameCount;
+  int nameCapacity;
+  const char **names;
+};
+
+void InitLayout(struct Layout *layout) {
+  AssertNotNull(layout);
+
+  memset(layout, 0, sizeof(*layout));
+}
+
+void ReleaseLayout(struct Layout *layout) {
+  AssertNotNull(layout);
+
+  FreeBytes(layout->text);
+  FreeBytes(layout->strings);
+  FreeBytes(layout->monitors);
+  FreeBytes(layout->rules);
+  InitLayout(layout);
+}
+
+void LayoutFail(struct LayoutParser *parser, const char *format, ...) {
+  if (parser->failed)
+    return;
+  parser->failed = true;
+
+  struct LayoutError *error = parser->error;
+  if (error == NULL)
+    return;
+  error->line = parser->line;
+  error->column = (int)(parser->at - parser->lineStart) + 1;
+  va_list args;
+  va_start(args, format);
+  vsnprintf(error->message, sizeof(error->message), format, args);
+  va_end(args);
+}
+
+void LayoutSkipSpace(struct LayoutParser *parser) {
+  while (parser->at < parser->end) {
+    char c = *parser->at;
+    if (c == '\n') {
+      parser->at++;
+      parser->line++;
+      parser->lineStart = parser->at;
+    } else if (c == ' ' || c == '\t' || c == '\r') {
+      parser->at++;
+    } else if (c == '#') {
+      while (parser->at < parser->end && *parser->at != '\n')
+        parser->at++;
+    } else {
+      break;
+    }
+  }
+}
+
+char LayoutPeek(struct LayoutParser *parser) {
+  LayoutSkipSpace(parser);
+  return parser->at < parser->end ? *parser->at : '\0';
+}
+
+bool LayoutExpect(struct LayoutParser *parser, char c, const char *what) {
+  if (LayoutPeek(parser) != c) {
+    LayoutFail(parser, "expected %s", what);
+    return false;
+  }
+  parser->at++;
+  return true;
+}
+
+bool LayoutMatchWord(struct LayoutParser *parser, const char *word) {
+  size_t length = strlen(word);
+  if ((size_t)(parser->end - parser->at) < length || memcmp(parser->at, word, length) != 0)
+    return false;
+  parser->at += length;
+  return true;
+}
+
+void LayoutAppendUtf8(struct LayoutParser *parser, unsigned int code) {
+  char *out = &parser->strings[parser->stringCount];
+  if (code < 0x80) {
+    out[0] = (char)code;
+    parser->stringCount += 1;
+  } else if (code < 0x800) {
+    out[0] = (char)(0xc0 | code >> 6);
+    out[1] = (char)(0x80 | (code & 0x3f));
+    parser->stringCount += 2;
+  } else {
+    out[0] = (char)(0xe0 | code >> 12);
+    out[1] = (char)(0x80 | (code >> 6 & 0x3f));
+    out[2] = (char)(0x80 | (code & 0x3f));
+    parser->stringCount += 3;
+  }
+}
+
+int LayoutHexDigit(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+bool LayoutParseHex(struct LayoutParser *parser, unsigned int *code) {
+  *code = 0;
+  for (int digit = 0; digit < 4; digit++) {
+    int value = parser->at < parser->end ? LayoutHexDigit(*parser->at) : -1;
+    if (value < 0) {
+      LayoutFail(parser, "a \\u escape needs four hex digits");
+      return false;
+    }
+    *code = *code << 4 | value;
+    parser->at++;
+  }
+  return true;
+}
+
+// Decodes a string into the parser's strings and returns it, or NULL on failure. Every \u escape decodes to no more
+// bytes than its six characters, so the decoded string never outgrows its source.
+const char *LayoutParseString(struct LayoutParser *parser) {
+  if (!LayoutExpect(parser, '"', "a string"))
+    return NULL;
+
+  const char *string = &parser->strings[parser->stringCount];
+  while (parser->at < parser->end && *parser->at != '"') {
+    char c = *parser->at;
+    if (c == '\n' || (unsigned char)c < 0x20) {
+      LayoutFail(parser, "a string runs to the end of the line");
+      return NULL;
+    }
+    parser->at++;
+    if (c != '\\') {
+      parser->strings[parser->stringCount++] = c;
+      continue;
+    }
+
+    c = parser->at < parser->end ? *parser->at++ : '\0';
+    unsigned int code = 0;
+    switch (c) {
+    case '"':
+    case '\\':
+    case '/':
+      parser->strings[parser->stringCount++] = c;
+      break;
+    case 'b':
+      parser->strings[parser->stringCount++] = '\b';
+      break;
+    case 'f':
+      parser->strings[parser->stringCount++] = '\f';
+      break;
+    case 'n':
+      parser->strings[parser->stringCount++] = '\n';
+      break;
+    case 'r':
+      parser->strings[parser->stringCount++] = '\r';
+      break;
+    case 't':
+      parser->strings[parser->stringCount++] = '\t';
+      break;
+    case 'u':
+      if (!LayoutParseHex(parser, &code))
+        return NULL;
+      if (code == 0) {
+        LayoutFail(parser, "a string cannot hold \\u0000");
+        return NULL;
+      }
+      // Characters beyond the basic plane are written as surrogate pairs, which are encoded one half at a time.
+      LayoutAppendUtf8(parser, code);
+      break;
+    default:
+      parser->at--;
+      LayoutFail(parser, "\\%c is not an escape", c);
+      return NULL;
+    }
+  }
+
+  if (parser->at == parser->end) {
+    LayoutFail(parser, "a string has no closing quote");
+    return NULL;
+  }
+  parser->at++;
+  parser->strings[parser->stringCount++] = '\0';
+  return string;
+}
+
+// Reads an object key and its colon. Keys longer than the buffer cannot be any the loader knows, and come back empty.
+bool LayoutParseKey(struct LayoutParser *parser, char *key, int size) {
+  int mark = parser->stringCount;
+  const char *string = LayoutParseString(parser);
+  if (string == NULL)
+    return false;
+  key[0] = '\0';
+  if ((int)strlen(string) < size)
+    strcpy(key, string);
+  parser->stringCount = mark;
+  return LayoutExpect(parser, ':', "a colon after the key");
+}
+
+// Steps through an object whose { has been read: returns true with the next key, or false at the closing } or on a
+// syntax error.
+bool LayoutNextKey(struct LayoutParser *parser, bool *first, char *key, int size) {
+  char c = LayoutPeek(parser);
+  if (c == '}') {
+    parser->at++;
+    return false;
+  }
+  if (!*first && !LayoutExpect(parser, ',', "a comma or }"))
+    return false;
+  *first = false;
+  if (LayoutPeek(parser) != '"') {
+    LayoutFail(parser, "expected a key in quotes");
+    return false;
+  }
+  return LayoutParseKey(parser, key, size);
+}
+
+// Steps through an array whose [ has been read, returning true while there is another element.
+bool LayoutNextElement(struct LayoutParser *parser, bool *first) {
+  char c = LayoutPeek(parser);
+  if (c == ']') {
+    parser->at++;
+    return false;
+  }
+  if (!*first && !LayoutExpect(parser, ',', "a comma or ]"))
+    return false;
+  *first = false;
+  return true;
+}
+
+bool LayoutParseInt(struct LayoutParser *parser, int *value) {
+  LayoutSkipSpace(parser);
+  long long number = 0;
+  const char *start = parser->at;
+  while (parser->at < parser->end && *parser->at >= '0' && *parser->at <= '9' && number < 1000000)
+    number = number * 10 + (*parser->at++ - '0');
+  if (parser->at == start || number >= 1000000) {
+    parser->at = start;
+    LayoutFail(parser, "expected a count");
+    return false;
+  }
+  *value = (int)number;
+  return true;
+}
+
+void LayoutPush(struct LayoutParser *parser, struct Bin *bin) {
+  if (parser->pendingCount == parser->pendingCapacity) {
+    int newCapacity = parser->pendingCapacity ? parser->pendingCapacity * 2 : 64;
+    struct Bin **newPending = AllocateArray(struct Bin *, newCapacity);
+    if (parser->pending != NULL)
+      memcpy(newPending, parser->pending, parser->pendingCount * sizeof(struct Bin *));
+    FreeBytes(parser->pending);
+    parser->pending = newPending;
+    parser->pendingCapacity = newCapacity;
+  }
+  parser->pending[parser->pendingCount++] = bin;
+}
+
+unsigned long long LayoutHash(const char *text, int length) {
+  unsigned long long hash = 14695981039346656037ull;
+  for (int index = 0; index < length; index++)
+    hash = (hash ^ (unsigned char)text[index]) * 1099511628211ull;
+  return hash;
+}
+
+int LayoutNameSlot(const char **names, int capacity, const char *name) {
+  int slot = (int)(LayoutHash(name, (int)strlen(name)) & (capacity - 1));
+  while (names[slot] != NULL && strcmp(names[slot], name) != 0)
+    slot = (slot + 1) & (capacity - 1);
+  return slot;
+}
+
+void LayoutClearNames(struct LayoutParser *parser) {
+  if (parser->names != NULL)
+    memset(parser->names, 0, parser->nameCapacity * sizeof(const char *));
+  parser->nameCount = 0;
+}
+
+// Names are only checked on the first pass over the text; building trusts it.
+bool LayoutAddName(struct LayoutParser *parser, const char *name) {
+  if (parser->arena != NULL)
+    return true;
+
+  if ((parser->nameCount + 1) * 2 > parser->nameCapacity) {
+    int newCapacity = parser->nameCapacity ? parser->nameCapacity * 2 : 64;
+    const char **newNames = AllocateArray(const char *, newCapacity);
+    for (int slot = 0; slot < parser->nameCapacity; slot++)
+      if (parser->names[slot] != NULL)
+        newNames[LayoutNameSlot(newNames, newCapacity, parser->names[slot])] = parser->names[slot];
+    FreeBytes(parser->names);
+    parser->names = newNames;
+    parser->nameCapacity = newCapacity;
+  }
+
+  int slot = LayoutNameSlot(parser->names, parser->nameCapacity, name);
+  if (parser->names[slot] != NULL)
+    return false;
+  parser->names[slot] = name;
+  parser->nameCount++;
+  return true;
+}
+
+// Parses a cell name, reporting a repeated one at its start. Strings never span lines, so stepping back is safe.
+const char *LayoutParseName(struct LayoutParser *parser) {
+  LayoutSkipSpace(parser);
+  const char *start = parser->at;
+  const char *name = LayoutParseString(parser);
+  if (name == NULL)
+    return NULL;
+  if (!LayoutAddName(parser, name)) {
+    parser->failed = false;
+    parser->at = start;
+    LayoutFail(parser, "the cell name \"%s\" is used twice", name);
+    return NULL;
+  }
+  return name;
+}
+
+struct Bin *LayoutNewCell(struct LayoutParser *parser, const char *name) {
+  if (parser->arena == NULL)
+    return NULL;
+  struct Cell *cell = NewCell(parser->arena);
+  cell->name = name;
+  return Wrap(cell, bin);
+}
+
+bool LayoutParseBin(struct LayoutParser *parser, struct Bin **bin, bool allowEmpty);
+
+// Parses a "slots" array, leaving its bins on the pending stack, and returns how many there were or -1. Keys after
+// the slots are left to the container.
+int LayoutParseSlots(struct LayoutParser *parser) {
+  char key[16];
+  bool first = false;
+  if (!LayoutNextKey(parser, &first, key, sizeof(key)) || strcmp(key, "slots") != 0) {
+    LayoutFail(parser, "expected the \"slots\" key");
+    return -1;
+  }
+  if (!LayoutExpect(parser, '[', "a list of slots"))
+    return -1;
+
+  int count = 0;
+  bool firstSlot = true;
+  while (LayoutNextElement(parser, &firstSlot)) {
+    struct Bin *slot = NULL;
+    if (!LayoutParseBin(parser, &slot, true))
+      return -1;
+    if (parser->arena != NULL)
+      LayoutPush(parser, slot);
+    count++;
+  }
+  return parser->failed ? -1 : count;
+}
+
+// Parses a list of count sizes, each a weight or a {"weight", "min", "max"} object, into sizes unless it is NULL.
+bool LayoutParseSizes(struct LayoutParser *parser, struct SlotSize *sizes, int count, const char *what) {
+  if (!LayoutExpect(parser, '[', "a list of sizes"))
+    return false;
+
+  int index = 0;
+  bool first = true;
+  while (LayoutNextElement(parser, &first)) {
+    if (index == count) {
+      LayoutSkipSpace(parser);
+      LayoutFail(parser, "expected only %d sizes, one per %s", count, what);
+      return false;
+    }
+
+    struct SlotSize size = uniformSlotSize;
+    if (LayoutPeek(parser) == '{') {
+      const char *start = parser->at++;
+      char key[16];
+      bool firstKey = true;
+      while (LayoutNextKey(parser, &firstKey, key, sizeof(key))) {
+        int *field = NULL;
+        if (strcmp(key, "weight") == 0)
+          field = &size.weight;
+        else if (strcmp(key, "min") == 0)
+          field = &size.min;
+        else if (strcmp(key, "max") == 0)
+          field = &size.max;
+        if (field == NULL) {
+          LayoutFail(parser, "a size has no \"%s\"", key);
+          return false;
+        }
+        if (!LayoutParseInt(parser, field))
+          return false;
+      }
+      if (parser->failed)
+        return false;
+      if (size.max != 0 && size.max < size.min) {
+        parser->at = start;
+        LayoutFail(parser, "a size's max of %d is less than its min of %d", size.max, size.min);
+        return false;
+      }
+    } else if (!LayoutParseInt(parser, &size.weight)) {
+      return false;
+    }
+
+    if (sizes != NULL)
+      sizes[index] = size;
+    index++;
+  }
+  if (parser->failed)
+    return false;
+  if (index != count) {
+    parser->at--;
+    LayoutFail(parser, "expected %d sizes, one per %s, not %d", count, what, index);
+    return false;
+  }
+  return true;
+}
+
+// Moves the last count pending bins into slots, which a new container has just allocated.
+void LayoutFillSlots(struct LayoutParser *parser, struct Bin *container, struct Bin **slots, int count) {
+  struct Bin **bins = &parser->pending[parser->pendingCount - count];
+  for (int slot = 0; slot < count; slot++) {
+    slots[slot] = bins[slot];
+    if (bins[slot] != NULL)
+      bins[slot]->parent = container;
+  }
+  parser->pendingCount -= count;
+}
+
+bool LayoutParseShelf(struct LayoutParser *parser, struct Bin **bin) {
+  LayoutSkipSpace(parser);
+  const char *start = parser->at;
+  const char *direction = LayoutParseString(parser);
+  if (direction == NULL)
+    return false;
+  bool horizontal = strcmp(direction, "horizontal") == 0;
+  if (!horizontal && strcmp(direction, "vertical") != 0) {
+    parser->at = start;
+    LayoutFail(parser, "a shelf is \"horizontal\" or \"vertical\", not \"%s\"", direction);
+    return false;
+  }
+
+  int count = LayoutParseSlots(parser);
+  if (count < 0)
+    return false;
+  if (count == 0) {
+    LayoutFail(parser, "a shelf needs at least one slot");
+    return false;
+  }
+
+  struct Shelf *shelf = NULL;
+  if (parser->arena != NULL) {
+    enum ShelfDirection shelfDirection = horizontal ? ShelfDirection_Horizontal : ShelfDirection_Vertical;
+    shelf = NewEmptyShelf(parser->arena, shelfDirection, count);
+    LayoutFillSlots(parser, &shelf->bin, shelf->bins, count);
+    *bin = Wrap(shelf, bin);
+  }
+
+  char key[16];
+  bool first = false;
+  bool sized = false;
+  while (LayoutNextKey(parser, &first, key, sizeof(key))) {
+    if (strcmp(key, "sizes") != 0 || sized) {
+      LayoutFail(parser, "a shelf has no %s\"%s\" after its slots", sized ? "second " : "", key);
+      return false;
+    }
+    sized = true;
+    if (!LayoutParseSizes(parser, shelf != NULL ? shelf->track.sizes : NULL, count, "slot"))
+      return false;
+  }
+  return !parser->failed;
+}
+
+// Parses a list of [row, column, rows, columns] spans, marking every cell in each one in taken, and sets them on grid
+// unless it is NULL. Returns how many cells they cover besides their top left ones, or -1.
+int LayoutParseSpans(struct LayoutParser *parser, bool *taken, int rowCount, int columnCount, struct Grid *grid) {
+  if (!LayoutExpect(parser, '[', "a list of spans"))
+    return -1;
+
+  int coveredCount = 0;
+  bool first = true;
+  while (LayoutNextElement(parser, &first)) {
+    LayoutSkipSpace(parser);
+    const char *start = parser->at;
+    int row, column, rowSpan, columnSpan;
+    if (!LayoutExpect(parser, '[', "[row, column, rows, columns]") || !LayoutParseInt(parser, &row) ||
+        !LayoutExpect(parser, ',', "a comma after the row") || !LayoutParseInt(parser, &column) ||
+        !LayoutExpect(parser, ',', "a comma after the column") || !LayoutParseInt(parser, &rowSpan) ||
+        !LayoutExpect(parser, ',', "a comma after the rows") || !LayoutParseInt(parser, &columnSpan) ||
+        !LayoutExpect(parser, ']', "] after the columns"))
+      return -1;
+
+    if (row < 0 || column < 0 || rowSpan < 1 || columnSpan < 1 || row >= rowCount || column >= columnCount ||
+        rowSpan > rowCount - row || columnSpan > columnCount - column) {
+      parser->at = start;
+      LayoutFail(parser, "a span of %d by %d cells from %d, %d runs off the %d by %d grid", rowSpan, columnSpan, row,
+                 column, rowCount, columnCount);
+      return -1;
+    }
+    for (int spanRow = row; spanRow < row + rowSpan; spanRow++) {
+      for (int spanColumn = column; spanColumn < column + columnSpan; spanColumn++) {
+        if (taken[spanRow * columnCount + spanColumn]) {
+          parser->at = start;
+          LayoutFail(parser, "the span from %d, %d overlaps another at %d, %d", row, column, spanRow, spanColumn);
+          return -1;
+        }
+        taken[spanRow * columnCount + spanColumn] = true;
+      }
+    }
+    coveredCount += rowSpan * columnSpan - 1;
+    if (grid != NULL)
+      GridSetSpan(grid, row, column, rowSpan, columnSpan);
+  }
+  return parser->failed ? -1 : coveredCount;
+}
+
+bool LayoutParseGrid(struct LayoutParser *parser, struct Bin **bin) {
+  int rowCount, columnCount;
+  if (!LayoutExpect(parser, '[', "[rows, columns]") || !LayoutParseInt(parser, &rowCount) ||
+      !LayoutExpect(parser, ',', "a comma between rows and columns") || !LayoutParseInt(parser, &columnCount) ||
+      !LayoutExpect(parser, ']', "] after the columns"))
+    return false;
+  if (rowCount < 1 || columnCount < 1 || rowCount > 1000 || columnCount > 1000) {
+    LayoutFail(parser, "a grid has from 1 to 1000 rows and columns");
+    return false;
+  }
+
+  int count = LayoutParseSlots(parser);
+  if (count < 0)
+    return false;
+
+  // The slots wait on the pending stack until the spans say which cells they go to.
+  struct Grid *grid = NULL;
+  if (parser->arena != NULL) {
+    grid = NewEmptyGrid(parser->arena, rowCount, columnCount);
+    *bin = Wrap(grid, bin);
+  }
+
+  bool *taken = NULL;
+  int coveredCount = 0;
+  char key[16];
+  bool first = false;
+  bool rowsSized = false;
+  bool columnsSized = false;
+  bool parsed = true;
+  while (parsed && LayoutNextKey(parser, &first, key, sizeof(key))) {
+    bool rows = strcmp(key, "rows") == 0;
+    bool columns = strcmp(key, "columns") == 0;
+    bool spans = strcmp(key, "spans") == 0;
+    if ((!rows && !columns && !spans) || (rows && rowsSized) || (columns && columnsSized) ||
+        (spans && taken != NULL)) {
+      LayoutFail(parser, "a grid has no %s\"%s\" after its slots", rows || columns || spans ? "second " : "", key);
+      parsed = false;
+    } else if (rows) {
+      rowsSized = true;
+      parsed = LayoutParseSizes(parser, grid != NULL ? grid->rows.sizes : NULL, rowCount, "row");
+    } else if (columns) {
+      columnsSized = true;
+      parsed = LayoutParseSizes(parser, grid != NULL ? grid->columns.sizes : NULL, columnCount, "column");
+    } else {
+      taken = AllocateArray(bool, rowCount * columnCount);
+      memset(taken, 0, rowCount * columnCount * sizeof(bool));
+      coveredCount = LayoutParseSpans(parser, taken, rowCount, columnCount, grid);
+      parsed = coveredCount >= 0;
+    }
+  }
+  if (!parsed || parser->failed) {
+    FreeBytes(taken);
+    return false;
+  }
+
+  int cellCount = rowCount * columnCount - coveredCount;
+  if (count != cellCount) {
+    parser->at--;
+    if (coveredCount == 0)
+      LayoutFail(parser, "a %d by %d grid needs %d slots, not %d", rowCount, columnCount, cellCount, count);
+    else
+      LayoutFail(parser, "a %d by %d grid with %d cells taken in by spans needs %d slots, not %d", rowCount,
+                 columnCount, coveredCount, cellCount, count);
+    FreeBytes(taken);
+    return false;
+  }
+
+  // Each slot goes to the next cell no span covers, in row-major order.
+  if (grid != NULL) {
+    struct Bin **slots = &parser->pending[parser->pendingCount - count];
+    int slot = 0;
+    for (int row = 0; row < rowCount; row++) {
+      for (int column = 0; column < columnCount; column++) {
+        int spanRow = row;
+        int spanColumn = column;
+        if (GridFindSpan(grid, &spanRow, &spanColumn))
+          continue;
+        grid->bins[row * columnCount + column] = slots[slot];
+        if (slots[slot] != NULL)
+          slots[slot]->parent = &grid->bin;
+        slot++;
+      }
+    }
+    parser->pendingCount -= count;
+  }
+  FreeBytes(taken);
+  return true;
+}
+
+bool LayoutParseSwirl(struct LayoutParser *parser, struct Bin **bin) {
+  int tightness;
+  if (!LayoutParseInt(parser, &tightness))
+    return false;
+  if (tightness < 1 || tightness > 1000) {
+    LayoutFail(parser, "a swirl's tightness is from 1 to 1000 pixels, not %d", tightness);
+    return false;
+  }
+
+  int count = LayoutParseSlots(parser);
+  if (count < 0)
+    return false;
+  if (count == 0) {
+    LayoutFail(parser, "a swirl needs at least one slot");
+    return false;
+  }
+
+  if (parser->arena != NULL) {
+    struct Swirl *swirl = NewEmptySwirl(parser->arena, count, tightness);
+    LayoutFillSlots(parser, &swirl->bin, swirl->bins, count);
+    *bin = Wrap(swirl, bin);
+  }
+
+  char key[16];
+  bool first = false;
+  if (LayoutNextKey(parser, &first, key, sizeof(key))) {
+    LayoutFail(parser, "a swirl has no \"%s\" after its slots", key);
+    return false;
+  }
+  return !parser->failed;
+}
+
+bool LayoutParseStack(struct LayoutParser *parser, struct Bin **bin) {
+  LayoutSkipSpace(parser);
+  const char *start = parser->at;
+  const char *style = LayoutParseString(parser);
+  if (style == NULL)
+    return false;
+  bool tabs = strcmp(style, "tabs") == 0;
+  if (!tabs && strcmp(style, "depth") != 0) {
+    parser->at = start;
+    LayoutFail(parser, "a stack is \"tabs\" or \"depth\", not \"%s\"", style);
+    return false;
+  }
+
+  int count = LayoutParseSlots(parser);
+  if (count < 0)
+    return false;
+  if (count == 0) {
+    LayoutFail(parser, "a stack needs at least one slot");
+    return false;
+  }
+
+  struct Stack *stack = NULL;
+  if (parser->arena != NULL) {
+    stack = NewEmptyStack(parser->arena, tabs ? StackStyle_Tabs : StackStyle_Depth, count);
+    LayoutFillSlots(parser, &stack->bin, stack->bins, count);
+    *bin = Wrap(stack, bin);
+  }
+
+  char key[16];
+  bool first = false;
+  bool chosen = false;
+  while (LayoutNextKey(parser, &first, key, sizeof(key))) {
+    if (strcmp(key, "active") != 0 || chosen) {
+      LayoutFail(parser, "a stack has no %s\"%s\" after its slots", chosen ? "second " : "", key);
+      return false;
+    }
+    chosen = true;
+    LayoutSkipSpace(parser);
+    start = parser->at;
+    int active;
+    if (!LayoutParseInt(parser, &active))
+      return false;
+    if (active < 0 || active >= count) {
+      parser->at = start;
+      LayoutFail(parser, "a stack's active slot is from 0 to %d, not %d", count - 1, active);
+      return false;
+    }
+    if (stack != NULL)
+      stack->active = active;
+  }
+  return !parser->failed;
+}
+
+bool LayoutParseCell(struct LayoutParser *parser, struct Bin **bin) {
+  const char *name = NULL;
+  if (!(LayoutPeek(parser) == 'n' && LayoutMatchWord(parser, "null"))) {
+    name = LayoutParseName(parser);
+    if (name == NULL)
+      return false;
+  }
+  *bin = LayoutNewCell(parser, name);
+
+  char key[16];
+  bool first = false;
+  while (LayoutNextKey(parser, &first, key, sizeof(key))) {
+    if (strcmp(key, "bin") != 0) {
+      LayoutFail(parser, "a cell has no \"%s\"", key);
+      return false;
+    }
+    struct Bin *subBin = NULL;
+    if (!LayoutParseBin(parser, &subBin, false))
+      return false;
+    if (*bin != NULL)
+      CellSetSubBin(BinCell(*bin), subBin);
+  }
+  return !parser->failed;
+}
+
+bool LayoutParseBin(struct LayoutParser *parser, struct Bin **bin, bool allowEmpty) {
+  *bin = NULL;
+  char c = LayoutPeek(parser);
+  if (c == 'n' && LayoutMatchWord(parser, "null")) {
+    if (!allowEmpty) {
+      parser->at -= 4;
+      LayoutFail(parser, "only a shelf, grid, swirl or stack slot can be empty");
+      return false;
+    }
+    return true;
+  }
+
+  if (c == '"') {
+    const char *name = LayoutParseName(parser);
+    if (name == NULL)
+      return false;
+    *bin = LayoutNewCell(parser, name);
+    return true;
+  }
+
+  if (c != '{') {
+    LayoutFail(parser, "expected a cell name, a bin or null");
+    return false;
+  }
+  parser->at++;
+
+  char key[16];
+  bool first = true;
+  if (!LayoutNextKey(parser, &first, key, sizeof(key))) {
+    LayoutFail(parser, "expected \"cell\", \"shelf\", \"grid\", \"swirl\" or \"stack\"");
+    return false;
+  }
+  if (strcmp(key, "cell") == 0)
+    return LayoutParseCell(parser, bin);
+  if (strcmp(key, "shelf") == 0)
+    return LayoutParseShelf(parser, bin);
+  if (strcmp(key, "grid") == 0)
+    return LayoutParseGrid(parser, bin);
+  if (strcmp(key, "swirl") == 0)
+    return LayoutParseSwirl(parser, bin);
+  if (strcmp(key, "stack") == 0)
+    return LayoutParseStack(parser, bin);
+  LayoutFail(parser, "a bin starts with \"cell\", \"shelf\", \"grid\", \"swirl\" or \"stack\", not \"%s\"", key);
+  return false;
+}
+
+bool LayoutParseMonitor(struct LayoutParser *parser, struct Layout *layout) {
+  if (!LayoutExpect(parser, '{', "a monitor"))
+    return false;
+
+  struct LayoutMonitor monitor = {};
+  char key[16];
+  bool first = true;
+  while (LayoutNextKey(parser, &first, key, sizeof(key))) {
+    if (strcmp(key, "monitor") == 0) {
+      monitor.device = LayoutParseString(parser);
+      if (monitor.device == NULL)
+        return false;
+      for (int index = 0; index < layout->monitorCount; index++)
+        if (strcmp(layout->monitors[index].device, monitor.device) == 0) {
+          LayoutFail(parser, "monitor \"%s\" is laid out twice", monitor.device);
+          return false;
+        }
+    } else if (strcmp(key, "layout") == 0) {
+      LayoutSkipSpace(parser);
+      monitor.source = parser->at;
+      monitor.line = parser->line;
+      monitor.column = (int)(parser->at - parser->lineStart) + 1;
+
+      LayoutClearNames(parser);
+      struct Bin *root = NULL;
+      if (!LayoutParseBin(parser, &root, false))
+        return false;
+      monitor.sourceLength = (int)(parser->at - monitor.source);
+      monitor.hash = LayoutHash(monitor.source, monitor.sourceLength);
+    } else {
+      LayoutFail(parser, "a monitor has no \"%s\"", key);
+      return false;
+    }
+  }
+  if (parser->failed)
+    return false;
+  if (monitor.device == NULL || monitor.source == NULL) {
+    parser->at--;
+    LayoutFail(parser, "a monitor needs both \"monitor\" and \"layout\"");
+    return false;
+  }
+
+  if (layout->monitorCount == layout->monitorCapacity) {
+    int newCapacity = layout->monitorCapacity ? layout->monitorCapacity * 2 : 16;
+    struct LayoutMonitor *newMonitors = AllocateArray(struct LayoutMonitor, newCapacity);
+    if (layout->monitors != NULL)
+      memcpy(newMonitors, layout->monitors, layout->monitorCount * sizeof(struct LayoutMonitor));
+    FreeBytes(layout->monitors);
+    layout->monitors = newMonitors;
+    layout->monitorCapacity = newCapacity;
+  }
+  layout->monitors[layout->monitorCount++] = monitor;
+  return true;
+}
+
+bool LayoutParseRule(struct LayoutParser *parser, struct Layout *layout) {
+  if (!LayoutExpect(parser, '{', "a rule"))
+    return false;
+
+  const char *fieldNames[RuleField_Count] = {
+      "class",
+      "title",
+      "process",
+  };
+  struct LayoutRule rule = {};
+  char key[16];
+  bool first = true;
+  while (LayoutNextKey(parser, &first, key, sizeof(key))) {
+    if (strcmp(key, "cell") == 0) {
+      rule.cell = LayoutParseString(parser);
+      if (rule.cell == NULL)
+        return false;
+      continue;
+    }
+
+    int field = 0;
+    while (field < RuleField_Count && strcmp(key, fieldNames[field]) != 0)
+      field++;
+    if (field == RuleField_Count) {
+      LayoutFail(parser, "a rule has no \"%s\"", key);
+      return false;
+    }
+
+    // The pattern is compiled here only to report a bad one at its place in the file.
+    LayoutSkipSpace(parser);
+    const char *patternAt = parser->at;
+    const char *pattern = LayoutParseString(parser);
+    if (pattern == NULL)
+      return false;
+    struct PatternSet check;
+    InitPatternSet(&check);
+    char patternError[128];
+    bool compiled = AddPattern(&check, pattern, patternError, sizeof(patternError)) >= 0;
+    ReleasePatternSet(&check);
+    if (!compiled) {
+      parser->at = patternAt;
+      LayoutFail(parser, "%s", patternError);
+      return false;
+    }
+    rule.patterns[field] = pattern;
+  }
+  if (parser->failed)
+    return false;
+  if (rule.cell == NULL) {
+    parser->at--;
+    LayoutFail(parser, "a rule needs a \"cell\"");
+    return false;
+  }
+
+  if (layout->ruleCount == layout->ruleCapacity) {
+    int newCapacity = layout->ruleCapacity ? layout->ruleCapacity * 2 : 64;
+    struct LayoutRule *newRules = AllocateArray(struct LayoutRule, newCapacity);
+    if (layout->rules != NULL)
+      memcpy(newRules, layout->rules, layout->ruleCount * sizeof(struct LayoutRule));
+    FreeBytes(layout->rules);
+    layout->rules = newRules;
+    layout->ruleCapacity = newCapacity;
+  }
+  layout->rules[layout->ruleCount++] = rule;
+  return true;
+}
+
+bool LayoutParseFile(struct LayoutParser *parser, struct Layout *layout) {
+  if (!LayoutExpect(parser, '{', "{ at the start of the layout"))
+    return false;
+
+  char key[16];
+  bool first = true;
+  while (LayoutNextKey(parser, &first, key, sizeof(key))) {
+    bool monitors = strcmp(key, "monitors") == 0;
+    if (!monitors && strcmp(key, "rules") != 0) {
+      LayoutFail(parser, "a layout has no \"%s\"", key);
+      return false;
+    }
+    if (!LayoutExpect(parser, '[', monitors ? "a list of monitors" : "a list of rules"))
+      return false;
+
+    bool firstElement = true;
+    while (LayoutNextElement(parser, &firstElement))
+      if (!(monitors ? LayoutParseMonitor(parser, layout) : LayoutParseRule(parser, layout)))
+        return false;
+    if (parser->failed)
+      return false;
+  }
+  if (parser->failed)
+    return false;
+
+  if (LayoutPeek(parser) != '\0') {
+    LayoutFail(parser, "expected the end of the layout");
+    return false;
+  }
+  return true;
+}
+
+bool ParseLayout(struct Layout *layout, const char *text, size_t size, struct LayoutError *error) {
+  AssertNotNull(layout);
+  AssertNotNull(text);
+
+  struct LayoutError ignored;
+  if (error == NULL)
+    error = &ignored;
+  memset(error, 0, sizeof(*error));
+
+  struct Layout next;
+  InitLayout(&next);
+  next.text = AllocateArray(char, size + 1);
+  memcpy(next.text, text, size);
+  next.strings = AllocateArray(char, size + 1);
+
+  struct LayoutParser parser = {};
+  parser.at = next.text;
+  parser.end = next.text + size;
+  parser.line = 1;
+  parser.lineStart = next.text;
+  parser.error = error;
+  parser.strings = next.strings;
+
+  bool parsed = LayoutParseFile(&parser, &next);
+  FreeBytes(parser.names);
+  if (!parsed) {
+    ReleaseLayout(&next);
+    return false;
+  }
+
+  ReleaseLayout(layout);
+  *layout = next;
+  return true;
+}
+
+bool ReadLayoutFile(struct Layout *layout, const char *path, struct LayoutError *error) {
+  AssertNotNull(path);
+
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    if (error != NULL) {
+      memset(error, 0, sizeof(*error));
+      snprintf(error->message, sizeof(error->message), "%s could not be opened", path);
+    }
+    return false;
+  }
+
+  int capacity = 4096;
+  int size = 0;
+  char *text = AllocateArray(char, capacity);
+  for (;;) {
+    size += (int)fread(text + size, 1, capacity - size, file);
+    if (size < capacity)
+      break;
+    char *newText = AllocateArray(char, capacity * 2);
+    memcpy(newText, text, size);
+    FreeBytes(text);
+    text = newText;
+    capacity *= 2;
+  }
+  fclose(file);
+
+  bool parsed = ParseLayout(layout, text, size, error);
+  FreeBytes(text);
+  return parsed;
+}
+
+struct LayoutMonitor *FindLayoutMonitor(struct Layout *layout, const char *device) {
+  AssertNotNull(layout);
+  AssertNotNull(device);
+
+  struct LayoutMonitor *fallback = NULL;
+  for (int index = 0; index < layout->monitorCount; index++) {
+    struct LayoutMonitor *monitor = &layout->monitors[index];
+    if (strcmp(monitor->device, device) == 0)
+      return monitor;
+    if (strcmp(monitor->device, "*") == 0)
+      fallback = monitor;
+  }
+  return fallback;
+}
+
+struct Bin *BuildLayoutTree(struct LayoutMonitor *monitor, struct Arena *arena, char **names) {
+  AssertNotNull(monitor);
+  AssertNotNull(arena);
+  AssertNotNull(names);
+
+  struct LayoutParser parser = {};
+  parser.at = monitor->source;
+  parser.end = monitor->source + monitor->sourceLength;
+  parser.line = monitor->line;
+  parser.lineStart = monitor->source - (monitor->column - 1);
+  parser.strings = AllocateArray(char, monitor->sourceLength + 1);
+  parser.arena = arena;
+
+  struct Bin *root = NULL;
+  bool parsed = LayoutParseBin(&parser, &root, false);
+  AssertMessage(parsed, ("The layout of monitor %s no longer parses", monitor->device));
+
+  FreeBytes(parser.pending);
+  FreeBytes(parser.names);
+  *names = parser.strings;
+  return root;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "bin.h"
+#include "rules.h"
+
+// A text layout file: the portable defaults for each monitor's tree, and the placement rules. The file is JSON, with
+// # comments allowed between values:
+//
+//   {
+//     "monitors": [
+//       {"monitor": "DISPLAY1", "layout": {"shelf": "horizontal", "slots": ["left", "right"], "sizes": [2, 1]}},
+//       {"monitor": "*", "layout": {"grid": [2, 2], "slots": ["a", "b", null, {"cell": "d", "bin": "e"}]}}
+//     ],
+//     "rules": [
+//       {"cell": "right", "process": "(?i)^notepad\\.exe$"}
+//     ]
+//   }
+//
+// A bin is a cell name, a {"cell": name} object that may hold a sub bin under "bin", or a shelf, grid, swirl or stack
+// object whose "slots" lists its bins in row-major order, with null for an empty slot. A swirl's kind key gives its
+// tightness in pixels, and its slots go from the top of the spiral down. A stack's is "tabs" or "depth", and it may
+// say which slot shows under "active" after its slots, the first if not. The key naming the kind of bin comes first.
+// After the slots, a shelf may size them under "sizes", and a grid its "rows" and "columns", each a list with a weight
+// or a {"weight": 2, "min": 200, "max": 800} object per slot, where a field left out means weight 1 or no limit. A grid
+// may also list "spans" as [row, column, rows, columns], each making one cell take in the others in that rectangle;
+// its slots then skip the cells taken in.
+// Monitor "*" applies to monitors with no entry of their own. Rules take a pattern for the window "class", "title" or
+// "process", as described in patterns.h.
+//
+// Parsing reads the text once, front to back, without building a document: it checks the whole file, compiles the
+// rule patterns, and keeps each monitor's layout as a span of the text. A monitor's tree is built from its span only
+// when asked for, and each span is hashed so a reload can tell which monitors it leaves unchanged.
+
+struct LayoutError {
+  int line;
+  int column;
+  char message[160];
+};
+
+struct LayoutMonitor {
+  const char *device;
+
+  // The text of the monitor's layout, where it starts in the file, and a hash that changes when the text does.
+  const char *source;
+  int sourceLength;
+  int line;
+  int column;
+  unsigned long long hash;
+};
+
+struct LayoutRule {
+  const char *cell;
+  // NULL for fields the rule does not look at.
+  const char *patterns[RuleField_Count];
+};
+
+struct Layout {
+  // The file's text, and its strings decoded.
+  char *text;
+  char *strings;
+
+  int monitorCount;
+  int monitorCapacity;
+  struct LayoutMonitor *monitors;
+
+  int ruleCount;
+  int ruleCapacity;
+  struct LayoutRule *rules;
+};
+
+void InitLayout(struct Layout *layout);
+void ReleaseLayout(struct Layout *layout);
+
+// Replaces layout with the one described by text. If text is not a valid layout, layout is left as it was and error
+// says where and why, so a reload is all or nothing.
+bool ParseLayout(struct Layout *layout, const char *text, size_t size, struct LayoutError *error);
+bool ReadLayoutFile(struct Layout *layout, const char *path, struct LayoutError *error);
+
+// Returns the entry for the monitor with this device name, the "*" entry if it has none, or NULL.
+struct LayoutMonitor *FindLayoutMonitor(struct Layout *layout, const char *device);
+
+// Builds the monitor's tree in arena and returns its root. The cell names are kept in *names, which the caller frees
+// with FreeBytes once the tree is gone.
+struct Bin *BuildLayoutTree(struct LayoutMonitor *monitor, struct Arena *arena, char **names);
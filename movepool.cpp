@@ -0,0 +1,578 @@
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "handles.h"
+#include "movepool.h"
+
+// Where each window should go, found by handle in a handle table (handles.h). A window has a slot only while it has a
+// move pending, in flight or stuck, so a destroyed window's handle, reused by a new window, does not hand it the old
+// one's state.
+struct MoveSlot {
+  WindowHandle hWnd;
+  struct Bounds bounds;
+  bool pending;
+  // A move of the window is in flight and has not been given up on.
+  bool moving;
+  // The window was in a batch that timed out, so it is moved on its own until a move of it finishes.
+  bool alone;
+  bool unresponsive;
+  // Batches and stackings holding the window that timed out and have not finished yet.
+  int stuckJobs;
+};
+
+struct MoveWorker {
+  bool alive;
+  unsigned int generation;
+
+  // The work being done, and whether it has run past the timeout. A batch or stacking that timed out has let its
+  // windows go, since it cannot tell which of them hung.
+  bool busy;
+  bool stuck;
+  bool released;
+  double started;
+
+  // A batch of moves, or a single move of a window moved alone, or a stacking when stackings is not NULL.
+  bool single;
+  int count;
+  struct WindowPlacement placements[MOVE_BATCH_LIMIT];
+  struct WindowStacking *stackings;
+};
+
+// A copy of the stackings passed to QueueWindowStackings, freed by the worker that makes them.
+struct MoveStacking {
+  struct WindowStacking *stackings;
+  int count;
+};
+
+// Everything below the lock is shared with the workers. Only the overlay thread allocates: the ready ring is as large
+// as the slot table, since it holds each window at most once, the stacking ring grows as it is queued to, and
+// completions are a fixed ring.
+struct MovePool {
+  std::mutex lock;
+  std::condition_variable workReady;
+  std::condition_variable workerExited;
+
+  bool running;
+  unsigned int generation;
+  double timeout;
+  void (*placeWindowFn)(WindowHandle hWnd, struct Bounds bounds);
+  void (*placeWindowsFn)(const struct WindowPlacement *placements, int count);
+  void (*stackWindowsFn)(const struct WindowStacking *stackings, int count);
+  void (*notifyFn)();
+
+  int targetWorkers;
+  int liveWorkers;
+  struct MoveWorker workers[MOVE_WORKER_LIMIT];
+
+  // MoveSlot entries.
+  struct HandleTable slots;
+
+  // Windows with a pending move and none in flight, oldest first.
+  int readyHead;
+  int readyCount;
+  WindowHandle *ready;
+
+  // Stackings not started yet, oldest first, and whether one is being made.
+  int stackingHead;
+  int stackingCount;
+  int stackingCapacity;
+  struct MoveStacking *stackingQueue;
+  bool stackingRunning;
+
+  int completionHead;
+  int completionCount;
+  struct MoveCompletion completions[MOVE_COMPLETION_LIMIT];
+
+  // Windows with a move pending, in flight or stuck.
+  int outstanding;
+
+  struct MoveStats stats;
+};
+
+struct MovePool movePool;
+
+double MoveClock() {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct MoveSlot *FindMoveSlot(WindowHandle hWnd) {
+  return (struct MoveSlot *)FindHandleEntry(&movePool.slots, hWnd);
+}
+
+struct MoveSlot *AddMoveSlot(WindowHandle hWnd) {
+  struct MoveSlot *slot = FindMoveSlot(hWnd);
+  if (slot != NULL)
+    return slot;
+
+  // The ready ring grows with the table, keeping its order.
+  int oldCapacity = movePool.slots.capacity;
+  slot = (struct MoveSlot *)AddHandleEntry(&movePool.slots, hWnd);
+  if (movePool.slots.capacity != oldCapacity) {
+    WindowHandle *newReady = AllocateArray(WindowHandle, movePool.slots.capacity);
+    for (int entry = 0; entry < movePool.readyCount; entry++)
+      newReady[entry] = movePool.ready[(movePool.readyHead + entry) % oldCapacity];
+    FreeBytes(movePool.ready);
+    movePool.ready = newReady;
+    movePool.readyHead = 0;
+  }
+  return slot;
+}
+
+bool MoveSlotOutstanding(struct MoveSlot *slot) {
+  return slot->pending || slot->moving || slot->stuckJobs > 0;
+}
+
+// Keeps the count of outstanding windows up to date after a slot changed from outstanding or not, and removes the slot
+// once it has nothing outstanding. That moves other slots, so the caller must not use any slot pointer afterwards.
+void CountMoveSlot(struct MoveSlot *slot, bool wasOutstanding) {
+  bool outstanding = MoveSlotOutstanding(slot);
+  movePool.outstanding += (int)outstanding - (int)wasOutstanding;
+  if (!outstanding)
+    RemoveHandleIndex(&movePool.slots, FindHandleIndex(&movePool.slots, slot->hWnd));
+}
+
+void PushReadyMove(WindowHandle hWnd) {
+  movePool.ready[(movePool.readyHead + movePool.readyCount) % movePool.slots.capacity] = hWnd;
+  movePool.readyCount++;
+}
+
+WindowHandle PopReadyMove() {
+  WindowHandle hWnd = movePool.ready[movePool.readyHead];
+  movePool.readyHead = (movePool.readyHead + 1) % movePool.slots.capacity;
+  movePool.readyCount--;
+  return hWnd;
+}
+
+// Returns true if the queue was empty before.
+bool PushMoveCompletion(WindowHandle hWnd, struct Bounds bounds, enum MoveResult result, double seconds) {
+  if (movePool.completionCount == MOVE_COMPLETION_LIMIT) {
+    movePool.completionHead = (movePool.completionHead + 1) % MOVE_COMPLETION_LIMIT;
+    movePool.completionCount--;
+    movePool.stats.droppedCompletions++;
+  }
+
+  struct MoveCompletion *completion =
+      &movePool.completions[(movePool.completionHead + movePool.completionCount) % MOVE_COMPLETION_LIMIT];
+  completion->hWnd = hWnd;
+  completion->bounds = bounds;
+  completion->result = result;
+  completion->seconds = seconds;
+  return movePool.completionCount++ == 0;
+}
+
+void GrowMoveStackings() {
+  int newCapacity = movePool.stackingCapacity ? movePool.stackingCapacity * 2 : 16;
+  struct MoveStacking *newQueue = AllocateArray(struct MoveStacking, newCapacity);
+  for (int entry = 0; entry < movePool.stackingCount; entry++)
+    newQueue[entry] = movePool.stackingQueue[(movePool.stackingHead + entry) % movePool.stackingCapacity];
+
+  FreeBytes(movePool.stackingQueue);
+  movePool.stackingQueue = newQueue;
+  movePool.stackingHead = 0;
+  movePool.stackingCapacity = newCapacity;
+}
+
+// The oldest stacking can start once no other is being made and its windows have no moves left to make, so a window
+// is not moved over a stacking queued after the move. Unresponsive windows are left out of it, so they do not count.
+bool MoveStackingReady() {
+  if (movePool.stackingRunning || movePool.stackingCount == 0)
+    return false;
+
+  struct MoveStacking *next = &movePool.stackingQueue[movePool.stackingHead];
+  for (int index = 0; index < next->count; index++) {
+    struct MoveSlot *slot = FindMoveSlot(next->stackings[index].hWnd);
+    if (slot != NULL && !slot->unresponsive && (slot->pending || slot->moving))
+      return false;
+  }
+  return true;
+}
+
+void TakeMoveStacking(struct MoveWorker *worker) {
+  struct MoveStacking next = movePool.stackingQueue[movePool.stackingHead];
+  movePool.stackingHead = (movePool.stackingHead + 1) % movePool.stackingCapacity;
+  movePool.stackingCount--;
+
+  int kept = 0;
+  for (int index = 0; index < next.count; index++) {
+    struct MoveSlot *slot = FindMoveSlot(next.stackings[index].hWnd);
+    if (slot == NULL || !slot->unresponsive)
+      next.stackings[kept++] = next.stackings[index];
+  }
+  if (kept == 0) {
+    FreeBytes(next.stackings);
+    return;
+  }
+
+  worker->stackings = next.stackings;
+  worker->count = kept;
+  movePool.stackingRunning = true;
+  movePool.stats.stackings++;
+}
+
+// Takes the ready windows that can be batched, up to a batch, or else a single one that is moved alone.
+void TakeMoveBatch(struct MoveWorker *worker) {
+  for (int scan = movePool.readyCount; scan > 0 && worker->count < MOVE_BATCH_LIMIT; scan--) {
+    WindowHandle hWnd = PopReadyMove();
+    struct MoveSlot *slot = FindMoveSlot(hWnd);
+    bool alone = slot->alone || slot->unresponsive;
+    if (alone && worker->count > 0) {
+      PushReadyMove(hWnd);
+      continue;
+    }
+
+    slot->pending = false;
+    slot->moving = true;
+    worker->placements[worker->count].hWnd = hWnd;
+    worker->placements[worker->count].bounds = slot->bounds;
+    worker->count++;
+    if (alone) {
+      worker->single = true;
+      break;
+    }
+  }
+
+  if (worker->single)
+    movePool.stats.singles++;
+  else
+    movePool.stats.batches++;
+}
+
+// Returns true if the overlay thread should be told about the completions queued.
+bool FinishMoveWork(struct MoveWorker *worker, double seconds) {
+  bool notify = false;
+  if (worker->stackings != NULL) {
+    if (!worker->released)
+      movePool.stackingRunning = false;
+    for (int index = 0; index < worker->count && worker->released; index++) {
+      struct MoveSlot *slot = FindMoveSlot(worker->stackings[index].hWnd);
+      bool wasOutstanding = MoveSlotOutstanding(slot);
+      slot->stuckJobs--;
+      if (slot->unresponsive && slot->stuckJobs == 0) {
+        slot->unresponsive = false;
+        movePool.stats.recovered++;
+        notify |= PushMoveCompletion(slot->hWnd, {}, MoveResult_Recovered, seconds);
+      }
+      CountMoveSlot(slot, wasOutstanding);
+    }
+    FreeBytes(worker->stackings);
+    worker->stackings = NULL;
+    return notify;
+  }
+
+  for (int index = 0; index < worker->count; index++) {
+    struct WindowPlacement *placement = &worker->placements[index];
+    struct MoveSlot *slot = FindMoveSlot(placement->hWnd);
+    bool wasOutstanding = MoveSlotOutstanding(slot);
+    if (!worker->released) {
+      slot->moving = false;
+      slot->alone = false;
+      if (slot->pending)
+        PushReadyMove(slot->hWnd);
+    } else {
+      slot->stuckJobs--;
+      // The window was moved again while the batch was stuck, and the batch may have put it back.
+      if (!SameBounds(slot->bounds, placement->bounds) && !slot->pending && !slot->moving) {
+        slot->pending = true;
+        PushReadyMove(slot->hWnd);
+      }
+    }
+
+    enum MoveResult result = MoveResult_Done;
+    if (slot->unresponsive && !worker->released) {
+      slot->unresponsive = false;
+      result = MoveResult_Recovered;
+      movePool.stats.recovered++;
+    }
+    movePool.stats.completed++;
+    CountMoveSlot(slot, wasOutstanding);
+    notify |= PushMoveCompletion(placement->hWnd, placement->bounds, result, seconds);
+  }
+  return notify;
+}
+
+void MoveWorkerLoop(int index, unsigned int generation) {
+  std::unique_lock<std::mutex> hold(movePool.lock);
+  struct MoveWorker *worker = &movePool.workers[index];
+  bool counted = true;
+
+  for (;;) {
+    bool stacking = false;
+    while (movePool.generation == generation && movePool.running && movePool.readyCount == 0 &&
+           !(stacking = MoveStackingReady()))
+      movePool.workReady.wait(hold);
+    if (movePool.generation != generation || !movePool.running)
+      break;
+
+    worker->single = false;
+    worker->released = false;
+    worker->count = 0;
+    if (stacking || MoveStackingReady())
+      TakeMoveStacking(worker);
+    else
+      TakeMoveBatch(worker);
+    if (worker->count == 0)
+      continue;
+    worker->busy = true;
+    worker->started = MoveClock();
+
+    void (*placeWindowFn)(WindowHandle hWnd, struct Bounds bounds) = movePool.placeWindowFn;
+    void (*placeWindowsFn)(const struct WindowPlacement *placements, int count) = movePool.placeWindowsFn;
+    void (*stackWindowsFn)(const struct WindowStacking *stackings, int count) = movePool.stackWindowsFn;
+    hold.unlock();
+    if (worker->stackings != NULL)
+      stackWindowsFn(worker->stackings, worker->count);
+    else if (!worker->single && placeWindowsFn != NULL)
+      placeWindowsFn(worker->placements, worker->count);
+    else
+      for (int move = 0; move < worker->count; move++)
+        placeWindowFn(worker->placements[move].hWnd, worker->placements[move].bounds);
+    hold.lock();
+
+    // The pool was stopped while this work was stuck, and its tables are gone.
+    if (movePool.generation != generation) {
+      FreeBytes(worker->stackings);
+      worker->stackings = NULL;
+      break;
+    }
+
+    worker->busy = false;
+    if (FinishMoveWork(worker, MoveClock() - worker->started) && movePool.notifyFn)
+      movePool.notifyFn();
+    // Finishing can queue moves again and let a stacking start, which this worker may not be the one to take.
+    if (movePool.readyCount > 0 || MoveStackingReady())
+      movePool.workReady.notify_all();
+
+    // A worker that was replaced while it was stuck leaves, unless the pool is short of workers again.
+    if (worker->stuck) {
+      worker->stuck = false;
+      if (movePool.liveWorkers >= movePool.targetWorkers) {
+        counted = false;
+        break;
+      }
+      movePool.liveWorkers++;
+    }
+  }
+
+  if (movePool.generation == generation && counted)
+    movePool.liveWorkers--;
+  worker->alive = false;
+  movePool.workerExited.notify_all();
+}
+
+// Takes the first worker slot not held by a live thread, including ones abandoned by an earlier generation.
+void StartMoveWorker() {
+  for (int index = 0; index < MOVE_WORKER_LIMIT; index++) {
+    struct MoveWorker *worker = &movePool.workers[index];
+    if (worker->alive)
+      continue;
+
+    memset(worker, 0, sizeof(*worker));
+    worker->alive = true;
+    worker->generation = movePool.generation;
+    movePool.liveWorkers++;
+    movePool.stats.workersStarted++;
+    std::thread(MoveWorkerLoop, index, movePool.generation).detach();
+    return;
+  }
+}
+
+void StartMoveWorkers(int workerCount, double timeoutSeconds, const struct Backend *windows, void (*notifyFn)()) {
+  AssertNotNull(windows);
+  AssertNotNull(windows->placeWindowFn);
+
+  std::lock_guard<std::mutex> hold(movePool.lock);
+  AssertMessage(!movePool.running, ("The move workers are already running"));
+
+  movePool.running = true;
+  movePool.generation++;
+  movePool.timeout = timeoutSeconds;
+  movePool.placeWindowFn = windows->placeWindowFn;
+  movePool.placeWindowsFn = windows->placeWindowsFn;
+  movePool.stackWindowsFn = windows->stackWindowsFn;
+  movePool.notifyFn = notifyFn;
+  InitHandleTable(&movePool.slots, sizeof(struct MoveSlot), 256);
+  movePool.targetWorkers = workerCount < MOVE_WORKER_LIMIT ? workerCount : MOVE_WORKER_LIMIT;
+  movePool.liveWorkers = 0;
+  memset(&movePool.stats, 0, sizeof(movePool.stats));
+  for (int worker = 0; worker < movePool.targetWorkers; worker++)
+    StartMoveWorker();
+}
+
+void StopMoveWorkers() {
+  std::unique_lock<std::mutex> hold(movePool.lock);
+  if (!movePool.running)
+    return;
+
+  movePool.running = false;
+  movePool.readyCount = 0;
+  movePool.workReady.notify_all();
+
+  std::chrono::duration<double> timeout(movePool.timeout);
+  movePool.workerExited.wait_for(hold, timeout, [] {
+    for (int index = 0; index < MOVE_WORKER_LIMIT; index++)
+      if (movePool.workers[index].alive && movePool.workers[index].generation == movePool.generation)
+        return false;
+    return true;
+  });
+
+  movePool.generation++;
+  for (int entry = 0; entry < movePool.stackingCount; entry++)
+    FreeBytes(movePool.stackingQueue[(movePool.stackingHead + entry) % movePool.stackingCapacity].stackings);
+  ReleaseHandleTable(&movePool.slots);
+  FreeBytes(movePool.ready);
+  FreeBytes(movePool.stackingQueue);
+  movePool.ready = NULL;
+  movePool.stackingQueue = NULL;
+  movePool.readyHead = 0;
+  movePool.stackingHead = 0;
+  movePool.stackingCount = 0;
+  movePool.stackingCapacity = 0;
+  movePool.stackingRunning = false;
+  movePool.completionHead = 0;
+  movePool.completionCount = 0;
+  movePool.outstanding = 0;
+  movePool.liveWorkers = 0;
+}
+
+void QueueWindowMoves(const struct WindowPlacement *placements, int count) {
+  std::lock_guard<std::mutex> hold(movePool.lock);
+  AssertMessage(movePool.running, ("Window moves were queued with no move workers running"));
+
+  for (int index = 0; index < count; index++) {
+    struct MoveSlot *slot = AddMoveSlot(placements[index].hWnd);
+    slot->bounds = placements[index].bounds;
+    movePool.stats.queued++;
+
+    if (slot->pending) {
+      movePool.stats.coalesced++;
+      continue;
+    }
+
+    bool wasOutstanding = MoveSlotOutstanding(slot);
+    slot->pending = true;
+    if (!slot->moving)
+      PushReadyMove(slot->hWnd);
+    CountMoveSlot(slot, wasOutstanding);
+  }
+
+  movePool.workReady.notify_all();
+}
+
+void QueueWindowMove(WindowHandle hWnd, struct Bounds bounds) {
+  struct WindowPlacement placement = {hWnd, bounds};
+  QueueWindowMoves(&placement, 1);
+}
+
+void QueueWindowStackings(const struct WindowStacking *stackings, int count) {
+  std::lock_guard<std::mutex> hold(movePool.lock);
+  AssertMessage(movePool.running, ("Window stackings were queued with no move workers running"));
+
+  if (count == 0 || movePool.stackWindowsFn == NULL)
+    return;
+
+  if (movePool.stackingCount == movePool.stackingCapacity)
+    GrowMoveStackings();
+  struct MoveStacking *stacking =
+      &movePool.stackingQueue[(movePool.stackingHead + movePool.stackingCount) % movePool.stackingCapacity];
+  stacking->stackings = AllocateArray(struct WindowStacking, count);
+  memcpy(stacking->stackings, stackings, count * sizeof(struct WindowStacking));
+  stacking->count = count;
+  movePool.stackingCount++;
+
+  movePool.workReady.notify_all();
+}
+
+// A stacking that timed out lets the next one start. Its windows are marked unresponsive, and so left out of later
+// stackings, until it finishes.
+void ReleaseMoveStacking(struct MoveWorker *worker, double seconds) {
+  worker->released = true;
+  movePool.stackingRunning = false;
+  for (int index = 0; index < worker->count; index++) {
+    struct MoveSlot *slot = AddMoveSlot(worker->stackings[index].hWnd);
+    bool wasOutstanding = MoveSlotOutstanding(slot);
+    slot->unresponsive = true;
+    slot->stuckJobs++;
+    CountMoveSlot(slot, wasOutstanding);
+    movePool.stats.timedOut++;
+    PushMoveCompletion(worker->stackings[index].hWnd, {}, MoveResult_TimedOut, seconds);
+  }
+}
+
+// Which window of a batch that timed out hung is not known, so each of them is queued to be moved again on its own,
+// and the ones that time out then are marked unresponsive.
+void ReleaseMoveBatch(struct MoveWorker *worker) {
+  worker->released = true;
+  movePool.stats.splitBatches++;
+  for (int index = 0; index < worker->count; index++) {
+    struct MoveSlot *slot = FindMoveSlot(worker->placements[index].hWnd);
+    slot->moving = false;
+    slot->pending = true;
+    slot->alone = true;
+    slot->stuckJobs++;
+    PushReadyMove(slot->hWnd);
+  }
+}
+
+void CheckMoveTimeouts() {
+  std::lock_guard<std::mutex> hold(movePool.lock);
+  if (!movePool.running)
+    return;
+
+  double now = MoveClock();
+  for (int index = 0; index < MOVE_WORKER_LIMIT; index++) {
+    struct MoveWorker *worker = &movePool.workers[index];
+    if (!worker->alive || worker->generation != movePool.generation || !worker->busy || worker->stuck)
+      continue;
+    if (now - worker->started <= movePool.timeout)
+      continue;
+
+    worker->stuck = true;
+    movePool.liveWorkers--;
+    if (worker->stackings != NULL) {
+      ReleaseMoveStacking(worker, now - worker->started);
+    } else if (worker->count > 1) {
+      ReleaseMoveBatch(worker);
+    } else {
+      // A window moved alone is the one that hung, so it keeps its move in flight.
+      struct MoveSlot *slot = FindMoveSlot(worker->placements[0].hWnd);
+      slot->unresponsive = true;
+      movePool.stats.timedOut++;
+      PushMoveCompletion(slot->hWnd, slot->bounds, MoveResult_TimedOut, now - worker->started);
+    }
+    movePool.workReady.notify_all();
+
+    if (movePool.liveWorkers < movePool.targetWorkers)
+      StartMoveWorker();
+  }
+}
+
+int TakeMoveCompletions(struct MoveCompletion *completions, int limit) {
+  std::lock_guard<std::mutex> hold(movePool.lock);
+
+  int count = movePool.completionCount < limit ? movePool.completionCount : limit;
+  for (int index = 0; index < count; index++)
+    completions[index] = movePool.completions[(movePool.completionHead + index) % MOVE_COMPLETION_LIMIT];
+  movePool.completionHead = (movePool.completionHead + count) % MOVE_COMPLETION_LIMIT;
+  movePool.completionCount -= count;
+  return count;
+}
+
+int PendingMoves() {
+  std::lock_guard<std::mutex> hold(movePool.lock);
+  return movePool.outstanding + movePool.stackingCount + movePool.stackingRunning;
+}
+
+bool WindowUnresponsive(WindowHandle hWnd) {
+  std::lock_guard<std::mutex> hold(movePool.lock);
+  struct MoveSlot *slot = FindMoveSlot(hWnd);
+  return slot != NULL && slot->unresponsive;
+}
+
+struct MoveStats GetMoveStats() {
+  std::lock_guard<std::mutex> hold(movePool.lock);
+  struct MoveStats stats = movePool.stats;
+  stats.slots = movePool.slots.count;
+  return stats;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "placement.h"
+
+// Window moves run on a pool of worker threads, so a window whose process has stopped responding holds up a worker
+// rather than the overlay. A worker takes every window that is ready to move, up to MOVE_BATCH_LIMIT, and places them
+// in one batch with the backend's placeWindowsFn. Each window has at most one move in flight; moves queued for it
+// meanwhile replace one another, so it ends up wherever it was last asked to be.
+//
+// The windows of a batch that runs past the timeout are moved again one at a time, through placeWindowFn, so the
+// window that hung holds up only its own worker, and a single move that runs past the timeout marks its window
+// unresponsive. Unresponsive windows are left out of batches until a move of theirs finishes. Stuck workers are
+// replaced, up to MOVE_WORKER_LIMIT. Finished and timed out moves are queued for the overlay thread, which notifyFn
+// tells about them.
+//
+// Stackings run on the workers too, one at a time in the order they were queued, each after the moves queued before it
+// for its windows. Unresponsive windows are left out of them and keep their place in the z-order.
+
+#define MOVE_WORKER_LIMIT 16
+#define MOVE_BATCH_LIMIT 64
+
+// Completions the overlay thread has not taken yet; past this the oldest are dropped.
+#define MOVE_COMPLETION_LIMIT 1024
+
+enum MoveResult {
+  MoveResult_Done,
+  // The move has run past the timeout, and its window is marked unresponsive until a move of it finishes.
+  MoveResult_TimedOut,
+  // An unresponsive window has finished a move after all.
+  MoveResult_Recovered,
+};
+
+// Stackings only report timeouts and recoveries, with empty bounds.
+struct MoveCompletion {
+  WindowHandle hWnd;
+  struct Bounds bounds;
+  enum MoveResult result;
+  double seconds;
+};
+
+struct MoveStats {
+  long long queued;
+  long long coalesced;
+  long long completed;
+  long long batches;
+  long long singles;
+  long long splitBatches;
+  long long stackings;
+  long long timedOut;
+  long long recovered;
+  long long droppedCompletions;
+  int workersStarted;
+  // Windows the pool keeps state for, which are those with a move pending, in flight or stuck.
+  int slots;
+};
+
+// Starts workerCount threads that move and stack windows with the placeWindowFn, placeWindowsFn and stackWindowsFn
+// of windows, which are copied, so the backend can be pointed at the Queue functions below afterwards. notifyFn, which
+// may be NULL, is called on a worker whenever a completion is queued while none were waiting.
+void StartMoveWorkers(int workerCount, double timeoutSeconds, const struct Backend *windows, void (*notifyFn)());
+
+// Drops the queued moves and stackings and waits up to the timeout for the ones in flight. Workers still stuck in a
+// hung window after that are abandoned, and exit once it lets them go.
+void StopMoveWorkers();
+
+// Queue work for the workers. They match Backend::placeWindowFn, placeWindowsFn and stackWindowsFn, so they can stand
+// in for a backend's own.
+void QueueWindowMove(WindowHandle hWnd, struct Bounds bounds);
+void QueueWindowMoves(const struct WindowPlacement *placements, int count);
+void QueueWindowStackings(const struct WindowStacking *stackings, int count);
+
+// Marks the windows of work that has run past the timeout unresponsive, queueing a completion for each. Call it from
+// the overlay thread now and then; it is cheap.
+void CheckMoveTimeouts();
+
+// Copies up to limit completions, oldest first, and removes them from the queue. Returns how many were copied.
+int TakeMoveCompletions(struct MoveCompletion *completions, int limit);
+
+// Windows with a move or stacking queued, in flight or stuck.
+int PendingMoves();
+
+bool WindowUnresponsive(WindowHandle hWnd);
+struct MoveStats GetMoveStats();
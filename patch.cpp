@@ -0,0 +1,202 @@
+#include "patch.h"
+#include "tracker.h"
+
+struct Patcher {
+  struct PatchStats *stats;
+
+  // Live subtrees cut out of the tree, destroyed once their windows have found new cells.
+  int droppedCount;
+  int droppedCapacity;
+  struct Bin **dropped;
+};
+
+int PatchCountBins(struct Bin *bin) {
+  int count = 1;
+  for (int child = 0; child < BinChildCount(bin); child++)
+    if (BinChild(bin, child) != NULL)
+      count += PatchCountBins(BinChild(bin, child));
+  return count;
+}
+
+// The slot holding a bin's child, so a subtree can be moved without destroying the one it replaces. NULL for kinds of
+// bin whose children cannot be swapped, which are never patched in place.
+struct Bin **PatchChildSlot(struct Bin *bin, int index) {
+  struct Cell *cell = BinCell(bin);
+  if (cell != NULL)
+    return &cell->subBin;
+
+  if (bin->onLayoutFn == ShelfLayout) {
+    struct Shelf *shelf = Unwrap(struct Shelf, bin, bin);
+    AssertIndex(index, shelf->slotCount);
+    return &shelf->bins[index];
+  }
+  if (bin->onLayoutFn == GridLayout) {
+    struct Grid *grid = Unwrap(struct Grid, bin, bin);
+    AssertIndex(index, grid->rowCount * grid->columnCount);
+    return &grid->bins[index];
+  }
+  if (bin->onLayoutFn == SwirlLayout) {
+    struct Swirl *swirl = Unwrap(struct Swirl, bin, bin);
+    AssertIndex(index, swirl->slotCount);
+    return &swirl->bins[index];
+  }
+  if (bin->onLayoutFn == StackLayout) {
+    struct Stack *stack = Unwrap(struct Stack, bin, bin);
+    AssertIndex(index, stack->slotCount);
+    return &stack->bins[index];
+  }
+  return NULL;
+}
+
+bool PatchSameShape(struct Bin *live, struct Bin *next) {
+  if (live->onDrawFn != next->onDrawFn || live->onLayoutFn != next->onLayoutFn)
+    return false;
+
+  struct Cell *cell = BinCell(live);
+  if (cell != NULL)
+    return (cell->subBin == NULL) == (BinCell(next)->subBin == NULL);
+
+  if (live->onLayoutFn == ShelfLayout) {
+    struct Shelf *liveShelf = Unwrap(struct Shelf, bin, live);
+    struct Shelf *nextShelf = Unwrap(struct Shelf, bin, next);
+    return liveShelf->direction == nextShelf->direction && liveShelf->slotCount == nextShelf->slotCount;
+  }
+  if (live->onLayoutFn == GridLayout) {
+    struct Grid *liveGrid = Unwrap(struct Grid, bin, live);
+    struct Grid *nextGrid = Unwrap(struct Grid, bin, next);
+    return GridSameSpans(liveGrid, nextGrid);
+  }
+  if (live->onLayoutFn == SwirlLayout) {
+    struct Swirl *liveSwirl = Unwrap(struct Swirl, bin, live);
+    struct Swirl *nextSwirl = Unwrap(struct Swirl, bin, next);
+    return liveSwirl->slotCount == nextSwirl->slotCount;
+  }
+  if (live->onLayoutFn == StackLayout) {
+    struct Stack *liveStack = Unwrap(struct Stack, bin, live);
+    struct Stack *nextStack = Unwrap(struct Stack, bin, next);
+    return liveStack->style == nextStack->style && liveStack->slotCount == nextStack->slotCount;
+  }
+  return false;
+}
+
+void PatchDrop(struct Patcher *patcher, struct Bin *bin) {
+  if (patcher->droppedCount == patcher->droppedCapacity) {
+    int newCapacity = patcher->droppedCapacity ? patcher->droppedCapacity * 2 : 64;
+    struct Bin **newDropped = AllocateArray(struct Bin *, newCapacity);
+    if (patcher->dropped != NULL)
+      memcpy(newDropped, patcher->dropped, patcher->droppedCount * sizeof(struct Bin *));
+    FreeBytes(patcher->dropped);
+    patcher->dropped = newDropped;
+    patcher->droppedCapacity = newCapacity;
+  }
+
+  bin->parent = NULL;
+  patcher->dropped[patcher->droppedCount++] = bin;
+  patcher->stats->removed += PatchCountBins(bin);
+}
+
+// Moves next's child at index into live, in place of live's own.
+void PatchSwap(struct Patcher *patcher, struct Bin *live, struct Bin *next, int index) {
+  struct Bin **liveSlot = PatchChildSlot(live, index);
+  struct Bin **nextSlot = PatchChildSlot(next, index);
+  AssertNotNull(liveSlot);
+  AssertNotNull(nextSlot);
+
+  struct Bin *old = *liveSlot;
+  struct Bin *graft = *nextSlot;
+  *nextSlot = NULL;
+  *liveSlot = graft;
+
+  if (graft != NULL) {
+    graft->parent = live;
+    patcher->stats->added += PatchCountBins(graft);
+  }
+  if (old != NULL)
+    PatchDrop(patcher, old);
+  MarkLayoutDirty(live);
+}
+
+// live and next have the same shape.
+void PatchBin(struct Patcher *patcher, struct Bin *live, struct Bin *next) {
+  patcher->stats->kept++;
+
+  struct Cell *liveCell = BinCell(live);
+  if (liveCell != NULL) {
+    const char *name = BinCell(next)->name;
+    bool same = liveCell->name == NULL ? name == NULL : name != NULL && strcmp(liveCell->name, name) == 0;
+    if (!same)
+      patcher->stats->renamed++;
+    CellSetName(liveCell, name);
+  }
+
+  // Sizes that differ mark the container dirty, so only it is laid out again.
+  if (live->onLayoutFn == ShelfLayout) {
+    struct Shelf *liveShelf = Unwrap(struct Shelf, bin, live);
+    struct Shelf *nextShelf = Unwrap(struct Shelf, bin, next);
+    for (int slot = 0; slot < liveShelf->slotCount; slot++)
+      ShelfSetSize(liveShelf, slot, nextShelf->track.sizes[slot]);
+  } else if (live->onLayoutFn == GridLayout) {
+    struct Grid *liveGrid = Unwrap(struct Grid, bin, live);
+    struct Grid *nextGrid = Unwrap(struct Grid, bin, next);
+    for (int row = 0; row < liveGrid->rowCount; row++)
+      GridSetRowSize(liveGrid, row, nextGrid->rows.sizes[row]);
+    for (int column = 0; column < liveGrid->columnCount; column++)
+      GridSetColumnSize(liveGrid, column, nextGrid->columns.sizes[column]);
+  } else if (live->onLayoutFn == SwirlLayout) {
+    struct Swirl *liveSwirl = Unwrap(struct Swirl, bin, live);
+    struct Swirl *nextSwirl = Unwrap(struct Swirl, bin, next);
+    SwirlSetTightness(liveSwirl, nextSwirl->tightness);
+  }
+
+  for (int child = 0; child < BinChildCount(live); child++) {
+    struct Bin *liveChild = BinChild(live, child);
+    struct Bin *nextChild = BinChild(next, child);
+    if (liveChild != NULL && nextChild != NULL && PatchSameShape(liveChild, nextChild))
+      PatchBin(patcher, liveChild, nextChild);
+    else if (liveChild != NULL || nextChild != NULL)
+      PatchSwap(patcher, live, next, child);
+  }
+}
+
+void PatchMoveWindows(struct Patcher *patcher, struct Bin *bin, struct Bin *root) {
+  struct Cell *cell = BinCell(bin);
+  if (cell != NULL && cell->hWnd != NULL && cell->name != NULL) {
+    struct Cell *target = FindNamedCell(root, cell->name);
+    if (target != NULL && target->hWnd == NULL && target->subBin == NULL) {
+      CellSetWindow(target, cell->hWnd);
+      patcher->stats->windowsMoved++;
+    }
+  }
+
+  for (int child = 0; child < BinChildCount(bin); child++)
+    if (BinChild(bin, child) != NULL)
+      PatchMoveWindows(patcher, BinChild(bin, child), root);
+}
+
+struct Bin *PatchTree(struct Bin *root, struct Bin *next, struct PatchStats *stats) {
+  AssertNotNull(root);
+  AssertNotNull(next);
+  AssertNotNull(stats);
+  AssertMessage(BinArena(root) == BinArena(next), ("A tree can only be patched from one in the same arena"));
+
+  memset(stats, 0, sizeof(*stats));
+  struct Patcher patcher = {};
+  patcher.stats = stats;
+
+  struct Bin *patched = root;
+  if (PatchSameShape(root, next)) {
+    PatchBin(&patcher, root, next);
+    DestroyBin(next);
+  } else {
+    stats->added += PatchCountBins(next);
+    PatchDrop(&patcher, root);
+    patched = next;
+  }
+
+  for (int index = 0; index < patcher.droppedCount; index++) {
+    PatchMoveWindows(&patcher, patcher.dropped[index], patched);
+    DestroyBin(patcher.dropped[index]);
+  }
+  FreeBytes(patcher.dropped);
+  return patched;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "bin.h"
+
+// Brings a live tree in line with a freshly built one, such as a monitor's tree after its layout file changed, while
+// touching as little of it as it can. The two trees are walked together: a live bin whose kind and shape match the
+// new one stays, with the new cell name, slot sizes or swirl tightness, and only where they differ is the live subtree
+// swapped for the new one. The bins that stay keep their windows, their bounds and their clean layout, and a stack the
+// slot it shows, so the next layout pass and placement only cover what changed.
+
+struct PatchStats {
+  // Bins left in place, and bins taken from the new tree or dropped from the live one.
+  int kept;
+  int added;
+  int removed;
+  // Cells that stayed but were given another name.
+  int renamed;
+  // Windows that moved to a cell of the same name elsewhere because theirs was dropped.
+  int windowsMoved;
+};
+
+// Patches the tree below root to match next and returns the resulting root, which is next itself if the roots differ.
+// Both trees must come from the same arena. next is used up: the parts grafted into the live tree are moved there and
+// the rest is destroyed. Windows held by dropped cells go to the empty cell with the same name, if there is one. The
+// live cell names are replaced by the new tree's, so whatever held the old ones can be freed afterwards.
+struct Bin *PatchTree(struct Bin *root, struct Bin *next, struct PatchStats *stats);
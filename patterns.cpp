@@ -0,0 +1,634 @@
+#include <ctype.h>
+#include <stdio.h>
+
+#include "patterns.h"
+
+#define PATTERN_HASH_SLOTS (PATTERN_DFA_LIMIT * 2)
+
+// The second way out of a split that only has one.
+#define PATTERN_NO_EXIT -2
+
+void InitPatternSet(struct PatternSet *set) {
+  AssertNotNull(set);
+
+  memset(set, 0, sizeof(*set));
+  set->startState = -1;
+}
+
+void PatternReleaseDfa(struct PatternSet *set) {
+  FreeBytes(set->transitions);
+  FreeBytes(set->listStart);
+  FreeBytes(set->listLength);
+  FreeBytes(set->accepting);
+  FreeBytes(set->accepts);
+  FreeBytes(set->lists);
+  FreeBytes(set->hashSlots);
+  FreeBytes(set->stack);
+  FreeBytes(set->scratch);
+  FreeBytes(set->marks);
+  set->transitions = NULL;
+  set->listStart = NULL;
+  set->listLength = NULL;
+  set->accepting = NULL;
+  set->accepts = NULL;
+  set->lists = NULL;
+  set->hashSlots = NULL;
+  set->stack = NULL;
+  set->scratch = NULL;
+  set->marks = NULL;
+  set->dfaCount = 0;
+  set->dfaCapacity = 0;
+  set->listCount = 0;
+  set->listCapacity = 0;
+  set->startState = -1;
+}
+
+void ReleasePatternSet(struct PatternSet *set) {
+  AssertNotNull(set);
+
+  PatternReleaseDfa(set);
+  FreeBytes(set->nfa);
+  FreeBytes(set->sets);
+  FreeBytes(set->starts);
+  FreeBytes(set->restarts);
+  InitPatternSet(set);
+}
+
+int PatternWords(struct PatternSet *set) { return (set->patternCount + 63) / 64; }
+
+// Returns array with room for at least one more element than count, moving it to a larger allocation if needed.
+void *PatternGrow(void *array, int count, int *capacity, size_t size, const char *name) {
+  if (count < *capacity)
+    return array;
+
+  int newCapacity = *capacity ? *capacity * 2 : 64;
+  void *newArray = AllocateBytes(size, newCapacity, name);
+  if (array != NULL)
+    memcpy(newArray, array, count * size);
+  FreeBytes(array);
+  *capacity = newCapacity;
+  return newArray;
+}
+
+int PatternNewState(struct PatternSet *set, enum PatternNfaKind kind, int out, int out1) {
+  set->nfa = (struct PatternNfaState *)PatternGrow(set->nfa, set->nfaCount, &set->nfaCapacity,
+                                                   sizeof(struct PatternNfaState), "PatternNfaState");
+  struct PatternNfaState *state = &set->nfa[set->nfaCount];
+  state->kind = kind;
+  state->out = out;
+  state->out1 = out1;
+  state->set = -1;
+  state->pattern = -1;
+  return set->nfaCount++;
+}
+
+// A set state with an empty character set, for the caller to fill in.
+int PatternNewSetState(struct PatternSet *set) {
+  set->sets = (struct PatternCharSet *)PatternGrow(set->sets, set->setCount, &set->setCapacity,
+                                                   sizeof(struct PatternCharSet), "PatternCharSet");
+  memset(&set->sets[set->setCount], 0, sizeof(struct PatternCharSet));
+
+  int state = PatternNewState(set, PatternNfa_Set, -1, PATTERN_NO_EXIT);
+  set->nfa[state].set = set->setCount++;
+  return state;
+}
+
+void CharSetAdd(struct PatternCharSet *chars, int symbol) { chars->bits[symbol >> 5] |= 1u << (symbol & 31); }
+
+bool CharSetHas(const struct PatternCharSet *chars, int symbol) {
+  return (chars->bits[symbol >> 5] >> (symbol & 31)) & 1;
+}
+
+// Fragments under construction leave their exits unpatched. Each unpatched out field holds the next one in a list,
+// entries being a state index shifted left once with the low bit telling out from out1, ending with -1.
+
+struct PatternFragment {
+  int start;
+  int exits;
+};
+
+int *PatternExitField(struct PatternSet *set, int exit) {
+  struct PatternNfaState *state = &set->nfa[exit >> 1];
+  return exit & 1 ? &state->out1 : &state->out;
+}
+
+void PatternPatch(struct PatternSet *set, int exits, int target) {
+  while (exits != -1) {
+    int *field = PatternExitField(set, exits);
+    exits = *field;
+    *field = target;
+  }
+}
+
+int PatternAppendExits(struct PatternSet *set, int first, int second) {
+  if (first == -1)
+    return second;
+
+  int exit = first;
+  while (*PatternExitField(set, exit) != -1)
+    exit = *PatternExitField(set, exit);
+  *PatternExitField(set, exit) = second;
+  return first;
+}
+
+struct PatternParser {
+  struct PatternSet *set;
+  const char *pattern;
+  const char *at;
+  const char *end;
+  bool ignoreCase;
+
+  const char *message;
+  const char *messageAt;
+};
+
+void PatternFail(struct PatternParser *parser, const char *message) {
+  if (parser->message == NULL) {
+    parser->message = message;
+    parser->messageAt = parser->at;
+  }
+}
+
+void PatternAddChar(struct PatternParser *parser, struct PatternCharSet *chars, unsigned char c) {
+  CharSetAdd(chars, c);
+  if (parser->ignoreCase && isalpha(c)) {
+    CharSetAdd(chars, tolower(c));
+    CharSetAdd(chars, toupper(c));
+  }
+}
+
+// Adds the characters an escape stands for. Returns false for a letter or digit with no meaning as an escape.
+bool PatternAddEscape(struct PatternParser *parser, struct PatternCharSet *chars, unsigned char c) {
+  struct PatternCharSet cls = {};
+  bool negate = isupper(c) != 0;
+  switch (tolower(c)) {
+  case 'd':
+    for (int digit = '0'; digit <= '9'; digit++)
+      CharSetAdd(&cls, digit);
+    break;
+  case 'w':
+    for (int symbol = 0; symbol < 256; symbol++)
+      if (isalnum(symbol) || symbol == '_')
+        CharSetAdd(&cls, symbol);
+    break;
+  case 's':
+    for (const char *space = " \t\r\n\f\v"; *space; space++)
+      CharSetAdd(&cls, *space);
+    break;
+  default:
+    if (c == 'n' || c == 't' || c == 'r') {
+      PatternAddChar(parser, chars, c == 'n' ? '\n' : c == 't' ? '\t' : '\r');
+      return true;
+    }
+    if (isalnum(c))
+      return false;
+    PatternAddChar(parser, chars, c);
+    return true;
+  }
+
+  for (int word = 0; word < 8; word++)
+    chars->bits[word] |= negate ? ~cls.bits[word] : cls.bits[word];
+  return true;
+}
+
+void PatternParseClass(struct PatternParser *parser, struct PatternCharSet *chars) {
+  bool negate = parser->at < parser->end && *parser->at == '^';
+  if (negate)
+    parser->at++;
+
+  struct PatternCharSet cls = {};
+  bool first = true;
+  while (parser->at < parser->end && (*parser->at != ']' || first)) {
+    first = false;
+    unsigned char c = *parser->at++;
+    if (c == '\\') {
+      if (parser->at == parser->end)
+        break;
+      c = *parser->at++;
+      if (strchr("dwsDWS", c) != NULL) {
+        PatternAddEscape(parser, &cls, c);
+        continue;
+      }
+      if (c == 'n' || c == 't' || c == 'r')
+        c = c == 'n' ? '\n' : c == 't' ? '\t' : '\r';
+    }
+
+    if (parser->at + 1 < parser->end && parser->at[0] == '-' && parser->at[1] != ']') {
+      unsigned char last = parser->at[1];
+      parser->at += 2;
+      if (last < c) {
+        PatternFail(parser, "a class range runs backwards");
+        return;
+      }
+      for (int symbol = c; symbol <= last; symbol++)
+        PatternAddChar(parser, &cls, (unsigned char)symbol);
+    } else {
+      PatternAddChar(parser, &cls, c);
+    }
+  }
+
+  if (parser->at == parser->end) {
+    PatternFail(parser, "a [ has no closing ]");
+    return;
+  }
+  parser->at++;
+
+  for (int word = 0; word < 8; word++)
+    chars->bits[word] |= negate ? ~cls.bits[word] : cls.bits[word];
+}
+
+struct PatternFragment PatternParseAlternation(struct PatternParser *parser);
+
+struct PatternFragment PatternParseAtom(struct PatternParser *parser) {
+  struct PatternSet *set = parser->set;
+  struct PatternFragment fragment = {-1, -1};
+
+  unsigned char c = *parser->at;
+  if (c == '(') {
+    parser->at++;
+    if (parser->end - parser->at >= 2 && parser->at[0] == '?' && parser->at[1] == ':')
+      parser->at += 2;
+    fragment = PatternParseAlternation(parser);
+    if (parser->at == parser->end || *parser->at != ')') {
+      PatternFail(parser, "a ( has no closing )");
+      return fragment;
+    }
+    parser->at++;
+    return fragment;
+  }
+
+  if (c == '*' || c == '+' || c == '?') {
+    PatternFail(parser, "a repeat has nothing to repeat");
+    return fragment;
+  }
+  if (c == '^' || c == '$') {
+    PatternFail(parser, "^ and $ are only supported at the ends of a pattern");
+    return fragment;
+  }
+
+  int state = PatternNewSetState(set);
+  struct PatternCharSet *chars = &set->sets[set->nfa[state].set];
+  parser->at++;
+  if (c == '.') {
+    for (int word = 0; word < 8; word++)
+      chars->bits[word] = ~0u;
+  } else if (c == '[') {
+    PatternParseClass(parser, chars);
+  } else if (c == '\\') {
+    if (parser->at == parser->end)
+      PatternFail(parser, "the pattern ends with a \\");
+    else if (!PatternAddEscape(parser, chars, *parser->at++))
+      PatternFail(parser, "an escape is not recognised");
+  } else {
+    PatternAddChar(parser, chars, c);
+  }
+
+  fragment.start = state;
+  fragment.exits = state << 1;
+  return fragment;
+}
+
+struct PatternFragment PatternParseRepeat(struct PatternParser *parser) {
+  struct PatternSet *set = parser->set;
+  struct PatternFragment fragment = PatternParseAtom(parser);
+
+  while (parser->message == NULL && parser->at < parser->end &&
+         (*parser->at == '*' || *parser->at == '+' || *parser->at == '?')) {
+    char repeat = *parser->at++;
+    int split = PatternNewState(set, PatternNfa_Split, fragment.start, -1);
+    if (repeat == '*') {
+      PatternPatch(set, fragment.exits, split);
+      fragment.start = split;
+      fragment.exits = split << 1 | 1;
+    } else if (repeat == '+') {
+      PatternPatch(set, fragment.exits, split);
+      fragment.exits = split << 1 | 1;
+    } else {
+      fragment.exits = PatternAppendExits(set, fragment.exits, split << 1 | 1);
+      fragment.start = split;
+    }
+  }
+  return fragment;
+}
+
+struct PatternFragment PatternParseConcatenation(struct PatternParser *parser) {
+  struct PatternSet *set = parser->set;
+
+  // An empty sequence, as in a| or (), matches without consuming anything.
+  int empty = PatternNewState(set, PatternNfa_Split, -1, PATTERN_NO_EXIT);
+  struct PatternFragment fragment = {empty, empty << 1};
+
+  while (parser->message == NULL && parser->at < parser->end && *parser->at != '|' && *parser->at != ')') {
+    struct PatternFragment next = PatternParseRepeat(parser);
+    if (parser->message != NULL)
+      break;
+    PatternPatch(set, fragment.exits, next.start);
+    fragment.exits = next.exits;
+  }
+  return fragment;
+}
+
+struct PatternFragment PatternParseAlternation(struct PatternParser *parser) {
+  struct PatternSet *set = parser->set;
+  struct PatternFragment fragment = PatternParseConcatenation(parser);
+
+  while (parser->message == NULL && parser->at < parser->end && *parser->at == '|') {
+    parser->at++;
+    struct PatternFragment other = PatternParseConcatenation(parser);
+    int split = PatternNewState(set, PatternNfa_Split, fragment.start, other.start);
+    fragment.start = split;
+    fragment.exits = PatternAppendExits(set, fragment.exits, other.exits);
+  }
+  return fragment;
+}
+
+int AddPattern(struct PatternSet *set, const char *pattern, char *error, int errorSize) {
+  AssertNotNull(set);
+  AssertNotNull(pattern);
+
+  struct PatternParser parser = {};
+  parser.set = set;
+  parser.pattern = pattern;
+  parser.at = pattern;
+
+  if (strncmp(parser.at, "(?i)", 4) == 0) {
+    parser.ignoreCase = true;
+    parser.at += 4;
+  }
+  bool anchored = *parser.at == '^';
+  if (anchored)
+    parser.at++;
+
+  // A trailing $ anchors the pattern unless it is escaped, which takes an odd number of backslashes before it.
+  parser.end = parser.at + strlen(parser.at);
+  bool endAnchored = false;
+  if (parser.end > parser.at && parser.end[-1] == '$') {
+    int slashes = 0;
+    for (const char *back = parser.end - 2; back >= parser.at && *back == '\\'; back--)
+      slashes++;
+    if (slashes % 2 == 0) {
+      endAnchored = true;
+      parser.end--;
+    }
+  }
+
+  int nfaMark = set->nfaCount;
+  int setMark = set->setCount;
+  struct PatternFragment fragment = PatternParseAlternation(&parser);
+  if (parser.message == NULL && parser.at != parser.end)
+    PatternFail(&parser, "a ) has no opening (");
+
+  if (parser.message != NULL) {
+    set->nfaCount = nfaMark;
+    set->setCount = setMark;
+    if (error != NULL)
+      snprintf(error, errorSize, "%s at offset %d of \"%s\"", parser.message, (int)(parser.messageAt - pattern),
+               pattern);
+    return -1;
+  }
+
+  int index = set->patternCount++;
+  int match = PatternNewState(set, PatternNfa_Match, -1, PATTERN_NO_EXIT);
+  set->nfa[match].pattern = index;
+  if (endAnchored) {
+    int end = PatternNewSetState(set);
+    CharSetAdd(&set->sets[set->nfa[end].set], PATTERN_END_SYMBOL);
+    set->nfa[end].out = match;
+    PatternPatch(set, fragment.exits, end);
+  } else {
+    PatternPatch(set, fragment.exits, match);
+  }
+
+  if (set->startCount == set->startCapacity) {
+    int capacity = set->startCapacity;
+    set->starts = (int *)PatternGrow(set->starts, set->startCount, &capacity, sizeof(int), "int");
+    int *restarts = (int *)AllocateArray(int, capacity);
+    if (set->restarts != NULL)
+      memcpy(restarts, set->restarts, set->restartCount * sizeof(int));
+    FreeBytes(set->restarts);
+    set->restarts = restarts;
+    set->startCapacity = capacity;
+  }
+  set->starts[set->startCount++] = fragment.start;
+  if (!anchored)
+    set->restarts[set->restartCount++] = fragment.start;
+
+  // The cached states were built without this pattern.
+  PatternReleaseDfa(set);
+  return index;
+}
+
+// Adds every set and match state reachable from state without consuming anything to the scratch list.
+void PatternClosure(struct PatternSet *set, int state, int *count) {
+  int depth = 0;
+  set->stack[depth++] = state;
+  while (depth > 0) {
+    int top = set->stack[--depth];
+    if (top < 0 || set->marks[top] == set->markGeneration)
+      continue;
+    set->marks[top] = set->markGeneration;
+
+    struct PatternNfaState *nfa = &set->nfa[top];
+    if (nfa->kind == PatternNfa_Split) {
+      set->stack[depth++] = nfa->out1;
+      set->stack[depth++] = nfa->out;
+    } else {
+      set->scratch[(*count)++] = top;
+    }
+  }
+}
+
+void PatternBeginClosure(struct PatternSet *set) {
+  if (++set->markGeneration == 0) {
+    memset(set->marks, 0, set->nfaCount * sizeof(unsigned int));
+    set->markGeneration = 1;
+  }
+}
+
+int ComparePatternStates(const void *a, const void *b) { return *(const int *)a - *(const int *)b; }
+
+void PatternClearStates(struct PatternSet *set) {
+  set->dfaCount = 0;
+  set->listCount = 0;
+  set->startState = -1;
+  for (int slot = 0; slot < PATTERN_HASH_SLOTS; slot++)
+    set->hashSlots[slot] = -1;
+}
+
+// Finds or adds the DFA state for the NFA states in scratch. Returns -1 if the cache is full.
+int PatternInternState(struct PatternSet *set, int count) {
+  int *states = set->scratch;
+  qsort(states, count, sizeof(int), ComparePatternStates);
+
+  unsigned int hash = 2166136261u;
+  for (int index = 0; index < count; index++)
+    hash = (hash ^ (unsigned int)states[index]) * 16777619u;
+
+  int slot = hash & (PATTERN_HASH_SLOTS - 1);
+  for (; set->hashSlots[slot] >= 0; slot = (slot + 1) & (PATTERN_HASH_SLOTS - 1)) {
+    int dfa = set->hashSlots[slot];
+    if (set->listLength[dfa] == count && memcmp(&set->lists[set->listStart[dfa]], states, count * sizeof(int)) == 0)
+      return dfa;
+  }
+
+  if (set->dfaCount == PATTERN_DFA_LIMIT)
+    return -1;
+
+  if (set->dfaCount == set->dfaCapacity) {
+    int capacity = set->dfaCapacity;
+    set->listStart = (int *)PatternGrow(set->listStart, set->dfaCount, &capacity, sizeof(int), "int");
+    capacity = set->dfaCapacity;
+    set->listLength = (int *)PatternGrow(set->listLength, set->dfaCount, &capacity, sizeof(int), "int");
+    capacity = set->dfaCapacity;
+    set->accepting = (bool *)PatternGrow(set->accepting, set->dfaCount, &capacity, sizeof(bool), "bool");
+
+    int newCapacity = capacity;
+    int *newTransitions = AllocateArray(int, (size_t)newCapacity * PATTERN_SYMBOLS);
+    if (set->transitions != NULL)
+      memcpy(newTransitions, set->transitions, (size_t)set->dfaCount * PATTERN_SYMBOLS * sizeof(int));
+    FreeBytes(set->transitions);
+    set->transitions = newTransitions;
+
+    unsigned long long *newAccepts = AllocateArray(unsigned long long, (size_t)newCapacity * set->acceptWords + 1);
+    if (set->accepts != NULL)
+      memcpy(newAccepts, set->accepts, (size_t)set->dfaCount * set->acceptWords * sizeof(unsigned long long));
+    FreeBytes(set->accepts);
+    set->accepts = newAccepts;
+    set->dfaCapacity = newCapacity;
+  }
+
+  if (set->listCount + count > set->listCapacity) {
+    int newCapacity = set->listCapacity ? set->listCapacity * 2 : 256;
+    while (newCapacity < set->listCount + count)
+      newCapacity *= 2;
+    int *newLists = AllocateArray(int, newCapacity);
+    if (set->lists != NULL)
+      memcpy(newLists, set->lists, set->listCount * sizeof(int));
+    FreeBytes(set->lists);
+    set->lists = newLists;
+    set->listCapacity = newCapacity;
+  }
+
+  int dfa = set->dfaCount++;
+  set->listStart[dfa] = set->listCount;
+  set->listLength[dfa] = count;
+  memcpy(&set->lists[set->listCount], states, count * sizeof(int));
+  set->listCount += count;
+
+  int *row = &set->transitions[(size_t)dfa * PATTERN_SYMBOLS];
+  for (int symbol = 0; symbol < PATTERN_SYMBOLS; symbol++)
+    row[symbol] = -1;
+
+  unsigned long long *accepts = &set->accepts[(size_t)dfa * set->acceptWords];
+  memset(accepts, 0, set->acceptWords * sizeof(unsigned long long));
+  set->accepting[dfa] = false;
+  for (int index = 0; index < count; index++) {
+    struct PatternNfaState *nfa = &set->nfa[states[index]];
+    if (nfa->kind == PatternNfa_Match) {
+      accepts[nfa->pattern >> 6] |= 1ull << (nfa->pattern & 63);
+      set->accepting[dfa] = true;
+    }
+  }
+
+  set->hashSlots[slot] = dfa;
+  set->stats.dfaStates++;
+  return dfa;
+}
+
+// Interns the state in scratch, emptying the cache first if it is full.
+int PatternAddState(struct PatternSet *set, int count) {
+  int dfa = PatternInternState(set, count);
+  if (dfa >= 0)
+    return dfa;
+
+  PatternClearStates(set);
+  set->stats.flushes++;
+  return PatternInternState(set, count);
+}
+
+void PatternPrepareDfa(struct PatternSet *set) {
+  if (set->hashSlots != NULL)
+    return;
+
+  set->acceptWords = PatternWords(set);
+  set->hashSlots = AllocateArray(int, PATTERN_HASH_SLOTS);
+  set->stack = AllocateArray(int, set->nfaCount * 2 + set->startCount + 1);
+  set->scratch = AllocateArray(int, set->nfaCount + 1);
+  set->marks = AllocateArray(unsigned int, set->nfaCount + 1);
+  set->markGeneration = 0;
+  PatternClearStates(set);
+}
+
+int PatternStartState(struct PatternSet *set) {
+  PatternBeginClosure(set);
+  int count = 0;
+  for (int start = 0; start < set->startCount; start++)
+    PatternClosure(set, set->starts[start], &count);
+  return PatternAddState(set, count);
+}
+
+int PatternBuildStep(struct PatternSet *set, int dfa, int symbol) {
+  PatternBeginClosure(set);
+  int count = 0;
+  const int *states = &set->lists[set->listStart[dfa]];
+  int length = set->listLength[dfa];
+  for (int index = 0; index < length; index++) {
+    struct PatternNfaState *nfa = &set->nfa[states[index]];
+    if (nfa->kind == PatternNfa_Set && CharSetHas(&set->sets[nfa->set], symbol))
+      PatternClosure(set, nfa->out, &count);
+  }
+  if (symbol != PATTERN_END_SYMBOL)
+    for (int restart = 0; restart < set->restartCount; restart++)
+      PatternClosure(set, set->restarts[restart], &count);
+
+  long long flushes = set->stats.flushes;
+  int next = PatternAddState(set, count);
+  // A flush drops the state the step was taken from along with the rest, so there is no row left to fill in.
+  if (set->stats.flushes == flushes)
+    set->transitions[(size_t)dfa * PATTERN_SYMBOLS + symbol] = next;
+  return next;
+}
+
+void MatchPatterns(struct PatternSet *set, const char *text, unsigned long long *matched) {
+  AssertNotNull(set);
+  AssertNotNull(text);
+
+  int words = PatternWords(set);
+  memset(matched, 0, words * sizeof(unsigned long long));
+  set->stats.matches++;
+  if (set->patternCount == 0)
+    return;
+
+  PatternPrepareDfa(set);
+  if (set->startState < 0)
+    set->startState = PatternStartState(set);
+
+  int dfa = set->startState;
+  const unsigned char *at = (const unsigned char *)text;
+  for (;; at++) {
+    if (set->accepting[dfa]) {
+      const unsigned long long *accepts = &set->accepts[(size_t)dfa * words];
+      for (int word = 0; word < words; word++)
+        matched[word] |= accepts[word];
+    }
+
+    int symbol = *at ? *at : PATTERN_END_SYMBOL;
+    int next = set->transitions[(size_t)dfa * PATTERN_SYMBOLS + symbol];
+    if (next < 0)
+      next = PatternBuildStep(set, dfa, symbol);
+    dfa = next;
+
+    if (symbol == PATTERN_END_SYMBOL)
+      break;
+    // Nothing can match any more once every pattern has failed and none can start again.
+    if (set->listLength[dfa] == 0 && set->restartCount == 0)
+      break;
+  }
+
+  if (set->accepting[dfa]) {
+    const unsigned long long *accepts = &set->accepts[(size_t)dfa * words];
+    for (int word = 0; word < words; word++)
+      matched[word] |= accepts[word];
+  }
+  set->stats.bytes += (const char *)at - text;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "core.h"
+
+// A set of regular expressions matched together in one pass over the text. Every pattern is compiled into one shared
+// NFA, which is turned into a DFA lazily: each DFA state is built the first time the text leads to it and then cached,
+// so matching is one table lookup per byte however many patterns there are. The cache is flushed if it grows past
+// PATTERN_DFA_LIMIT states.
+//
+// The syntax is a small subset of the usual one: literals, ., [...] and [^...] classes with ranges, \d \w \s and
+// their negations, escapes, grouping with (...) or (?:...), alternation with |, and the * + ? repeats. A pattern
+// matches anywhere in the text unless it starts with ^ or ends with $, and (?i) at its very start makes it ignore
+// case.
+
+#define PATTERN_DFA_LIMIT 4096
+
+// Every byte, plus a symbol for the end of the text that only $ consumes.
+#define PATTERN_SYMBOLS 257
+#define PATTERN_END_SYMBOL 256
+
+enum PatternNfaKind {
+  PatternNfa_Set,
+  PatternNfa_Split,
+  PatternNfa_Match,
+};
+
+struct PatternNfaState {
+  enum PatternNfaKind kind;
+  // Set states consume a symbol in sets[set] and go to out; split states go to out and, unless it is negative, out1.
+  int out;
+  int out1;
+  int set;
+  int pattern;
+};
+
+struct PatternCharSet {
+  unsigned int bits[(PATTERN_SYMBOLS + 31) / 32];
+};
+
+struct PatternStats {
+  long long matches;
+  long long bytes;
+  long long dfaStates;
+  long long flushes;
+};
+
+struct PatternSet {
+  int patternCount;
+
+  int nfaCount;
+  int nfaCapacity;
+  struct PatternNfaState *nfa;
+
+  int setCount;
+  int setCapacity;
+  struct PatternCharSet *sets;
+
+  // The start of every pattern, and of those not anchored with ^, which may start again at any position.
+  int startCount;
+  int restartCount;
+  int startCapacity;
+  int *starts;
+  int *restarts;
+
+  // DFA states, each a sorted list of NFA states in lists, with a row of transitions (negative until built) and the
+  // patterns it has matched.
+  int dfaCount;
+  int dfaCapacity;
+  int *transitions;
+  int *listStart;
+  int *listLength;
+  bool *accepting;
+  unsigned long long *accepts;
+  int acceptWords;
+  int listCount;
+  int listCapacity;
+  int *lists;
+  int *hashSlots;
+  int startState;
+
+  // Scratch space for building states.
+  int *stack;
+  int *scratch;
+  unsigned int *marks;
+  unsigned int markGeneration;
+
+  struct PatternStats stats;
+};
+
+void InitPatternSet(struct PatternSet *set);
+void ReleasePatternSet(struct PatternSet *set);
+
+// Compiles pattern into the set and returns its index, or returns -1 and describes the problem in error.
+int AddPattern(struct PatternSet *set, const char *pattern, char *error, int errorSize);
+
+// The number of 64 bit words a match result needs.
+int PatternWords(struct PatternSet *set);
+
+// Sets the bit of every pattern that matches text in matched, which holds PatternWords(set) words.
+void MatchPatterns(struct PatternSet *set, const char *text, unsigned long long *matched);
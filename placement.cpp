@@ -0,0 +1,122 @@
+#include "placement.h"
+#include "tracker.h"
+
+void InitPlacements(struct Placements *placements) {
+  AssertNotNull(placements);
+
+  memset(placements, 0, sizeof(*placements));
+  placements->layoutVisited = -1;
+}
+
+void ReleasePlacements(struct Placements *placements) {
+  AssertNotNull(placements);
+
+  FreeBytes(placements->changed.placements);
+  InitPlacements(placements);
+}
+
+void ReleasePlacementList(struct PlacementList *list) {
+  AssertNotNull(list);
+
+  FreeBytes(list->placements);
+  memset(list, 0, sizeof(*list));
+}
+
+void PlacementForget(struct Bin *bin) {
+  struct Cell *cell = BinCell(bin);
+  if (cell != NULL)
+    cell->placedWindow = NULL;
+  bin->placementDirty = true;
+
+  int childCount = BinChildCount(bin);
+  for (int child = 0; child < childCount; child++) {
+    struct Bin *childBin = BinChild(bin, child);
+    if (childBin != NULL)
+      PlacementForget(childBin);
+  }
+}
+
+void ResetPlacements(struct Placements *placements, struct Bin *root) {
+  AssertNotNull(placements);
+  AssertNotNull(root);
+
+  PlacementForget(root);
+  placements->layoutVisited = -1;
+}
+
+void PlacementListAdd(struct PlacementList *list, WindowHandle hWnd, struct Bounds bounds) {
+  if (list->count == list->capacity) {
+    int newCapacity = list->capacity ? list->capacity * 2 : 64;
+    struct WindowPlacement *newPlacements = AllocateArray(struct WindowPlacement, newCapacity);
+    if (list->placements != NULL)
+      memcpy(newPlacements, list->placements, list->count * sizeof(struct WindowPlacement));
+    FreeBytes(list->placements);
+    list->placements = newPlacements;
+    list->capacity = newCapacity;
+  }
+
+  struct WindowPlacement *placement = &list->placements[list->count++];
+  placement->hWnd = hWnd;
+  placement->bounds = bounds;
+}
+
+bool SameBounds(struct Bounds a, struct Bounds b) {
+  return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+}
+
+void PlacementCollect(struct Placements *placements, struct PlacementList *batch, struct Bin *bin) {
+  // A bin the layout passes have not visited kept its bounds, and so did everything below it.
+  if (!bin->placementDirty)
+    return;
+  bin->placementDirty = false;
+
+  struct Cell *cell = BinCell(bin);
+  if (cell != NULL && cell->hWnd != NULL) {
+    placements->windowsCollected++;
+    if (cell->placedWindow != cell->hWnd || !SameBounds(cell->placedBounds, cell->bin.bounds)) {
+      cell->placedWindow = cell->hWnd;
+      cell->placedBounds = cell->bin.bounds;
+      // A window the tracker reports already in place, say because it was put there by hand, needs no call either.
+      struct TrackedWindow *tracked = FindTrackedWindow(cell->hWnd);
+      if (tracked == NULL || !SameBounds(tracked->bounds, cell->bin.bounds))
+        PlacementListAdd(batch, cell->hWnd, cell->bin.bounds);
+    }
+  }
+
+  int childCount = BinChildCount(bin);
+  // The windows of a stack's hidden slots, and of the slots under a zoomed one, are left where they were until they
+  // show again, and their cells remember where that is.
+  for (int child = 0; child < childCount; child++) {
+    struct Bin *childBin = BinChild(bin, child);
+    if (childBin != NULL && childBin->placementDirty && BinChildShown(bin, child))
+      PlacementCollect(placements, batch, childBin);
+  }
+}
+
+int CollectPlacements(struct Placements *placements, struct Bin *root, struct PlacementList *batch) {
+  AssertNotNull(placements);
+  AssertNotNull(root);
+  AssertNotNull(batch);
+
+  if (placements->layoutVisited == layoutStats.visited)
+    return 0;
+  placements->layoutVisited = layoutStats.visited;
+  placements->passes++;
+
+  int first = batch->count;
+  PlacementCollect(placements, batch, root);
+  placements->windowsPlaced += batch->count - first;
+  return batch->count - first;
+}
+
+int ApplyPlacements(struct Placements *placements, struct Bin *root) {
+  struct PlacementList *changed = &placements->changed;
+  changed->count = 0;
+  int count = CollectPlacements(placements, root, changed);
+  if (count == 0)
+    return 0;
+
+  PlaceWindows(changed->placements, count);
+  placements->batches++;
+  return count;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "bin.h"
+
+// Keeps the windows held by cells in step with the layout. After a layout pass the window of every shown cell it
+// visited is compared with where the cell last put it; only the windows that moved are handed to the backend, in one
+// batch, so a reflow of the whole desktop is one transaction rather than a call per window. The windows of hidden cells
+// keep their record, so a cell that shows again with the bounds it had is not placed again.
+
+struct WindowPlacement {
+  WindowHandle hWnd;
+  struct Bounds bounds;
+};
+
+struct PlacementList {
+  int count;
+  int capacity;
+  struct WindowPlacement *placements;
+};
+
+struct Placements {
+  // The batch ApplyPlacements collects into.
+  struct PlacementList changed;
+
+  long long layoutVisited;
+
+  long long passes;
+  long long windowsCollected;
+  long long windowsPlaced;
+  long long batches;
+};
+
+void InitPlacements(struct Placements *placements);
+void ReleasePlacements(struct Placements *placements);
+
+// Places every window below root whose cell has moved since it was last placed, and returns how many were. Does
+// nothing when no layout pass has run since the last call.
+int ApplyPlacements(struct Placements *placements, struct Bin *root);
+
+// As ApplyPlacements, but adds the windows to batch rather than placing them, so that the windows of several trees can
+// be placed in one batch with PlaceWindows. The windows count as placed.
+int CollectPlacements(struct Placements *placements, struct Bin *root, struct PlacementList *batch);
+void ReleasePlacementList(struct PlacementList *list);
+
+// Forgets where every window below root was put, hidden or not, so the next call places them all again.
+void ResetPlacements(struct Placements *placements, struct Bin *root);
+
+bool SameBounds(struct Bounds a, struct Bounds b);
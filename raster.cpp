@@ -0,0 +1,469 @@
+#include <math.h>
+
+#include "raster.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define RASTER_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define RASTER_SSE2_TARGET
+#define RASTER_AVX2_TARGET
+#else
+#define RASTER_SSE2_TARGET __attribute__((target("sse2")))
+#define RASTER_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#else
+#define RASTER_X86 0
+#endif
+
+struct Raster raster;
+
+// x / 255, rounded, for x up to 255 * 255. The SIMD spans use the same steps on 16 bit lanes.
+unsigned int Div255(unsigned int x) {
+  x += 128;
+  return (x + (x >> 8)) >> 8;
+}
+
+// Scales every channel of a premultiplied colour by coverage / 255.
+unsigned int RasterScale(unsigned int color, unsigned int coverage) {
+  unsigned int scaled = 0;
+  for (int shift = 0; shift < 32; shift += 8)
+    scaled |= Div255(((color >> shift) & 0xff) * coverage) << shift;
+  return scaled;
+}
+
+unsigned int RasterPremultiply(unsigned int argb) {
+  unsigned int alpha = argb >> 24;
+  return RasterScale(argb & 0x00ffffff, alpha) | (alpha << 24);
+}
+
+// Premultiplied source over destination. No channel can carry into the next, since src + dst * (255 - srcAlpha) / 255
+// never exceeds 255.
+unsigned int RasterBlend(unsigned int dst, unsigned int src) {
+  unsigned int inverse = 255 - (src >> 24);
+  unsigned int blended = 0;
+  for (int shift = 0; shift < 32; shift += 8)
+    blended |= Div255(((dst >> shift) & 0xff) * inverse) << shift;
+  return src + blended;
+}
+
+void RasterSpanScalar(unsigned int *pixels, int count, unsigned int color) {
+  if ((color >> 24) == 255) {
+    for (int pixel = 0; pixel < count; pixel++)
+      pixels[pixel] = color;
+    return;
+  }
+
+  for (int pixel = 0; pixel < count; pixel++)
+    pixels[pixel] = RasterBlend(pixels[pixel], color);
+}
+
+#if RASTER_X86
+
+RASTER_SSE2_TARGET __m128i RasterBlendSSE2(__m128i dst, __m128i src, __m128i inverse) {
+  __m128i zero = _mm_setzero_si128();
+  __m128i bias = _mm_set1_epi16(128);
+
+  __m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(dst, zero), inverse), bias);
+  __m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(dst, zero), inverse), bias);
+  low = _mm_srli_epi16(_mm_add_epi16(low, _mm_srli_epi16(low, 8)), 8);
+  high = _mm_srli_epi16(_mm_add_epi16(high, _mm_srli_epi16(high, 8)), 8);
+  return _mm_add_epi8(_mm_packus_epi16(low, high), src);
+}
+
+RASTER_SSE2_TARGET void RasterSpanSSE2(unsigned int *pixels, int count, unsigned int color) {
+  __m128i src = _mm_set1_epi32((int)color);
+  int pixel = 0;
+
+  if ((color >> 24) == 255) {
+    for (; pixel + 4 <= count; pixel += 4)
+      _mm_storeu_si128((__m128i *)&pixels[pixel], src);
+  } else {
+    __m128i inverse = _mm_set1_epi16((short)(255 - (color >> 24)));
+    for (; pixel + 4 <= count; pixel += 4) {
+      __m128i dst = _mm_loadu_si128((__m128i *)&pixels[pixel]);
+      _mm_storeu_si128((__m128i *)&pixels[pixel], RasterBlendSSE2(dst, src, inverse));
+    }
+  }
+
+  RasterSpanScalar(&pixels[pixel], count - pixel, color);
+}
+
+// Unpacking and packing both work within 128 bit lanes, so the pixels come back out in their original order.
+RASTER_AVX2_TARGET void RasterSpanAVX2(unsigned int *pixels, int count, unsigned int color) {
+  __m256i src = _mm256_set1_epi32((int)color);
+  int pixel = 0;
+
+  if ((color >> 24) == 255) {
+    for (; pixel + 8 <= count; pixel += 8)
+      _mm256_storeu_si256((__m256i *)&pixels[pixel], src);
+  } else {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i bias = _mm256_set1_epi16(128);
+    __m256i inverse = _mm256_set1_epi16((short)(255 - (color >> 24)));
+    for (; pixel + 8 <= count; pixel += 8) {
+      __m256i dst = _mm256_loadu_si256((__m256i *)&pixels[pixel]);
+      __m256i low = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(dst, zero), inverse), bias);
+      __m256i high = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(dst, zero), inverse), bias);
+      low = _mm256_srli_epi16(_mm256_add_epi16(low, _mm256_srli_epi16(low, 8)), 8);
+      high = _mm256_srli_epi16(_mm256_add_epi16(high, _mm256_srli_epi16(high, 8)), 8);
+      _mm256_storeu_si256((__m256i *)&pixels[pixel], _mm256_add_epi8(_mm256_packus_epi16(low, high), src));
+    }
+  }
+
+  RasterSpanScalar(&pixels[pixel], count - pixel, color);
+}
+
+#if defined(_MSC_VER)
+bool RasterCpuHas(enum RasterSpans spans) {
+  int info[4];
+  __cpuid(info, 1);
+  if (spans == RasterSpans_SSE2)
+    return (info[3] & (1 << 26)) != 0;
+
+  // AVX2 also needs the operating system to save the wide registers.
+  bool osSavesAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+  __cpuidex(info, 7, 0);
+  return osSavesAvx && (info[1] & (1 << 5));
+}
+#else
+bool RasterCpuHas(enum RasterSpans spans) {
+  if (spans == RasterSpans_SSE2)
+    return __builtin_cpu_supports("sse2");
+  return __builtin_cpu_supports("avx2");
+}
+#endif
+
+void (*rasterSpanFns[RasterSpans_Count])(unsigned int *pixels, int count, unsigned int color) = {
+    RasterSpanScalar,
+    RasterSpanSSE2,
+    RasterSpanAVX2,
+};
+
+#else
+
+bool RasterCpuHas(enum RasterSpans spans) { return false; }
+
+void (*rasterSpanFns[RasterSpans_Count])(unsigned int *pixels, int count, unsigned int color) = {
+    RasterSpanScalar,
+    RasterSpanScalar,
+    RasterSpanScalar,
+};
+
+#endif
+
+const char *RasterSpansName(enum RasterSpans spans) {
+  static const char *names[RasterSpans_Count] = {"scalar", "sse2", "avx2"};
+  AssertIndex(spans, RasterSpans_Count);
+  return names[spans];
+}
+
+bool RasterSpansSupported(enum RasterSpans spans) {
+  AssertIndex(spans, RasterSpans_Count);
+  return spans == RasterSpans_Scalar || RasterCpuHas(spans);
+}
+
+void RasterAttach(unsigned int *pixels, int width, int height, struct Point origin) {
+  AssertNotNull(pixels);
+
+  if (raster.ownsPixels && raster.pixels != pixels)
+    FreeBytes(raster.pixels);
+
+  raster.pixels = pixels;
+  raster.ownsPixels = false;
+  raster.width = width;
+  raster.height = height;
+  raster.origin = origin;
+  raster.clip.x = 0;
+  raster.clip.y = 0;
+  raster.clip.width = width;
+  raster.clip.height = height;
+
+  raster.spans = RasterSpans_Scalar;
+  for (int spans = RasterSpans_Count - 1; spans > RasterSpans_Scalar; spans--) {
+    if (RasterSpansSupported((enum RasterSpans)spans)) {
+      raster.spans = (enum RasterSpans)spans;
+      break;
+    }
+  }
+}
+
+void RasterAllocate(int width, int height, struct Point origin) {
+  unsigned int *pixels = raster.pixels;
+  if (!raster.ownsPixels || raster.width != width || raster.height != height) {
+    if (raster.ownsPixels)
+      FreeBytes(raster.pixels);
+    raster.pixels = NULL;
+    raster.ownsPixels = false;
+    pixels = AllocateArray(unsigned int, width * height);
+  }
+
+  RasterAttach(pixels, width, height, origin);
+  raster.ownsPixels = true;
+}
+
+void ReleaseRaster() {
+  if (raster.ownsPixels)
+    FreeBytes(raster.pixels);
+  memset(&raster, 0, sizeof(raster));
+}
+
+void RasterSetClip(struct Bounds clip) {
+  int left = clip.x - raster.origin.x;
+  int top = clip.y - raster.origin.y;
+  int right = left + clip.width;
+  int bottom = top + clip.height;
+
+  left = left < 0 ? 0 : left;
+  top = top < 0 ? 0 : top;
+  right = right > raster.width ? raster.width : right;
+  bottom = bottom > raster.height ? raster.height : bottom;
+
+  raster.clip.x = left;
+  raster.clip.y = top;
+  raster.clip.width = right > left ? right - left : 0;
+  raster.clip.height = bottom > top ? bottom - top : 0;
+}
+
+unsigned int RasterCoverageColor(unsigned int color, float coverage) {
+  unsigned int scale = (unsigned int)(coverage * 255 + 0.5f);
+  return scale >= 255 ? color : RasterScale(color, scale);
+}
+
+// Blends an already scaled colour over count pixels of a row, which the caller has clipped. Single pixels, which the
+// edges of thin strokes are mostly made of, skip the span function.
+void RasterSpan(int y, int x, int count, unsigned int color) {
+  if (count <= 0 || color == 0)
+    return;
+
+  unsigned int *pixels = &raster.pixels[y * raster.width + x];
+  if (count == 1)
+    *pixels = (color >> 24) == 255 ? color : RasterBlend(*pixels, color);
+  else
+    rasterSpanFns[raster.spans](pixels, count, color);
+  raster.spanCount++;
+  raster.pixelCount += count;
+}
+
+// Stores rather than blends, so a translucent clear leaves a translucent buffer for a per-pixel alpha window.
+void RasterClear(unsigned int color) {
+  color = RasterPremultiply(color);
+  for (int y = raster.clip.y; y < raster.clip.y + raster.clip.height; y++) {
+    unsigned int *row = &raster.pixels[y * raster.width + raster.clip.x];
+    for (int x = 0; x < raster.clip.width; x++)
+      row[x] = color;
+  }
+  raster.spanCount += raster.clip.height;
+  raster.pixelCount += (long long)raster.clip.width * raster.clip.height;
+}
+
+// Fills [x0, x1) x [y0, y1) in buffer pixels, covering the pixels on its edges by the fraction of them it overlaps.
+void RasterFillRectangle(float x0, float y0, float x1, float y1, unsigned int color) {
+  float left = fmaxf(x0, (float)raster.clip.x);
+  float top = fmaxf(y0, (float)raster.clip.y);
+  float right = fminf(x1, (float)(raster.clip.x + raster.clip.width));
+  float bottom = fminf(y1, (float)(raster.clip.y + raster.clip.height));
+  if (left >= right || top >= bottom)
+    return;
+
+  int firstRow = (int)floorf(top);
+  int lastRow = (int)ceilf(bottom);
+  int firstColumn = (int)floorf(left);
+  int lastColumn = (int)ceilf(right) - 1;
+
+  float leftCoverage = firstColumn == lastColumn ? right - left : firstColumn + 1 - left;
+  float rightCoverage = right - lastColumn;
+
+  // Rows between the first and the last are fully covered vertically, so their colours are worked out once.
+  unsigned int leftColor = RasterCoverageColor(color, leftCoverage);
+  unsigned int rightColor = RasterCoverageColor(color, rightCoverage);
+
+  for (int row = firstRow; row < lastRow; row++) {
+    float rowCoverage = fminf(bottom, (float)(row + 1)) - fmaxf(top, (float)row);
+    if (rowCoverage >= 1) {
+      RasterSpan(row, firstColumn, 1, leftColor);
+      if (firstColumn != lastColumn) {
+        RasterSpan(row, firstColumn + 1, lastColumn - firstColumn - 1, color);
+        RasterSpan(row, lastColumn, 1, rightColor);
+      }
+      continue;
+    }
+
+    RasterSpan(row, firstColumn, 1, RasterCoverageColor(color, leftCoverage * rowCoverage));
+    if (firstColumn != lastColumn) {
+      RasterSpan(row, firstColumn + 1, lastColumn - firstColumn - 1, RasterCoverageColor(color, rowCoverage));
+      RasterSpan(row, lastColumn, 1, RasterCoverageColor(color, rightCoverage * rowCoverage));
+    }
+  }
+}
+
+void RasterFillBounds(struct Bounds bounds, unsigned int color) {
+  float x = (float)(bounds.x - raster.origin.x);
+  float y = (float)(bounds.y - raster.origin.y);
+  RasterFillRectangle(x, y, x + bounds.width, y + bounds.height, RasterPremultiply(color));
+}
+
+void RasterFillPixel(int x, int y, unsigned int color, float coverage) {
+  if (x < raster.clip.x || x >= raster.clip.x + raster.clip.width)
+    return;
+  if (y < raster.clip.y || y >= raster.clip.y + raster.clip.height)
+    return;
+  RasterSpan(y, x, 1, RasterCoverageColor(color, coverage));
+}
+
+float RasterCoverage(float distance) { return fminf(fmaxf(0.5f - distance, 0), 1); }
+
+// Signed distance from a point to a box with rounded corners, negative inside.
+float RasterRoundedBoxDistance(float x, float y, float centerX, float centerY, float halfWidth, float halfHeight,
+                               float radius) {
+  float qx = fabsf(x - centerX) - (halfWidth - radius);
+  float qy = fabsf(y - centerY) - (halfHeight - radius);
+  float outside = sqrtf(fmaxf(qx, 0) * fmaxf(qx, 0) + fmaxf(qy, 0) * fmaxf(qy, 0));
+  return outside + fminf(fmaxf(qx, qy), 0) - radius;
+}
+
+// An inset outline: the straight runs are filled as rectangles, and only the corners are covered pixel by pixel, as
+// the area between the outer rounded box and the one inset by the pen width.
+void RasterStrokeRoundedRectangle(struct Bounds bounds, float radius, float width, unsigned int color) {
+  if (bounds.width <= 0 || bounds.height <= 0)
+    return;
+
+  float x = (float)(bounds.x - raster.origin.x);
+  float y = (float)(bounds.y - raster.origin.y);
+  float w = (float)bounds.width;
+  float h = (float)bounds.height;
+  width = fminf(width, fminf(w, h) / 2);
+  radius = fminf(radius, fminf(w, h) / 2);
+  float innerRadius = fmaxf(radius - width, 0);
+
+  int corner = (int)ceilf(fmaxf(radius, width));
+  int topRows = corner < (bounds.height + 1) / 2 ? corner : (bounds.height + 1) / 2;
+  int bottomRows = corner < bounds.height - topRows ? corner : bounds.height - topRows;
+  int leftColumns = corner < (bounds.width + 1) / 2 ? corner : (bounds.width + 1) / 2;
+  int rightColumns = corner < bounds.width - leftColumns ? corner : bounds.width - leftColumns;
+
+  RasterFillRectangle(x + leftColumns, y, x + w - rightColumns, y + width, color);
+  RasterFillRectangle(x + leftColumns, y + h - width, x + w - rightColumns, y + h, color);
+  RasterFillRectangle(x, y + topRows, x + width, y + h - bottomRows, color);
+  RasterFillRectangle(x + w - width, y + topRows, x + w, y + h - bottomRows, color);
+
+  float centerX = x + w / 2;
+  float centerY = y + h / 2;
+  bool hasInner = w / 2 - width > 0 && h / 2 - width > 0;
+  int rows[2][2] = {{0, topRows}, {bounds.height - bottomRows, bounds.height}};
+  int columns[2][2] = {{0, leftColumns}, {bounds.width - rightColumns, bounds.width}};
+  for (int rowRange = 0; rowRange < 2; rowRange++) {
+    for (int columnRange = 0; columnRange < 2; columnRange++) {
+      for (int row = rows[rowRange][0]; row < rows[rowRange][1]; row++) {
+        for (int column = columns[columnRange][0]; column < columns[columnRange][1]; column++) {
+          float px = x + column + 0.5f;
+          float py = y + row + 0.5f;
+          float coverage = RasterCoverage(RasterRoundedBoxDistance(px, py, centerX, centerY, w / 2, h / 2, radius));
+          if (hasInner)
+            coverage -= RasterCoverage(
+                RasterRoundedBoxDistance(px, py, centerX, centerY, w / 2 - width, h / 2 - width, innerRadius));
+          if (coverage > 0)
+            RasterFillPixel((int)x + column, (int)y + row, color, coverage);
+        }
+      }
+    }
+  }
+}
+
+// Dash-dot as GDI+ draws it: a dash three pen widths long, then a gap, a dot and a gap of one pen width each.
+const float rasterDashPattern[] = {3, 1, 1, 1};
+#define RASTER_DASH_PERIOD 6
+
+bool RasterDashOn(float distance, float width) {
+  float phase = fmodf(distance, RASTER_DASH_PERIOD * width);
+  return phase < 3 * width || (phase >= 4 * width && phase < 5 * width);
+}
+
+// Lines have flat caps and are centred on the path. Horizontal and vertical lines, the only ones the overlay draws,
+// are filled as one rectangle per dash; anything else is covered pixel by pixel from its distance to the line.
+void RasterStrokeLine(float x0, float y0, float x1, float y1, float width, bool dashed, unsigned int color) {
+  float dx = x1 - x0;
+  float dy = y1 - y0;
+  float length = sqrtf(dx * dx + dy * dy);
+  if (length == 0)
+    return;
+
+  if (dx == 0 || dy == 0) {
+    float start = 0;
+    for (int dash = 0; start < length; dash = (dash + 1) % 4) {
+      float end = fminf(start + rasterDashPattern[dash] * width, length);
+      if (!dashed)
+        end = length;
+      if (!dashed || dash % 2 == 0) {
+        if (dy == 0) {
+          float from = x0 + (dx > 0 ? start : -end);
+          float to = x0 + (dx > 0 ? end : -start);
+          RasterFillRectangle(from, y0 - width / 2, to, y0 + width / 2, color);
+        } else {
+          float from = y0 + (dy > 0 ? start : -end);
+          float to = y0 + (dy > 0 ? end : -start);
+          RasterFillRectangle(x0 - width / 2, from, x0 + width / 2, to, color);
+        }
+      }
+      start = end;
+    }
+    return;
+  }
+
+  int left = (int)floorf(fminf(x0, x1) - width);
+  int right = (int)ceilf(fmaxf(x0, x1) + width);
+  int top = (int)floorf(fminf(y0, y1) - width);
+  int bottom = (int)ceilf(fmaxf(y0, y1) + width);
+  for (int y = top; y < bottom; y++) {
+    for (int x = left; x < right; x++) {
+      float px = x + 0.5f - x0;
+      float py = y + 0.5f - y0;
+      float along = (px * dx + py * dy) / length;
+      if (along < 0 || along > length || (dashed && !RasterDashOn(along, width)))
+        continue;
+      float across = fabsf(px * dy - py * dx) / length;
+      RasterFillPixel(x, y, color, fminf(fmaxf(width / 2 + 0.5f - across, 0), 1));
+    }
+  }
+}
+
+void RasterDrawLine(struct Point from, struct Point to, enum LineStyle style) {
+  const struct LineStyleInfo *info = &lineStyles[style];
+  RasterStrokeLine((float)(from.x - raster.origin.x), (float)(from.y - raster.origin.y),
+                   (float)(to.x - raster.origin.x), (float)(to.y - raster.origin.y), info->width, info->dashed,
+                   RasterPremultiply(info->color));
+}
+
+// Outlines are drawn solid whatever their style; the overlay only dashes lines.
+void RasterDrawRectangle(struct Bounds bounds, enum LineStyle style) {
+  const struct LineStyleInfo *info = &lineStyles[style];
+  RasterStrokeRoundedRectangle(bounds, 0, info->width, RasterPremultiply(info->color));
+}
+
+void RasterDrawRoundedRectangle(struct Bounds bounds, int diameter, enum LineStyle style) {
+  const struct LineStyleInfo *info = &lineStyles[style];
+  RasterStrokeRoundedRectangle(bounds, diameter / 2.0f, info->width, RasterPremultiply(info->color));
+}
+
+void RasterDrawText(int, int, int, const char *) {}
+
+unsigned long long RasterHash() {
+  unsigned long long hash = 14695981039346656037ull;
+  for (int pixel = 0; pixel < raster.width * raster.height; pixel++)
+    hash = (hash ^ raster.pixels[pixel]) * 1099511628211ull;
+  return hash;
+}
+
+struct Backend rasterBackend = {
+    "raster",
+    RasterDrawLine,
+    RasterDrawRectangle,
+    RasterDrawRoundedRectangle,
+    RasterDrawText,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+};
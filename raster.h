@@ -0,0 +1,57 @@
+#pragma once
+
+#include "backend.h"
+
+// A software rasterizer for the overlay's primitives, drawing into a premultiplied BGRA buffer. It stands in for GDI+
+// where that is slow (full screen translucent redraws) or missing (the Linux build), and its output can be hashed and
+// compared pixel for pixel. Edges are anti-aliased by the area of each pixel they cover; runs of pixels with equal
+// coverage are blended by a span function chosen for the best instruction set the processor has. Every span function
+// produces exactly the same pixels. Text is not rasterized.
+
+enum RasterSpans {
+  RasterSpans_Scalar,
+  RasterSpans_SSE2,
+  RasterSpans_AVX2,
+  RasterSpans_Count,
+};
+
+struct Raster {
+  int width;
+  int height;
+  unsigned int *pixels;
+  bool ownsPixels;
+
+  // The screen position of the top left pixel, and the part of the buffer drawing is limited to, in buffer pixels.
+  struct Point origin;
+  struct Bounds clip;
+
+  enum RasterSpans spans;
+
+  long long spanCount;
+  long long pixelCount;
+};
+
+extern struct Raster raster;
+extern struct Backend rasterBackend;
+
+const char *RasterSpansName(enum RasterSpans spans);
+bool RasterSpansSupported(enum RasterSpans spans);
+
+// Draws into width * height pixels, rows top to bottom, owned by the caller. The fastest supported span function is
+// selected and the clip reset to the whole buffer.
+void RasterAttach(unsigned int *pixels, int width, int height, struct Point origin);
+
+// As RasterAttach, into a buffer the rasterizer allocates, and keeps while the size stays the same.
+void RasterAllocate(int width, int height, struct Point origin);
+void ReleaseRaster();
+
+// Limits drawing to clip, in screen coordinates.
+void RasterSetClip(struct Bounds clip);
+
+// Replaces everything inside the clip with an ARGB colour, which may be translucent.
+void RasterClear(unsigned int color);
+
+// Blends a possibly translucent ARGB colour over bounds, in screen coordinates.
+void RasterFillBounds(struct Bounds bounds, unsigned int color);
+
+unsigned long long RasterHash();
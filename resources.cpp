@@ -0,0 +1,95 @@
+#include "resources.h"
+
+void *ResourcePen(struct ResourceCache *cache, enum LineStyle style) {
+  AssertNotNull(cache);
+  AssertIndex(style, LineStyle_Count);
+
+  cache->lookups++;
+  if (cache->pens[style] == NULL) {
+    cache->pens[style] = cache->createPenFn(style, cache->scale);
+    cache->creations++;
+  }
+  return cache->pens[style];
+}
+
+void *ResourceFont(struct ResourceCache *cache, int size) {
+  AssertNotNull(cache);
+
+  cache->lookups++;
+  for (int font = 0; font < cache->fontCount; font++)
+    if (cache->fonts[font].size == size)
+      return cache->fonts[font].font;
+
+  // Few sizes are in use at once, so when the table is full the oldest entry makes way.
+  struct ResourceFont *entry;
+  if (cache->fontCount < RESOURCE_FONT_LIMIT) {
+    entry = &cache->fonts[cache->fontCount++];
+  } else {
+    entry = &cache->fonts[cache->nextFont];
+    cache->nextFont = (cache->nextFont + 1) % RESOURCE_FONT_LIMIT;
+    cache->destroyFontFn(entry->font);
+  }
+  entry->size = size;
+  entry->font = cache->createFontFn(size, cache->scale);
+  cache->creations++;
+  return entry->font;
+}
+
+unsigned int ResourceTextHash(const char *text, int size) {
+  unsigned int hash = 2166136261u ^ (unsigned int)size;
+  for (const char *c = text; *c; c++)
+    hash = (hash ^ (unsigned char)*c) * 16777619u;
+  return hash;
+}
+
+void *ResourceText(struct ResourceCache *cache, const char *text, int size) {
+  AssertNotNull(cache);
+  AssertNotNull(text);
+
+  if (strlen(text) >= RESOURCE_TEXT_LENGTH)
+    return NULL;
+
+  cache->lookups++;
+  struct ResourceText *entry = &cache->texts[ResourceTextHash(text, size) % RESOURCE_TEXT_LIMIT];
+  if (entry->layout != NULL && entry->size == size && strcmp(entry->text, text) == 0)
+    return entry->layout;
+
+  if (entry->layout != NULL)
+    cache->destroyTextFn(entry->layout);
+  entry->size = size;
+  strcpy(entry->text, text);
+  entry->layout = cache->createTextFn(text, size, cache->scale);
+  cache->creations++;
+  return entry->layout;
+}
+
+void FlushResources(struct ResourceCache *cache) {
+  AssertNotNull(cache);
+
+  for (int style = 0; style < LineStyle_Count; style++) {
+    if (cache->pens[style] != NULL)
+      cache->destroyPenFn(cache->pens[style]);
+    cache->pens[style] = NULL;
+  }
+
+  for (int font = 0; font < cache->fontCount; font++)
+    cache->destroyFontFn(cache->fonts[font].font);
+  cache->fontCount = 0;
+  cache->nextFont = 0;
+
+  for (int text = 0; text < RESOURCE_TEXT_LIMIT; text++) {
+    if (cache->texts[text].layout != NULL)
+      cache->destroyTextFn(cache->texts[text].layout);
+    cache->texts[text].layout = NULL;
+  }
+}
+
+void SetResourceScale(struct ResourceCache *cache, float scale) {
+  AssertNotNull(cache);
+
+  if (cache->scale == scale)
+    return;
+
+  FlushResources(cache);
+  cache->scale = scale;
+}
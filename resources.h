@@ -0,0 +1,56 @@
+#pragma once
+
+#include "core.h"
+
+// Backend drawing objects are expensive to create, so a renderer looks them up here rather than building them per
+// primitive. Pens are keyed by LineStyle, fonts by pixel size and laid out text by string and size. Everything is
+// created on first use and kept until the scale changes, for example when the overlay moves to a monitor with a
+// different DPI.
+
+#define RESOURCE_FONT_LIMIT 8
+#define RESOURCE_TEXT_LIMIT 64
+#define RESOURCE_TEXT_LENGTH 64
+
+struct ResourceFont {
+  int size;
+  void *font;
+};
+
+// Direct mapped by a hash of the string and size; a colliding entry replaces the old one.
+struct ResourceText {
+  int size;
+  char text[RESOURCE_TEXT_LENGTH];
+  void *layout;
+};
+
+struct ResourceCache {
+  void *(*createPenFn)(enum LineStyle style, float scale);
+  void *(*createFontFn)(int size, float scale);
+  void *(*createTextFn)(const char *text, int size, float scale);
+  void (*destroyPenFn)(void *pen);
+  void (*destroyFontFn)(void *font);
+  void (*destroyTextFn)(void *layout);
+
+  float scale;
+
+  void *pens[LineStyle_Count];
+
+  int fontCount;
+  int nextFont;
+  struct ResourceFont fonts[RESOURCE_FONT_LIMIT];
+
+  struct ResourceText texts[RESOURCE_TEXT_LIMIT];
+
+  long long lookups;
+  long long creations;
+};
+
+void *ResourcePen(struct ResourceCache *cache, enum LineStyle style);
+void *ResourceFont(struct ResourceCache *cache, int size);
+
+// Returns NULL for text too long to cache, which the caller then draws directly.
+void *ResourceText(struct ResourceCache *cache, const char *text, int size);
+
+// Drops everything if the scale differs from the one the resources were made for.
+void SetResourceScale(struct ResourceCache *cache, float scale);
+void FlushResources(struct ResourceCache *cache);
@@ -0,0 +1,205 @@
+#include <stdio.h>
+
+#include "rules.h"
+
+void InitRuleSet(struct RuleSet *rules) {
+  AssertNotNull(rules);
+
+  memset(rules, 0, sizeof(*rules));
+  InitHandleTable(&rules->windows, sizeof(struct RuleWindow), 256);
+  for (int field = 0; field < RuleField_Count; field++)
+    InitPatternSet(&rules->fields[field]);
+}
+
+void ForgetAllWindowRules(struct RuleSet *rules) {
+  for (int index = 0; index < rules->windows.capacity; index++)
+    FreeBytes(HandleEntry(struct RuleWindow, &rules->windows, index)->allowed);
+  ReleaseHandleTable(&rules->windows);
+}
+
+void ReleaseRuleSet(struct RuleSet *rules) {
+  AssertNotNull(rules);
+
+  ForgetAllWindowRules(rules);
+  for (int rule = 0; rule < rules->ruleCount; rule++)
+    FreeBytes(rules->rules[rule].cellName);
+  FreeBytes(rules->rules);
+  for (int field = 0; field < RuleField_Count; field++) {
+    ReleasePatternSet(&rules->fields[field]);
+    FreeBytes(rules->patternRules[field]);
+  }
+  FreeBytes(rules->matched);
+  InitRuleSet(rules);
+}
+
+int RuleWords(struct RuleSet *rules) { return (rules->ruleCount + 63) / 64; }
+
+bool AddRule(struct RuleSet *rules, const char *cellName, const char *classPattern, const char *titlePattern,
+             const char *processPattern, char *error, int errorSize) {
+  AssertNotNull(rules);
+  AssertNotNull(cellName);
+
+  if (rules->ruleCount == rules->ruleCapacity) {
+    int newCapacity = rules->ruleCapacity ? rules->ruleCapacity * 2 : 64;
+    struct Rule *newRules = AllocateArray(struct Rule, newCapacity);
+    if (rules->rules != NULL)
+      memcpy(newRules, rules->rules, rules->ruleCount * sizeof(struct Rule));
+    FreeBytes(rules->rules);
+    rules->rules = newRules;
+    rules->ruleCapacity = newCapacity;
+  }
+
+  // A pattern that compiled before a later one failed stays in its set, owned by no rule.
+  const char *patterns[RuleField_Count] = {
+      classPattern,
+      titlePattern,
+      processPattern,
+  };
+  struct Rule *rule = &rules->rules[rules->ruleCount];
+  for (int field = 0; field < RuleField_Count; field++) {
+    rule->patterns[field] = -1;
+    if (patterns[field] == NULL)
+      continue;
+
+    int pattern = AddPattern(&rules->fields[field], patterns[field], error, errorSize);
+    if (pattern < 0)
+      return false;
+
+    if (pattern >= rules->patternRuleCapacity[field]) {
+      int newCapacity = rules->patternRuleCapacity[field] ? rules->patternRuleCapacity[field] * 2 : 64;
+      int *newPatternRules = AllocateArray(int, newCapacity);
+      for (int index = 0; index < newCapacity; index++)
+        newPatternRules[index] = index < rules->patternRuleCapacity[field] ? rules->patternRules[field][index] : -1;
+      FreeBytes(rules->patternRules[field]);
+      rules->patternRules[field] = newPatternRules;
+      rules->patternRuleCapacity[field] = newCapacity;
+    }
+    rules->patternRules[field][pattern] = rules->ruleCount;
+    rule->patterns[field] = pattern;
+  }
+
+  size_t nameSize = strlen(cellName) + 1;
+  rule->cellName = AllocateArray(char, nameSize);
+  memcpy(rule->cellName, cellName, nameSize);
+  rules->ruleCount++;
+
+  // The cached results have no room for the new rule.
+  ForgetAllWindowRules(rules);
+  return true;
+}
+
+const char *RuleCellName(struct RuleSet *rules, int rule) {
+  AssertNotNull(rules);
+  AssertIndex(rule, rules->ruleCount);
+
+  return rules->rules[rule].cellName;
+}
+
+bool WindowRulesKnown(struct RuleSet *rules, WindowHandle hWnd) {
+  AssertNotNull(rules);
+
+  return FindHandleIndex(&rules->windows, hWnd) >= 0;
+}
+
+struct RuleWindow *AddRuleWindow(struct RuleSet *rules, WindowHandle hWnd) {
+  struct RuleWindow *window = (struct RuleWindow *)AddHandleEntry(&rules->windows, hWnd);
+  window->allowed = AllocateArray(unsigned long long, RuleField_Count * RuleWords(rules) + 1);
+  window->rule = -1;
+  return window;
+}
+
+void ForgetWindowRules(struct RuleSet *rules, WindowHandle hWnd) {
+  AssertNotNull(rules);
+
+  int index = FindHandleIndex(&rules->windows, hWnd);
+  if (index < 0)
+    return;
+  FreeBytes(HandleEntry(struct RuleWindow, &rules->windows, index)->allowed);
+  RemoveHandleIndex(&rules->windows, index);
+}
+
+unsigned int RuleTextHash(const char *text) {
+  unsigned int hash = 2166136261u;
+  for (const unsigned char *at = (const unsigned char *)text; *at; at++)
+    hash = (hash ^ *at) * 16777619u;
+  return hash;
+}
+
+// Matches one field's text and records the rules it allows: those whose pattern for the field matched, and those
+// without one.
+void MatchRuleField(struct RuleSet *rules, struct RuleWindow *window, int field, const char *text) {
+  struct PatternSet *set = &rules->fields[field];
+  int ruleWords = RuleWords(rules);
+  unsigned long long *allowed = &window->allowed[field * ruleWords];
+  memset(allowed, 0, ruleWords * sizeof(unsigned long long));
+
+  int patternWords = PatternWords(set);
+  if (patternWords > rules->matchedWords) {
+    FreeBytes(rules->matched);
+    rules->matched = AllocateArray(unsigned long long, patternWords);
+    rules->matchedWords = patternWords;
+  }
+  if (patternWords > 0) {
+    MatchPatterns(set, text, rules->matched);
+    rules->stats.fieldsMatched++;
+  }
+
+  for (int rule = 0; rule < rules->ruleCount; rule++) {
+    int pattern = rules->rules[rule].patterns[field];
+    if (pattern < 0 || (rules->matched[pattern >> 6] >> (pattern & 63)) & 1)
+      allowed[rule >> 6] |= 1ull << (rule & 63);
+  }
+}
+
+int MatchWindowRules(struct RuleSet *rules, WindowHandle hWnd, const char *const *texts) {
+  AssertNotNull(rules);
+  AssertNotNull(hWnd);
+  AssertNotNull(texts);
+
+  rules->stats.lookups++;
+  if (rules->ruleCount == 0)
+    return -1;
+
+  struct RuleWindow *window = (struct RuleWindow *)FindHandleEntry(&rules->windows, hWnd);
+  if (window == NULL)
+    window = AddRuleWindow(rules, hWnd);
+
+  bool changed = false;
+  for (int field = 0; field < RuleField_Count; field++) {
+    const char *text = texts[field];
+    if (text == NULL) {
+      if (window->known[field])
+        continue;
+      text = "";
+    }
+
+    unsigned int hash = RuleTextHash(text);
+    if (window->known[field] && window->textHashes[field] == hash)
+      continue;
+
+    MatchRuleField(rules, window, field, text);
+    window->textHashes[field] = hash;
+    window->known[field] = true;
+    changed = true;
+  }
+
+  if (!changed) {
+    rules->stats.cached++;
+    return window->rule;
+  }
+
+  // The first rule every field allows.
+  int ruleWords = RuleWords(rules);
+  window->rule = -1;
+  for (int word = 0; word < ruleWords && window->rule < 0; word++) {
+    unsigned long long allowed = window->allowed[word];
+    for (int field = 1; field < RuleField_Count; field++)
+      allowed &= window->allowed[field * ruleWords + word];
+    for (int bit = 0; allowed != 0; bit++, allowed >>= 1)
+      if (allowed & 1) {
+        window->rule = word * 64 + bit;
+        break;
+      }
+  }
+  return window->rule;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "bin.h"
+#include "handles.h"
+#include "patterns.h"
+
+// Rules that send new windows to named cells. A rule matches a window's class, title and process name against a
+// pattern each, any of which may be left out to match everything. The patterns for each field are compiled together
+// into one PatternSet, so a window is matched against every rule in a single pass per field however many rules there
+// are.
+//
+// What each field matched is cached per window, keyed by handle along with a hash of the text. When only the title
+// changes, only the title is matched again, and the rules are combined from the cached class and process results.
+
+enum RuleField {
+  RuleField_Class,
+  RuleField_Title,
+  RuleField_Process,
+  RuleField_Count,
+};
+
+struct Rule {
+  char *cellName;
+  // The pattern for each field in that field's set, or -1 if the rule does not look at it.
+  int patterns[RuleField_Count];
+};
+
+struct RuleWindow {
+  WindowHandle hWnd;
+  unsigned int textHashes[RuleField_Count];
+  bool known[RuleField_Count];
+  // For each field, the rules that field allows, ruleWords words each.
+  unsigned long long *allowed;
+  int rule;
+};
+
+struct RuleStats {
+  long long lookups;
+  long long cached;
+  long long fieldsMatched;
+};
+
+struct RuleSet {
+  int ruleCount;
+  int ruleCapacity;
+  struct Rule *rules;
+
+  struct PatternSet fields[RuleField_Count];
+  // The rule each pattern of each field belongs to.
+  int patternRuleCapacity[RuleField_Count];
+  int *patternRules[RuleField_Count];
+
+  // RuleWindow entries.
+  struct HandleTable windows;
+
+  unsigned long long *matched;
+  int matchedWords;
+
+  struct RuleStats stats;
+};
+
+void InitRuleSet(struct RuleSet *rules);
+void ReleaseRuleSet(struct RuleSet *rules);
+
+// Adds a rule that sends windows to the cell named cellName, after every rule added before it. NULL patterns match
+// anything. Returns false and describes the problem in error if a pattern does not compile.
+bool AddRule(struct RuleSet *rules, const char *cellName, const char *classPattern, const char *titlePattern,
+             const char *processPattern, char *error, int errorSize);
+
+// Returns the first rule matching the window, or -1. Each entry of texts is the current text of a field, or NULL if it
+// has not changed since the window was last matched; fields never given are treated as empty.
+int MatchWindowRules(struct RuleSet *rules, WindowHandle hWnd, const char *const *texts);
+
+// Whether the window has been matched since it was last forgotten.
+bool WindowRulesKnown(struct RuleSet *rules, WindowHandle hWnd);
+void ForgetWindowRules(struct RuleSet *rules, WindowHandle hWnd);
+
+const char *RuleCellName(struct RuleSet *rules, int rule);
@@ -0,0 +1,527 @@
+#include <stdio.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "snapshot.h"
+
+// Children of a grid beyond this many rows or columns are taken as a sign of a damaged file.
+#define SNAPSHOT_GRID_LIMIT 32768
+
+void ReserveSnapshotBuffer(struct SnapshotBuffer *buffer, size_t size) {
+  if (size <= buffer->capacity)
+    return;
+
+  size_t newCapacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+  while (newCapacity < size)
+    newCapacity *= 2;
+  char *newBytes = AllocateArray(char, newCapacity);
+  if (buffer->bytes != NULL)
+    memcpy(newBytes, buffer->bytes, buffer->size);
+  FreeBytes(buffer->bytes);
+  buffer->bytes = newBytes;
+  buffer->capacity = newCapacity;
+}
+
+void ReleaseSnapshotBuffer(struct SnapshotBuffer *buffer) {
+  AssertNotNull(buffer);
+
+  FreeBytes(buffer->bytes);
+  memset(buffer, 0, sizeof(*buffer));
+}
+
+enum SnapshotKind SnapshotBinKind(struct Bin *bin) {
+  if (bin == NULL)
+    return SnapshotKind_Empty;
+  if (BinCell(bin) != NULL)
+    return SnapshotKind_Cell;
+  if (bin->onLayoutFn == ShelfLayout)
+    return SnapshotKind_Shelf;
+  if (bin->onLayoutFn == SwirlLayout)
+    return SnapshotKind_Swirl;
+  if (bin->onLayoutFn == StackLayout)
+    return SnapshotKind_Stack;
+  AssertMessage(bin->onLayoutFn == GridLayout, ("A bin of unknown kind cannot be saved"));
+  return SnapshotKind_Grid;
+}
+
+// The slot sizes a container has, or 0 if it has none or they are all uniform.
+int SnapshotSizeCount(struct Bin *bin) {
+  if (bin == NULL)
+    return 0;
+  if (bin->onLayoutFn == ShelfLayout) {
+    struct Shelf *shelf = Unwrap(struct Shelf, bin, bin);
+    return TrackIsUniform(&shelf->track, shelf->slotCount) ? 0 : shelf->slotCount;
+  }
+  if (bin->onLayoutFn == GridLayout) {
+    struct Grid *grid = Unwrap(struct Grid, bin, bin);
+    if (TrackIsUniform(&grid->rows, grid->rowCount) && TrackIsUniform(&grid->columns, grid->columnCount))
+      return 0;
+    return grid->rowCount + grid->columnCount;
+  }
+  return 0;
+}
+
+// Copies the spans of a grid into spans, unless it is NULL, and returns how many there are.
+int SnapshotGridSpans(struct Bin *bin, struct SnapshotSpan *spans) {
+  if (bin == NULL || bin->onLayoutFn != GridLayout)
+    return 0;
+
+  struct Grid *grid = Unwrap(struct Grid, bin, bin);
+  if (grid->spanLeft == NULL)
+    return 0;
+
+  int count = 0;
+  for (int row = 0; row < grid->rowCount; row++) {
+    for (int column = 0; column < grid->columnCount; column++) {
+      struct SnapshotSpan span = {row, column, 1, 1};
+      GridGetSpan(grid, row, column, &span.rowCount, &span.columnCount);
+      if (span.rowCount == 1 && span.columnCount == 1)
+        continue;
+      if (spans != NULL)
+        spans[count] = span;
+      count++;
+    }
+  }
+  return count;
+}
+
+int SnapshotChildCount(const struct SnapshotNode *node) {
+  if (node->kind == SnapshotKind_Grid)
+    return node->rowCount * node->columnCount;
+  return node->kind == SnapshotKind_Empty ? 0 : node->rowCount;
+}
+
+void WriteSnapshot(struct Bin *root, unsigned long long layoutHash, struct SnapshotBuffer *buffer) {
+  AssertNotNull(root);
+  AssertNotNull(buffer);
+
+  // Lists the bins breadth first, so each one's children follow each other, and totals the sizes and names.
+  int queueCount = 0;
+  int queueCapacity = 256;
+  struct Bin **queue = AllocateArray(struct Bin *, queueCapacity);
+  queue[queueCount++] = root;
+  int sizeCount = 0;
+  int spanCount = 0;
+  int stringBytes = 0;
+  for (int index = 0; index < queueCount; index++) {
+    struct Bin *bin = queue[index];
+    if (bin == NULL)
+      continue;
+
+    struct Cell *cell = BinCell(bin);
+    if (cell != NULL && cell->name != NULL)
+      stringBytes += (int)strlen(cell->name) + 1;
+    sizeCount += SnapshotSizeCount(bin);
+    spanCount += SnapshotGridSpans(bin, NULL);
+
+    int childCount = BinChildCount(bin);
+    if (queueCount + childCount > queueCapacity) {
+      int newCapacity = queueCapacity * 2;
+      while (newCapacity < queueCount + childCount)
+        newCapacity *= 2;
+      struct Bin **newQueue = AllocateArray(struct Bin *, newCapacity);
+      memcpy(newQueue, queue, queueCount * sizeof(struct Bin *));
+      FreeBytes(queue);
+      queue = newQueue;
+      queueCapacity = newCapacity;
+    }
+    for (int child = 0; child < childCount; child++)
+      queue[queueCount++] = BinChild(bin, child);
+  }
+
+  size_t nodeBytes = queueCount * sizeof(struct SnapshotNode);
+  size_t sizeBytes = sizeCount * sizeof(struct SlotSize);
+  size_t spanBytes = spanCount * sizeof(struct SnapshotSpan);
+  buffer->size = 0;
+  ReserveSnapshotBuffer(buffer, sizeof(struct SnapshotHeader) + nodeBytes + sizeBytes + spanBytes + stringBytes);
+  buffer->size = sizeof(struct SnapshotHeader) + nodeBytes + sizeBytes + spanBytes + stringBytes;
+
+  struct SnapshotHeader *header = (struct SnapshotHeader *)buffer->bytes;
+  header->magic = SNAPSHOT_MAGIC;
+  header->version = SNAPSHOT_VERSION;
+  header->nodeCount = queueCount;
+  header->sizeCount = sizeCount;
+  header->spanCount = spanCount;
+  header->stringBytes = stringBytes;
+  header->layoutHash = layoutHash;
+
+  struct SnapshotNode *nodes = (struct SnapshotNode *)(header + 1);
+  struct SlotSize *sizes = (struct SlotSize *)(nodes + queueCount);
+  struct SnapshotSpan *spans = (struct SnapshotSpan *)(sizes + sizeCount);
+  char *strings = (char *)(spans + spanCount);
+  int sizeIndex = 0;
+  int spanIndex = 0;
+  int stringCount = 0;
+  int nextChild = 1;
+  for (int index = 0; index < queueCount; index++) {
+    struct Bin *bin = queue[index];
+    struct SnapshotNode *node = &nodes[index];
+    memset(node, 0, sizeof(*node));
+    node->kind = (unsigned char)SnapshotBinKind(bin);
+    node->name = -1;
+    node->firstSize = -1;
+    if (SnapshotSizeCount(bin) > 0)
+      node->firstSize = sizeIndex;
+
+    if (node->kind == SnapshotKind_Cell) {
+      struct Cell *cell = BinCell(bin);
+      node->rowCount = cell->subBin != NULL ? 1 : 0;
+      node->columnCount = 1;
+      if (cell->name != NULL) {
+        int length = (int)strlen(cell->name) + 1;
+        memcpy(&strings[stringCount], cell->name, length);
+        node->name = stringCount;
+        stringCount += length;
+      }
+    } else if (node->kind == SnapshotKind_Shelf) {
+      struct Shelf *shelf = Unwrap(struct Shelf, bin, bin);
+      node->direction = (unsigned char)shelf->direction;
+      node->rowCount = shelf->slotCount;
+      node->columnCount = 1;
+      if (node->firstSize >= 0) {
+        memcpy(&sizes[sizeIndex], shelf->track.sizes, shelf->slotCount * sizeof(struct SlotSize));
+        sizeIndex += shelf->slotCount;
+      }
+    } else if (node->kind == SnapshotKind_Grid) {
+      struct Grid *grid = Unwrap(struct Grid, bin, bin);
+      node->rowCount = grid->rowCount;
+      node->columnCount = grid->columnCount;
+      if (node->firstSize >= 0) {
+        memcpy(&sizes[sizeIndex], grid->rows.sizes, grid->rowCount * sizeof(struct SlotSize));
+        sizeIndex += grid->rowCount;
+        memcpy(&sizes[sizeIndex], grid->columns.sizes, grid->columnCount * sizeof(struct SlotSize));
+        sizeIndex += grid->columnCount;
+      }
+      node->firstSpan = spanIndex;
+      node->spanCount = SnapshotGridSpans(bin, &spans[spanIndex]);
+      spanIndex += node->spanCount;
+    } else if (node->kind == SnapshotKind_Swirl) {
+      struct Swirl *swirl = Unwrap(struct Swirl, bin, bin);
+      node->tightness = (unsigned short)swirl->tightness;
+      node->rowCount = swirl->slotCount;
+      node->columnCount = 1;
+    } else if (node->kind == SnapshotKind_Stack) {
+      struct Stack *stack = Unwrap(struct Stack, bin, bin);
+      node->direction = (unsigned char)stack->style;
+      node->rowCount = stack->slotCount;
+      node->columnCount = 1;
+      node->active = stack->active;
+    }
+
+    int childCount = SnapshotChildCount(node);
+    node->firstChild = childCount > 0 ? nextChild - index : 0;
+    nextChild += childCount;
+  }
+
+  FreeBytes(queue);
+}
+
+bool SaveSnapshot(const struct SnapshotBuffer *buffer, const char *path) {
+  AssertNotNull(buffer);
+  AssertNotNull(path);
+
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    ReportError("Could not open %s to save the layout", path);
+    return false;
+  }
+  bool written = fwrite(buffer->bytes, 1, buffer->size, file) == buffer->size;
+  if (fclose(file) != 0)
+    written = false;
+  if (!written)
+    ReportError("Could not save the layout to %s", path);
+  return written;
+}
+
+// Spans must fit their grid and cover only empty children besides their top left one. Spans that do not overlap cover
+// no more cells than the grid has, which keeps the checks as cheap as the children are many; any that overlap anyway
+// are left out by GridSetSpan.
+const char *ValidateSnapshotSpans(const struct SnapshotNode *node, const struct SnapshotNode *children,
+                                  const struct SnapshotSpan *spans, int spanCount) {
+  if (node->spanCount == 0)
+    return NULL;
+  if (node->kind != SnapshotKind_Grid || node->firstSpan < 0 || node->spanCount < 0 ||
+      node->spanCount > spanCount - node->firstSpan)
+    return "a node's spans are out of place";
+
+  long long area = 0;
+  for (int index = node->firstSpan; index < node->firstSpan + node->spanCount; index++) {
+    const struct SnapshotSpan *span = &spans[index];
+    if (span->row < 0 || span->column < 0 || span->rowCount < 1 || span->columnCount < 1 ||
+        span->rowCount > node->rowCount - span->row || span->columnCount > node->columnCount - span->column)
+      return "a span runs off its grid";
+    area += (long long)span->rowCount * span->columnCount;
+    if (area > (long long)node->rowCount * node->columnCount)
+      return "the spans of a grid overlap";
+
+    for (int row = span->row; row < span->row + span->rowCount; row++)
+      for (int column = span->column; column < span->column + span->columnCount; column++)
+        if ((row != span->row || column != span->column) &&
+            children[row * node->columnCount + column].kind != SnapshotKind_Empty)
+          return "a cell covered by a span holds a bin";
+  }
+  return NULL;
+}
+
+// Checks everything ReadSnapshot relies on, so that building the tree afterwards cannot fail part way through.
+const char *ValidateSnapshot(const void *data, size_t size) {
+  if (size < sizeof(struct SnapshotHeader))
+    return "it is too short";
+
+  const struct SnapshotHeader *header = (const struct SnapshotHeader *)data;
+  if (header->magic != SNAPSHOT_MAGIC)
+    return "it is not a snapshot";
+  if (header->version != SNAPSHOT_VERSION)
+    return "it is from another version";
+  size_t room = size - sizeof(struct SnapshotHeader);
+  if (header->nodeCount < 1 || header->sizeCount < 0 || header->spanCount < 0 || header->stringBytes < 0 ||
+      (size_t)header->nodeCount > room / sizeof(struct SnapshotNode))
+    return "its size does not match its header";
+  room -= header->nodeCount * sizeof(struct SnapshotNode);
+  if ((size_t)header->sizeCount > room / sizeof(struct SlotSize))
+    return "its size does not match its header";
+  room -= header->sizeCount * sizeof(struct SlotSize);
+  if ((size_t)header->spanCount > room / sizeof(struct SnapshotSpan) ||
+      room != header->spanCount * sizeof(struct SnapshotSpan) + header->stringBytes)
+    return "its size does not match its header";
+
+  const struct SnapshotNode *nodes = (const struct SnapshotNode *)(header + 1);
+  const struct SlotSize *sizes = (const struct SlotSize *)(nodes + header->nodeCount);
+  const struct SnapshotSpan *spans = (const struct SnapshotSpan *)(sizes + header->sizeCount);
+  const char *strings = (const char *)(spans + header->spanCount);
+  if (header->stringBytes > 0 && strings[header->stringBytes - 1] != '\0')
+    return "its last name is not terminated";
+  if (nodes[0].kind == SnapshotKind_Empty)
+    return "its root is empty";
+  for (int index = 0; index < header->sizeCount; index++) {
+    const struct SlotSize *size = &sizes[index];
+    if (size->weight < 0 || size->min < 0 || (size->max != 0 && size->max < size->min))
+      return "a slot size is out of range";
+  }
+
+  // Breadth first order puts each node's children right after those of the node before it.
+  int nextChild = 1;
+  for (int index = 0; index < header->nodeCount; index++) {
+    const struct SnapshotNode *node = &nodes[index];
+    if (node->name < -1 || node->name >= header->stringBytes)
+      return "a name is out of range";
+
+    switch (node->kind) {
+    case SnapshotKind_Empty:
+      break;
+    case SnapshotKind_Cell:
+      if (node->rowCount < 0 || node->rowCount > 1)
+        return "a cell has more than one sub bin";
+      break;
+    case SnapshotKind_Shelf:
+      if (node->direction > ShelfDirection_Vertical || node->rowCount < 0 || node->rowCount > header->nodeCount)
+        return "a shelf is malformed";
+      break;
+    case SnapshotKind_Grid:
+      if (node->rowCount < 1 || node->columnCount < 1 || node->rowCount > SNAPSHOT_GRID_LIMIT ||
+          node->columnCount > SNAPSHOT_GRID_LIMIT)
+        return "a grid is malformed";
+      break;
+    case SnapshotKind_Swirl:
+      if (node->tightness < 1 || node->rowCount < 0 || node->rowCount > header->nodeCount)
+        return "a swirl is malformed";
+      break;
+    case SnapshotKind_Stack:
+      if (node->direction > StackStyle_Tabs || node->rowCount < 0 || node->rowCount > header->nodeCount ||
+          node->active < 0 || (node->active > 0 && node->active >= node->rowCount))
+        return "a stack is malformed";
+      break;
+    default:
+      return "a node is of no known kind";
+    }
+
+    int childCount = SnapshotChildCount(node);
+    if (node->firstSize != -1) {
+      int sizeCount = node->kind == SnapshotKind_Grid ? node->rowCount + node->columnCount : node->rowCount;
+      if (node->kind == SnapshotKind_Empty || node->kind == SnapshotKind_Cell || node->kind == SnapshotKind_Swirl ||
+          node->kind == SnapshotKind_Stack || node->firstSize < 0 || sizeCount > header->sizeCount - node->firstSize)
+        return "a node's sizes are out of place";
+    }
+    if (childCount == 0)
+      continue;
+    if (node->firstChild != nextChild - index || childCount > header->nodeCount - nextChild)
+      return "a node's children are out of place";
+    if (node->kind == SnapshotKind_Cell && nodes[nextChild].kind == SnapshotKind_Empty)
+      return "a cell holds an empty sub bin";
+    const char *problem = ValidateSnapshotSpans(node, &nodes[nextChild], spans, header->spanCount);
+    if (problem != NULL)
+      return problem;
+    nextChild += childCount;
+  }
+  if (nextChild != header->nodeCount)
+    return "some nodes have no parent";
+
+  return NULL;
+}
+
+struct Bin *ReadSnapshot(struct Arena *arena, const void *data, size_t size) {
+  AssertNotNull(arena);
+
+  const char *problem = ValidateSnapshot(data, size);
+  if (problem != NULL) {
+    ReportError("The layout snapshot was not loaded because %s", problem);
+    return NULL;
+  }
+
+  const struct SnapshotHeader *header = (const struct SnapshotHeader *)data;
+  const struct SnapshotNode *nodes = (const struct SnapshotNode *)(header + 1);
+  const struct SlotSize *sizes = (const struct SlotSize *)(nodes + header->nodeCount);
+  const struct SnapshotSpan *spans = (const struct SnapshotSpan *)(sizes + header->sizeCount);
+  const char *strings = (const char *)(spans + header->spanCount);
+
+  struct Bin **bins = AllocateArray(struct Bin *, header->nodeCount);
+  for (int index = 0; index < header->nodeCount; index++) {
+    const struct SnapshotNode *node = &nodes[index];
+    if (node->kind == SnapshotKind_Cell) {
+      struct Cell *cell = NewCell(arena);
+      if (node->name >= 0)
+        cell->name = &strings[node->name];
+      bins[index] = Wrap(cell, bin);
+    } else if (node->kind == SnapshotKind_Shelf) {
+      struct Shelf *shelf = NewEmptyShelf(arena, (enum ShelfDirection)node->direction, node->rowCount);
+      if (node->firstSize >= 0)
+        memcpy(shelf->track.sizes, &sizes[node->firstSize], node->rowCount * sizeof(struct SlotSize));
+      bins[index] = Wrap(shelf, bin);
+    } else if (node->kind == SnapshotKind_Grid) {
+      struct Grid *grid = NewEmptyGrid(arena, node->rowCount, node->columnCount);
+      if (node->firstSize >= 0) {
+        memcpy(grid->rows.sizes, &sizes[node->firstSize], node->rowCount * sizeof(struct SlotSize));
+        memcpy(grid->columns.sizes, &sizes[node->firstSize + node->rowCount],
+               node->columnCount * sizeof(struct SlotSize));
+      }
+      for (int spanIndex = node->firstSpan; spanIndex < node->firstSpan + node->spanCount; spanIndex++) {
+        const struct SnapshotSpan *span = &spans[spanIndex];
+        GridSetSpan(grid, span->row, span->column, span->rowCount, span->columnCount);
+      }
+      bins[index] = Wrap(grid, bin);
+    } else if (node->kind == SnapshotKind_Swirl) {
+      struct Swirl *swirl = NewEmptySwirl(arena, node->rowCount, node->tightness);
+      bins[index] = Wrap(swirl, bin);
+    } else if (node->kind == SnapshotKind_Stack) {
+      struct Stack *stack = NewEmptyStack(arena, (enum StackStyle)node->direction, node->rowCount);
+      stack->active = node->active;
+      bins[index] = Wrap(stack, bin);
+    }
+  }
+
+  // Every bin starts out dirty, so the children are linked in directly rather than through the Put functions, which
+  // would mark the whole path to the root dirty again for each one.
+  for (int index = 0; index < header->nodeCount; index++) {
+    const struct SnapshotNode *node = &nodes[index];
+    struct Bin *bin = bins[index];
+    struct Bin **children = &bins[index + node->firstChild];
+    int childCount = SnapshotChildCount(node);
+    if (node->kind == SnapshotKind_Cell && childCount > 0) {
+      struct Cell *cell = Unwrap(struct Cell, bin, bin);
+      cell->subBin = children[0];
+      children[0]->parent = bin;
+    } else if (node->kind == SnapshotKind_Shelf || node->kind == SnapshotKind_Grid ||
+               node->kind == SnapshotKind_Swirl || node->kind == SnapshotKind_Stack) {
+      struct Shelf *shelf = Unwrap(struct Shelf, bin, bin);
+      struct Grid *grid = Unwrap(struct Grid, bin, bin);
+      struct Swirl *swirl = Unwrap(struct Swirl, bin, bin);
+      struct Stack *stack = Unwrap(struct Stack, bin, bin);
+      struct Bin **slots = node->kind == SnapshotKind_Shelf   ? shelf->bins
+                           : node->kind == SnapshotKind_Grid  ? grid->bins
+                           : node->kind == SnapshotKind_Swirl ? swirl->bins
+                                                              : stack->bins;
+      for (int child = 0; child < childCount; child++) {
+        slots[child] = children[child];
+        if (children[child] != NULL)
+          children[child]->parent = bin;
+      }
+    }
+  }
+
+  struct Bin *root = bins[0];
+  FreeBytes(bins);
+  return root;
+}
+
+bool OpenSnapshot(struct Snapshot *snapshot, const char *path) {
+  AssertNotNull(snapshot);
+  AssertNotNull(path);
+
+  memset(snapshot, 0, sizeof(*snapshot));
+
+#if defined(_WIN32)
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+    CloseHandle(file);
+    return false;
+  }
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  const void *data = mapping != NULL ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+  if (data == NULL) {
+    if (mapping != NULL)
+      CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+  snapshot->file = file;
+  snapshot->mapping = mapping;
+  snapshot->size = (size_t)size.QuadPart;
+#else
+  int file = open(path, O_RDONLY);
+  if (file < 0)
+    return false;
+  struct stat status;
+  if (fstat(file, &status) != 0 || status.st_size == 0) {
+    close(file);
+    return false;
+  }
+  void *data = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+  close(file);
+  if (data == MAP_FAILED)
+    return false;
+  snapshot->size = (size_t)status.st_size;
+#endif
+
+  snapshot->data = data;
+  return true;
+}
+
+void CloseSnapshot(struct Snapshot *snapshot) {
+  AssertNotNull(snapshot);
+
+  if (snapshot->data == NULL)
+    return;
+
+#if defined(_WIN32)
+  UnmapViewOfFile(snapshot->data);
+  CloseHandle((HANDLE)snapshot->mapping);
+  CloseHandle((HANDLE)snapshot->file);
+#else
+  munmap((void *)snapshot->data, snapshot->size);
+#endif
+  memset(snapshot, 0, sizeof(*snapshot));
+}
+
+struct Bin *LoadSnapshot(struct Arena *arena, struct Snapshot *snapshot) {
+  AssertNotNull(snapshot);
+  AssertNotNull(snapshot->data);
+
+  return ReadSnapshot(arena, snapshot->data, snapshot->size);
+}
+
+unsigned long long SnapshotLayoutHash(const struct Snapshot *snapshot) {
+  AssertNotNull(snapshot);
+  AssertNotNull(snapshot->data);
+
+  return ((const struct SnapshotHeader *)snapshot->data)->layoutHash;
+}
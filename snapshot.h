@@ -0,0 +1,97 @@
+#pragma once
+
+#include "bin.h"
+
+// A compact binary image of a bin tree, for saving the layout of each monitor between runs. The image is a header, a
+// flat table of fixed size nodes in breadth first order, so the children of every node are consecutive and found by a
+// relative index, a table of the slot sizes of containers that have other than uniform ones, a table of the spans of
+// grids, and a table of the cell names. Loading maps the file and builds the bins straight from the node
+// table in one pass, without parsing anything; the cell names point into the mapping rather than being copied.
+//
+// Windows held by cells are not saved, since their handles mean nothing to the next run. Numbers are in the byte order
+// of the machine that wrote them.
+
+#define SNAPSHOT_MAGIC 0x59444e57
+#define SNAPSHOT_VERSION 6
+
+enum SnapshotKind {
+  SnapshotKind_Empty,
+  SnapshotKind_Cell,
+  SnapshotKind_Shelf,
+  SnapshotKind_Grid,
+  SnapshotKind_Swirl,
+  SnapshotKind_Stack,
+};
+
+struct SnapshotHeader {
+  unsigned int magic;
+  unsigned int version;
+  int nodeCount;
+  int sizeCount;
+  int spanCount;
+  int stringBytes;
+  // The hash of the layout file entry the tree came from, so a snapshot taken before the entry changed can be told
+  // apart; 0 if the tree did not come from the layout file.
+  unsigned long long layoutHash;
+};
+
+struct SnapshotNode {
+  unsigned char kind;
+  unsigned char direction;
+  // A swirl's tightness, which is never 0.
+  unsigned short tightness;
+  // Offset of the cell's name in the string table, or -1.
+  int name;
+  // Index of the first child relative to this node. Shelves, swirls and stacks have rowCount children, grids rowCount
+  // * columnCount in row-major order, and cells one if they hold a sub bin.
+  int firstChild;
+  int rowCount;
+  int columnCount;
+  // Index of the container's first slot size in the size table, or -1 if they are all uniform. Shelves have rowCount
+  // sizes, grids rowCount for the rows followed by columnCount for the columns.
+  int firstSize;
+  // The grid's spans in the span table, which cover only Empty children apart from the top left one of each.
+  int firstSpan;
+  int spanCount;
+  // The slot a stack shows, whose style is in direction.
+  int active;
+};
+
+struct SnapshotSpan {
+  int row;
+  int column;
+  int rowCount;
+  int columnCount;
+};
+
+struct SnapshotBuffer {
+  size_t size;
+  size_t capacity;
+  char *bytes;
+};
+
+// A snapshot file mapped into memory.
+struct Snapshot {
+  const void *data;
+  size_t size;
+  void *file;
+  void *mapping;
+};
+
+// Writes the tree below root into buffer, replacing what it held.
+void WriteSnapshot(struct Bin *root, unsigned long long layoutHash, struct SnapshotBuffer *buffer);
+void ReleaseSnapshotBuffer(struct SnapshotBuffer *buffer);
+bool SaveSnapshot(const struct SnapshotBuffer *buffer, const char *path);
+
+// Builds the tree held in data in arena and returns its root, or reports the problem and returns NULL if data is not
+// a valid snapshot. Cell names point into data, which must outlive the tree.
+struct Bin *ReadSnapshot(struct Arena *arena, const void *data, size_t size);
+
+// Maps a snapshot file, returning false if it cannot be opened. The mapping must stay open while a tree read from it
+// is alive.
+bool OpenSnapshot(struct Snapshot *snapshot, const char *path);
+void CloseSnapshot(struct Snapshot *snapshot);
+struct Bin *LoadSnapshot(struct Arena *arena, struct Snapshot *snapshot);
+
+// The layout hash the snapshot was written with. Only valid once LoadSnapshot has accepted it.
+unsigned long long SnapshotLayoutHash(const struct Snapshot *snapshot);
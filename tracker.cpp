@@ -0,0 +1,127 @@
+#include "tracker.h"
+
+struct WindowTracker windowTracker;
+
+void ReleaseWindowTracker() {
+  for (int index = 0; index < windowTracker.windows.capacity; index++) {
+    struct TrackedWindow *window = HandleEntry(struct TrackedWindow, &windowTracker.windows, index);
+    if (window->cell != NULL)
+      window->cell->hWnd = NULL;
+  }
+
+  FreeBytes(windowTracker.windows.entries);
+  memset(&windowTracker, 0, sizeof(windowTracker));
+}
+
+struct TrackedWindow *FindTrackedWindow(WindowHandle hWnd) {
+  return (struct TrackedWindow *)FindHandleEntry(&windowTracker.windows, hWnd);
+}
+
+struct TrackedWindow *TrackWindow(WindowHandle hWnd, struct Bounds bounds, int flags) {
+  AssertNotNull(hWnd);
+  windowTracker.stats.events++;
+
+  struct TrackedWindow *window = FindTrackedWindow(hWnd);
+  if (window == NULL) {
+    if (windowTracker.windows.entrySize == 0)
+      InitHandleTable(&windowTracker.windows, sizeof(struct TrackedWindow), 256);
+    // Cells point at windows by handle, so the entries moving as the table grows is safe.
+    window = (struct TrackedWindow *)AddHandleEntry(&windowTracker.windows, hWnd);
+    windowTracker.stats.created++;
+  }
+
+  window->bounds = bounds;
+  window->flags = flags;
+  return window;
+}
+
+void TrackWindowDestroyed(WindowHandle hWnd) {
+  windowTracker.stats.events++;
+
+  int index = FindHandleIndex(&windowTracker.windows, hWnd);
+  if (index < 0) {
+    windowTracker.stats.ignored++;
+    return;
+  }
+
+  struct Cell *cell = HandleEntry(struct TrackedWindow, &windowTracker.windows, index)->cell;
+  if (cell != NULL) {
+    cell->hWnd = NULL;
+    MarkLayoutDirty(&cell->bin);
+  }
+  if (windowTracker.foreground == hWnd)
+    windowTracker.foreground = NULL;
+
+  RemoveHandleIndex(&windowTracker.windows, index);
+  windowTracker.stats.destroyed++;
+}
+
+void TrackWindowMoved(WindowHandle hWnd, struct Bounds bounds) {
+  windowTracker.stats.events++;
+
+  struct TrackedWindow *window = FindTrackedWindow(hWnd);
+  if (window == NULL) {
+    windowTracker.stats.ignored++;
+    return;
+  }
+  window->bounds = bounds;
+}
+
+void TrackWindowFlags(WindowHandle hWnd, int set, int clear) {
+  windowTracker.stats.events++;
+
+  struct TrackedWindow *window = FindTrackedWindow(hWnd);
+  if (window == NULL) {
+    windowTracker.stats.ignored++;
+    return;
+  }
+  window->flags = (window->flags & ~clear) | set;
+}
+
+void TrackForeground(WindowHandle hWnd) {
+  windowTracker.stats.events++;
+  windowTracker.foreground = hWnd;
+}
+
+void CellLinkWindow(struct Cell *cell, WindowHandle hWnd) {
+  AssertNotNull(cell);
+
+  if (cell->hWnd == hWnd)
+    return;
+
+  struct TrackedWindow *old = FindTrackedWindow(cell->hWnd);
+  if (old != NULL)
+    old->cell = NULL;
+  cell->hWnd = NULL;
+  cell->placedWindow = NULL;
+
+  if (hWnd != NULL) {
+    struct TrackedWindow *window = FindTrackedWindow(hWnd);
+    if (window == NULL) {
+      struct Bounds bounds = {};
+      window = TrackWindow(hWnd, bounds, TrackedWindow_Visible);
+    }
+    if (window->cell != NULL) {
+      window->cell->hWnd = NULL;
+      window->cell->placedWindow = NULL;
+      MarkLayoutDirty(&window->cell->bin);
+    }
+    window->cell = cell;
+    cell->hWnd = hWnd;
+  }
+}
+
+void CellSetWindow(struct Cell *cell, WindowHandle hWnd) {
+  AssertNotNull(cell);
+
+  if (cell->hWnd == hWnd)
+    return;
+
+  CellLinkWindow(cell, hWnd);
+  MarkLayoutDirty(&cell->bin);
+}
+
+struct Cell *WindowCell(WindowHandle hWnd) {
+  struct TrackedWindow *window = FindTrackedWindow(hWnd);
+  return window != NULL ? window->cell : NULL;
+}
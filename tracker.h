@@ -0,0 +1,60 @@
+#pragma once
+
+#include "bin.h"
+#include "handles.h"
+
+// An in-memory model of the desktop's top level windows, kept current by the window system's event notifications
+// instead of being enumerated on demand. Windows are found by handle through a handle table (handles.h), which also
+// links each window to the cell holding it. A destroyed window is unlinked from its cell at once, so nothing downstream
+// is ever handed a stale handle.
+
+enum TrackedWindowFlag {
+  TrackedWindow_Visible = 0x1,
+  TrackedWindow_Minimized = 0x2,
+};
+
+struct TrackedWindow {
+  WindowHandle hWnd;
+  struct Bounds bounds;
+  int flags;
+  struct Cell *cell;
+};
+
+struct TrackerStats {
+  long long events;
+  // Events about windows the tracker does not know, such as moves of windows it was never told about.
+  long long ignored;
+  long long created;
+  long long destroyed;
+};
+
+struct WindowTracker {
+  // TrackedWindow entries, set up on first use so the zeroed tracker is ready as it is.
+  struct HandleTable windows;
+
+  WindowHandle foreground;
+
+  struct TrackerStats stats;
+};
+
+extern struct WindowTracker windowTracker;
+
+void ReleaseWindowTracker();
+
+// Returns the tracked window, or NULL if there is none with this handle.
+struct TrackedWindow *FindTrackedWindow(WindowHandle hWnd);
+
+// Handlers for the window system's notifications. TrackWindow adds a window or refreshes one already known.
+struct TrackedWindow *TrackWindow(WindowHandle hWnd, struct Bounds bounds, int flags);
+void TrackWindowDestroyed(WindowHandle hWnd);
+void TrackWindowMoved(WindowHandle hWnd, struct Bounds bounds);
+void TrackWindowFlags(WindowHandle hWnd, int set, int clear);
+void TrackForeground(WindowHandle hWnd);
+
+// Puts a window in a cell, or takes it out with NULL. A window is in at most one cell, so it leaves any other first.
+// Cells give up their window when destroyed; a tree dropped by resetting its arena must empty its cells beforehand.
+void CellSetWindow(struct Cell *cell, WindowHandle hWnd);
+// As CellSetWindow, but leaves the cell's layout clean, for callers that place the window themselves. A cell the window
+// is taken from is still marked dirty.
+void CellLinkWindow(struct Cell *cell, WindowHandle hWnd);
+struct Cell *WindowCell(WindowHandle hWnd);
@@ -0,0 +1,162 @@
+#include "void.h"
+#include "placement.h"
+#include "tracker.h"
+
+void InitVoid(struct Void *parking, struct Point offscreen) {
+  AssertNotNull(parking);
+
+  memset(parking, 0, sizeof(*parking));
+  InitHandleTable(&parking->windows, sizeof(struct ParkedWindow), 64);
+  parking->offscreen = offscreen;
+}
+
+void ReleaseVoid(struct Void *parking) {
+  AssertNotNull(parking);
+
+  ReleaseHandleTable(&parking->windows);
+  InitVoid(parking, parking->offscreen);
+}
+
+struct ParkedWindow *FindParkedWindow(struct Void *parking, WindowHandle hWnd) {
+  AssertNotNull(parking);
+
+  return (struct ParkedWindow *)FindHandleEntry(&parking->windows, hWnd);
+}
+
+WindowHandle NewestParkedWindow(struct Void *parking) {
+  AssertNotNull(parking);
+
+  return parking->newest;
+}
+
+WindowHandle OlderParkedWindow(struct Void *parking, WindowHandle hWnd) {
+  struct ParkedWindow *window = FindParkedWindow(parking, hWnd);
+  return window != NULL ? window->older : NULL;
+}
+
+// Takes the entry at index out of the recency order and the table.
+void RemoveParkedIndex(struct Void *parking, int index) {
+  struct ParkedWindow *window = HandleEntry(struct ParkedWindow, &parking->windows, index);
+  struct ParkedWindow *newer = FindParkedWindow(parking, window->newer);
+  struct ParkedWindow *older = FindParkedWindow(parking, window->older);
+  if (newer != NULL)
+    newer->older = window->older;
+  else
+    parking->newest = window->older;
+  if (older != NULL)
+    older->newer = window->newer;
+  else
+    parking->oldest = window->newer;
+
+  RemoveHandleIndex(&parking->windows, index);
+}
+
+// Adds the window as the most recently parked one, or makes it so if it is parked already, and returns where it is
+// moved to.
+struct Bounds VoidAdd(struct Void *parking, WindowHandle hWnd, struct Bounds bounds) {
+  int index = FindHandleIndex(&parking->windows, hWnd);
+  if (index >= 0)
+    RemoveParkedIndex(parking, index);
+
+  // Entries link to each other by handle, so the entries moving as the table grows is safe.
+  struct ParkedWindow *window = (struct ParkedWindow *)AddHandleEntry(&parking->windows, hWnd);
+  window->bounds = bounds;
+  window->newer = NULL;
+  window->older = parking->newest;
+  struct ParkedWindow *older = FindParkedWindow(parking, parking->newest);
+  if (older != NULL)
+    older->newer = hWnd;
+  else
+    parking->oldest = hWnd;
+  parking->newest = hWnd;
+  parking->stats.parked++;
+
+  struct Bounds offscreen = {parking->offscreen.x, parking->offscreen.y, bounds.width, bounds.height};
+  return offscreen;
+}
+
+void ParkWindow(struct Void *parking, WindowHandle hWnd, struct Bounds bounds) {
+  AssertNotNull(parking);
+  AssertNotNull(hWnd);
+
+  PlaceWindow(hWnd, VoidAdd(parking, hWnd, bounds));
+}
+
+// Where a cell's window is: as the window system last reported it, or else the cell's bounds.
+struct Bounds VoidCellWindowBounds(struct Cell *cell) {
+  struct TrackedWindow *tracked = FindTrackedWindow(cell->hWnd);
+  if (tracked != NULL && tracked->bounds.width > 0 && tracked->bounds.height > 0)
+    return tracked->bounds;
+  return cell->bin.bounds;
+}
+
+bool ParkCellWindow(struct Void *parking, struct Cell *cell) {
+  AssertNotNull(parking);
+  AssertNotNull(cell);
+
+  WindowHandle hWnd = cell->hWnd;
+  if (hWnd == NULL)
+    return false;
+
+  struct Bounds bounds = VoidCellWindowBounds(cell);
+  CellLinkWindow(cell, NULL);
+  ParkWindow(parking, hWnd, bounds);
+  return true;
+}
+
+bool SwapParkedWindow(struct Void *parking, struct Cell *cell, WindowHandle hWnd) {
+  AssertNotNull(parking);
+  AssertNotNull(cell);
+  AssertMessage(cell->subBin == NULL, ("Only a cell without a sub bin can hold a window"));
+
+  if (hWnd == NULL)
+    hWnd = parking->newest;
+  int index = FindHandleIndex(&parking->windows, hWnd);
+  if (index < 0)
+    return false;
+
+  struct WindowPlacement moves[2];
+  int moveCount = 0;
+  RemoveParkedIndex(parking, index);
+  moves[moveCount].hWnd = hWnd;
+  moves[moveCount].bounds = cell->bin.bounds;
+  moveCount++;
+
+  WindowHandle swapped = cell->hWnd;
+  if (swapped != NULL) {
+    moves[moveCount].hWnd = swapped;
+    moves[moveCount].bounds = VoidAdd(parking, swapped, VoidCellWindowBounds(cell));
+    moveCount++;
+  }
+
+  // The cell keeps its bounds, so it is relinked rather than marked dirty, and the layout is left as it is. It records
+  // where its new window is put here, since no placement pass will.
+  CellLinkWindow(cell, hWnd);
+  cell->placedWindow = hWnd;
+  cell->placedBounds = cell->bin.bounds;
+  PlaceWindows(moves, moveCount);
+  parking->stats.swapped++;
+  return true;
+}
+
+bool RestoreParkedWindow(struct Void *parking, WindowHandle hWnd) {
+  AssertNotNull(parking);
+
+  int index = FindHandleIndex(&parking->windows, hWnd);
+  if (index < 0)
+    return false;
+
+  struct Bounds bounds = HandleEntry(struct ParkedWindow, &parking->windows, index)->bounds;
+  RemoveParkedIndex(parking, index);
+  PlaceWindow(hWnd, bounds);
+  parking->stats.restored++;
+  return true;
+}
+
+void ForgetParkedWindow(struct Void *parking, WindowHandle hWnd) {
+  AssertNotNull(parking);
+
+  int index = FindHandleIndex(&parking->windows, hWnd);
+  if (index >= 0)
+    RemoveParkedIndex(parking, index);
+}
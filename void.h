@@ -0,0 +1,63 @@
+#pragma once
+
+#include "bin.h"
+#include "handles.h"
+
+// Windows parked out of the way, off every monitor, to be swapped back into a cell when they are wanted again. The void
+// keeps, for each parked window, where it was before it was parked, and the order the windows were parked in, most
+// recent first. Windows are found by handle through a handle table (handles.h), whose entries link to their neighbours
+// in that order by handle, so parking, taking out and finding the most recent window all take constant time.
+//
+// A swap moves the two windows in one batch and relinks the cell to its new window directly. The cell keeps its bounds,
+// so nothing is marked dirty and the next layout pass has nothing to lay out or place on its account.
+
+struct ParkedWindow {
+  WindowHandle hWnd;
+  // Where the window was before it was parked.
+  struct Bounds bounds;
+  // The windows parked just after and just before this one, or NULL.
+  WindowHandle newer;
+  WindowHandle older;
+};
+
+struct VoidStats {
+  long long parked;
+  long long swapped;
+  long long restored;
+};
+
+struct Void {
+  // ParkedWindow entries.
+  struct HandleTable windows;
+
+  WindowHandle newest;
+  WindowHandle oldest;
+
+  // Where parked windows are moved to, keeping their size.
+  struct Point offscreen;
+
+  struct VoidStats stats;
+};
+
+void InitVoid(struct Void *parking, struct Point offscreen);
+void ReleaseVoid(struct Void *parking);
+
+// Returns the parked window, or NULL if the window is not parked.
+struct ParkedWindow *FindParkedWindow(struct Void *parking, WindowHandle hWnd);
+// The most recently parked window, and the one parked before a given one, or NULL.
+WindowHandle NewestParkedWindow(struct Void *parking);
+WindowHandle OlderParkedWindow(struct Void *parking, WindowHandle hWnd);
+
+// Moves a window that is in no cell offscreen, remembering bounds as where it was. Parking a window already parked
+// makes it the most recent.
+void ParkWindow(struct Void *parking, WindowHandle hWnd, struct Bounds bounds);
+// Parks the window of a cell, leaving the cell empty. Returns false if the cell has no window.
+bool ParkCellWindow(struct Void *parking, struct Cell *cell);
+// Swaps a parked window, or the most recently parked one if hWnd is NULL, with the window of a cell without a sub bin,
+// which is parked in its place if the cell has one. Both windows are moved in one batch. Returns false, changing
+// nothing, if there is no such parked window.
+bool SwapParkedWindow(struct Void *parking, struct Cell *cell, WindowHandle hWnd);
+// Moves a parked window back to where it was parked from. Returns false if the window is not parked.
+bool RestoreParkedWindow(struct Void *parking, WindowHandle hWnd);
+// Forgets a parked window, for when it is destroyed.
+void ForgetParkedWindow(struct Void *parking, WindowHandle hWnd);
@@ -0,0 +1,279 @@
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "watcher.h"
+
+struct FileWatcher {
+  char path[1024];
+  // The file's name within its directory, which is what the notifications carry.
+  const char *fileName;
+  double debounce;
+  void (*loadFn)(void *context, const char *path, double changedAt);
+  void *context;
+
+  std::thread thread;
+  std::mutex lock;
+  struct FileWatchStats stats;
+
+#if defined(_WIN32)
+  wchar_t wideName[MAX_PATH];
+  HANDLE directory;
+  HANDLE changeEvent;
+  HANDLE stopEvent;
+#else
+  int inotify;
+  // Written to by StopFileWatcher to wake the thread.
+  int stopPipe[2];
+#endif
+};
+
+double FileWatchClock() {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Folds one notification into the burst being debounced.
+void FileWatchNoticed(struct FileWatcher *watcher, bool *pending, double *firstChange, double *lastChange) {
+  double now = FileWatchClock();
+  if (!*pending)
+    *firstChange = now;
+  *pending = true;
+  *lastChange = now;
+
+  std::lock_guard<std::mutex> hold(watcher->lock);
+  watcher->stats.events++;
+}
+
+// Returns how long to wait for the next notification in milliseconds, or -1 for as long as it takes, loading the file
+// first if the burst has been over for the debounce time.
+int FileWatchSettle(struct FileWatcher *watcher, bool *pending, double firstChange, double lastChange) {
+  if (!*pending)
+    return -1;
+
+  double wait = lastChange + watcher->debounce - FileWatchClock();
+  if (wait > 0)
+    return (int)(wait * 1000) + 1;
+
+  *pending = false;
+  watcher->loadFn(watcher->context, watcher->path, firstChange);
+
+  std::lock_guard<std::mutex> hold(watcher->lock);
+  watcher->stats.loads++;
+  watcher->stats.lastLatency = FileWatchClock() - firstChange;
+  return -1;
+}
+
+#if defined(_WIN32)
+
+bool FileWatchRead(struct FileWatcher *watcher, DWORD *buffer, DWORD size, OVERLAPPED *overlapped) {
+  DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE;
+  return ReadDirectoryChangesW(watcher->directory, buffer, size, FALSE, filter, NULL, overlapped, NULL) != 0;
+}
+
+void FileWatchLoop(struct FileWatcher *watcher) {
+  DWORD buffer[4096];
+  OVERLAPPED overlapped = {};
+  overlapped.hEvent = watcher->changeEvent;
+  if (!FileWatchRead(watcher, buffer, sizeof(buffer), &overlapped))
+    return;
+
+  bool pending = false;
+  double firstChange = 0;
+  double lastChange = 0;
+  for (;;) {
+    int timeout = FileWatchSettle(watcher, &pending, firstChange, lastChange);
+    HANDLE handles[2] = {
+        watcher->changeEvent,
+        watcher->stopEvent,
+    };
+    DWORD woken = WaitForMultipleObjects(2, handles, FALSE, timeout < 0 ? INFINITE : (DWORD)timeout);
+    if (woken == WAIT_TIMEOUT)
+      continue;
+    if (woken != WAIT_OBJECT_0)
+      break;
+
+    DWORD bytes = 0;
+    if (!GetOverlappedResult(watcher->directory, &overlapped, &bytes, FALSE))
+      break;
+
+    // No bytes means the notifications overflowed the buffer, and the file may be among them.
+    bool changed = bytes == 0;
+    for (char *entry = (char *)buffer; bytes > 0;) {
+      FILE_NOTIFY_INFORMATION *info = (FILE_NOTIFY_INFORMATION *)entry;
+      int length = (int)(info->FileNameLength / sizeof(wchar_t));
+      if (length == (int)wcslen(watcher->wideName) && _wcsnicmp(info->FileName, watcher->wideName, length) == 0)
+        changed = true;
+      if (info->NextEntryOffset == 0)
+        break;
+      entry += info->NextEntryOffset;
+    }
+    if (changed)
+      FileWatchNoticed(watcher, &pending, &firstChange, &lastChange);
+
+    if (!FileWatchRead(watcher, buffer, sizeof(buffer), &overlapped))
+      break;
+  }
+
+  CancelIo(watcher->directory);
+  DWORD bytes;
+  GetOverlappedResult(watcher->directory, &overlapped, &bytes, TRUE);
+}
+
+bool FileWatchOpen(struct FileWatcher *watcher, const char *directory) {
+  if (MultiByteToWideChar(CP_UTF8, 0, watcher->fileName, -1, watcher->wideName, MAX_PATH) == 0)
+    return false;
+
+  watcher->directory =
+      CreateFileA(directory, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                  OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+  if (watcher->directory == INVALID_HANDLE_VALUE)
+    return false;
+
+  watcher->changeEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+  watcher->stopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+  return watcher->changeEvent != NULL && watcher->stopEvent != NULL;
+}
+
+void FileWatchClose(struct FileWatcher *watcher) {
+  if (watcher->stopEvent != NULL)
+    CloseHandle(watcher->stopEvent);
+  if (watcher->changeEvent != NULL)
+    CloseHandle(watcher->changeEvent);
+  if (watcher->directory != INVALID_HANDLE_VALUE)
+    CloseHandle(watcher->directory);
+}
+
+void FileWatchStop(struct FileWatcher *watcher) { SetEvent(watcher->stopEvent); }
+
+#else
+
+void FileWatchLoop(struct FileWatcher *watcher) {
+  // Room for a good many events; inotify never splits one across reads.
+  alignas(struct inotify_event) char buffer[16384];
+
+  bool pending = false;
+  double firstChange = 0;
+  double lastChange = 0;
+  for (;;) {
+    int timeout = FileWatchSettle(watcher, &pending, firstChange, lastChange);
+    struct pollfd fds[2] = {
+        {watcher->inotify, POLLIN, 0},
+        {watcher->stopPipe[0], POLLIN, 0},
+    };
+    if (poll(fds, 2, timeout) < 0 || fds[1].revents != 0)
+      break;
+    if (fds[0].revents == 0)
+      continue;
+
+    ssize_t bytes = read(watcher->inotify, buffer, sizeof(buffer));
+    if (bytes <= 0)
+      break;
+
+    bool changed = false;
+    for (char *entry = buffer; entry < buffer + bytes;) {
+      struct inotify_event *event = (struct inotify_event *)entry;
+      if ((event->mask & IN_Q_OVERFLOW) || (event->len > 0 && strcmp(event->name, watcher->fileName) == 0))
+        changed = true;
+      entry += sizeof(struct inotify_event) + event->len;
+    }
+    if (changed)
+      FileWatchNoticed(watcher, &pending, &firstChange, &lastChange);
+  }
+}
+
+bool FileWatchOpen(struct FileWatcher *watcher, const char *directory) {
+  watcher->inotify = inotify_init1(IN_CLOEXEC);
+  if (watcher->inotify < 0 || pipe(watcher->stopPipe) != 0)
+    return false;
+
+  uint32_t mask = IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE | IN_MOVED_TO | IN_DELETE;
+  return inotify_add_watch(watcher->inotify, directory, mask) >= 0;
+}
+
+void FileWatchClose(struct FileWatcher *watcher) {
+  if (watcher->stopPipe[0] >= 0) {
+    close(watcher->stopPipe[0]);
+    close(watcher->stopPipe[1]);
+  }
+  if (watcher->inotify >= 0)
+    close(watcher->inotify);
+}
+
+void FileWatchStop(struct FileWatcher *watcher) {
+  char stop = 0;
+  if (write(watcher->stopPipe[1], &stop, 1) != 1)
+    ReportError("The file watcher could not be told to stop");
+}
+
+#endif
+
+struct FileWatcher *StartFileWatcher(const char *path, double debounceSeconds,
+                                     void (*loadFn)(void *context, const char *path, double changedAt), void *context) {
+  AssertNotNull(path);
+  AssertNotNull(loadFn);
+
+  struct FileWatcher *watcher = new FileWatcher();
+  snprintf(watcher->path, sizeof(watcher->path), "%s", path);
+  watcher->debounce = debounceSeconds;
+  watcher->loadFn = loadFn;
+  watcher->context = context;
+#if defined(_WIN32)
+  watcher->directory = INVALID_HANDLE_VALUE;
+#else
+  watcher->inotify = -1;
+  watcher->stopPipe[0] = -1;
+  watcher->stopPipe[1] = -1;
+#endif
+
+  // Splits the path into its directory, which is what gets watched, and the file's name.
+  char directory[sizeof(watcher->path)];
+  snprintf(directory, sizeof(directory), "%s", path);
+  char *slash = strrchr(directory, '/');
+#if defined(_WIN32)
+  char *backslash = strrchr(directory, '\\');
+  if (slash == NULL || (backslash != NULL && backslash > slash))
+    slash = backslash;
+#endif
+  watcher->fileName = watcher->path;
+  if (slash != NULL) {
+    watcher->fileName = watcher->path + (slash - directory) + 1;
+    slash[slash == directory ? 1 : 0] = '\0';
+  } else {
+    snprintf(directory, sizeof(directory), ".");
+  }
+
+  if (!FileWatchOpen(watcher, directory)) {
+    FileWatchClose(watcher);
+    delete watcher;
+    return NULL;
+  }
+
+  watcher->thread = std::thread(FileWatchLoop, watcher);
+  return watcher;
+}
+
+void StopFileWatcher(struct FileWatcher *watcher) {
+  if (watcher == NULL)
+    return;
+
+  FileWatchStop(watcher);
+  watcher->thread.join();
+  FileWatchClose(watcher);
+  delete watcher;
+}
+
+struct FileWatchStats GetFileWatchStats(struct FileWatcher *watcher) {
+  AssertNotNull(watcher);
+
+  std::lock_guard<std::mutex> hold(watcher->lock);
+  return watcher->stats;
+}
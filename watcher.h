@@ -0,0 +1,31 @@
+#pragma once
+
+#include "core.h"
+
+// Watches one file from a thread of its own, using ReadDirectoryChangesW on Windows and inotify elsewhere. Editors
+// save in bursts (truncate, write, rename over, touch), so a change is only acted on once the file has been left alone
+// for the debounce time. loadFn then runs on the watcher thread, where it can read and parse the file without holding
+// up the overlay, and hands the result over however it likes.
+
+struct FileWatchStats {
+  // Notifications about the file, and the loads they were folded into.
+  long long events;
+  long long loads;
+  // Seconds from the first notification of the last burst to the end of its load, of which the debounce is part.
+  double lastLatency;
+};
+
+struct FileWatcher;
+
+// Starts watching path, which need not exist yet, though its directory must. loadFn is passed context, the path and
+// the FileWatchClock time of the first notification in the burst. Returns NULL if the directory cannot be watched.
+struct FileWatcher *StartFileWatcher(const char *path, double debounceSeconds,
+                                     void (*loadFn)(void *context, const char *path, double changedAt), void *context);
+
+// Stops the thread, waiting for a load in progress to finish, and frees the watcher.
+void StopFileWatcher(struct FileWatcher *watcher);
+
+struct FileWatchStats GetFileWatchStats(struct FileWatcher *watcher);
+
+// Seconds on a steady clock, for measuring from a change to when it has been applied.
+double FileWatchClock();
@@ -5,9 +5,68 @@
 #include <GDIPlus.h>
 // clang-format on
 
+#include "bin.h"
+#include "damage.h"
+#include "hitindex.h"
+#include "inputqueue.h"
+#include "layout.h"
+#include "movepool.h"
+#include "patch.h"
+#include "placement.h"
+#include "raster.h"
+#include "resources.h"
+#include "rules.h"
+#include "snapshot.h"
+#include "tracker.h"
+#include "void.h"
+#include "watcher.h"
+
 // Restricts the overlay to half the monitor, so as not to obscure the debugger.
 #define HALF_MONITOR 1
 
+// Writes the render statistics to the debugger output after every paint.
+#define SHOW_RENDER_STATS 0
+
+// Writes the input statistics to the debugger output after every frame of input.
+#define SHOW_INPUT_STATS 0
+
+// Queued input is processed at most once every this many milliseconds, or once per refresh of the overlay's monitor
+// when 0.
+#define INPUT_TICK_MS 0
+#define INPUT_TIMER_ID 1
+
+// Windows are moved by this many worker threads, so that one whose process has hung cannot stall the overlay, or on
+// the overlay thread in one deferred batch when 0. A move taking longer than the timeout marks its window unresponsive.
+#define MOVE_WORKERS 4
+#define MOVE_TIMEOUT_MS 500
+#define MOVE_TIMER_ID 2
+#define WM_MOVES_DONE (WM_APP + 1)
+
+// Writes every move that times out or recovers to the debugger output.
+#define SHOW_MOVE_STATS 0
+
+// Writes the cell each new or renamed window is sent to by the placement rules to the debugger output.
+#define SHOW_RULE_MATCHES 0
+
+// The layout file, read from the working directory at startup and again whenever it is saved, or when F5 is pressed
+// in the overlay. A save is read once the file has been left alone for LAYOUT_DEBOUNCE_MS.
+#define LAYOUT_PATH "windy-layout.json"
+#define LAYOUT_RELOAD_KEY VK_F5
+#define LAYOUT_DEBOUNCE_MS 100
+#define WM_LAYOUT_LOADED (WM_APP + 2)
+
+// In the overlay, VOID_PARK_KEY parks the window of the cell under the cursor offscreen and VOID_SWAP_KEY swaps the
+// most recently parked window into it. Parked windows go back where they were when windy exits.
+#define VOID_PARK_KEY 'P'
+#define VOID_SWAP_KEY 'O'
+#define VOID_OFFSCREEN -32000
+
+// Print what each layout reload changed and how long it took to the debugger.
+#define SHOW_RELOAD_STATS 0
+
+// Print the monitors reflowed after each display change to the debugger.
+#define SHOW_DISPLAY_CHANGES 0
+
 #define HOTKEY_ID 1
 #define HOTKEY_META MOD_WIN
 #define HOTKEY_CODE VK_OEM_3
@@ -24,28 +83,17 @@ struct {
   HINSTANCE hInst;
 } win;
 
-struct Point {
-  int x;
-  int y;
-};
-
-struct Bounds {
-  int x;
-  int y;
-  int width;
-  int height;
-};
-
-struct {
-  HWND hWnd;
-  struct Bounds placement;
-} onDeck;
-
 struct {
   struct Monitor *monitor;
   HWND hWnd;
   struct Bounds bounds;
   bool isOpen;
+
+  // Input is queued as it arrives and processed at most once a tick, immediately if a tick has passed since the last
+  // time and otherwise when the input timer fires.
+  double inputTick;
+  double lastInput;
+  bool inputScheduled;
 } overlay;
 
 void FatalWin32Error(const char *format, ...) { __debugbreak(); }
@@ -57,952 +105,1140 @@ void FatalWin32Error(const char *format, ...) { __debugbreak(); }
     }                                                                                                                  \
   } while (0)
 
-void ReportError(const char *format, ...) { __debugbreak(); }
-
-void FatalError(const char *format, ...) { __debugbreak(); }
-
-void *AllocateBytes(size_t size, size_t count, const char *name) {
-  void *mem = calloc(count, size);
-  if (mem == NULL)
-    FatalError("Allocation of %d %s%s failed", count, name, count > 1 ? "s" : "");
-  return mem;
-}
-
-#define Allocate(type_) (type_ *)AllocateBytes(sizeof(type_), 1, #type_)
-#define AllocateArray(type_, count_) (type_ *)AllocateBytes(sizeof(type_), count_, #type_)
-
-#define OffsetOf(type_, member_)                                                                                       \
-  (size_t)((ptrdiff_t) & reinterpret_cast<const volatile char &>((((type_ *)0)->member_)))
-#define Unwrap(type_, member_, ptr_) (type_ *)((char *)ptr_ - OffsetOf(type_, member_))
-#define Wrap(ptr_, member_) (&((ptr_)->member_))
-
-#define AssertMessage(condition_, message_)                                                                            \
-  do {                                                                                                                 \
-    if (!(condition_))                                                                                                 \
-      FatalError message_;                                                                                             \
-  } while (0)
-#define AssertNull(pointer_) AssertMessage((pointer_) == NULL, ("%s is not NULL", #pointer_))
-#define AssertNotNull(pointer_) AssertMessage((pointer_) != NULL, ("%s is NULL", #pointer_))
-#define AssertGreater(a_, b_) AssertMessage((a_) > (b_), ("%s (%d) is not greater than %s (%d)", #a_, (a_), #b_, (b_)))
-#define AssertIndex(index_, count_)                                                                                    \
-  AssertMessage((index_) >= 0 && (index_) < (count_),                                                                  \
-                ("%s (%d) does not index %s (%d)", #index_, (index_), #count_, (count_)))
-
+// The back buffer is retained between paints, so a paint only has to redraw and copy the damaged part of it.
 struct {
   PAINTSTRUCT ps;
   HDC hdc;
   Gdiplus::Graphics *g;
+
+  // A top-down 32 bit DIB section, so the software rasterizer can draw straight into its pixels.
+  HDC backDC;
+  HBITMAP backBitmap;
+  HGDIOBJ oldBitmap;
+  unsigned int *backPixels;
+  int backWidth;
+  int backHeight;
+
+  // Set by --software on the command line: the overlay is drawn by the built-in rasterizer instead of GDI+.
+  bool software;
+
+  // Set by --layered on the command line: the back buffer holds premultiplied alpha and is pushed to the screen with
+  // UpdateLayeredWindow after input, instead of being painted in WM_PAINT and blended at OVERLAY_ALPHA as a whole.
+  // GDI+ then draws through a bitmap over the DIB's pixels, since drawing through a DC drops the alpha channel.
+  bool layered;
+  Gdiplus::Bitmap *surface;
+
+  // Long lived drawing objects shared by every paint; pens, fonts and text come from win32Resources.
+  Gdiplus::FontFamily *fontFamily;
+  Gdiplus::SolidBrush *textBrush;
+  Gdiplus::GraphicsPath *path;
+
+  // The last paint's commands, so a paint that would produce the same pixels only copies the back buffer.
+  struct DrawList list;
+  unsigned long long lastHash;
+  RECT lastPaint;
 } draw;
 
-void DrawText(int x, int y, int size, const char *text) {
-  Gdiplus::SolidBrush brush(Gdiplus::Color(255, 0, 0, 0));
-  Gdiplus::FontFamily fontFamily(L"Times New Roman");
-  Gdiplus::Font font(&fontFamily, (float)size, Gdiplus::FontStyleRegular, Gdiplus::UnitPixel);
-  Gdiplus::PointF pointF((float)x - overlay.bounds.x, (float)y - overlay.bounds.y);
+#define OVERLAY_ALPHA 200
 
-  size_t chars;
-  WCHAR wideText[_MAX_PATH];
-  mbstowcs_s(&chars, wideText, _MAX_PATH, text, strlen(text));
+// The background of a per-pixel alpha overlay. It is almost rather than entirely transparent: a layered window lets
+// mouse input through wherever its alpha is zero.
+#define LAYERED_BACKGROUND 0x01000000
 
-  draw.g->DrawString(wideText, -1, &font, pointF, &brush);
+void MakeLineStyle(Gdiplus::Pen *pen, enum LineStyle style, float scale) {
+  const struct LineStyleInfo *info = &lineStyles[style];
+  pen->SetColor(Gdiplus::Color((Gdiplus::ARGB)info->color));
+  pen->SetWidth(info->width * scale);
+  pen->SetDashStyle(info->dashed ? Gdiplus::DashStyleDashDot : Gdiplus::DashStyleSolid);
+  pen->SetAlignment(Gdiplus::PenAlignmentInset);
 }
 
-#define OVERLAY_ALPHA 200
+void *Win32CreatePen(enum LineStyle style, float scale) {
+  Gdiplus::Pen *pen = new Gdiplus::Pen(Gdiplus::Color(255, 0, 0, 0), 1);
+  MakeLineStyle(pen, style, scale);
+  return pen;
+}
 
-enum Dimension {
-  Dimension_BorderInset = 0,
-};
+void *Win32CreateFont(int size, float scale) {
+  return new Gdiplus::Font(draw.fontFamily, size * scale, Gdiplus::FontStyleRegular, Gdiplus::UnitPixel);
+}
+
+// Text is laid out once into a glyph outline at the origin, then filled wherever it is drawn.
+void *Win32CreateText(const char *text, int size, float scale) {
+  size_t chars;
+  WCHAR wideText[RESOURCE_TEXT_LENGTH];
+  mbstowcs_s(&chars, wideText, RESOURCE_TEXT_LENGTH, text, _TRUNCATE);
 
-enum LineStyle {
-  LineStyle_Border,
-  LineStyle_Focus,
-  LineStyle_Action,
-  LineStyle_ActionHint,
+  Gdiplus::GraphicsPath *path = new Gdiplus::GraphicsPath();
+  path->AddString(wideText, -1, draw.fontFamily, Gdiplus::FontStyleRegular, size * scale, Gdiplus::PointF(0, 0),
+                  NULL);
+  return path;
+}
+
+void Win32DestroyPen(void *pen) { delete (Gdiplus::Pen *)pen; }
+void Win32DestroyFont(void *font) { delete (Gdiplus::Font *)font; }
+void Win32DestroyText(void *layout) { delete (Gdiplus::GraphicsPath *)layout; }
+
+struct ResourceCache win32Resources = {
+    Win32CreatePen,
+    Win32CreateFont,
+    Win32CreateText,
+    Win32DestroyPen,
+    Win32DestroyFont,
+    Win32DestroyText,
+    1.0f,
+    // The pens, fonts and texts start out empty, to be made as they are first used.
+    {},
+    0,
+    0,
+    {},
+    {},
+    0,
+    0,
 };
 
-void MakeLineStyle(Gdiplus::Pen *pen, LineStyle style) {
-  switch (style) {
-  case LineStyle_Border:
-    pen->SetColor(Gdiplus::Color(255, 0x1f, 0x1f, 0xff));
-    pen->SetWidth(2.5f);
-    pen->SetDashStyle(Gdiplus::DashStyleSolid);
-    break;
-  case LineStyle_Focus:
-    pen->SetColor(Gdiplus::Color(255, 128, 128, 128));
-    pen->SetWidth(3);
-    pen->SetDashStyle(Gdiplus::DashStyleDashDot);
-    break;
-  case LineStyle_Action:
-    pen->SetColor(Gdiplus::Color(255, 0xf3, 0xa1, 0x16));
-    pen->SetWidth(3.5f);
-    pen->SetDashStyle(Gdiplus::DashStyleDashDot);
-    break;
-  case LineStyle_ActionHint:
-    pen->SetColor(Gdiplus::Color(60, 0x40, 0x40, 0x40));
-    pen->SetWidth(3.5f);
-    pen->SetDashStyle(Gdiplus::DashStyleDashDot);
-    break;
-  default:
-    break;
+void Win32DrawText(int x, int y, int size, const char *text) {
+  float left = (float)x - overlay.bounds.x;
+  float top = (float)y - overlay.bounds.y;
+
+  Gdiplus::GraphicsPath *path = (Gdiplus::GraphicsPath *)ResourceText(&win32Resources, text, size);
+  if (path != NULL) {
+    draw.g->TranslateTransform(left, top);
+    draw.g->FillPath(draw.textBrush, path);
+    draw.g->ResetTransform();
+    return;
   }
-  pen->SetAlignment(Gdiplus::PenAlignmentInset);
+
+  size_t chars;
+  WCHAR wideText[_MAX_PATH];
+  mbstowcs_s(&chars, wideText, _MAX_PATH, text, _TRUNCATE);
+
+  Gdiplus::Font *font = (Gdiplus::Font *)ResourceFont(&win32Resources, size);
+  draw.g->DrawString(wideText, -1, font, Gdiplus::PointF(left, top), draw.textBrush);
 }
 
-void DrawLine(struct Point from, struct Point to, LineStyle style) {
-  Gdiplus::Pen pen(Gdiplus::Color(255, 0, 0, 0), 1);
-  MakeLineStyle(&pen, style);
+void Win32DrawLine(struct Point from, struct Point to, enum LineStyle style) {
+  Gdiplus::Pen *pen = (Gdiplus::Pen *)ResourcePen(&win32Resources, style);
 
-  draw.g->DrawLine(&pen, from.x - overlay.bounds.x, from.y - overlay.bounds.y, to.x - overlay.bounds.x,
+  draw.g->DrawLine(pen, from.x - overlay.bounds.x, from.y - overlay.bounds.y, to.x - overlay.bounds.x,
                    to.y - overlay.bounds.y);
 }
 
-void DrawRoundedRectangle(struct Bounds bounds, int diameter, LineStyle style) {
+void Win32AddRoundedRectangle(Gdiplus::GraphicsPath *path, struct Bounds bounds, int diameter) {
   if (diameter > bounds.width)
     diameter = bounds.width;
   if (diameter > bounds.height)
     diameter = bounds.height;
 
   Gdiplus::Rect corner(bounds.x - overlay.bounds.x, bounds.y - overlay.bounds.y, diameter, diameter);
-  Gdiplus::GraphicsPath path;
-  path.AddArc(corner, 180, 90);
+  path->StartFigure();
+  path->AddArc(corner, 180, 90);
   corner.X += bounds.width - diameter - 1;
-  path.AddArc(corner, 270, 90);
+  path->AddArc(corner, 270, 90);
   corner.Y += bounds.height - diameter - 1;
-  path.AddArc(corner, 0, 90);
+  path->AddArc(corner, 0, 90);
   corner.X -= bounds.width - diameter - 1;
-  path.AddArc(corner, 90, 90);
-  path.CloseFigure();
-
-  Gdiplus::Pen pen(Gdiplus::Color(255, 0, 0, 0), 1);
-  MakeLineStyle(&pen, style);
-
-  draw.g->DrawPath(&pen, &path);
+  path->AddArc(corner, 90, 90);
+  path->CloseFigure();
 }
 
-void DrawRectangle(struct Bounds bounds, LineStyle style) {
-  Gdiplus::Pen pen(Gdiplus::Color(255, 0, 0, 0), 1);
-  MakeLineStyle(&pen, style);
+void Win32DrawRoundedRectangle(struct Bounds bounds, int diameter, enum LineStyle style) {
+  // The path differs for every rectangle, but one path object is reset and refilled rather than made each time.
+  Gdiplus::GraphicsPath *path = draw.path;
+  path->Reset();
+  Win32AddRoundedRectangle(path, bounds, diameter);
 
-  draw.g->DrawRectangle(&pen, bounds.x - overlay.bounds.x, bounds.y - overlay.bounds.y, bounds.width, bounds.height);
+  draw.g->DrawPath((Gdiplus::Pen *)ResourcePen(&win32Resources, style), path);
 }
 
-struct Point MakePoint(int x, int y) {
-  struct Point point;
-  point.x = x;
-  point.y = y;
-  return point;
-}
+void Win32DrawRectangle(struct Bounds bounds, enum LineStyle style) {
+  Gdiplus::Pen *pen = (Gdiplus::Pen *)ResourcePen(&win32Resources, style);
 
-bool PointInBounds(struct Point point, struct Bounds bounds) {
-  if (point.x < bounds.x)
-    return false;
-  if (point.x >= bounds.x + bounds.width)
-    return false;
-  if (point.y < bounds.y)
-    return false;
-  if (point.y >= bounds.y + bounds.height)
-    return false;
-  return true;
+  draw.g->DrawRectangle(pen, bounds.x - overlay.bounds.x, bounds.y - overlay.bounds.y, bounds.width, bounds.height);
 }
 
-struct Point BoundsMidpoint(struct Bounds bounds) {
-  struct Point midPoint;
-  midPoint.x = bounds.x + bounds.width / 2;
-  midPoint.y = bounds.y + bounds.height / 2;
-  return midPoint;
-}
+// Every outline in a batch shares one pen, so they are gathered into one path and stroked with a single call.
+void Win32DrawCommands(const struct DrawCommand *commands, int count, const char *text) {
+  if (commands[0].style == DrawStyle_Text) {
+    for (int index = 0; index < count; index++)
+      Win32DrawText(commands[index].x0, commands[index].y0, commands[index].size, text + commands[index].text);
+    return;
+  }
 
-struct Input {
-  bool used;
-  unsigned int sequence;
-  struct Point position;
-  int buttons;
-  int key;
-  bool shift;
-};
+  Gdiplus::GraphicsPath *path = draw.path;
+  path->Reset();
+  for (int index = 0; index < count; index++) {
+    const struct DrawCommand *command = &commands[index];
+    struct Bounds bounds = {command->x0, command->y0, command->x1, command->y1};
+    switch (command->kind) {
+    case DrawCommand_Line:
+      path->StartFigure();
+      path->AddLine(command->x0 - overlay.bounds.x, command->y0 - overlay.bounds.y, command->x1 - overlay.bounds.x,
+                    command->y1 - overlay.bounds.y);
+      break;
+    case DrawCommand_Rectangle:
+      path->AddRectangle(
+          Gdiplus::Rect(bounds.x - overlay.bounds.x, bounds.y - overlay.bounds.y, bounds.width, bounds.height));
+      break;
+    case DrawCommand_RoundedRectangle:
+      Win32AddRoundedRectangle(path, bounds, command->size);
+      break;
+    default:
+      break;
+    }
+  }
 
-struct Input oldInput;
-struct Input newInput;
+  draw.g->DrawPath((Gdiplus::Pen *)ResourcePen(&win32Resources, (enum LineStyle)commands[0].style), path);
+}
 
-struct Bin {
-  void (*onDrawFn)(struct Bin *bin);
-  void (*onInputFn)(struct Bin *bin);
-  void (*onLayoutFn)(struct Bin *bin);
-  void (*onDestroyFn)(struct Bin *bin);
+void Win32PlaceWindow(WindowHandle hWnd, struct Bounds bounds) {
+  SetWindowPos((HWND)hWnd, NULL, bounds.x, bounds.y, bounds.width, bounds.height, SWP_SHOWWINDOW);
+}
 
-  struct Bounds bounds;
-};
+// Deferred positioning moves every window before any of them repaints. If the batch cannot be built, for instance
+// because one of the windows has gone, the windows are placed one at a time instead.
+void Win32PlaceWindows(const struct WindowPlacement *placements, int count) {
+  HDWP defer = BeginDeferWindowPos(count);
+  for (int index = 0; index < count && defer != NULL; index++) {
+    struct Bounds bounds = placements[index].bounds;
+    defer = DeferWindowPos(defer, (HWND)placements[index].hWnd, NULL, bounds.x, bounds.y, bounds.width, bounds.height,
+                           SWP_SHOWWINDOW);
+  }
+  if (defer != NULL && EndDeferWindowPos(defer))
+    return;
 
-struct Shelf {
-  struct Bin bin;
+  for (int index = 0; index < count; index++)
+    Win32PlaceWindow(placements[index].hWnd, placements[index].bounds);
+}
 
-  enum ShelfDirection direction;
+UINT Win32StackingFlags(const struct WindowStacking *stacking) {
+  UINT flags = SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE;
+  if (stacking->show == WindowShow_Show)
+    flags |= SWP_SHOWWINDOW;
+  if (stacking->show == WindowShow_Hide)
+    flags |= SWP_HIDEWINDOW | SWP_NOZORDER;
+  return flags;
+}
 
-  int slotCount;
+// Restacks, shows and hides without moving, sizing or activating the windows, falling back to one call per window
+// like placement.
+void Win32StackWindows(const struct WindowStacking *stackings, int count) {
+  HDWP defer = BeginDeferWindowPos(count);
+  for (int index = 0; index < count && defer != NULL; index++) {
+    HWND above = stackings[index].above != NULL ? (HWND)stackings[index].above : HWND_TOP;
+    defer = DeferWindowPos(defer, (HWND)stackings[index].hWnd, above, 0, 0, 0, 0,
+                           Win32StackingFlags(&stackings[index]));
+  }
+  if (defer != NULL && EndDeferWindowPos(defer))
+    return;
 
-  int hoverSlot;
+  for (int index = 0; index < count; index++) {
+    HWND above = stackings[index].above != NULL ? (HWND)stackings[index].above : HWND_TOP;
+    SetWindowPos((HWND)stackings[index].hWnd, above, 0, 0, 0, 0, Win32StackingFlags(&stackings[index]));
+  }
+}
 
-  struct Bin **bins;
+struct Backend win32Backend = {
+    "win32",
+    Win32DrawLine,
+    Win32DrawRectangle,
+    Win32DrawRoundedRectangle,
+    Win32DrawText,
+    Win32DrawCommands,
+    Win32PlaceWindow,
+    Win32PlaceWindows,
+    Win32StackWindows,
+    &win32Resources,
 };
 
-enum ShelfDirection { ShelfDirection_Horizontal, ShelfDirection_Vertical };
+#define MONITOR_LIMIT 16
 
-struct Shelf *NewShelf(enum ShelfDirection direction, int count);
-struct Bounds ShelfMakeCellBounds(struct Shelf *shelf, int slot);
+// A display, as found by EnumerateMonitors. Monitors are known by device name, which stays the same when a display is
+// unplugged and plugged back in while its HMONITOR does not, so an unplugged monitor keeps its tree until it returns.
+struct Monitor {
+  char device[CCHDEVICENAME];
+  // NULL while the display is unplugged.
+  HMONITOR hMonitor;
+  // The work area, the DPI against 96 and the refresh rate, as of the last display change.
+  struct Bounds bounds;
+  float scale;
+  int refreshRate;
+  // Whether the above changed since the tree was last reflowed, and the scale it was laid out at.
+  bool changed;
+  float layoutScale;
 
-enum CellAction { CellAction_None, CellAction_SplitHorizontal, CellAction_SplitVertical };
+  struct Arena arena;
+  struct Bin *root;
+  struct HitIndex hitIndex;
+  struct Placements placements;
 
-struct Cell {
-  struct Bin bin;
+  // The layout the tree was loaded from, which its cell names point into.
+  struct Snapshot snapshot;
 
-  unsigned int sequence;
-  enum CellAction previewAction;
-  struct Bin *subBin;
-  HWND hWnd;
+  // The hash of the layout file entry the tree was built from and the tree's cell names, or 0 and NULL.
+  unsigned long long layoutHash;
+  char *layoutNames;
 };
 
-void PlaceOnDeckWindow();
+struct Monitor monitors[MONITOR_LIMIT];
+int monitorCount;
 
-void CellInput(struct Bin *bin) {
-  AssertNotNull(bin);
-
-  struct Cell *cell = Unwrap(struct Cell, bin, bin);
+// Each monitor's layout is saved in the working directory under the monitor's device name.
+void MonitorSnapshotPath(struct Monitor *monitor, char *path, int size) {
+  snprintf(path, size, "windy-%s.snapshot", monitor->device);
+}
 
-  cell->sequence = newInput.sequence;
+struct Layout layout;
 
-  if (cell->subBin != NULL) {
-    if (cell->subBin->onInputFn)
-      cell->subBin->onInputFn(cell->subBin);
-  } else {
-    struct Point midPoint = BoundsMidpoint(cell->bin.bounds);
-    int xDelta = abs(newInput.position.x - midPoint.x);
-    int yDelta = abs(newInput.position.y - midPoint.y);
-
-    cell->previewAction = CellAction_None;
-    if (xDelta < yDelta) {
-      if (xDelta < 10)
-        cell->previewAction = CellAction_SplitHorizontal;
-    } else {
-      if (yDelta < 10)
-        cell->previewAction = CellAction_SplitVertical;
-    }
+void ReportLayoutError(const struct LayoutError *error) {
+  if (error->line == 0)
+    ReportError("%s", error->message);
+  else
+    ReportError("%s:%d:%d: %s", LAYOUT_PATH, error->line, error->column, error->message);
+}
 
-    if (cell->previewAction == CellAction_SplitHorizontal) {
-      if ((newInput.buttons & MK_LBUTTON) && !(oldInput.buttons & MK_LBUTTON)) {
-        struct Shelf *newShelf = NewShelf(ShelfDirection_Horizontal, 2);
-        struct Bin *newBin = Wrap(newShelf, bin);
-        cell->subBin = newBin;
-        cell->subBin->bounds = cell->bin.bounds;
-        if (cell->subBin->onLayoutFn)
-          cell->subBin->onLayoutFn(cell->subBin);
-        cell->previewAction = CellAction_None;
-      }
-    } else if (cell->previewAction == CellAction_SplitVertical) {
-      if ((newInput.buttons & MK_LBUTTON) && !(oldInput.buttons & MK_LBUTTON)) {
-        struct Shelf *newShelf = NewShelf(ShelfDirection_Vertical, 2);
-        struct Bin *newBin = Wrap(newShelf, bin);
-        cell->subBin = newBin;
-        cell->subBin->bounds = cell->bin.bounds;
-        if (cell->subBin->onLayoutFn)
-          cell->subBin->onLayoutFn(cell->subBin);
-        cell->previewAction = CellAction_None;
-      }
-      // cell->hWnd = onDeck.hWnd;
-      // onDeck.placement = cell->bin.bounds;
-      // PlaceOnDeckWindow();
+// A monitor starts with the tree it had when windy last exited, then the layout file's tree for it, then two cells.
+// The tree it exited with is passed over if the layout file's entry for it has changed since, so an edit made while
+// windy was not running is not hidden by the old tree.
+struct Bin *NewMonitorRoot(struct Monitor *monitor) {
+  struct LayoutMonitor *entry = FindLayoutMonitor(&layout, monitor->device);
+  unsigned long long layoutHash = entry != NULL ? entry->hash : 0;
+
+  char path[MAX_PATH];
+  MonitorSnapshotPath(monitor, path, sizeof(path));
+  if (OpenSnapshot(&monitor->snapshot, path)) {
+    struct Bin *root = LoadSnapshot(&monitor->arena, &monitor->snapshot);
+    if (root != NULL && SnapshotLayoutHash(&monitor->snapshot) == layoutHash) {
+      monitor->layoutHash = layoutHash;
+      return root;
     }
+    // The arena holds nothing else yet, so resetting it drops whatever was built from the snapshot.
+    ResetArena(&monitor->arena);
+    CloseSnapshot(&monitor->snapshot);
   }
-}
-
-void CellDraw(struct Bin *bin) {
-  AssertNotNull(bin);
-
-  struct Cell *cell = Unwrap(struct Cell, bin, bin);
 
-  DrawRoundedRectangle(cell->bin.bounds, 5, LineStyle_Border);
-
-  if (cell->subBin != NULL) {
-    if (cell->subBin->onDrawFn)
-      cell->subBin->onDrawFn(cell->subBin);
-  } else {
-    if (cell->sequence == newInput.sequence) {
-      struct Point midPoint = BoundsMidpoint(cell->bin.bounds);
+  if (entry != NULL) {
+    monitor->layoutHash = entry->hash;
+    return BuildLayoutTree(entry, &monitor->arena, &monitor->layoutNames);
+  }
 
-      struct Point from, to;
-      from = MakePoint(cell->bin.bounds.x, midPoint.y);
-      to = MakePoint(cell->bin.bounds.x + cell->bin.bounds.width, midPoint.y);
-      DrawLine(from, to, cell->previewAction == CellAction_SplitVertical ? LineStyle_Action : LineStyle_ActionHint);
+  struct Shelf *shelf = NewShelf(&monitor->arena, ShelfDirection_Horizontal, 2);
+  CellSetName(BinCell(ShelfGet(shelf, 0)), "left");
+  CellSetName(BinCell(ShelfGet(shelf, 1)), "right");
+  return Wrap(shelf, bin);
+}
 
-      from = MakePoint(midPoint.x, cell->bin.bounds.y);
-      to = MakePoint(midPoint.x, cell->bin.bounds.y + cell->bin.bounds.height);
-      DrawLine(from, to, cell->previewAction == CellAction_SplitHorizontal ? LineStyle_Action : LineStyle_ActionHint);
-    }
+// The snapshot is written out before its mapping is closed, since the cell names still point into it.
+void SaveMonitorLayouts() {
+  struct SnapshotBuffer buffer = {};
+  for (int i = 0; i < monitorCount; i++) {
+    struct Monitor *monitor = &monitors[i];
+    char path[MAX_PATH];
+    MonitorSnapshotPath(monitor, path, sizeof(path));
+    WriteSnapshot(monitor->root, monitor->layoutHash, &buffer);
+    CloseSnapshot(&monitor->snapshot);
+    FreeBytes(monitor->layoutNames);
+    monitor->layoutNames = NULL;
+    SaveSnapshot(&buffer, path);
   }
+  ReleaseSnapshotBuffer(&buffer);
 }
 
-void CellLayout(struct Bin *bin) {
-  AssertNotNull(bin);
-
-  struct Cell *cell = Unwrap(struct Cell, bin, bin);
+BOOL CALLBACK Win32AddMonitor(HMONITOR hMonitor, HDC hdc, LPRECT rect, LPARAM lParam) {
+  MONITORINFOEXA info;
+  info.cbSize = sizeof(info);
+  if (!GetMonitorInfoA(hMonitor, &info))
+    return TRUE;
 
-  if (cell->subBin != NULL) {
-    cell->subBin->bounds = cell->bin.bounds;
-    if (cell->subBin->onLayoutFn)
-      cell->subBin->onLayoutFn(cell->subBin);
+  const char *device = info.szDevice;
+  while (*device == '\\' || *device == '.')
+    device++;
+
+  struct Monitor *monitor = NULL;
+  for (int i = 0; i < monitorCount && monitor == NULL; i++)
+    if (strcmp(monitors[i].device, device) == 0)
+      monitor = &monitors[i];
+  if (monitor == NULL) {
+    if (monitorCount == MONITOR_LIMIT) {
+      ReportError("Only %d monitors are supported; %s is ignored", MONITOR_LIMIT, device);
+      return TRUE;
+    }
+    monitor = &monitors[monitorCount++];
+    snprintf(monitor->device, sizeof(monitor->device), "%s", device);
+    monitor->changed = true;
   }
+
+  struct Bounds bounds;
+  bounds.x = info.rcWork.left;
+  bounds.y = info.rcWork.top;
+  bounds.width = info.rcWork.right - info.rcWork.left;
+  bounds.height = info.rcWork.bottom - info.rcWork.top;
+
+  float scale = 1;
+  UINT dpiX, dpiY;
+  if (GetDpiForMonitor(hMonitor, MDT_EFFECTIVE_DPI, &dpiX, &dpiY) == S_OK)
+    scale = dpiX / 96.0f;
+
+  int refreshRate = 0;
+  DEVMODEA mode = {};
+  mode.dmSize = sizeof(mode);
+  if (EnumDisplaySettingsA(info.szDevice, ENUM_CURRENT_SETTINGS, &mode) && mode.dmDisplayFrequency > 1)
+    refreshRate = (int)mode.dmDisplayFrequency;
+
+  if (memcmp(&bounds, &monitor->bounds, sizeof(bounds)) != 0 || scale != monitor->scale)
+    monitor->changed = true;
+  monitor->hMonitor = hMonitor;
+  monitor->bounds = bounds;
+  monitor->scale = scale;
+  monitor->refreshRate = refreshRate;
+  return TRUE;
 }
 
-void CellDestroy(struct Bin *bin) {
-  AssertNotNull(bin);
+// Finds the displays, at startup and after each display change rather than whenever the overlay opens, and gives new
+// ones a tree. Monitors whose work area or DPI changed, or that were plugged back in, are marked for ReflowMonitors.
+void EnumerateMonitors() {
+  for (int i = 0; i < monitorCount; i++)
+    monitors[i].hMonitor = NULL;
 
-  struct Cell *cell = Unwrap(struct Cell, bin, bin);
+  int oldCount = monitorCount;
+  EnumDisplayMonitors(NULL, NULL, Win32AddMonitor, 0);
 
-  if (cell->subBin != NULL) {
-    if (cell->subBin->onDestroyFn)
-      cell->subBin->onDestroyFn(cell->subBin);
+  for (int i = 0; i < monitorCount; i++) {
+    struct Monitor *monitor = &monitors[i];
+    if (i >= oldCount) {
+      InitArena(&monitor->arena);
+      monitor->root = NewMonitorRoot(monitor);
+      InitHitIndex(&monitor->hitIndex, monitor->root);
+      InitPlacements(&monitor->placements);
+    } else if (monitor->hMonitor == NULL) {
+      // Unplugged; when it comes back its bounds are taken to have changed.
+      monitor->changed = true;
+    }
   }
 }
 
-struct Cell *NewCell() {
-  struct Cell *cell = Allocate(struct Cell);
-  cell->bin.onInputFn = CellInput;
-  cell->bin.onDrawFn = CellDraw;
-  cell->bin.onLayoutFn = CellLayout;
-  cell->bin.onDestroyFn = CellDestroy;
-  return cell;
-}
-
-struct Bin *ShelfGet(struct Shelf *shelf, int slot) {
-  AssertNotNull(shelf);
-  AssertNotNull(shelf->bins);
-  AssertIndex(slot, shelf->slotCount);
-
-  return shelf->bins[slot];
+struct Monitor *FindMonitor(HMONITOR hMonitor) {
+  for (int i = 0; i < monitorCount; i++)
+    if (monitors[i].hMonitor == hMonitor)
+      return &monitors[i];
+  return NULL;
 }
 
-void ShelfPut(struct Shelf *shelf, int slot, struct Bin *bin) {
-  AssertNotNull(shelf);
-  AssertNotNull(shelf->bins);
-  AssertIndex(slot, shelf->slotCount);
-
-  AssertNull(shelf->bins[slot]);
-
-  shelf->bins[slot] = bin;
+struct Monitor *GetMonitorAtCursor() {
+  POINT mousePoint = {};
+  CheckWin32(GetCursorPos(&mousePoint));
 
-  if (bin != NULL) {
-    bin->bounds = ShelfMakeCellBounds(shelf, slot);
-    if (bin->onLayoutFn)
-      bin->onLayoutFn(bin);
+  HMONITOR hMonitor = MonitorFromPoint(mousePoint, MONITOR_DEFAULTTONULL);
+  if (hMonitor == NULL) {
+    ReportError("Mouse position %d %d was not over any monitor", mousePoint.x, mousePoint.y);
+    return NULL;
   }
-}
 
-void ShelfClear(struct Shelf *shelf, int slot) {
-  AssertNotNull(shelf);
-  AssertNotNull(shelf->bins);
-  AssertIndex(slot, shelf->slotCount);
-
-  struct Bin *bin = shelf->bins[slot];
-  if (bin != NULL) {
-    if (bin->onDestroyFn != NULL)
-      bin->onDestroyFn(bin);
-
-    free(bin);
-    shelf->bins[slot] = NULL;
+  // A display that has just changed may not have been announced yet.
+  struct Monitor *monitor = FindMonitor(hMonitor);
+  if (monitor == NULL) {
+    EnumerateMonitors();
+    monitor = FindMonitor(hMonitor);
   }
+  return monitor;
 }
 
-void ShelfInsert(struct Shelf *shelf, int newSlot) {
-  AssertNotNull(shelf);
-  AssertIndex(newSlot, shelf->slotCount + 1);
-
-  struct Bin **oldBins = shelf->bins;
-  AssertNotNull(oldBins);
-
-  shelf->slotCount += 1;
-  shelf->bins = AllocateArray(struct Bin *, shelf->slotCount);
-
-  for (int slot = 0; slot < newSlot; slot++)
-    ShelfPut(shelf, slot, oldBins[slot]);
-
-  struct Cell *newCell = NewCell();
-  struct Bin *newBin = Wrap(newCell, bin);
-  ShelfPut(shelf, newSlot, newBin);
+// The part of the monitor the overlay covers and the tree is laid out in.
+struct Bounds MonitorLayoutBounds(struct Monitor *monitor) {
+  struct Bounds bounds = monitor->bounds;
 
-  for (int slot = newSlot + 1; slot < shelf->slotCount; slot++)
-    ShelfPut(shelf, slot, oldBins[slot - 1]);
+#if HALF_MONITOR
+  bounds.width = bounds.width / 2;
+  bounds.x += bounds.width;
+#endif
 
-  free(oldBins);
+  return bounds;
 }
 
-void ShelfDelete(struct Shelf *shelf, int oldSlot) {
-  AssertNotNull(shelf);
-  AssertIndex(oldSlot, shelf->slotCount);
-
-  ShelfClear(shelf, oldSlot);
-
-  struct Bin **oldBins = shelf->bins;
-  AssertNotNull(oldBins);
-
-  shelf->slotCount -= 1;
-  shelf->bins = AllocateArray(struct Bin *, shelf->slotCount);
+// Sets the dimensions to the monitor's scale. Laying out another monitor changes them, so whatever records or hit tests
+// the overlay's tree selects its monitor first.
+void SelectMonitor(struct Monitor *monitor) { SelectRootScale(monitor->root, monitor->scale, &monitor->layoutScale); }
 
-  for (int slot = 0; slot < oldSlot; slot++)
-    ShelfPut(shelf, slot, oldBins[slot]);
+void LayoutMonitor(struct Monitor *monitor) {
+  LayoutRootAtScale(monitor->root, MonitorLayoutBounds(monitor), monitor->scale, &monitor->layoutScale);
+}
 
-  for (int slot = oldSlot; slot < shelf->slotCount; slot++)
-    ShelfPut(shelf, slot, oldBins[slot + 1]);
+// Patches the monitor's tree to match its entry in the layout file, so that only the bins that changed are rebuilt and
+// laid out, and only their windows placed, in one batch.
+void PatchMonitorRoot(struct Monitor *monitor, struct LayoutMonitor *entry, struct PatchStats *stats) {
+  char *names;
+  struct Bin *next = BuildLayoutTree(entry, &monitor->arena, &names);
+  struct Bin *root = PatchTree(monitor->root, next, stats);
+
+  // The tree's cell names now point into the new names, not the old ones or the snapshot.
+  CloseSnapshot(&monitor->snapshot);
+  FreeBytes(monitor->layoutNames);
+  monitor->layoutNames = names;
+  monitor->layoutHash = entry->hash;
+
+  if (root != monitor->root || stats->added > 0 || stats->removed > 0) {
+    ReleaseHitIndex(&monitor->hitIndex);
+    monitor->root = root;
+    InitHitIndex(&monitor->hitIndex, root);
+  }
 
-  free(oldBins);
+  // An unplugged monitor's tree is laid out when the monitor comes back.
+  if (monitor->hMonitor != NULL) {
+    LayoutMonitor(monitor);
+    ApplyPlacements(&monitor->placements, root);
+  }
 }
 
-struct Bounds ShelfMakeCellBounds(struct Shelf *shelf, int slot) {
-  AssertNotNull(shelf);
-  AssertIndex(slot, shelf->slotCount);
-
-  AssertGreater(shelf->slotCount, 0);
+void PickOnDeckWindow() {
+  POINT mousePoint = {};
+  CheckWin32(GetCursorPos(&mousePoint));
 
-  struct Bounds bounds;
+  onDeck.placement = {100, 100, 800, 600};
 
-  if (shelf->direction == ShelfDirection_Vertical) {
-    bounds.width = shelf->bin.bounds.width - 2 * Dimension_BorderInset;
-    bounds.height = (shelf->bin.bounds.height - (shelf->slotCount + 1) * Dimension_BorderInset) / shelf->slotCount;
-    bounds.x = shelf->bin.bounds.x + Dimension_BorderInset;
-    bounds.y = shelf->bin.bounds.y + slot * (bounds.height + Dimension_BorderInset) + Dimension_BorderInset;
-  } else {
-    bounds.width = (shelf->bin.bounds.width - (shelf->slotCount + 1) * Dimension_BorderInset) / shelf->slotCount;
-    bounds.height = shelf->bin.bounds.height - 2 * Dimension_BorderInset;
-    bounds.x = shelf->bin.bounds.x + slot * (bounds.width + Dimension_BorderInset) + Dimension_BorderInset;
-    bounds.y = shelf->bin.bounds.y + Dimension_BorderInset;
-  }
+  HWND hWnd = WindowFromPoint(mousePoint);
+  onDeck.hWnd = GetAncestor(hWnd, GA_ROOT);
+}
 
+struct Bounds Win32WindowBounds(HWND hWnd) {
+  RECT rc = {};
+  GetWindowRect(hWnd, &rc);
+  struct Bounds bounds = {rc.left, rc.top, rc.right - rc.left, rc.bottom - rc.top};
   return bounds;
 }
 
-void ShelfDraw(struct Bin *bin) {
-  AssertNotNull(bin);
-
-  struct Shelf *shelf = Unwrap(struct Shelf, bin, bin);
-
-  for (int slot = 0; slot < shelf->slotCount; slot++) {
-    struct Bin *bin = ShelfGet(shelf, slot);
-    if (bin->onDrawFn)
-      bin->onDrawFn(bin);
-  }
+int Win32WindowFlags(HWND hWnd) {
+  return (IsWindowVisible(hWnd) ? TrackedWindow_Visible : 0) | (IsIconic(hWnd) ? TrackedWindow_Minimized : 0);
 }
 
-void ShelfInput(struct Bin *bin) {
-  AssertNotNull(bin);
+// Sends new windows to named cells: the cell, then patterns for the window's class, title and process name, with NULL
+// matching anything. The first rule that matches wins.
+const char *placementRules[][RuleField_Count + 1] = {
+    {"right", NULL, NULL, "(?i)^notepad\\.exe$"},
+};
+
+struct RuleSet windowRules;
+struct Void desktopVoid;
 
-  struct Shelf *shelf = Unwrap(struct Shelf, bin, bin);
+void Win32ProcessName(HWND hWnd, char *name, DWORD size) {
+  name[0] = '\0';
+  DWORD processId = 0;
+  GetWindowThreadProcessId(hWnd, &processId);
+  HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
+  if (process == NULL)
+    return;
 
-  shelf->hoverSlot = -1;
+  char path[MAX_PATH];
+  DWORD pathSize = MAX_PATH;
+  if (QueryFullProcessImageNameA(process, 0, path, &pathSize)) {
+    const char *slash = strrchr(path, '\\');
+    strncpy(name, slash != NULL ? slash + 1 : path, size - 1);
+    name[size - 1] = '\0';
+  }
+  CloseHandle(process);
+}
 
-  for (int slot = 0; slot < shelf->slotCount; slot++) {
-    struct Bounds bounds = ShelfMakeCellBounds(shelf, slot);
-    if (PointInBounds(newInput.position, bounds)) {
-      shelf->hoverSlot = slot;
-    }
+// Matches a window against the placement rules and puts it in the named cell if it is in no cell yet and the cell is
+// free. Once a window has been matched, a title change matches only the title again, so the class and process name are
+// not looked up.
+void Win32ApplyRules(HWND hWnd, bool titleChanged) {
+  char className[256];
+  char title[256];
+  char process[MAX_PATH];
+  const char *texts[RuleField_Count] = {};
+  if (!titleChanged || !WindowRulesKnown(&windowRules, hWnd)) {
+    GetClassNameA(hWnd, className, sizeof(className));
+    Win32ProcessName(hWnd, process, sizeof(process));
+    texts[RuleField_Class] = className;
+    texts[RuleField_Process] = process;
   }
+  GetWindowTextA(hWnd, title, sizeof(title));
+  texts[RuleField_Title] = title;
 
-  if (shelf->hoverSlot != -1) {
-    struct Bin *hoverBin = ShelfGet(shelf, shelf->hoverSlot);
-    if (hoverBin != NULL) {
-      if (hoverBin->onInputFn)
-        hoverBin->onInputFn(hoverBin);
-    }
+  int rule = MatchWindowRules(&windowRules, hWnd, texts);
+  if (rule < 0 || WindowCell(hWnd) != NULL)
+    return;
 
-    if (!newInput.used) {
-      if (newInput.key == 'X') {
-        if (shelf->slotCount > 1) {
-          ShelfDelete(shelf, shelf->hoverSlot);
-          newInput.used = true;
-        }
-        // Pass other cases up to the parent to deal with.
-      }
-
-      if (newInput.key == 'H') {
-        if (shelf->direction == ShelfDirection_Horizontal) {
-          ShelfInsert(shelf, shelf->hoverSlot);
-          newInput.used = true;
-        } else {
-          ShelfClear(shelf, shelf->hoverSlot);
-          struct Shelf *newShelf = NewShelf(ShelfDirection_Horizontal, 2);
-          struct Bin *newBin = Wrap(newShelf, bin);
-          ShelfPut(shelf, shelf->hoverSlot, newBin);
-          newInput.used = true;
-        }
-      }
-
-      if (newInput.key == 'V') {
-        if (shelf->direction == ShelfDirection_Vertical) {
-          ShelfInsert(shelf, shelf->hoverSlot);
-          newInput.used = true;
-        } else {
-          ShelfClear(shelf, shelf->hoverSlot);
-          struct Shelf *newShelf = NewShelf(ShelfDirection_Vertical, 2);
-          struct Bin *newBin = Wrap(newShelf, bin);
-          ShelfPut(shelf, shelf->hoverSlot, newBin);
-          newInput.used = true;
-        }
-      }
+  for (int i = 0; i < monitorCount; i++) {
+    struct Monitor *monitor = &monitors[i];
+    if (monitor->hMonitor == NULL)
+      continue;
+    struct Cell *cell = FindNamedCell(monitor->root, RuleCellName(&windowRules, rule));
+    if (cell == NULL || cell->hWnd != NULL || cell->subBin != NULL)
+      continue;
+
+    if (SHOW_RULE_MATCHES) {
+      char message[512];
+      snprintf(message, sizeof(message), "rule %d sends \"%s\" to %s\n", rule, title, cell->name);
+      OutputDebugStringA(message);
     }
+    CellSetWindow(cell, hWnd);
+    LayoutMonitor(monitor);
+    ApplyPlacements(&monitor->placements, monitor->root);
+    return;
   }
 }
 
-void ShelfLayout(struct Bin *bin) {
-  AssertNotNull(bin);
-
-  struct Shelf *shelf = Unwrap(struct Shelf, bin, bin);
+// The events also arrive for child windows, carets, cursors and so on; only top level windows are tracked. A destroyed
+// or moved window is only looked up in the tracker, so windows it does not know cost no calls at all.
+void CALLBACK Win32WindowEvent(HWINEVENTHOOK hook, DWORD event, HWND hWnd, LONG idObject, LONG idChild, DWORD thread,
+                               DWORD time) {
+  if (hWnd == NULL || idObject != OBJID_WINDOW || idChild != CHILDID_SELF)
+    return;
 
-  for (int slot = 0; slot < shelf->slotCount; slot++) {
-    struct Bin *bin = ShelfGet(shelf, slot);
-    if (bin != NULL) {
-      bin->bounds = ShelfMakeCellBounds(shelf, slot);
-      if (bin->onLayoutFn != NULL)
-        bin->onLayoutFn(bin);
+  switch (event) {
+  case EVENT_OBJECT_CREATE:
+    if (GetAncestor(hWnd, GA_ROOT) == hWnd)
+      TrackWindow(hWnd, Win32WindowBounds(hWnd), Win32WindowFlags(hWnd));
+    break;
+  case EVENT_OBJECT_SHOW:
+    if (GetAncestor(hWnd, GA_ROOT) == hWnd) {
+      TrackWindow(hWnd, Win32WindowBounds(hWnd), Win32WindowFlags(hWnd));
+      Win32ApplyRules(hWnd, false);
     }
+    break;
+  case EVENT_OBJECT_NAMECHANGE:
+    if (FindTrackedWindow(hWnd) != NULL)
+      Win32ApplyRules(hWnd, true);
+    break;
+  case EVENT_OBJECT_DESTROY:
+    TrackWindowDestroyed(hWnd);
+    ForgetWindowRules(&windowRules, hWnd);
+    ForgetParkedWindow(&desktopVoid, hWnd);
+    break;
+  case EVENT_OBJECT_HIDE:
+    TrackWindowFlags(hWnd, 0, TrackedWindow_Visible);
+    break;
+  case EVENT_OBJECT_LOCATIONCHANGE:
+    if (FindTrackedWindow(hWnd) != NULL)
+      TrackWindowMoved(hWnd, Win32WindowBounds(hWnd));
+    break;
+  case EVENT_SYSTEM_MINIMIZESTART:
+    TrackWindowFlags(hWnd, TrackedWindow_Minimized, 0);
+    break;
+  case EVENT_SYSTEM_MINIMIZEEND:
+    TrackWindowFlags(hWnd, 0, TrackedWindow_Minimized);
+    break;
+  case EVENT_SYSTEM_FOREGROUND:
+    TrackForeground(hWnd);
+    break;
+  default:
+    break;
   }
 }
 
-void ShelfDestroy(struct Bin *bin) {
-  AssertNotNull(bin);
-
-  struct Shelf *shelf = Unwrap(struct Shelf, bin, bin);
-
-  for (int slot = 0; slot < shelf->slotCount; slot++)
-    ShelfClear(shelf, slot);
-
-  free(shelf->bins);
+BOOL CALLBACK Win32SeedWindow(HWND hWnd, LPARAM lParam) {
+  if (IsWindowVisible(hWnd))
+    TrackWindow(hWnd, Win32WindowBounds(hWnd), Win32WindowFlags(hWnd));
+  return TRUE;
 }
 
-struct Shelf *NewShelf(enum ShelfDirection direction, int count) {
-  struct Shelf *shelf = Allocate(struct Shelf);
-  shelf->bin.onDrawFn = ShelfDraw;
-  shelf->bin.onInputFn = ShelfInput;
-  shelf->bin.onLayoutFn = ShelfLayout;
-  shelf->bin.onDestroyFn = ShelfDestroy;
-
-  shelf->direction = direction;
-
-  shelf->slotCount = count;
-  shelf->bins = AllocateArray(struct Bin *, shelf->slotCount);
-
-  for (int slot = 0; slot < shelf->slotCount; slot++) {
-    struct Cell *newCell = NewCell();
-    struct Bin *newBin = Wrap(newCell, bin);
-    ShelfPut(shelf, slot, newBin);
+HWINEVENTHOOK windowHooks[4];
+
+// The layout file's rules replace the built in ones when it has any. Its patterns were checked when it was read.
+void LoadWindowRules() {
+  InitRuleSet(&windowRules);
+  if (layout.ruleCount > 0) {
+    for (int rule = 0; rule < layout.ruleCount; rule++) {
+      char error[256];
+      const char **patterns = layout.rules[rule].patterns;
+      if (!AddRule(&windowRules, layout.rules[rule].cell, patterns[RuleField_Class], patterns[RuleField_Title],
+                   patterns[RuleField_Process], error, sizeof(error)))
+        ReportError("Layout rule %d was ignored: %s", rule, error);
+    }
+    return;
   }
 
-  return shelf;
+  for (size_t rule = 0; rule < sizeof(placementRules) / sizeof(placementRules[0]); rule++) {
+    char error[256];
+    const char **patterns = placementRules[rule];
+    if (!AddRule(&windowRules, patterns[0], patterns[1], patterns[2], patterns[3], error, sizeof(error)))
+      ReportError("Placement rule %d was ignored: %s", (int)rule, error);
+  }
 }
 
-struct Grid {
-  struct Bin bin;
-
-  int rowCount;
-  int columnCount;
-
-  int hoverRow;
-  int hoverColumn;
-
-  struct Bin **bins;
-};
-
-struct Grid *NewGrid();
-struct Bounds GridMakeCellBounds(struct Grid *grid, int row, int column);
-
-struct Bin *Grid(struct Grid *grid, int row, int column) {
-  AssertNotNull(grid);
-  AssertNotNull(grid->bins);
-  AssertIndex(row, grid->rowCount);
-  AssertIndex(column, grid->columnCount);
-
-  int index = grid->columnCount * row + column;
+// Seeds the tracker with the windows already open, then keeps it current from events delivered to this thread's
+// message loop.
+void StartWindowTracking() {
+  LoadWindowRules();
+  InitVoid(&desktopVoid, MakePoint(VOID_OFFSCREEN, VOID_OFFSCREEN));
+
+  DWORD flags = WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS;
+  windowHooks[0] = SetWinEventHook(EVENT_OBJECT_CREATE, EVENT_OBJECT_HIDE, NULL, Win32WindowEvent, 0, 0, flags);
+  windowHooks[1] = SetWinEventHook(EVENT_OBJECT_LOCATIONCHANGE, EVENT_OBJECT_NAMECHANGE, NULL, Win32WindowEvent, 0, 0,
+                                   flags);
+  windowHooks[2] = SetWinEventHook(EVENT_SYSTEM_MINIMIZESTART, EVENT_SYSTEM_MINIMIZEEND, NULL, Win32WindowEvent, 0, 0,
+                                   flags);
+  windowHooks[3] =
+      SetWinEventHook(EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND, NULL, Win32WindowEvent, 0, 0, flags);
+  for (int hook = 0; hook < 4; hook++)
+    CheckWin32(windowHooks[hook] != NULL);
+
+  EnumWindows(Win32SeedWindow, 0);
+  TrackForeground(GetForegroundWindow());
+}
 
-  return grid->bins[index];
+void StopWindowTracking() {
+  for (int hook = 0; hook < 4; hook++)
+    UnhookWinEvent(windowHooks[hook]);
+  while (NewestParkedWindow(&desktopVoid) != NULL)
+    RestoreParkedWindow(&desktopVoid, NewestParkedWindow(&desktopVoid));
+  ReleaseVoid(&desktopVoid);
+  ReleaseWindowTracker();
+  ReleaseRuleSet(&windowRules);
 }
 
-void GridPut(struct Grid *grid, int row, int column, struct Bin *bin) {
-  AssertNotNull(grid);
-  AssertNotNull(grid->bins);
-  AssertIndex(row, grid->rowCount);
-  AssertIndex(column, grid->columnCount);
+void ReleaseBackBuffer() {
+  if (draw.backDC == NULL)
+    return;
 
-  int index = grid->columnCount * row + column;
-  AssertNull(grid->bins[index]);
+  delete draw.g;
+  draw.g = NULL;
+  delete draw.surface;
+  draw.surface = NULL;
+  SelectObject(draw.backDC, draw.oldBitmap);
+  DeleteObject(draw.backBitmap);
+  DeleteDC(draw.backDC);
+  draw.backDC = NULL;
+  draw.backBitmap = NULL;
+  draw.backPixels = NULL;
+  draw.lastHash = 0;
+}
 
-  grid->bins[index] = bin;
+// Keeps one back buffer the size of the overlay, recreating it only when the size changes. Its contents are only
+// trusted once a full paint has been done, which ShowOverlay arranges.
+void PrepareBackBuffer(int width, int height) {
+  if (draw.backDC != NULL && draw.backWidth == width && draw.backHeight == height)
+    return;
 
-  if (bin != NULL) {
-    bin->bounds = GridMakeCellBounds(grid, row, column);
-    if (bin->onLayoutFn)
-      bin->onLayoutFn(bin);
+  ReleaseBackBuffer();
+
+  BITMAPINFO info = {};
+  info.bmiHeader.biSize = sizeof(info.bmiHeader);
+  info.bmiHeader.biWidth = width;
+  info.bmiHeader.biHeight = -height;
+  info.bmiHeader.biPlanes = 1;
+  info.bmiHeader.biBitCount = 32;
+  info.bmiHeader.biCompression = BI_RGB;
+
+  void *pixels = NULL;
+  draw.backDC = CreateCompatibleDC(NULL);
+  draw.backBitmap = CreateDIBSection(NULL, &info, DIB_RGB_COLORS, &pixels, NULL, 0);
+  CheckWin32(draw.backBitmap != NULL);
+  draw.backPixels = (unsigned int *)pixels;
+  draw.oldBitmap = SelectObject(draw.backDC, draw.backBitmap);
+  draw.backWidth = width;
+  draw.backHeight = height;
+
+  if (draw.layered) {
+    draw.surface = new Gdiplus::Bitmap(width, height, width * 4, PixelFormat32bppPARGB, (BYTE *)pixels);
+    draw.g = new Gdiplus::Graphics(draw.surface);
+  } else {
+    draw.g = new Gdiplus::Graphics(draw.backDC);
   }
+  draw.g->SetSmoothingMode(Gdiplus::SmoothingMode::SmoothingModeAntiAlias);
 }
 
-void GridClear(struct Grid *grid, int row, int column) {
-  AssertNotNull(grid);
-  AssertNotNull(grid->bins);
-  AssertIndex(row, grid->rowCount);
-  AssertIndex(column, grid->columnCount);
-
-  int index = grid->columnCount * row + column;
-
-  struct Bin *bin = grid->bins[index];
-  if (bin != NULL) {
-    if (bin->onDestroyFn != NULL)
-      bin->onDestroyFn(bin);
+double RenderClock() {
+  LARGE_INTEGER frequency, now;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&now);
+  return (double)now.QuadPart / frequency.QuadPart;
+}
 
-    free(bin);
-    grid->bins[index] = NULL;
-  }
+void CountRender(double start, RECT paint) {
+  renderStats.paints++;
+  renderStats.lastPaintSeconds = RenderClock() - start;
+  renderStats.paintSeconds += renderStats.lastPaintSeconds;
+
+#if SHOW_RENDER_STATS
+  char line[256];
+  sprintf_s(line, "paint %lld: %dx%d in %.3f ms, %lld pixels in %.1f ms total\n", renderStats.paints,
+            paint.right - paint.left, paint.bottom - paint.top, renderStats.lastPaintSeconds * 1000,
+            renderStats.pixelsTouched, renderStats.paintSeconds * 1000);
+  OutputDebugStringA(line);
+#endif
 }
 
-void GridInsertRow(struct Grid *grid, int newRow) {
-  AssertNotNull(grid);
-  AssertIndex(newRow, grid->rowCount + 1);
+// Redraws the part of the back buffer inside paint, in client coordinates, unless it would be drawn with the same
+// commands as last time. Returns whether any pixels changed.
+bool RenderBackBuffer(RECT paint) {
+  RECT rc;
+  GetClientRect(overlay.hWnd, &rc);
+  PrepareBackBuffer(rc.right - rc.left, rc.bottom - rc.top);
 
-  struct Bin **oldBins = grid->bins;
-  AssertNotNull(oldBins);
+  int paintWidth = paint.right - paint.left;
+  int paintHeight = paint.bottom - paint.top;
 
-  grid->rowCount += 1;
-  grid->bins = AllocateArray(struct Bin *, grid->rowCount * grid->columnCount);
+  struct Bounds clip = {paint.left + overlay.bounds.x, paint.top + overlay.bounds.y, paintWidth, paintHeight};
+  SelectMonitor(overlay.monitor);
+  RecordRoot(overlay.monitor->root, clip, &draw.list);
+  unsigned long long hash = DrawListHash(&draw.list);
 
-  for (int column = 0; column < grid->columnCount; column++) {
-    for (int row = 0; row < newRow; row++)
-      GridPut(grid, row, column, oldBins[grid->columnCount * row + column]);
+  if (hash == draw.lastHash && EqualRect(&paint, &draw.lastPaint)) {
+    renderStats.skippedPaints++;
+    return false;
+  }
 
-    struct Cell *newCell = NewCell();
-    struct Bin *newBin = Wrap(newCell, bin);
-    GridPut(grid, newRow, column, newBin);
+  unsigned int background = LAYERED_BACKGROUND;
+  if (!draw.layered) {
+    COLORREF color = GetSysColor(COLOR_WINDOW);
+    background = 0xff000000 | GetRValue(color) << 16 | GetGValue(color) << 8 | GetBValue(color);
+  }
 
-    for (int row = newRow + 1; row < grid->rowCount; row++)
-      GridPut(grid, row, column, oldBins[grid->columnCount * (row - 1) + column]);
+  if (draw.software) {
+    GdiFlush();
+    RasterAttach(draw.backPixels, draw.backWidth, draw.backHeight, MakePoint(overlay.bounds.x, overlay.bounds.y));
+    RasterSetClip(clip);
+    RasterClear(background);
+    SubmitDrawList(&draw.list);
+  } else {
+    draw.g->SetClip(Gdiplus::Rect(paint.left, paint.top, paintWidth, paintHeight));
+    draw.g->Clear(Gdiplus::Color((Gdiplus::ARGB)background));
+    SubmitDrawList(&draw.list);
+    draw.g->ResetClip();
+    draw.g->Flush(Gdiplus::FlushIntentionSync);
   }
 
-  free(oldBins);
+  renderStats.pixelsTouched += (long long)paintWidth * paintHeight;
+  draw.lastHash = hash;
+  draw.lastPaint = paint;
+  return true;
 }
 
-void GridDeleteRow(struct Grid *grid, int oldRow) {
-  AssertNotNull(grid);
-  AssertIndex(oldRow, grid->rowCount);
-
-  for (int column = 0; column < grid->columnCount; column++)
-    GridClear(grid, oldRow, column);
+// Redraws the damaged part of a per-pixel alpha overlay and pushes just that part to the screen. Input that leaves
+// the commands unchanged, such as moving within a cell, never reaches the compositor.
+void PresentLayered() {
+  if (!overlay.isOpen || damage.rectCount == 0)
+    return;
 
-  struct Bin **oldBins = grid->bins;
-  AssertNotNull(oldBins);
+  double start = RenderClock();
 
-  grid->rowCount -= 1;
-  grid->bins = AllocateArray(struct Bin *, grid->rowCount * grid->columnCount);
+  struct Bounds dirty = damage.rects[0];
+  for (int rect = 1; rect < damage.rectCount; rect++)
+    dirty = BoundsUnion(dirty, damage.rects[rect]);
+  ClearDamage();
 
-  for (int column = 0; column < grid->columnCount; column++) {
-    for (int row = 0; row < oldRow; row++)
-      GridPut(grid, row, column, oldBins[grid->columnCount * row + column]);
+  RECT paint;
+  paint.left = max(dirty.x - overlay.bounds.x - DAMAGE_MARGIN, 0);
+  paint.top = max(dirty.y - overlay.bounds.y - DAMAGE_MARGIN, 0);
+  paint.right = min(dirty.x + dirty.width - overlay.bounds.x + DAMAGE_MARGIN, overlay.bounds.width);
+  paint.bottom = min(dirty.y + dirty.height - overlay.bounds.y + DAMAGE_MARGIN, overlay.bounds.height);
+  if (paint.left >= paint.right || paint.top >= paint.bottom)
+    return;
 
-    for (int row = oldRow; row < grid->rowCount; row++)
-      GridPut(grid, row, column, oldBins[grid->columnCount * (row + 1) + column]);
-  }
+  if (!RenderBackBuffer(paint))
+    return;
 
-  free(oldBins);
+  POINT source = {0, 0};
+  SIZE size = {draw.backWidth, draw.backHeight};
+  BLENDFUNCTION blend = {AC_SRC_OVER, 0, 255, AC_SRC_ALPHA};
+
+  UPDATELAYEREDWINDOWINFO info = {};
+  info.cbSize = sizeof(info);
+  info.hdcSrc = draw.backDC;
+  info.pptSrc = &source;
+  info.psize = &size;
+  info.pblend = &blend;
+  info.dwFlags = ULW_ALPHA;
+  info.prcDirty = &paint;
+  CheckWin32(UpdateLayeredWindowIndirect(overlay.hWnd, &info));
+
+  CountRender(start, paint);
 }
 
-void GridInsertColumn(struct Grid *grid, int newColumn) {
-  AssertNotNull(grid);
-  AssertIndex(newColumn, grid->columnCount + 1);
-
-  int oldColumnCount = grid->columnCount;
-  struct Bin **oldBins = grid->bins;
-  AssertNotNull(oldBins);
-
-  grid->columnCount += 1;
-  grid->bins = AllocateArray(struct Bin *, grid->rowCount * grid->columnCount);
+void ShowOverlay() {
+  overlay.monitor = GetMonitorAtCursor();
+  if (overlay.monitor == NULL)
+    return;
 
-  for (int row = 0; row < grid->rowCount; row++) {
-    for (int column = 0; column < newColumn; column++)
-      GridPut(grid, row, column, oldBins[oldColumnCount * row + column]);
+  overlay.bounds = MonitorLayoutBounds(overlay.monitor);
 
-    struct Cell *newCell = NewCell();
-    struct Bin *newBin = Wrap(newCell, bin);
-    GridPut(grid, row, newColumn, newBin);
+  SetWindowPos(overlay.hWnd, HWND_TOPMOST, overlay.bounds.x, overlay.bounds.y, overlay.bounds.width,
+               overlay.bounds.height, SWP_SHOWWINDOW);
 
-    for (int column = newColumn + 1; column < grid->columnCount; column++)
-      GridPut(grid, row, column, oldBins[oldColumnCount * row + column - 1]);
-  }
+  LayoutMonitor(overlay.monitor);
+  ApplyPlacements(&overlay.monitor->placements, overlay.monitor->root);
 
-  free(oldBins);
-}
+  overlay.inputTick = INPUT_TICK_MS / 1000.0;
+  if (INPUT_TICK_MS == 0)
+    overlay.inputTick = overlay.monitor->refreshRate > 1 ? 1.0 / overlay.monitor->refreshRate : 1 / 60.0;
 
-void GridDeleteColumn(struct Grid *grid, int oldColumn) {
-  AssertNotNull(grid);
-  AssertIndex(oldColumn, grid->columnCount);
+  SetResourceScale(&win32Resources, overlay.monitor->scale);
 
-  for (int row = 0; row < grid->rowCount; row++)
-    GridClear(grid, row, oldColumn);
+  // The back buffer may hold another monitor's tree, so the first paint is a full one.
+  draw.lastHash = 0;
+  ClearDamage();
+  overlay.isOpen = true;
 
-  int oldColumnCount = grid->columnCount;
-  struct Bin **oldBins = grid->bins;
-  AssertNotNull(oldBins);
+  if (draw.layered) {
+    DamageBounds(overlay.bounds);
+    PresentLayered();
+  } else {
+    InvalidateRect(overlay.hWnd, NULL, FALSE);
+  }
+}
 
-  grid->columnCount -= 1;
-  grid->bins = AllocateArray(struct Bin *, grid->rowCount * grid->columnCount);
+void HideOverlay() {
+  ShowWindow(overlay.hWnd, SW_HIDE);
 
-  for (int row = 0; row < grid->rowCount; row++) {
-    for (int column = 0; column < oldColumn; column++)
-      GridPut(grid, row, column, oldBins[oldColumnCount * row + column]);
+  overlay.isOpen = false;
+}
 
-    for (int column = oldColumn; column < grid->columnCount; column++)
-      GridPut(grid, row, column, oldBins[oldColumnCount * row + column + 1]);
+void InvalidateDamage() {
+  for (int rect = 0; rect < damage.rectCount; rect++) {
+    struct Bounds bounds = damage.rects[rect];
+    RECT rc;
+    rc.left = bounds.x - overlay.bounds.x - DAMAGE_MARGIN;
+    rc.top = bounds.y - overlay.bounds.y - DAMAGE_MARGIN;
+    rc.right = bounds.x + bounds.width - overlay.bounds.x + DAMAGE_MARGIN;
+    rc.bottom = bounds.y + bounds.height - overlay.bounds.y + DAMAGE_MARGIN;
+    InvalidateRect(overlay.hWnd, &rc, FALSE);
   }
+  ClearDamage();
+}
 
-  free(oldBins);
+// Hands the damage to whichever way the overlay reaches the screen.
+void PresentDamage() {
+  if (draw.layered)
+    PresentLayered();
+  else
+    InvalidateDamage();
 }
 
-struct Bounds GridMakeCellBounds(struct Grid *grid, int row, int column) {
-  AssertNotNull(grid);
-  AssertIndex(row, grid->rowCount);
-  AssertIndex(column, grid->columnCount);
+void ProcessOverlayInput() {
+  if (overlay.inputScheduled) {
+    KillTimer(overlay.hWnd, INPUT_TIMER_ID);
+    overlay.inputScheduled = false;
+  }
 
-  AssertGreater(grid->columnCount, 0);
-  AssertGreater(grid->rowCount, 0);
+  overlay.lastInput = RenderClock();
+  SelectMonitor(overlay.monitor);
+  if (ProcessInput(&overlay.monitor->hitIndex) == 0)
+    return;
 
-  struct Bounds bounds;
-  bounds.width = (grid->bin.bounds.width - (grid->columnCount + 1) * Dimension_BorderInset) / grid->columnCount;
-  bounds.height = (grid->bin.bounds.height - (grid->rowCount + 1) * Dimension_BorderInset) / grid->rowCount;
-  bounds.x = grid->bin.bounds.x + column * (bounds.width + Dimension_BorderInset) + Dimension_BorderInset;
-  bounds.y = grid->bin.bounds.y + row * (bounds.height + Dimension_BorderInset) + Dimension_BorderInset;
-  return bounds;
-}
+  ApplyPlacements(&overlay.monitor->placements, overlay.monitor->root);
+  PresentDamage();
 
-void GridDraw(struct Bin *bin) {
-  AssertNotNull(bin);
+#if SHOW_INPUT_STATS
+  char line[256];
+  sprintf_s(line, "input: %lld raw, %lld coalesced, %lld processed in %lld frames\n", inputStats.rawEvents,
+            inputStats.coalescedEvents, inputStats.processedEvents, inputStats.frames);
+  OutputDebugStringA(line);
+#endif
+}
 
-  struct Grid *grid = Unwrap(struct Grid, bin, bin);
+void ScheduleOverlayInput(bool full) {
+  double wait = overlay.lastInput + overlay.inputTick - RenderClock();
+  if (full || wait <= 0) {
+    ProcessOverlayInput();
+    return;
+  }
 
-  for (int row = 0; row < grid->rowCount; row++) {
-    for (int column = 0; column < grid->columnCount; column++) {
-      struct Bin *bin = Grid(grid, row, column);
-      if (bin->onDrawFn)
-        bin->onDrawFn(bin);
-    }
+  if (!overlay.inputScheduled) {
+    SetTimer(overlay.hWnd, INPUT_TIMER_ID, (UINT)(wait * 1000) + 1, NULL);
+    overlay.inputScheduled = true;
   }
 }
 
-void GridInput(struct Bin *bin) {
-  AssertNotNull(bin);
-
-  struct Grid *grid = Unwrap(struct Grid, bin, bin);
+// Brings each monitor's tree in line with the layout file just read, and the rules with its rules. Trees whose entry
+// is unchanged are left alone. The rules hold the old file's cell names, so they are always loaded again.
+void ApplyLayout(double changedAt, double parsedAt) {
+  struct PatchStats total = {};
+  int patched = 0;
+  for (int i = 0; i < monitorCount; i++) {
+    struct Monitor *monitor = &monitors[i];
+    struct LayoutMonitor *entry = FindLayoutMonitor(&layout, monitor->device);
+    if (entry == NULL || entry->hash == monitor->layoutHash)
+      continue;
+
+    struct PatchStats stats;
+    PatchMonitorRoot(monitor, entry, &stats);
+    total.kept += stats.kept;
+    total.added += stats.added;
+    total.removed += stats.removed;
+    total.renamed += stats.renamed;
+    total.windowsMoved += stats.windowsMoved;
+    patched++;
+  }
 
-  grid->hoverRow = -1;
-  grid->hoverColumn = -1;
+  ReleaseRuleSet(&windowRules);
+  LoadWindowRules();
 
-  for (int row = 0; row < grid->rowCount; row++) {
-    for (int column = 0; column < grid->columnCount; column++) {
-      struct Bounds bounds = GridMakeCellBounds(grid, row, column);
-      if (PointInBounds(newInput.position, bounds)) {
-        grid->hoverRow = row;
-        grid->hoverColumn = column;
-      }
-    }
+  if (overlay.isOpen && patched > 0) {
+    draw.lastHash = 0;
+    DamageBounds(overlay.bounds);
+    PresentDamage();
   }
 
-  if (grid->hoverRow != -1 && grid->hoverColumn != -1) {
-    struct Bin *hoverBin = Grid(grid, grid->hoverRow, grid->hoverColumn);
-    if (hoverBin != NULL) {
-      if (hoverBin->onInputFn)
-        hoverBin->onInputFn(hoverBin);
-    }
+#if SHOW_RELOAD_STATS
+  char line[256];
+  sprintf_s(line, "layout: %d monitors patched, %d bins kept, %d added, %d removed, %d renamed, %d windows moved; "
+                  "parsed in %.1f ms, applied %.1f ms after the change\n",
+            patched, total.kept, total.added, total.removed, total.renamed, total.windowsMoved,
+            (parsedAt - changedAt) * 1000, (FileWatchClock() - changedAt) * 1000);
+  OutputDebugStringA(line);
+#endif
+}
 
-    if (!newInput.used) {
-      if (newInput.key == 'X') {
-        if (grid->rowCount > 1 && grid->columnCount == 1) {
-          GridDeleteRow(grid, grid->hoverRow);
-          newInput.used = true;
-        } else if (grid->rowCount == 1 && grid->columnCount > 1) {
-          GridDeleteColumn(grid, grid->hoverColumn);
-          newInput.used = true;
-        }
-        // Pass other cases up to the parent to deal with.
-      }
-
-      if (newInput.key == 'H') {
-        GridClear(grid, grid->hoverRow, grid->hoverColumn);
-        struct Grid *newGrid = NewGrid();
-        struct Bin *newBin = Wrap(newGrid, bin);
-        GridPut(grid, grid->hoverRow, grid->hoverColumn, newBin);
-        newInput.used = true;
-      }
-
-      if (newInput.key == 'C' && !newInput.shift) {
-        GridInsertColumn(grid, grid->hoverColumn);
-        newInput.used = true;
-      }
-      if (newInput.key == 'C' && newInput.shift) {
-        if (grid->columnCount > 1)
-          GridDeleteColumn(grid, grid->hoverColumn);
-        newInput.used = true;
-      }
-
-      if (newInput.key == 'R' && !newInput.shift) {
-        GridInsertRow(grid, grid->hoverRow);
-        newInput.used = true;
-      }
-
-      if (newInput.key == 'R' && newInput.shift) {
-        if (grid->rowCount > 1)
-          GridDeleteRow(grid, grid->hoverRow);
-        newInput.used = true;
-      }
-    }
+void ReloadLayout() {
+  double start = FileWatchClock();
+  struct LayoutError error;
+  if (!ReadLayoutFile(&layout, LAYOUT_PATH, &error)) {
+    ReportLayoutError(&error);
+    return;
   }
+  ApplyLayout(start, FileWatchClock());
 }
 
-void GridLayout(struct Bin *bin) {
-  AssertNotNull(bin);
-
-  struct Grid *grid = Unwrap(struct Grid, bin, bin);
+// A layout file read and parsed on the watcher thread, handed to the overlay thread in a WM_LAYOUT_LOADED message.
+struct LayoutLoad {
+  bool parsed;
+  struct Layout layout;
+  struct LayoutError error;
+  double changedAt;
+  double parsedAt;
+};
 
-  for (int row = 0; row < grid->rowCount; row++) {
-    for (int column = 0; column < grid->columnCount; column++) {
-      struct Bin *bin = Grid(grid, row, column);
-      if (bin != NULL) {
-        bin->bounds = GridMakeCellBounds(grid, row, column);
-        if (bin->onLayoutFn != NULL)
-          bin->onLayoutFn(bin);
-      }
-    }
+struct FileWatcher *layoutWatcher;
+
+// Called on the watcher thread.
+void Win32LoadLayout(void *context, const char *path, double changedAt) {
+  struct LayoutLoad *load = Allocate(struct LayoutLoad);
+  InitLayout(&load->layout);
+  load->parsed = ReadLayoutFile(&load->layout, path, &load->error);
+  load->changedAt = changedAt;
+  load->parsedAt = FileWatchClock();
+  if (!PostMessage(overlay.hWnd, WM_LAYOUT_LOADED, 0, (LPARAM)load)) {
+    ReleaseLayout(&load->layout);
+    FreeBytes(load);
   }
 }
 
-void GridDestroy(struct Bin *bin) {
-  AssertNotNull(bin);
-
-  struct Grid *grid = Unwrap(struct Grid, bin, bin);
-
-  for (int row = 0; row < grid->rowCount; row++)
-    for (int column = 0; column < grid->columnCount; column++)
-      GridClear(grid, row, column);
-
-  free(grid->bins);
+// A file with a mistake in it changes nothing, and one that was deleted is ignored until it comes back.
+void OnLayoutLoaded(struct LayoutLoad *load) {
+  if (load->parsed) {
+    ReleaseLayout(&layout);
+    layout = load->layout;
+    ApplyLayout(load->changedAt, load->parsedAt);
+  } else if (load->error.line > 0) {
+    ReportLayoutError(&load->error);
+  }
+  FreeBytes(load);
 }
 
-struct Grid *NewGrid() {
-  struct Grid *grid = Allocate(struct Grid);
-  grid->bin.onDrawFn = GridDraw;
-  grid->bin.onInputFn = GridInput;
-  grid->bin.onLayoutFn = GridLayout;
-  grid->bin.onDestroyFn = GridDestroy;
-
-  grid->rowCount = 1;
-  grid->columnCount = 1;
-  grid->bins = AllocateArray(struct Bin *, 1);
+// The moves of every monitor reflowed after a display change, placed in one batch.
+struct PlacementList reflowBatch;
 
-  struct Cell *newCell = NewCell();
-  struct Bin *newBin = Wrap(newCell, bin);
-  GridPut(grid, 0, 0, newBin);
+// Lays out the tree of every monitor marked changed and places the windows of all of them together.
+int ReflowMonitors() {
+  reflowBatch.count = 0;
+  int reflowed = 0;
+  for (int i = 0; i < monitorCount; i++) {
+    struct Monitor *monitor = &monitors[i];
+    if (!monitor->changed || monitor->hMonitor == NULL)
+      continue;
 
-  return grid;
+    monitor->changed = false;
+    LayoutMonitor(monitor);
+    CollectPlacements(&monitor->placements, monitor->root, &reflowBatch);
+    reflowed++;
+  }
+  if (reflowBatch.count > 0)
+    PlaceWindows(reflowBatch.placements, reflowBatch.count);
+  return reflowed;
 }
 
-#define MONITOR_LIMIT 16
-
-struct Monitor {
-  HMONITOR hMonitor;
-  MONITORINFO info;
-  struct Bounds bounds;
-  struct Bin *root;
-};
-
-struct Monitor monitors[MAX_MONITORS];
-
-void UpdateMonitorInfo(struct Monitor *monitor) {
-  monitor->info = {sizeof(MONITORINFO)};
-  CheckWin32(GetMonitorInfo(monitor->hMonitor, &monitor->info));
+// Displays plugged in or out, resolution and DPI changes, and work area changes such as a moved task bar all come here.
+// The overlay closes if its monitor changed under it.
+void OnDisplayChange() {
+  double start = RenderClock();
+  EnumerateMonitors();
+  bool overlayMoved = overlay.isOpen && (overlay.monitor->hMonitor == NULL || overlay.monitor->changed);
+  int reflowed = ReflowMonitors();
+  if (overlayMoved) {
+    HideOverlay();
+    ClearOnDeckWindow();
+  }
 
-  monitor->bounds.x = monitor->info.rcWork.left;
-  monitor->bounds.y = monitor->info.rcWork.top;
-  monitor->bounds.width = monitor->info.rcWork.right - monitor->info.rcWork.left;
-  monitor->bounds.height = monitor->info.rcWork.bottom - monitor->info.rcWork.top;
+#if SHOW_DISPLAY_CHANGES
+  char line[256];
+  sprintf_s(line, "displays: %d monitors, %d reflowed, %d windows moved in %.1f ms\n", monitorCount, reflowed,
+            reflowBatch.count, (RenderClock() - start) * 1000);
+  OutputDebugStringA(line);
+#endif
 }
 
-struct Monitor *GetMonitorAtCursor() {
-  POINT mousePoint = {};
-  CheckWin32(GetCursorPos(&mousePoint));
-
-  HMONITOR hMonitor = MonitorFromPoint(mousePoint, MONITOR_DEFAULTTONULL);
-  if (hMonitor == NULL) {
-    ReportError("Mouse position %d %d was not over any monitor", mousePoint.x, mousePoint.y);
-    return NULL;
+// Called on a move worker; the completions are taken on the overlay thread.
+void Win32NotifyMoves() { PostMessage(overlay.hWnd, WM_MOVES_DONE, 0, 0); }
+
+void OnMovesDone() {
+  CheckMoveTimeouts();
+
+  struct MoveCompletion completions[64];
+  int count;
+  while ((count = TakeMoveCompletions(completions, 64)) > 0) {
+#if SHOW_MOVE_STATS
+    for (int index = 0; index < count; index++) {
+      struct MoveCompletion *completion = &completions[index];
+      if (completion->result == MoveResult_Done)
+        continue;
+      char line[256];
+      sprintf_s(line, "window %p %s after %.0f ms\n", completion->hWnd,
+                completion->result == MoveResult_TimedOut ? "stopped responding" : "recovered",
+                completion->seconds * 1000);
+      OutputDebugStringA(line);
+    }
+#endif
   }
+}
 
-  for (int i = 0; i < MONITOR_LIMIT; i++) {
-    struct Monitor *monitor = &monitors[i];
-    if (monitor->hMonitor == NULL) {
-      monitor->hMonitor = hMonitor;
-      monitor->root = Wrap(NewShelf(ShelfDirection_Horizontal, 2), bin);
-      UpdateMonitorInfo(monitor);
-      return monitor;
-    }
-    if (monitor->hMonitor == hMonitor) {
-      UpdateMonitorInfo(monitor);
-      return monitor;
-    }
+void OnOverlayMouse(UINT message, UINT buttons, int x, int y) {
+  if (!overlay.isOpen) {
+    ReportError("Overlay received a mouse event %d at %d %d when it was not open", message, x, y);
+    return;
   }
 
-  return NULL;
+  ScheduleOverlayInput(QueueMouse(MakePoint(x + overlay.bounds.x, y + overlay.bounds.y), buttons));
 }
 
-void PickOnDeckWindow() {
+// Parks or swaps the window of the cell under the cursor. Neither changes the cell's bounds, so the tree is left clean
+// and only the cell is redrawn.
+void OnVoidKey(UINT key) {
   POINT mousePoint = {};
   CheckWin32(GetCursorPos(&mousePoint));
+  SelectMonitor(overlay.monitor);
+  struct Bin *leaf = HitTestLeaf(&overlay.monitor->hitIndex, MakePoint(mousePoint.x, mousePoint.y));
+  struct Cell *cell = leaf != NULL ? BinCell(leaf) : NULL;
+  if (cell == NULL || cell->subBin != NULL)
+    return;
 
-  onDeck.placement = {100, 100, 800, 600};
+  bool changed = key == VOID_PARK_KEY ? ParkCellWindow(&desktopVoid, cell) : SwapParkedWindow(&desktopVoid, cell, NULL);
+  if (!changed)
+    return;
 
-  HWND hWnd = WindowFromPoint(mousePoint);
-  onDeck.hWnd = GetAncestor(hWnd, GA_ROOT);
+  DamageBounds(cell->bin.bounds);
+  PresentDamage();
 }
 
-void ClearOnDeckWindow() { onDeck.hWnd = NULL; }
-
-void PlaceOnDeckWindow() {
-  if (!onDeck.hWnd) {
-    ReportError("Tried to place the on deck window when none was active");
+void OnOverlayKey(UINT key) {
+  if (!overlay.isOpen) {
+    ReportError("Overlay received a key event %d when it was not open", key);
     return;
   }
 
-  SetWindowPos(onDeck.hWnd, NULL, onDeck.placement.x, onDeck.placement.y, onDeck.placement.width,
-               onDeck.placement.height, SWP_SHOWWINDOW);
-}
-
-void ShowOverlay() {
-  overlay.monitor = GetMonitorAtCursor();
-  if (overlay.monitor == NULL)
+  if (key == LAYOUT_RELOAD_KEY) {
+    ProcessOverlayInput();
+    ReloadLayout();
+    return;
+  }
+  if (key == VOID_PARK_KEY || key == VOID_SWAP_KEY) {
+    ProcessOverlayInput();
+    OnVoidKey(key);
     return;
-
-  overlay.bounds = overlay.monitor->bounds;
-
-#if HALF_MONITOR
-  overlay.bounds.width = overlay.bounds.width / 2;
-  overlay.bounds.x += overlay.bounds.width;
-#endif
-
-  SetWindowPos(overlay.hWnd, HWND_TOPMOST, overlay.bounds.x, overlay.bounds.y, overlay.bounds.width,
-               overlay.bounds.height, SWP_SHOWWINDOW);
-
-  struct Bin *rootBin = overlay.monitor->root;
-  if (rootBin) {
-    rootBin->bounds = overlay.bounds;
-    if (rootBin->onLayoutFn)
-      rootBin->onLayoutFn(rootBin);
   }
 
-  overlay.isOpen = true;
-}
-
-void HideOverlay() {
-  ShowWindow(overlay.hWnd, SW_HIDE);
-
-  overlay.isOpen = false;
+  bool shift = GetAsyncKeyState(VK_SHIFT) || GetAsyncKeyState(VK_LSHIFT);
+  ScheduleOverlayInput(QueueKey(key, shift));
 }
 
 void OnOverlayHotkey() {
@@ -1010,79 +1246,36 @@ void OnOverlayHotkey() {
     PickOnDeckWindow();
     ShowOverlay();
   } else {
+    ProcessOverlayInput();
     HideOverlay();
     ClearOnDeckWindow();
   }
 }
 
-void OnOverlayMouse(UINT message, UINT buttons, int x, int y) {
+void OnOverlayPaint() {
   if (!overlay.isOpen) {
-    ReportError("Overlay received a mouse event %d at %d %d when it was not open", message, x, y);
+    // ReportError("Overlay received a paint event");
     return;
   }
 
-  oldInput = newInput;
-  newInput.used = false;
-  newInput.sequence++;
-  newInput.position.x = x + overlay.bounds.x;
-  newInput.position.y = y + overlay.bounds.y;
-  newInput.buttons = buttons;
-  newInput.key = 0;
-
-  overlay.monitor->root->onInputFn(overlay.monitor->root);
-
-  InvalidateRect(overlay.hWnd, NULL, TRUE);
-}
-
-void OnOverlayKey(UINT key) {
-  if (!overlay.isOpen) {
-    ReportError("Overlay received a key event %d when it was not open", key);
+  // A per-pixel alpha overlay keeps what UpdateLayeredWindow last gave it, so there is nothing to paint.
+  if (draw.layered) {
+    ValidateRect(overlay.hWnd, NULL);
     return;
   }
 
-  oldInput = newInput;
-  newInput.used = false;
-  newInput.key = key;
-  newInput.shift = GetAsyncKeyState(VK_SHIFT) || GetAsyncKeyState(VK_LSHIFT);
-
-  overlay.monitor->root->onInputFn(overlay.monitor->root);
-
-  InvalidateRect(overlay.hWnd, NULL, TRUE);
-}
-
-void OnOverlayPaint() {
-  if (!overlay.isOpen) {
-    // ReportError("Overlay received a paint event");
-    return;
-  }
+  double start = RenderClock();
 
   draw.hdc = BeginPaint(overlay.hWnd, &draw.ps);
 
-  RECT rc;
-  GetClientRect(overlay.hWnd, &rc);
-
-  HDC hdcMem = CreateCompatibleDC(draw.hdc);
-  HBITMAP hbmMem = CreateCompatibleBitmap(draw.hdc, rc.right - rc.left, rc.bottom - rc.top);
-  SelectObject(hdcMem, hbmMem);
-
-  HBRUSH hbrBkGnd = CreateSolidBrush(GetSysColor(COLOR_WINDOW));
-  FillRect(hdcMem, &rc, hbrBkGnd);
-  DeleteObject(hbrBkGnd);
-
-  draw.g = new Gdiplus::Graphics(hdcMem);
-  draw.g->SetSmoothingMode(Gdiplus::SmoothingMode::SmoothingModeAntiAlias);
-
-  overlay.monitor->root->onDrawFn(overlay.monitor->root);
-
-  delete draw.g;
-  draw.g = NULL;
-
-  BitBlt(draw.hdc, rc.left, rc.top, rc.right - rc.left, rc.bottom - rc.top, hdcMem, 0, 0, SRCCOPY);
-
-  DeleteObject(hbmMem);
-  DeleteDC(hdcMem);
+  RECT paint = draw.ps.rcPaint;
+  RenderBackBuffer(paint);
+  BitBlt(draw.hdc, paint.left, paint.top, paint.right - paint.left, paint.bottom - paint.top, draw.backDC, paint.left,
+         paint.top, SRCCOPY);
 
   EndPaint(overlay.hWnd, &draw.ps);
+
+  CountRender(start, paint);
 }
 
 LRESULT CALLBACK OverlayWindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
@@ -1105,6 +1298,36 @@ LRESULT CALLBACK OverlayWindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARA
     OnOverlayKey((UINT)wParam);
     break;
 
+  case WM_TIMER:
+    if (wParam == INPUT_TIMER_ID && overlay.isOpen) {
+      ProcessOverlayInput();
+      return 0;
+    }
+    if (wParam == MOVE_TIMER_ID) {
+      OnMovesDone();
+      return 0;
+    }
+    break;
+
+  case WM_MOVES_DONE:
+    OnMovesDone();
+    return 0;
+
+  case WM_LAYOUT_LOADED:
+    OnLayoutLoaded((struct LayoutLoad *)lParam);
+    return 0;
+
+  // The overlay places itself, so the size suggested with WM_DPICHANGED is not wanted.
+  case WM_DISPLAYCHANGE:
+  case WM_DPICHANGED:
+    OnDisplayChange();
+    return 0;
+
+  case WM_SETTINGCHANGE:
+    if (wParam == SPI_SETWORKAREA)
+      OnDisplayChange();
+    break;
+
   case WM_ERASEBKGND:
     return TRUE;
 
@@ -1139,7 +1362,9 @@ void CreateOverlay() {
                               rc.bottom - rc.top, NULL, NULL, win.hInst, NULL);
 
   SetWindowLong(overlay.hWnd, GWL_EXSTYLE, GetWindowLong(overlay.hWnd, GWL_EXSTYLE) | WS_EX_LAYERED);
-  SetLayeredWindowAttributes(overlay.hWnd, 0, OVERLAY_ALPHA, LWA_ALPHA);
+  // A window given constant alpha can no longer be updated with UpdateLayeredWindow.
+  if (!draw.layered)
+    SetLayeredWindowAttributes(overlay.hWnd, 0, OVERLAY_ALPHA, LWA_ALPHA);
 
   CheckWin32(RegisterHotKey(overlay.hWnd, HOTKEY_ID, HOTKEY_META, HOTKEY_CODE));
 }
@@ -1147,12 +1372,53 @@ void CreateOverlay() {
 int CALLBACK WinMain(_In_ HINSTANCE hInstance, _In_ HINSTANCE hPrevInstance, _In_ LPSTR lpCmdLine, _In_ int nCmdShow) {
   SetProcessDpiAwareness((PROCESS_DPI_AWARENESS)PROCESS_PER_MONITOR_DPI_AWARE);
 
+  backend = &win32Backend;
+
+  // The software renderer draws with the rasterizer but still moves windows through Win32.
+  struct Backend win32SoftwareBackend = rasterBackend;
+  if (strstr(lpCmdLine, "--software") != NULL) {
+    win32SoftwareBackend.name = "win32-software";
+    win32SoftwareBackend.placeWindowFn = Win32PlaceWindow;
+    win32SoftwareBackend.placeWindowsFn = Win32PlaceWindows;
+    win32SoftwareBackend.stackWindowsFn = Win32StackWindows;
+    backend = &win32SoftwareBackend;
+    draw.software = true;
+  }
+  draw.layered = strstr(lpCmdLine, "--layered") != NULL;
+
   Gdiplus::GdiplusStartupInput gdiplusStartupInput;
   ULONG_PTR gdiplusToken;
   GdiplusStartup(&gdiplusToken, &gdiplusStartupInput, NULL);
 
+  draw.fontFamily = new Gdiplus::FontFamily(L"Times New Roman");
+  draw.textBrush = new Gdiplus::SolidBrush(Gdiplus::Color(255, 0, 0, 0));
+  draw.path = new Gdiplus::GraphicsPath();
+
   CreateOverlay();
 
+  InitLayout(&layout);
+  struct LayoutError layoutError;
+  if (!ReadLayoutFile(&layout, LAYOUT_PATH, &layoutError) && layoutError.line > 0)
+    ReportLayoutError(&layoutError);
+  layoutWatcher = StartFileWatcher(LAYOUT_PATH, LAYOUT_DEBOUNCE_MS / 1000.0, Win32LoadLayout, NULL);
+  if (layoutWatcher == NULL)
+    ReportError("Changes to %s will not be picked up until F5 is pressed", LAYOUT_PATH);
+
+  EnumerateMonitors();
+  ReflowMonitors();
+
+  StartWindowTracking();
+
+  // Every move, batch and restack goes through the workers, which make them with the backend's own functions.
+  struct Backend windows = *backend;
+  if (MOVE_WORKERS > 0) {
+    StartMoveWorkers(MOVE_WORKERS, MOVE_TIMEOUT_MS / 1000.0, &windows, Win32NotifyMoves);
+    backend->placeWindowFn = QueueWindowMove;
+    backend->placeWindowsFn = QueueWindowMoves;
+    backend->stackWindowsFn = QueueWindowStackings;
+    SetTimer(overlay.hWnd, MOVE_TIMER_ID, MOVE_TIMEOUT_MS, NULL);
+  }
+
   for (;;) {
     MSG msg;
     BOOL result = GetMessage(&msg, NULL, 0, 0);
@@ -1164,6 +1430,22 @@ int CALLBACK WinMain(_In_ HINSTANCE hInstance, _In_ HINSTANCE hPrevInstance, _In
     DispatchMessage(&msg);
   }
 
+  StopFileWatcher(layoutWatcher);
+  StopMoveWorkers();
+  // Parked windows are put back on the way out without the workers.
+  backend->placeWindowFn = windows.placeWindowFn;
+  backend->placeWindowsFn = windows.placeWindowsFn;
+  backend->stackWindowsFn = windows.stackWindowsFn;
+  SaveMonitorLayouts();
+  StopWindowTracking();
+  ReleasePlacementList(&reflowBatch);
+  ReleaseLayout(&layout);
+  ReleaseBackBuffer();
+  FlushResources(&win32Resources);
+  ReleaseDrawList(&draw.list);
+  delete draw.path;
+  delete draw.textBrush;
+  delete draw.fontFamily;
   Gdiplus::GdiplusShutdown(gdiplusToken);
 
   return 0;